@@ -117,3 +117,19 @@ swTestDeclare(DictionaryTestPop, NULL, NULL, swTestRun)
 
 swTestSuiteStructDeclare(DynamicArrayDictionaryTest, dictionaryTestSuiteSetup, dictionaryTestSuiteTeardown, swTestRun,
                          &DictionaryTestVerify, &DictionaryTestPop);
+
+// the fields are set by init whatever was in the memory before
+swTestDeclare(InitOnGarbageTest, NULL, NULL, swTestRun)
+{
+  swDynamicArray array;
+  memset(&array, 0xff, sizeof(array));
+  ASSERT_TRUE(swDynamicArrayInit(&array, sizeof(uint64_t), 4));
+  ASSERT_FALSE(array.hugePages);
+  ASSERT_FALSE(array.hugePageBacked);
+  ASSERT_EQUAL(swDynamicArrayCount(array), 0);
+  ASSERT_EQUAL(swDynamicArraySize(array), 4);
+  swDynamicArrayRelease(&array);
+  return true;
+}
+
+swTestSuiteStructDeclare(DynamicArrayInitTest, NULL, NULL, swTestRun, &InitOnGarbageTest);
@@ -2,6 +2,7 @@
 
 #include "collections/dynamic-array.h"
 #include "collections/hash-common.h"
+#include "core/huge-page.h"
 #include "core/memory.h"
 
 #define swDynamicArrayGetNextFreePtr(d) (d->data + (d->count * d->elementSize))
@@ -21,16 +22,60 @@ swDynamicArray *swDynamicArrayNew(size_t elementSize, uint32_t size)
   return rtn;
 }
 
+static void swDynamicArrayDataFree(swDynamicArray *array)
+{
+  if (array->hugePageBacked)
+    swHugePageFree(array->data, array->elementSize * array->size);
+  else
+    swMemoryFree(array->data);
+  array->data = NULL;
+  array->hugePageBacked = false;
+}
+
 void swDynamicArrayDelete(swDynamicArray *array)
 {
   if (array)
   {
     if (array->data)
-      swMemoryFree(array->data);
+      swDynamicArrayDataFree(array);
     swMemoryFree(array);
   }
 }
 
+// regular memory is reallocated in place, huge page memory is copied
+static bool swDynamicArrayDataResize(swDynamicArray *dynamicArray, uint32_t newSize)
+{
+  bool rtn = false;
+  size_t newDataSize = dynamicArray->elementSize * newSize;
+  bool hugePageBacked = dynamicArray->hugePages && (newDataSize >= swHugePageSizeGet());
+  if (!hugePageBacked && !dynamicArray->hugePageBacked)
+  {
+    uint8_t *newData = swMemoryRealloc(dynamicArray->data, newDataSize);
+    if (newData)
+    {
+      dynamicArray->data = newData;
+      rtn = true;
+    }
+  }
+  else
+  {
+    uint8_t *newData = (hugePageBacked)? swHugePageAlloc(newDataSize, NULL) : swMemoryMalloc(newDataSize);
+    if (newData)
+    {
+      if (dynamicArray->data)
+      {
+        uint32_t count = (dynamicArray->count < newSize)? dynamicArray->count : newSize;
+        memcpy(newData, dynamicArray->data, dynamicArray->elementSize * count);
+        swDynamicArrayDataFree(dynamicArray);
+      }
+      dynamicArray->data = newData;
+      dynamicArray->hugePageBacked = hugePageBacked;
+      rtn = true;
+    }
+  }
+  return rtn;
+}
+
 static bool swDynamicArrayResize(swDynamicArray *dynamicArray, uint32_t index)
 {
   bool rtn = false;
@@ -39,10 +84,8 @@ static bool swDynamicArrayResize(swDynamicArray *dynamicArray, uint32_t index)
     uint32_t newSize = 1 << swHashClosestShiftFind(index + 1);
     if (newSize != dynamicArray->size)
     {
-      uint8_t *newData = swMemoryRealloc(dynamicArray->data, dynamicArray->elementSize * newSize);
-      if (newData)
+      if (swDynamicArrayDataResize(dynamicArray, newSize))
       {
-        dynamicArray->data = newData;
         dynamicArray->size = newSize;
         rtn = true;
       }
@@ -69,40 +112,51 @@ swDynamicArray *swDynamicArrayNewFromStaticArray(const swStaticArray *staticArra
   return rtn;
 }
 
-bool swDynamicArraySetFromStaticArray(swDynamicArray *dynamicArray, const swStaticArray *staticArray)
+// the storage of the array is not expected to be zeroed, every field is set here
+static bool swDynamicArrayInitWithHugePages(swDynamicArray *array, size_t elementSize, uint32_t size, bool hugePages)
 {
   bool rtn = false;
-  if (dynamicArray && staticArray)
+  if (array && elementSize && size)
   {
-    swDynamicArray tempDynamicArray = {0};
-    if (swDynamicArrayInit(&tempDynamicArray, staticArray->elementSize, staticArray->count))
+    array->data = NULL;
+    array->elementSize = elementSize;
+    array->count = 0;
+    array->hugePages = hugePages;
+    array->hugePageBacked = false;
+    if (swDynamicArrayDataResize(array, size))
     {
-      memcpy(tempDynamicArray.data, staticArray->data, staticArray->count * staticArray->elementSize);
-      tempDynamicArray.count = staticArray->count;
-      swDynamicArrayRelease(dynamicArray);
-      *dynamicArray = tempDynamicArray;
+      array->size = size;
       rtn = true;
     }
+    else
+      array->elementSize = 0;
   }
   return rtn;
 }
 
-bool swDynamicArrayInit(swDynamicArray *array, size_t elementSize, uint32_t size)
+bool swDynamicArraySetFromStaticArray(swDynamicArray *dynamicArray, const swStaticArray *staticArray)
 {
   bool rtn = false;
-  if (array && elementSize && size)
+  if (dynamicArray && staticArray)
   {
-    if ((array->data = swMemoryMalloc(size * elementSize)))
+    swDynamicArray tempDynamicArray = { 0 };
+    if (swDynamicArrayInitWithHugePages(&tempDynamicArray, staticArray->elementSize, staticArray->count, dynamicArray->hugePages))
     {
-      array->elementSize = elementSize;
-      array->size = size;
-      array->count = 0;
+      memcpy(tempDynamicArray.data, staticArray->data, staticArray->count * staticArray->elementSize);
+      tempDynamicArray.count = staticArray->count;
+      swDynamicArrayRelease(dynamicArray);
+      *dynamicArray = tempDynamicArray;
       rtn = true;
     }
   }
   return rtn;
 }
 
+bool swDynamicArrayInit(swDynamicArray *array, size_t elementSize, uint32_t size)
+{
+  return swDynamicArrayInitWithHugePages(array, elementSize, size, false);
+}
+
 void swDynamicArrayClear(swDynamicArray *array)
 {
   if (array)
@@ -114,10 +168,7 @@ void swDynamicArrayRelease(swDynamicArray *array)
   if (array)
   {
     if (array->data)
-    {
-      swMemoryFree(array->data);
-      array->data = NULL;
-    }
+      swDynamicArrayDataFree(array);
     array->count = 0;
     array->size = 0;
     array->elementSize = 0;
@@ -139,6 +190,12 @@ bool swDynamicArrayEnsureCapacity(swDynamicArray *array, uint32_t size)
   return rtn;
 }
 
+void swDynamicArrayHugePagesSet(swDynamicArray *array, bool hugePages)
+{
+  if (array)
+    array->hugePages = hugePages;
+}
+
 bool swDynamicArrayAppendStaticArray(swDynamicArray *dynamicArray, const swStaticArray *staticArray)
 {
   bool rtn = false;
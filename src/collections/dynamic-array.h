@@ -13,6 +13,8 @@ typedef struct swDynamicArray
   uint8_t *data;
   uint32_t count;
   uint32_t size;
+  unsigned hugePages : 1;       // data bigger than the huge page size is allocated with swHugePageAlloc
+  unsigned hugePageBacked : 1;  // current data comes from swHugePageAlloc
 } swDynamicArray;
 
 #define swDynamicArrayData(a)             (a).data
@@ -32,6 +34,8 @@ bool swDynamicArrayInit(swDynamicArray *array, size_t elementSize, uint32_t size
 void swDynamicArrayClear(swDynamicArray *array);
 void swDynamicArrayRelease(swDynamicArray *array);
 bool swDynamicArrayEnsureCapacity(swDynamicArray *array, uint32_t size);
+// opt in for huge pages, takes effect on the next resize
+void swDynamicArrayHugePagesSet(swDynamicArray *array, bool hugePages);
 
 bool swDynamicArrayAppendStaticArray(swDynamicArray *dynamicArray, const swStaticArray *staticArray);
 bool swDynamicArraySet(swDynamicArray *dynamicArray, uint32_t position, void *element);
@@ -2,8 +2,28 @@
 
 #include <string.h>
 
+#include <core/huge-page.h>
 #include <core/memory.h>
 
+// all three node arrays use the same backing, so it is decided by the size of the biggest one
+static inline bool swHashMapLinearHugePagesUse(swHashMapLinear *map, size_t size)
+{
+  return map->hugePages && ((size * sizeof(void *)) >= swHugePageSizeGet());
+}
+
+static inline void *swHashMapLinearNodesAlloc(bool hugePageBacked, size_t size, size_t elementSize)
+{
+  return (hugePageBacked)? swHugePageAlloc(size * elementSize, NULL) : swMemoryCalloc(size, elementSize);
+}
+
+static inline void swHashMapLinearNodesFree(bool hugePageBacked, void *nodes, size_t size, size_t elementSize)
+{
+  if (hugePageBacked)
+    swHugePageFree(nodes, size * elementSize);
+  else
+    swMemoryFree(nodes);
+}
+
 static inline void swHashMapLinearClearInternal(swHashMapLinear *map)
 {
   map->count = 0;
@@ -83,11 +103,11 @@ void swHashMapLinearRelease(swHashMapLinear *map)
   {
     swHashMapLinearClearInternal(map);
     if (map->values)
-      swMemoryFree(map->values);
+      swHashMapLinearNodesFree(map->hugePageBacked, map->values, map->size, sizeof(void *));
     if (map->keys)
-      swMemoryFree(map->keys);
+      swHashMapLinearNodesFree(map->hugePageBacked, map->keys, map->size, sizeof(void *));
     if (map->hashes)
-      swMemoryFree(map->hashes);
+      swHashMapLinearNodesFree(map->hugePageBacked, map->hashes, map->size, sizeof(uint32_t));
     memset(map, 0, sizeof(*map));
   }
 }
@@ -145,13 +165,14 @@ static bool swHashMapLinearResize(swHashMapLinear *map)
   uint32_t newMod = 0, newMask = 0;
   swHashShiftSet(shift, &newSize, &newMod, &newMask);
 
-  void **newKeys = swMemoryCalloc(newSize, sizeof(void *));
+  bool hugePageBacked = swHashMapLinearHugePagesUse(map, newSize);
+  void **newKeys = swHashMapLinearNodesAlloc(hugePageBacked, newSize, sizeof(void *));
   if (newKeys)
   {
-    void **newValues = swMemoryCalloc(newSize, sizeof(void *));
+    void **newValues = swHashMapLinearNodesAlloc(hugePageBacked, newSize, sizeof(void *));
     if (newValues)
     {
-      uint32_t *newHashes = swMemoryCalloc(newSize, sizeof(uint32_t));
+      uint32_t *newHashes = swHashMapLinearNodesAlloc(hugePageBacked, newSize, sizeof(uint32_t));
       if (newHashes)
       {
         rtn = true;
@@ -190,10 +211,11 @@ static bool swHashMapLinearResize(swHashMapLinear *map)
 
         if (rtn)
         {
-          swMemoryFree(map->keys);
-          swMemoryFree(map->values);
-          swMemoryFree(map->hashes);
+          swHashMapLinearNodesFree(map->hugePageBacked, map->keys, map->size, sizeof(void *));
+          swHashMapLinearNodesFree(map->hugePageBacked, map->values, map->size, sizeof(void *));
+          swHashMapLinearNodesFree(map->hugePageBacked, map->hashes, map->size, sizeof(uint32_t));
 
+          map->hugePageBacked = hugePageBacked;
           map->keys = newKeys;
           map->values = newValues;
           map->hashes = newHashes;
@@ -203,13 +225,13 @@ static bool swHashMapLinearResize(swHashMapLinear *map)
           map->used = map->count;
         }
         else
-          swMemoryFree(newHashes);
+          swHashMapLinearNodesFree(hugePageBacked, newHashes, newSize, sizeof(uint32_t));
       }
       if (!rtn)
-        swMemoryFree (newValues);
+        swHashMapLinearNodesFree(hugePageBacked, newValues, newSize, sizeof(void *));
     }
     if (!rtn)
-      swMemoryFree (newKeys);
+      swHashMapLinearNodesFree(hugePageBacked, newKeys, newSize, sizeof(void *));
   }
   return rtn;
 }
@@ -434,6 +456,12 @@ size_t swHashMapLinearCount(swHashMapLinear *map)
   return 0;
 }
 
+void swHashMapLinearHugePagesSet(swHashMapLinear *map, bool hugePages)
+{
+  if (map)
+    map->hugePages = hugePages;
+}
+
 swHashMapLinearIterator *swHashMapLinearIteratorNew(swHashMapLinear *map)
 {
   swHashMapLinearIterator *rtn = NULL;
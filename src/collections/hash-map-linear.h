@@ -22,6 +22,8 @@ typedef struct swHashMapLinear
   size_t    used;   // nodes used (real + tombstones)
   uint32_t  mod;
   uint32_t  mask;
+  unsigned  hugePages : 1;      // node arrays bigger than the huge page size are allocated with swHugePageAlloc
+  unsigned  hugePageBacked : 1; // current node arrays come from swHugePageAlloc
 } swHashMapLinear;
 
 typedef struct swHashMapLinearIterator
@@ -41,6 +43,8 @@ void    swHashMapLinearClear(swHashMapLinear *map);
 bool    swHashMapLinearValueGet(swHashMapLinear *map, void *key, void **value);
 void   *swHashMapLinearExtract(swHashMapLinear *map, void *key, void **value);
 size_t  swHashMapLinearCount(swHashMapLinear *map);
+// opt in for huge pages, takes effect on the next resize
+void    swHashMapLinearHugePagesSet(swHashMapLinear *map, bool hugePages);
 
 swHashMapLinearIterator *swHashMapLinearIteratorNew(swHashMapLinear *map);
 bool    swHashMapLinearIteratorInit(swHashMapLinearIterator *iter, swHashMapLinear *map);
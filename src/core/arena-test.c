@@ -0,0 +1,179 @@
+#include "core/arena.h"
+#include "core/time.h"
+#include "collections/dynamic-array.h"
+
+#include "unittest/unittest.h"
+
+#include <string.h>
+
+swTestDeclare(ArenaAllocTest, NULL, NULL, swTestRun)
+{
+  swArena arena = swArenaInitEmpty(1024);
+  uint8_t *first = swArenaAlloc(&arena, 100);
+  ASSERT_NOT_NULL(first);
+  ASSERT_EQUAL(((uintptr_t)first) % SW_ARENA_ALIGNMENT, 0);
+  uint8_t *second = swArenaAlloc(&arena, 100);
+  ASSERT_NOT_NULL(second);
+  // bump allocation in the same chunk
+  ASSERT_TRUE(second == first + 112);
+  ASSERT_EQUAL(swArenaAllocatedSize(&arena), 1024);
+
+  // chunk chaining
+  for (uint32_t i = 0; i < 20; i++)
+  {
+    uint8_t *data = swArenaAllocZero(&arena, 200);
+    ASSERT_NOT_NULL(data);
+    ASSERT_EQUAL(data[199], 0);
+    memset(data, 0xff, 200);
+  }
+  ASSERT_TRUE(swArenaAllocatedSize(&arena) > 1024);
+
+  // oversized allocation gets its own chunk
+  uint8_t *big = swArenaAlloc(&arena, 10000);
+  ASSERT_NOT_NULL(big);
+  memset(big, 0, 10000);
+
+  uint8_t *aligned = swArenaAllocAlign(&arena, 256, 10);
+  ASSERT_NOT_NULL(aligned);
+  ASSERT_EQUAL(((uintptr_t)aligned) % 256, 0);
+  ASSERT_NULL(swArenaAllocAlign(&arena, 24, 10));
+
+  char *string = swArenaDuplicate(&arena, "arena", sizeof("arena"));
+  ASSERT_STR("arena", string);
+  swArenaRelease(&arena);
+  ASSERT_EQUAL(swArenaAllocatedSize(&arena), 0);
+  return true;
+}
+
+swTestDeclare(ArenaResetTest, NULL, NULL, swTestRun)
+{
+  bool rtn = false;
+  swArena *arena = swArenaNew(4096);
+  if (arena)
+  {
+    uint8_t *first = swArenaAlloc(arena, 64);
+    for (uint32_t i = 0; i < 100; i++)
+      ASSERT_NOT_NULL(swArenaAlloc(arena, 1000));
+    ASSERT_NOT_NULL(swArenaAlloc(arena, 20000));
+    size_t allocated = swArenaAllocatedSize(arena);
+
+    // the same allocations after reset reuse the chunks
+    for (uint32_t j = 0; j < 10; j++)
+    {
+      swArenaReset(arena);
+      ASSERT_TRUE(swArenaAlloc(arena, 64) == first);
+      for (uint32_t i = 0; i < 100; i++)
+        ASSERT_NOT_NULL(swArenaAlloc(arena, 1000));
+      ASSERT_NOT_NULL(swArenaAlloc(arena, 20000));
+      ASSERT_EQUAL(swArenaAllocatedSize(arena), allocated);
+    }
+    swArenaDelete(arena);
+    rtn = true;
+  }
+  return rtn;
+}
+
+swTestDeclare(ArenaMarkRewindTest, NULL, NULL, swTestRun)
+{
+  swArena arena = swArenaInitEmpty(512);
+  swArenaMark emptyMark = swArenaMarkGet(&arena);
+  uint8_t *keep = swArenaAlloc(&arena, 100);
+  ASSERT_NOT_NULL(keep);
+  memset(keep, 0x5a, 100);
+
+  swArenaMark mark = swArenaMarkGet(&arena);
+  uint8_t *scratch = swArenaAlloc(&arena, 50);
+  for (uint32_t i = 0; i < 10; i++)
+    ASSERT_NOT_NULL(swArenaAlloc(&arena, 300));
+  swArenaRewind(&arena, mark);
+  ASSERT_TRUE(swArenaAlloc(&arena, 50) == scratch);
+  for (uint32_t i = 0; i < 100; i++)
+    ASSERT_EQUAL(keep[i], 0x5a);
+
+  swArenaRewind(&arena, emptyMark);
+  ASSERT_TRUE(swArenaAlloc(&arena, 100) == keep);
+  swArenaRelease(&arena);
+  return true;
+}
+
+swTestDeclare(ArenaManagerTest, NULL, NULL, swTestRun)
+{
+  swArena arena = swArenaInitEmpty(4096);
+  ASSERT_NULL(swArenaBind(&arena));
+  swMemoryManagerSet(swArenaManagerGet());
+
+  swDynamicArray *array = swDynamicArrayNew(sizeof(uint32_t), 4);
+  ASSERT_NOT_NULL(array);
+  for (uint32_t i = 0; i < 10000; i++)
+    ASSERT_TRUE(swDynamicArrayPush(array, &i));
+  for (uint32_t i = 0; i < 10000; i++)
+    ASSERT_EQUAL(*(uint32_t *)swDynamicArrayGet(array, i), i);
+  void *aligned = swMemoryCacheAlignMalloc(100);
+  ASSERT_NOT_NULL(aligned);
+  ASSERT_EQUAL(((uintptr_t)aligned) % 64, 0);
+  swMemoryFree(aligned);
+  swDynamicArrayDelete(array);
+
+  // without bound arena the manager falls back to malloc
+  ASSERT_TRUE(swArenaBind(NULL) == &arena);
+  char *string = swMemoryDuplicate("heap", sizeof("heap"));
+  ASSERT_STR("heap", string);
+  string = swMemoryRealloc(string, 10000);
+  ASSERT_STR("heap", string);
+  swMemoryFree(string);
+  aligned = swMemoryCacheAlignMalloc(100);
+  ASSERT_NOT_NULL(aligned);
+  ASSERT_EQUAL(((uintptr_t)aligned) % 64, 0);
+  swMemoryFree(aligned);
+
+  swMemoryManagerDefaultSet();
+  swArenaRelease(&arena);
+  return true;
+}
+
+#define SW_ARENA_TEST_EVENTS      100000
+#define SW_ARENA_TEST_ALLOCATIONS 16
+
+static void swArenaTestEvents(bool useArena)
+{
+  swArena arena = swArenaInitEmpty(0);
+  for (uint32_t i = 0; i < SW_ARENA_TEST_EVENTS; i++)
+  {
+    void *allocations[SW_ARENA_TEST_ALLOCATIONS];
+    for (uint32_t j = 0; j < SW_ARENA_TEST_ALLOCATIONS; j++)
+    {
+      allocations[j] = (useArena)? swArenaAlloc(&arena, 32 + j * 24) : malloc(32 + j * 24);
+      *(uint8_t *)allocations[j] = j;
+    }
+    if (useArena)
+      swArenaReset(&arena);
+    else
+    {
+      for (uint32_t j = 0; j < SW_ARENA_TEST_ALLOCATIONS; j++)
+        free(allocations[j]);
+    }
+  }
+  swArenaRelease(&arena);
+}
+
+static void swArenaTestEventsMalloc()
+{
+  swArenaTestEvents(false);
+}
+
+static void swArenaTestEventsArena()
+{
+  swArenaTestEvents(true);
+}
+
+swTestDeclare(ArenaBenchmarkTest, NULL, NULL, swTestRun)
+{
+  uint64_t mallocTime = swTimeMeasure(CLOCK_MONOTONIC_RAW, swArenaTestEventsMalloc);
+  uint64_t arenaTime = swTimeMeasure(CLOCK_MONOTONIC_RAW, swArenaTestEventsArena);
+  swTestLogLine("%u events x %u allocations: malloc/free = %lu ns, arena/reset = %lu ns\n",
+                SW_ARENA_TEST_EVENTS, SW_ARENA_TEST_ALLOCATIONS, mallocTime, arenaTime);
+  return (mallocTime && arenaTime);
+}
+
+swTestSuiteStructDeclare(ArenaTest, NULL, NULL, swTestRun,
+                         &ArenaAllocTest, &ArenaResetTest, &ArenaMarkRewindTest, &ArenaManagerTest, &ArenaBenchmarkTest);
@@ -0,0 +1,340 @@
+#include "core/arena.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define swArenaAlignUp(v, a)  (((v) + ((a) - 1)) & ~((size_t)(a) - 1))
+
+swArena *swArenaNew(size_t chunkSize)
+{
+  swArena *rtn = malloc(sizeof(swArena));
+  if (rtn)
+  {
+    if (!swArenaInit(rtn, chunkSize))
+    {
+      free(rtn);
+      rtn = NULL;
+    }
+  }
+  return rtn;
+}
+
+void swArenaDelete(swArena *arena)
+{
+  if (arena)
+  {
+    swArenaRelease(arena);
+    free(arena);
+  }
+}
+
+bool swArenaInit(swArena *arena, size_t chunkSize)
+{
+  bool rtn = false;
+  if (arena)
+  {
+    memset(arena, 0, sizeof(*arena));
+    arena->chunkSize = (chunkSize)? chunkSize : SW_ARENA_CHUNK_SIZE_DEFAULT;
+    rtn = true;
+  }
+  return rtn;
+}
+
+void swArenaRelease(swArena *arena)
+{
+  if (arena)
+  {
+    swArenaChunk *chunk = arena->first;
+    while (chunk)
+    {
+      swArenaChunk *next = chunk->next;
+      free(chunk);
+      chunk = next;
+    }
+    arena->first = arena->current = NULL;
+    arena->allocated = 0;
+  }
+}
+
+// makes a chunk that can fit size bytes the one after the current and moves to it,
+// chunks after the current one are all unused, so they can be reordered
+static bool swArenaChunkNext(swArena *arena, size_t size)
+{
+  bool rtn = false;
+  swArenaChunk *prev = arena->current;
+  swArenaChunk *chunk = (prev)? prev->next : arena->first;
+  while (chunk && (chunk->size < size))
+  {
+    prev = chunk;
+    chunk = chunk->next;
+  }
+  if (chunk)
+  {
+    if (prev != arena->current)
+    {
+      prev->next = chunk->next;
+      chunk->next = NULL;
+    }
+  }
+  else
+  {
+    if (!arena->chunkSize)
+      arena->chunkSize = SW_ARENA_CHUNK_SIZE_DEFAULT;
+    size_t chunkSize = (size > arena->chunkSize)? size : arena->chunkSize;
+    if ((chunk = malloc(sizeof(swArenaChunk) + chunkSize)))
+    {
+      chunk->next = NULL;
+      chunk->size = chunkSize;
+      arena->allocated += chunkSize;
+    }
+  }
+  if (chunk)
+  {
+    if (arena->current)
+    {
+      if (arena->current->next != chunk)
+      {
+        chunk->next = arena->current->next;
+        arena->current->next = chunk;
+      }
+    }
+    else if (arena->first != chunk)
+    {
+      chunk->next = arena->first;
+      arena->first = chunk;
+    }
+    chunk->used = 0;
+    arena->current = chunk;
+    rtn = true;
+  }
+  return rtn;
+}
+
+void *swArenaAllocAlign(swArena *arena, size_t alignment, size_t size)
+{
+  void *rtn = NULL;
+  if (arena && alignment && !(alignment & (alignment - 1)))
+  {
+    swArenaChunk *chunk = arena->current;
+    size_t offset = 0;
+    if (chunk)
+      offset = swArenaAlignUp((uintptr_t)(chunk->data + chunk->used), alignment) - (uintptr_t)chunk->data;
+    if (!chunk || (offset + size > chunk->size) || (offset + size < offset))
+    {
+      size_t padding = (alignment > SW_ARENA_ALIGNMENT)? alignment - SW_ARENA_ALIGNMENT : 0;
+      if ((size + padding >= size) && swArenaChunkNext(arena, size + padding))
+      {
+        chunk = arena->current;
+        offset = swArenaAlignUp((uintptr_t)chunk->data, alignment) - (uintptr_t)chunk->data;
+      }
+      else
+        chunk = NULL;
+    }
+    if (chunk)
+    {
+      rtn = chunk->data + offset;
+      chunk->used = offset + size;
+    }
+  }
+  return rtn;
+}
+
+void *swArenaAllocZero(swArena *arena, size_t size)
+{
+  void *rtn = swArenaAllocAlign(arena, SW_ARENA_ALIGNMENT, size);
+  if (rtn)
+    memset(rtn, 0, size);
+  return rtn;
+}
+
+void *swArenaDuplicate(swArena *arena, const void *src, size_t size)
+{
+  void *rtn = NULL;
+  if (src && (rtn = swArenaAllocAlign(arena, SW_ARENA_ALIGNMENT, size)))
+    memcpy(rtn, src, size);
+  return rtn;
+}
+
+void swArenaReset(swArena *arena)
+{
+  if (arena)
+  {
+    arena->current = arena->first;
+    if (arena->current)
+      arena->current->used = 0;
+  }
+}
+
+swArenaMark swArenaMarkGet(swArena *arena)
+{
+  swArenaMark rtn = { NULL, 0 };
+  if (arena && arena->current)
+  {
+    rtn.chunk = arena->current;
+    rtn.used = arena->current->used;
+  }
+  return rtn;
+}
+
+void swArenaRewind(swArena *arena, swArenaMark mark)
+{
+  if (arena)
+  {
+    if (mark.chunk)
+    {
+      arena->current = mark.chunk;
+      arena->current->used = mark.used;
+    }
+    else
+      swArenaReset(arena);
+  }
+}
+
+// memory manager interface, every block starts with a header that records its size and origin,
+// so realloc can copy the data and free can tell arena memory from malloc memory
+
+#define SW_ARENA_BLOCK_HEAP   1
+
+typedef struct swArenaBlockHeader
+{
+  uint32_t offset;  // distance from the header back to the start of malloc memory
+  uint32_t flags;
+  size_t size;
+} swArenaBlockHeader;
+
+static __thread swArena *boundArena = NULL;
+
+swArena *swArenaBind(swArena *arena)
+{
+  swArena *rtn = boundArena;
+  boundArena = arena;
+  return rtn;
+}
+
+static void *swArenaManagerBlockAlloc(size_t alignment, size_t size)
+{
+  void *rtn = NULL;
+  // aligned blocks reserve a full alignment in front, so the header always fits right before the data
+  size_t padding = (alignment > sizeof(swArenaBlockHeader))? alignment : sizeof(swArenaBlockHeader);
+  if (size + padding > size)
+  {
+    uint8_t *data = NULL;
+    uint32_t flags = 0;
+    if (boundArena)
+      data = swArenaAllocAlign(boundArena, (alignment > SW_ARENA_ALIGNMENT)? alignment : SW_ARENA_ALIGNMENT, size + padding);
+    else if (alignment <= SW_ARENA_ALIGNMENT)
+    {
+      if ((data = malloc(size + padding)))
+        flags = SW_ARENA_BLOCK_HEAP;
+    }
+    else if (posix_memalign((void **)&data, alignment, size + padding) == 0)
+      flags = SW_ARENA_BLOCK_HEAP;
+    else
+      data = NULL;
+    if (data)
+    {
+      swArenaBlockHeader *header = (swArenaBlockHeader *)(data + padding) - 1;
+      header->offset = (uint8_t *)header - data;
+      header->flags = flags;
+      header->size = size;
+      rtn = data + padding;
+    }
+  }
+  if (!rtn)
+    errno = ENOMEM;
+  return rtn;
+}
+
+static void *swArenaManagerMalloc(size_t size)
+{
+  return swArenaManagerBlockAlloc(SW_ARENA_ALIGNMENT, size);
+}
+
+static void swArenaManagerFree(void *ptr)
+{
+  if (ptr)
+  {
+    swArenaBlockHeader *header = (swArenaBlockHeader *)ptr - 1;
+    if (header->flags & SW_ARENA_BLOCK_HEAP)
+      free((uint8_t *)header - header->offset);
+    else if (boundArena && boundArena->current && ((uint8_t *)ptr + header->size == boundArena->current->data + boundArena->current->used))
+      // the last allocation can be given back
+      boundArena->current->used = (uint8_t *)header - header->offset - boundArena->current->data;
+  }
+}
+
+static void *swArenaManagerCalloc(size_t nmemb, size_t size)
+{
+  void *rtn = NULL;
+  size_t total = 0;
+  if (!__builtin_mul_overflow(nmemb, size, &total))
+  {
+    if ((rtn = swArenaManagerMalloc(total)))
+      memset(rtn, 0, total);
+  }
+  else
+    errno = ENOMEM;
+  return rtn;
+}
+
+static void *swArenaManagerRealloc(void *ptr, size_t size)
+{
+  void *rtn = NULL;
+  if (ptr)
+  {
+    if (size)
+    {
+      swArenaBlockHeader *header = (swArenaBlockHeader *)ptr - 1;
+      swArenaChunk *chunk = (boundArena)? boundArena->current : NULL;
+      if ((header->flags & SW_ARENA_BLOCK_HEAP) && !header->offset)
+      {
+        if ((size + sizeof(swArenaBlockHeader) > size) && (header = realloc(header, size + sizeof(swArenaBlockHeader))))
+        {
+          header->size = size;
+          rtn = header + 1;
+        }
+        else
+          errno = ENOMEM;
+      }
+      else if (size <= header->size)
+        rtn = ptr;
+      // the last allocation in the chunk grows in place
+      else if (!(header->flags & SW_ARENA_BLOCK_HEAP) && chunk && ((uint8_t *)ptr + header->size == chunk->data + chunk->used)
+               && (size - header->size <= chunk->size - chunk->used))
+      {
+        chunk->used += size - header->size;
+        header->size = size;
+        rtn = ptr;
+      }
+      else if ((rtn = swArenaManagerMalloc(size)))
+      {
+        memcpy(rtn, ptr, header->size);
+        swArenaManagerFree(ptr);
+      }
+    }
+    else
+      swArenaManagerFree(ptr);
+  }
+  else
+    rtn = swArenaManagerMalloc(size);
+  return rtn;
+}
+
+static int swArenaManagerAlignMalloc(void **memptr, size_t alignment, size_t size)
+{
+  int rtn = EINVAL;
+  if (memptr && alignment && !(alignment & (alignment - 1)) && !(alignment % sizeof(void *)))
+  {
+    *memptr = swArenaManagerBlockAlloc(alignment, size);
+    rtn = (*memptr)? 0 : ENOMEM;
+  }
+  return rtn;
+}
+
+static swMemoryManager arenaManager = { swArenaManagerMalloc, swArenaManagerCalloc, swArenaManagerRealloc, swArenaManagerFree, swArenaManagerAlignMalloc };
+
+swMemoryManager *swArenaManagerGet()
+{
+  return &arenaManager;
+}
@@ -0,0 +1,84 @@
+#ifndef SW_CORE_ARENA_H
+#define SW_CORE_ARENA_H
+
+#include "core/memory.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// region allocator for per request/per packet scratch memory: allocations bump the pointer
+// inside the current chunk, chunks are chained and kept for reuse, everything allocated is released
+// at once by swArenaReset or partially by swArenaRewind to a previously taken mark
+
+#define SW_ARENA_CHUNK_SIZE_DEFAULT   (16 * 1024)
+#define SW_ARENA_ALIGNMENT            16
+
+typedef struct swArenaChunk
+{
+  struct swArenaChunk *next;
+  size_t size;
+  size_t used;
+  uint8_t data[] __attribute__ ((aligned(SW_ARENA_ALIGNMENT)));
+} swArenaChunk;
+
+typedef struct swArena
+{
+  swArenaChunk *first;
+  swArenaChunk *current;
+  size_t chunkSize;
+  size_t allocated;
+} swArena;
+
+typedef struct swArenaMark
+{
+  swArenaChunk *chunk;
+  size_t used;
+} swArenaMark;
+
+#define swArenaInitEmpty(cs)    { .chunkSize = (cs) }
+
+swArena *swArenaNew(size_t chunkSize);
+void swArenaDelete(swArena *arena);
+
+bool swArenaInit(swArena *arena, size_t chunkSize);
+void swArenaRelease(swArena *arena);
+
+void *swArenaAllocAlign(swArena *arena, size_t alignment, size_t size);
+
+// bump the pointer inline when the current chunk has space, go through the slow path otherwise
+static inline void *swArenaAlloc(swArena *arena, size_t size)
+{
+  swArenaChunk *chunk = arena->current;
+  if (chunk)
+  {
+    size_t used = (chunk->used + (SW_ARENA_ALIGNMENT - 1)) & ~((size_t)SW_ARENA_ALIGNMENT - 1);
+    if ((size <= chunk->size) && (used <= chunk->size - size))
+    {
+      chunk->used = used + size;
+      return chunk->data + used;
+    }
+  }
+  return swArenaAllocAlign(arena, SW_ARENA_ALIGNMENT, size);
+}
+
+void *swArenaAllocZero(swArena *arena, size_t size);
+void *swArenaDuplicate(swArena *arena, const void *src, size_t size);
+
+// all the chunks are kept, so allocating the same amount of memory after reset does not call malloc
+void swArenaReset(swArena *arena);
+swArenaMark swArenaMarkGet(swArena *arena);
+void swArenaRewind(swArena *arena, swArenaMark mark);
+
+// total size of the chunks owned by the arena
+#define swArenaAllocatedSize(a) (a)->allocated
+
+// swMemoryManager interface, allocations made through it go to the arena bound to the calling thread
+// (or to malloc if no arena is bound), free is a no op for arena memory; typical use:
+//   swArenaBind(arena); swMemoryManagerSet(swArenaManagerGet());
+//   ... build temporary collections ...
+//   swMemoryManagerDefaultSet(); swArenaBind(NULL); swArenaReset(arena);
+// WARNING: memory allocated while the manager is set has to be freed while it is still set
+swMemoryManager *swArenaManagerGet();
+swArena *swArenaBind(swArena *arena);
+
+#endif // SW_CORE_ARENA_H
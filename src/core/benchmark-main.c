@@ -0,0 +1,6 @@
+#include "core/benchmark-runner.h"
+
+int main (int argc, char *argv[])
+{
+  return swBenchmarkMain(argc, argv);
+}
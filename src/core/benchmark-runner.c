@@ -0,0 +1,380 @@
+#include "core/benchmark-runner.h"
+#include "core/memory.h"
+
+#include <getopt.h>
+#include <math.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static swBenchmarkDeclaration benchmarkGlobal __attribute__ ((used, section(".benchmark"))) = { 0 };
+
+bool swBenchmarkDeclarationsGet(swBenchmarkDeclaration **begin, swBenchmarkDeclaration **end)
+{
+  bool rtn = false;
+  if (begin && end)
+  {
+    swBenchmarkDeclaration *first = &benchmarkGlobal;
+    swBenchmarkDeclaration *last = &benchmarkGlobal;
+    // find begin and end of section by comparing magics
+    while ((first - 1)->magic == SW_BENCHMARK_DECLARATION_MAGIC)
+      first--;
+    while ((last + 1)->magic == SW_BENCHMARK_DECLARATION_MAGIC)
+      last++;
+    *begin = first;
+    *end = last + 1;
+    rtn = true;
+  }
+  return rtn;
+}
+
+bool swBenchmarkBaselineSave(const char *path, swBenchmarkSummary *summaries, uint32_t count)
+{
+  bool rtn = false;
+  if (path && (summaries || !count))
+  {
+    FILE *file = fopen(path, "w");
+    if (file)
+    {
+      rtn = true;
+      for (uint32_t i = 0; rtn && (i < count); i++)
+      {
+        if (fprintf(file, "%s,%lu,%.6f,%.6f\n", summaries[i].name, summaries[i].count, summaries[i].mean, summaries[i].deviation) <= 0)
+          rtn = false;
+      }
+      if (fclose(file))
+        rtn = false;
+    }
+  }
+  return rtn;
+}
+
+swBenchmarkSummary *swBenchmarkBaselineLoad(const char *path, uint32_t *count)
+{
+  swBenchmarkSummary *rtn = NULL;
+  if (path && count)
+  {
+    FILE *file = fopen(path, "r");
+    if (file)
+    {
+      uint32_t size = 16;
+      uint32_t used = 0;
+      bool success = true;
+      char line[SW_BENCHMARK_NAME_MAX + 128];
+      if ((rtn = swMemoryMalloc(size * sizeof(*rtn))))
+      {
+        while (success && fgets(line, sizeof(line), file))
+        {
+          if (used == size)
+          {
+            swBenchmarkSummary *summaries = swMemoryRealloc(rtn, (size << 1) * sizeof(*rtn));
+            if (summaries)
+            {
+              rtn = summaries;
+              size <<= 1;
+            }
+            else
+              success = false;
+          }
+          if (success)
+          {
+            char *comma = strchr(line, ',');
+            swBenchmarkSummary *summary = &(rtn[used]);
+            if (comma && ((comma - line) < SW_BENCHMARK_NAME_MAX)
+                && (sscanf(comma + 1, "%lu,%lf,%lf", &(summary->count), &(summary->mean), &(summary->deviation)) == 3))
+            {
+              memcpy(summary->name, line, comma - line);
+              summary->name[comma - line] = '\0';
+              used++;
+            }
+            else
+              success = false;
+          }
+        }
+        if (success)
+          *count = used;
+        else
+        {
+          swMemoryFree(rtn);
+          rtn = NULL;
+        }
+      }
+      fclose(file);
+    }
+  }
+  return rtn;
+}
+
+const swBenchmarkSummary *swBenchmarkBaselineFind(const swBenchmarkSummary *summaries, uint32_t count, const char *name)
+{
+  const swBenchmarkSummary *rtn = NULL;
+  if (summaries && name)
+  {
+    for (uint32_t i = 0; i < count; i++)
+    {
+      if (strcmp(summaries[i].name, name) == 0)
+      {
+        rtn = &(summaries[i]);
+        break;
+      }
+    }
+  }
+  return rtn;
+}
+
+bool swBenchmarkRegressionCheck(const swBenchmarkSummary *baseline, const swBenchmarkSummary *current, double threshold, double significance, double *pValue)
+{
+  bool rtn = false;
+  if (baseline && current && (baseline->count > 1) && (current->count > 1))
+  {
+    double difference = current->mean - baseline->mean;
+    double error = sqrt((baseline->deviation * baseline->deviation) / baseline->count + (current->deviation * current->deviation) / current->count);
+    double t = (error > 0)? difference / error : ((difference > 0)? INFINITY : 0);
+    // probability of seeing a slow down this big when nothing changed
+    double p = 0.5 * erfc(t / M_SQRT2);
+    if (pValue)
+      *pValue = p;
+    if ((difference > baseline->mean * threshold / 100.0) && (p < significance))
+      rtn = true;
+  }
+  return rtn;
+}
+
+typedef enum swBenchmarkOutput
+{
+  swBenchmarkOutputText = 0,
+  swBenchmarkOutputJSON,
+  swBenchmarkOutputCSV
+} swBenchmarkOutput;
+
+static void swBenchmarkTextPrint(swBenchmarkCase *benchmark)
+{
+  swHistogram *histogram = &(benchmark->histogram);
+  printf("%-40s %12.3f ns  dev %10.3f  p50 %8lu  p99 %8lu  p99.9 %8lu  max %10lu  outliers %lu/%lu  (%u x %lu)\n",
+         benchmark->name, benchmark->mean, benchmark->deviation, swHistogramPercentileGet(histogram, 50),
+         swHistogramPercentileGet(histogram, 99), swHistogramPercentileGet(histogram, 99.9), histogram->max,
+         benchmark->outliersLow, benchmark->outliersHigh, benchmark->sampleSize, benchmark->batchSize);
+  if (benchmark->perfCountersAvailable)
+  {
+    printf("%-40s", "");
+    for (uint32_t i = 0; i < swPerfCounterMax; i++)
+    {
+      if (benchmark->perfCountersAvailable & (1 << i))
+        printf(" %s %.3f", swPerfCounterTextGet(i), benchmark->perfCounterValues[i]);
+    }
+    printf("\n");
+  }
+}
+
+// runs all the repetitions and combines them in total, total has to be initialized
+static bool swBenchmarkDeclarationRun(swBenchmarkDeclaration *declaration, uint32_t sampleSize, uint32_t repetitions, bool perfCounters, swBenchmarkCase *total, swBenchmarkSummary *summary)
+{
+  bool rtn = false;
+  swBenchmarkCase *benchmark = swMemoryMalloc(sizeof(*benchmark));
+  if (benchmark)
+  {
+    void *context = (declaration->setupFunc)? declaration->setupFunc() : NULL;
+    double sum = 0;
+    double sumOfSquares = 0;
+    total->sampleSize = 0;
+    total->perfCountersAvailable = (perfCounters)? (1 << swPerfCounterMax) - 1 : 0;
+    rtn = true;
+    for (uint32_t i = 0; rtn && (i < repetitions); i++)
+    {
+      rtn = swBenchmarkCaseInit(benchmark, declaration->name, declaration->func, context, sampleSize);
+      if (rtn)
+        benchmark->perfCounters = perfCounters;
+      if (rtn && swBenchmarkCaseRun(benchmark))
+      {
+        // only the counters available in every repetition are reported
+        total->perfCountersAvailable &= benchmark->perfCountersAvailable;
+        for (uint32_t j = 0; j < swPerfCounterMax; j++)
+          total->perfCounterValues[j] += benchmark->perfCounterValues[j] * benchmark->iterations;
+        swHistogramMerge(&(total->histogram), &(benchmark->histogram));
+        for (uint32_t j = 0; j < benchmark->sampleSize; j++)
+        {
+          sum += benchmark->samples[j];
+          sumOfSquares += benchmark->samples[j] * benchmark->samples[j];
+        }
+        total->sampleSize += benchmark->sampleSize;
+        total->batchSize = benchmark->batchSize;
+        total->iterations += benchmark->iterations;
+        total->totalTime += benchmark->totalTime;
+        total->outliersLow += benchmark->outliersLow;
+        total->outliersHigh += benchmark->outliersHigh;
+      }
+      else
+        rtn = false;
+      swBenchmarkCaseRelease(benchmark);
+    }
+    if (declaration->teardownFunc)
+      declaration->teardownFunc(context);
+    if (rtn)
+    {
+      double mean = sum / total->sampleSize;
+      double variance = sumOfSquares / total->sampleSize - mean * mean;
+      // the mean printed and compared with the baseline is the one over all the iterations, the
+      // samples give its deviation
+      total->mean = (double)total->totalTime / total->iterations;
+      total->deviation = (variance > 0)? sqrt(variance) : 0;
+      for (uint32_t i = 0; i < swPerfCounterMax; i++)
+        total->perfCounterValues[i] /= total->iterations;
+      snprintf(summary->name, sizeof(summary->name), "%s", declaration->name);
+      summary->count = total->sampleSize;
+      summary->mean = total->mean;
+      summary->deviation = total->deviation;
+    }
+    swMemoryFree(benchmark);
+  }
+  return rtn;
+}
+
+static void swBenchmarkUsagePrint(const char *program)
+{
+  fprintf(stderr, "usage: %s [-f|--filter text] [-r|--repetitions n] [-n|--samples n] [-c|--cpu n]\n"
+                  "       [-o|--output text|json|csv] [-s|--save file] [-b|--baseline file] [-t|--threshold percent] [-p|--perf] [-l|--list]\n", program);
+}
+
+int swBenchmarkMain(int argc, char *argv[])
+{
+  int rtn = EXIT_FAILURE;
+  const char *filter = NULL;
+  const char *savePath = NULL;
+  const char *baselinePath = NULL;
+  long repetitions = 1;
+  long sampleSize = 0;
+  long cpu = -1;
+  double threshold = SW_BENCHMARK_THRESHOLD;
+  bool list = false;
+  bool perfCounters = false;
+  swBenchmarkOutput output = swBenchmarkOutputText;
+  bool success = true;
+
+  static struct option options[] =
+  {
+    {"filter",      required_argument, NULL, 'f'},
+    {"repetitions", required_argument, NULL, 'r'},
+    {"samples",     required_argument, NULL, 'n'},
+    {"cpu",         required_argument, NULL, 'c'},
+    {"output",      required_argument, NULL, 'o'},
+    {"save",        required_argument, NULL, 's'},
+    {"baseline",    required_argument, NULL, 'b'},
+    {"threshold",   required_argument, NULL, 't'},
+    {"list",        no_argument,       NULL, 'l'},
+    {"perf",        no_argument,       NULL, 'p'},
+    {NULL,          0,                 NULL, 0}
+  };
+  int option = 0;
+  while (success && ((option = getopt_long(argc, argv, "f:r:n:c:o:s:b:t:lp", options, NULL)) != -1))
+  {
+    switch (option)
+    {
+      case 'f': filter = optarg; break;
+      case 'r': success = ((repetitions = strtol(optarg, NULL, 10)) > 0); break;
+      case 'n': success = ((sampleSize = strtol(optarg, NULL, 10)) > 0); break;
+      case 'c': success = ((cpu = strtol(optarg, NULL, 10)) >= 0); break;
+      case 's': savePath = optarg; break;
+      case 'b': baselinePath = optarg; break;
+      case 't': success = ((threshold = strtod(optarg, NULL)) >= 0); break;
+      case 'l': list = true; break;
+      case 'p': perfCounters = true; break;
+      case 'o':
+        if (strcmp(optarg, "json") == 0)
+          output = swBenchmarkOutputJSON;
+        else if (strcmp(optarg, "csv") == 0)
+          output = swBenchmarkOutputCSV;
+        else
+          success = (strcmp(optarg, "text") == 0);
+        break;
+      default: success = false; break;
+    }
+  }
+  if (!success)
+    swBenchmarkUsagePrint(argv[0]);
+
+  if (success && (cpu >= 0))
+  {
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu, &cpuSet);
+    if (sched_setaffinity(0, sizeof(cpuSet), &cpuSet))
+    {
+      fprintf(stderr, "failed to pin to CPU %ld\n", cpu);
+      success = false;
+    }
+  }
+
+  swBenchmarkSummary *baseline = NULL;
+  uint32_t baselineCount = 0;
+  if (success && baselinePath && !(baseline = swBenchmarkBaselineLoad(baselinePath, &baselineCount)))
+  {
+    fprintf(stderr, "failed to load baseline from '%s'\n", baselinePath);
+    success = false;
+  }
+
+  swBenchmarkDeclaration *begin = NULL;
+  swBenchmarkDeclaration *end = NULL;
+  swBenchmarkSummary *summaries = NULL;
+  swBenchmarkCase *total = NULL;
+  if (success && (total = swMemoryMalloc(sizeof(*total))) && swBenchmarkDeclarationsGet(&begin, &end) && (summaries = swMemoryCalloc(end - begin, sizeof(*summaries))))
+  {
+    uint32_t summaryCount = 0;
+    uint32_t regressions = 0;
+    if (!list && (output == swBenchmarkOutputCSV))
+      swBenchmarkCaseCSVHeaderPrint(stdout);
+    for (swBenchmarkDeclaration *declaration = begin; declaration != end; declaration++)
+    {
+      if ((declaration == &benchmarkGlobal) || (filter && !strstr(declaration->name, filter)))
+        continue;
+      if (list)
+      {
+        printf("%s\n", declaration->name);
+        continue;
+      }
+      swBenchmarkSummary *summary = &(summaries[summaryCount]);
+      memset(total, 0, sizeof(*total));
+      total->name = declaration->name;
+      if (swBenchmarkDeclarationRun(declaration, (sampleSize)? (uint32_t)sampleSize : declaration->sampleSize, repetitions, perfCounters, total, summary))
+      {
+        summaryCount++;
+        if (output == swBenchmarkOutputJSON)
+          swBenchmarkCaseJSONPrint(total, stdout);
+        else if (output == swBenchmarkOutputCSV)
+          swBenchmarkCaseCSVPrint(total, stdout);
+        else
+          swBenchmarkTextPrint(total);
+        if (baseline)
+        {
+          const swBenchmarkSummary *previous = swBenchmarkBaselineFind(baseline, baselineCount, summary->name);
+          double pValue = 1.0;
+          if (previous)
+          {
+            bool regression = swBenchmarkRegressionCheck(previous, summary, threshold, SW_BENCHMARK_SIGNIFICANCE, &pValue);
+            fprintf(stderr, "%-40s %s: %.3f ns -> %.3f ns (%+.2f%%, p = %.4f)\n", summary->name, (regression)? "REGRESSION" : "ok",
+                    previous->mean, summary->mean, (previous->mean > 0)? (summary->mean - previous->mean) * 100.0 / previous->mean : 0, pValue);
+            regressions += regression;
+          }
+          else
+            fprintf(stderr, "%-40s not in baseline\n", summary->name);
+        }
+      }
+      else
+      {
+        fprintf(stderr, "%s failed\n", declaration->name);
+        success = false;
+      }
+    }
+    if (savePath && !swBenchmarkBaselineSave(savePath, summaries, summaryCount))
+    {
+      fprintf(stderr, "failed to save baseline to '%s'\n", savePath);
+      success = false;
+    }
+    if (success && !regressions)
+      rtn = EXIT_SUCCESS;
+  }
+  swMemoryFree(summaries);
+  swMemoryFree(total);
+  swMemoryFree(baseline);
+  return rtn;
+}
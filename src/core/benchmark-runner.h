@@ -0,0 +1,53 @@
+#ifndef SW_CORE_BENCHMARKRUNNER_H
+#define SW_CORE_BENCHMARKRUNNER_H
+
+#include "core/benchmark.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// runs the benchmarks declared with swBenchmarkDeclare in the binary; the objects with
+// the declarations have to be linked directly, the ones in archives are not pulled in
+//
+// usage: <binary> [options]
+//   -f, --filter <text>        run only the benchmarks with the text in the name
+//   -r, --repetitions <n>      run every benchmark n times, the samples of all the runs are combined
+//   -n, --samples <n>          override the sample size of the declarations
+//   -c, --cpu <n>              pin the process to the CPU
+//   -o, --output <format>      text (default), json or csv
+//   -s, --save <file>          save the results as the baseline
+//   -b, --baseline <file>      compare with the baseline, the exit code is 1 when anything regressed
+//   -t, --threshold <percent>  smallest slow down that counts as a regression, 5% by default
+//   -p, --perf                 count cycles, instructions, cache, branch and TLB misses per call
+//                              when perf_event_open is allowed
+//   -l, --list                 list the benchmarks
+
+#define SW_BENCHMARK_NAME_MAX         128
+#define SW_BENCHMARK_THRESHOLD        5.0
+#define SW_BENCHMARK_SIGNIFICANCE     0.01
+
+bool swBenchmarkDeclarationsGet(swBenchmarkDeclaration **begin, swBenchmarkDeclaration **end);
+
+// what gets stored in the baseline, time per call in nanoseconds
+typedef struct swBenchmarkSummary
+{
+  char name[SW_BENCHMARK_NAME_MAX];
+  uint64_t count;
+  double mean;
+  double deviation;
+} swBenchmarkSummary;
+
+// one "name,count,mean,deviation" line per benchmark
+bool swBenchmarkBaselineSave(const char *path, swBenchmarkSummary *summaries, uint32_t count);
+// returned array is allocated with swMemoryMalloc
+swBenchmarkSummary *swBenchmarkBaselineLoad(const char *path, uint32_t *count);
+const swBenchmarkSummary *swBenchmarkBaselineFind(const swBenchmarkSummary *summaries, uint32_t count, const char *name);
+
+// Welch's t-test, current is a regression when it is slower by more than threshold percent and
+// the one sided p-value is below significance; the normal approximation of the t distribution
+// is used, so both sides need at least 30 samples for the p-value to mean anything
+bool swBenchmarkRegressionCheck(const swBenchmarkSummary *baseline, const swBenchmarkSummary *current, double threshold, double significance, double *pValue);
+
+int swBenchmarkMain(int argc, char *argv[]);
+
+#endif // SW_CORE_BENCHMARKRUNNER_H
@@ -1,7 +1,12 @@
 #include "core/benchmark.h"
+#include "core/benchmark-runner.h"
+#include "core/memory.h"
 
 #include "unittest/unittest.h"
 
+#include <string.h>
+#include <unistd.h>
+
 static void testFunction(void)
 {
   uint32_t j = 0;
@@ -74,7 +79,177 @@ swTestDeclare(BenchmarkCPUTimeTest, NULL, NULL, swTestRun)
   return rtn;
 }
 
+static void testContextFunction(void *context)
+{
+  uint64_t *counter = context;
+  (*counter)++;
+}
+
+swTestDeclare(BenchmarkCaseTest, NULL, NULL, swTestRun)
+{
+  uint64_t counter = 0;
+  swBenchmarkCase benchmark;
+  ASSERT_FALSE(swBenchmarkCaseInit(&benchmark, "counter", testContextFunction, &counter, 0));
+  ASSERT_TRUE(swBenchmarkCaseInit(&benchmark, "counter", testContextFunction, &counter, 1000));
+  ASSERT_TRUE(swBenchmarkCaseRun(&benchmark));
+  // calls this short need batches
+  ASSERT_TRUE(benchmark.batchSize > 1);
+  ASSERT_EQUAL(benchmark.iterations, benchmark.batchSize * 1000);
+  ASSERT_EQUAL(counter, benchmark.iterations + benchmark.warmupIterations + (benchmark.batchSize * 2 - 1));
+  ASSERT_EQUAL(benchmark.histogram.count, 1000);
+  ASSERT_TRUE(swHistogramPercentileGet(&(benchmark.histogram), 50) <= swHistogramPercentileGet(&(benchmark.histogram), 99));
+  ASSERT_TRUE(benchmark.outliersLow + benchmark.outliersHigh < 1000);
+  swTestLogLine("batch = %lu, mean = %.3f ns, deviation = %.3f, p50 = %lu, p99 = %lu, p99.9 = %lu, max = %lu, outliers = %lu/%lu\n",
+                benchmark.batchSize, benchmark.mean, benchmark.deviation, swHistogramPercentileGet(&(benchmark.histogram), 50),
+                swHistogramPercentileGet(&(benchmark.histogram), 99), swHistogramPercentileGet(&(benchmark.histogram), 99.9),
+                benchmark.histogram.max, benchmark.outliersLow, benchmark.outliersHigh);
+
+  // fixed batch size is used as is
+  benchmark.batchSize = 3;
+  benchmark.warmupIterations = 0;
+  counter = 0;
+  ASSERT_TRUE(swBenchmarkCaseRun(&benchmark));
+  ASSERT_EQUAL(counter, 3000);
+  swBenchmarkCaseRelease(&benchmark);
+  return true;
+}
+
+swTestDeclare(BenchmarkCaseOutputTest, NULL, NULL, swTestRun)
+{
+  uint64_t counter = 0;
+  swBenchmarkCase benchmark;
+  ASSERT_TRUE(swBenchmarkCaseInit(&benchmark, "output", testContextFunction, &counter, 100));
+  ASSERT_TRUE(swBenchmarkCaseRun(&benchmark));
+
+  char *output = NULL;
+  size_t outputSize = 0;
+  FILE *file = open_memstream(&output, &outputSize);
+  ASSERT_NOT_NULL(file);
+  ASSERT_TRUE(swBenchmarkCaseJSONPrint(&benchmark, file));
+  fclose(file);
+  swTestLogLine("%s", output);
+  const char *expected = "{\"name\":\"output\",\"samples\":100,";
+  ASSERT_TRUE(strncmp(output, expected, strlen(expected)) == 0);
+  ASSERT_NOT_NULL(strstr(output, "\"p99.9\":"));
+  free(output);
+
+  output = NULL;
+  file = open_memstream(&output, &outputSize);
+  ASSERT_NOT_NULL(file);
+  swBenchmarkCaseCSVHeaderPrint(file);
+  ASSERT_TRUE(swBenchmarkCaseCSVPrint(&benchmark, file));
+  fclose(file);
+  swTestLogLine("%s", output);
+  char *row = strchr(output, '\n');
+  ASSERT_NOT_NULL(row);
+  ASSERT_TRUE(strncmp(row + 1, "output,100,", 11) == 0);
+  free(output);
+  swBenchmarkCaseRelease(&benchmark);
+  return true;
+}
+
+swTestDeclare(BenchmarkCasePerfCountersTest, NULL, NULL, swTestRun)
+{
+  uint64_t counter = 0;
+  swBenchmarkCase benchmark;
+  ASSERT_TRUE(swBenchmarkCaseInit(&benchmark, "perf", testContextFunction, &counter, 100));
+  benchmark.perfCounters = true;
+  ASSERT_TRUE(swBenchmarkCaseRun(&benchmark));
+  // counters are optional, the timing has to be there either way
+  ASSERT_EQUAL(benchmark.histogram.count, 100);
+  if (benchmark.perfCountersAvailable & (1 << swPerfCounterInstructions))
+  {
+    swTestLogLine("instructions per call = %.3f\n", benchmark.perfCounterValues[swPerfCounterInstructions]);
+    ASSERT_TRUE(benchmark.perfCounterValues[swPerfCounterInstructions] > 0);
+  }
+  else
+    swTestLogLine("perf counters are not available\n");
+  swBenchmarkCaseRelease(&benchmark);
+  return true;
+}
+
+swBenchmarkDeclare(BenchmarkDeclared, NULL, NULL, 100)
+{
+  testContextFunction(context);
+}
+
+swTestDeclare(BenchmarkDeclarationTest, NULL, NULL, swTestRun)
+{
+  swBenchmarkDeclaration *begin = NULL;
+  swBenchmarkDeclaration *end = NULL;
+  ASSERT_TRUE(swBenchmarkDeclarationsGet(&begin, &end));
+  swBenchmarkDeclaration *found = NULL;
+  for (swBenchmarkDeclaration *declaration = begin; declaration != end; declaration++)
+  {
+    if (declaration->name && (strcmp(declaration->name, "BenchmarkDeclared") == 0))
+      found = declaration;
+  }
+  ASSERT_NOT_NULL(found);
+  if (found)
+  {
+    uint64_t counter = 0;
+    ASSERT_EQUAL(found->sampleSize, 100);
+    found->func(&counter);
+    ASSERT_EQUAL(counter, 1);
+  }
+  return true;
+}
+
+swTestDeclare(BenchmarkBaselineTest, NULL, NULL, swTestRun)
+{
+  swBenchmarkSummary summaries[] =
+  {
+    { .name = "first", .count = 1000, .mean = 10.0, .deviation = 1.0 },
+    { .name = "second", .count = 1000, .mean = 200.5, .deviation = 20.25 }
+  };
+  char path[] = "/tmp/benchmark-baseline-XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_TRUE(fd >= 0);
+  close(fd);
+  ASSERT_TRUE(swBenchmarkBaselineSave(path, summaries, 2));
+  uint32_t count = 0;
+  swBenchmarkSummary *loaded = swBenchmarkBaselineLoad(path, &count);
+  unlink(path);
+  ASSERT_NOT_NULL(loaded);
+  ASSERT_EQUAL(count, 2);
+  const swBenchmarkSummary *second = swBenchmarkBaselineFind(loaded, count, "second");
+  ASSERT_NOT_NULL(second);
+  ASSERT_EQUAL(second->count, 1000);
+  ASSERT_TRUE(second->mean == 200.5);
+  ASSERT_TRUE(second->deviation == 20.25);
+  ASSERT_NULL(swBenchmarkBaselineFind(loaded, count, "third"));
+  swMemoryFree(loaded);
+  ASSERT_NULL(swBenchmarkBaselineLoad("/nonexistent/baseline", &count));
+  return true;
+}
+
+swTestDeclare(BenchmarkRegressionTest, NULL, NULL, swTestRun)
+{
+  swBenchmarkSummary baseline = { .name = "test", .count = 1000, .mean = 100.0, .deviation = 10.0 };
+  swBenchmarkSummary current = baseline;
+  double pValue = 0;
+  // same numbers
+  ASSERT_FALSE(swBenchmarkRegressionCheck(&baseline, &current, SW_BENCHMARK_THRESHOLD, SW_BENCHMARK_SIGNIFICANCE, &pValue));
+  ASSERT_TRUE(pValue == 0.5);
+  // faster
+  current.mean = 80.0;
+  ASSERT_FALSE(swBenchmarkRegressionCheck(&baseline, &current, SW_BENCHMARK_THRESHOLD, SW_BENCHMARK_SIGNIFICANCE, &pValue));
+  // significant, but below the threshold
+  current.mean = 103.0;
+  ASSERT_FALSE(swBenchmarkRegressionCheck(&baseline, &current, SW_BENCHMARK_THRESHOLD, SW_BENCHMARK_SIGNIFICANCE, &pValue));
+  ASSERT_TRUE(pValue < SW_BENCHMARK_SIGNIFICANCE);
+  // slower and significant
+  current.mean = 110.0;
+  ASSERT_TRUE(swBenchmarkRegressionCheck(&baseline, &current, SW_BENCHMARK_THRESHOLD, SW_BENCHMARK_SIGNIFICANCE, &pValue));
+  // slower, but too noisy to tell
+  current.count = 10;
+  current.deviation = 100.0;
+  ASSERT_FALSE(swBenchmarkRegressionCheck(&baseline, &current, SW_BENCHMARK_THRESHOLD, SW_BENCHMARK_SIGNIFICANCE, &pValue));
+  ASSERT_TRUE(pValue > SW_BENCHMARK_SIGNIFICANCE);
+  return true;
+}
 
 swTestSuiteStructDeclare(BenchmarkTest, NULL, NULL, swTestRun,
-                         &BenchmarkBasicTest, &BenchmarkRealTimeTest, &BenchmarkMonotonicTest, &BenchmarkMonotonicRawTest, &BenchmarkCPUTimeTest);
+                         &BenchmarkBasicTest, &BenchmarkRealTimeTest, &BenchmarkMonotonicTest, &BenchmarkMonotonicRawTest, &BenchmarkCPUTimeTest,
+                         &BenchmarkCaseTest, &BenchmarkCaseOutputTest, &BenchmarkCasePerfCountersTest, &BenchmarkDeclarationTest, &BenchmarkBaselineTest, &BenchmarkRegressionTest);
 
@@ -3,6 +3,8 @@
 #include "core/stop-watch.h"
 #include "core/time.h"
 
+#include <math.h>
+#include <stdlib.h>
 #include <string.h>
 
 bool swBenchmarkTicksReset(swBenchmark *benchmark, uint32_t sampleSize, void (*func)())
@@ -172,3 +174,199 @@ bool swBenchmarkTimeRun(swBenchmark *benchmark)
   }
   return rtn;
 }
+
+bool swBenchmarkCaseInit(swBenchmarkCase *benchmark, const char *name, swBenchmarkFunction func, void *context, uint32_t sampleSize)
+{
+  bool rtn = false;
+  if (benchmark && name && func && sampleSize)
+  {
+    memset(benchmark, 0, sizeof(*benchmark));
+    benchmark->name = name;
+    benchmark->func = func;
+    benchmark->context = context;
+    benchmark->clockId = CLOCK_MONOTONIC;
+    benchmark->warmupIterations = SW_BENCHMARK_WARMUP_DEFAULT;
+    benchmark->sampleSize = sampleSize;
+    benchmark->batchTime = SW_BENCHMARK_BATCH_TIME_DEFAULT;
+    rtn = true;
+  }
+  return rtn;
+}
+
+static inline uint64_t swBenchmarkCaseBatchRun(swBenchmarkCase *benchmark, uint64_t batchSize)
+{
+  swBenchmarkFunction func = benchmark->func;
+  void *context = benchmark->context;
+  uint64_t start = swTimeGet(benchmark->clockId);
+  for (uint64_t i = 0; i < batchSize; i++)
+    func(context);
+  return swTimeGet(benchmark->clockId) - start;
+}
+
+static void swBenchmarkCaseCalibrate(swBenchmarkCase *benchmark)
+{
+  uint64_t batchSize = 1;
+  while (batchSize < SW_BENCHMARK_BATCH_SIZE_MAX)
+  {
+    if (swBenchmarkCaseBatchRun(benchmark, batchSize) >= benchmark->batchTime)
+      break;
+    batchSize <<= 1;
+  }
+  benchmark->batchSize = batchSize;
+}
+
+static int swBenchmarkSampleCompare(const void *first, const void *second)
+{
+  double difference = *(const double *)first - *(const double *)second;
+  return (difference > 0) - (difference < 0);
+}
+
+// quartile by linear interpolation between the closest ranks of the sorted samples
+static double swBenchmarkQuartile(double *sorted, uint32_t count, double fraction)
+{
+  double position = fraction * (count - 1);
+  uint32_t index = (uint32_t)position;
+  return (index + 1 < count)? sorted[index] + (position - index) * (sorted[index + 1] - sorted[index]) : sorted[index];
+}
+
+bool swBenchmarkCaseRun(swBenchmarkCase *benchmark)
+{
+  bool rtn = false;
+  if (benchmark && benchmark->func && benchmark->sampleSize)
+  {
+    swMemoryFree(benchmark->samples);
+    if ((benchmark->samples = swMemoryMalloc(benchmark->sampleSize * sizeof(double))))
+    {
+      swHistogramClear(&(benchmark->histogram));
+      benchmark->iterations = 0;
+      benchmark->totalTime = 0;
+      swBenchmarkCaseBatchRun(benchmark, benchmark->warmupIterations);
+      if (!benchmark->batchSize)
+        swBenchmarkCaseCalibrate(benchmark);
+
+      swPerfCounters counters;
+      bool countersStarted = false;
+      benchmark->perfCountersAvailable = 0;
+      memset(benchmark->perfCounterValues, 0, sizeof(benchmark->perfCounterValues));
+      if (benchmark->perfCounters && swPerfCountersInit(&counters))
+        countersStarted = swPerfCountersStart(&counters);
+      for (uint32_t i = 0; i < benchmark->sampleSize; i++)
+      {
+        uint64_t batchTime = swBenchmarkCaseBatchRun(benchmark, benchmark->batchSize);
+        benchmark->samples[i] = (double)batchTime / benchmark->batchSize;
+        swHistogramRecord(&(benchmark->histogram), (batchTime + (benchmark->batchSize >> 1)) / benchmark->batchSize);
+        benchmark->totalTime += batchTime;
+        benchmark->iterations += benchmark->batchSize;
+      }
+      if (countersStarted && swPerfCountersStop(&counters))
+      {
+        benchmark->perfCountersAvailable = counters.available;
+        for (uint32_t i = 0; i < swPerfCounterMax; i++)
+          benchmark->perfCounterValues[i] = (double)counters.values[i] / benchmark->iterations;
+      }
+      if (benchmark->perfCounters)
+        swPerfCountersRelease(&counters);
+      benchmark->mean = (double)benchmark->totalTime / benchmark->iterations;
+      double sumOfSquares = 0;
+      for (uint32_t i = 0; i < benchmark->sampleSize; i++)
+        sumOfSquares += (benchmark->samples[i] - benchmark->mean) * (benchmark->samples[i] - benchmark->mean);
+      benchmark->deviation = sqrt(sumOfSquares / benchmark->sampleSize);
+
+      // the histogram rounds to whole nanoseconds, fences are computed from the exact samples
+      double *sorted = swMemoryMalloc(benchmark->sampleSize * sizeof(double));
+      if (sorted)
+      {
+        memcpy(sorted, benchmark->samples, benchmark->sampleSize * sizeof(double));
+        qsort(sorted, benchmark->sampleSize, sizeof(double), swBenchmarkSampleCompare);
+        double q1 = swBenchmarkQuartile(sorted, benchmark->sampleSize, 0.25);
+        double q3 = swBenchmarkQuartile(sorted, benchmark->sampleSize, 0.75);
+        double low = q1 - 1.5 * (q3 - q1);
+        double high = q3 + 1.5 * (q3 - q1);
+        benchmark->outliersLow = benchmark->outliersHigh = 0;
+        for (uint32_t i = 0; i < benchmark->sampleSize; i++)
+        {
+          if (sorted[i] < low)
+            benchmark->outliersLow++;
+          else if (sorted[i] > high)
+            benchmark->outliersHigh++;
+        }
+        swMemoryFree(sorted);
+        rtn = true;
+      }
+    }
+  }
+  return rtn;
+}
+
+void swBenchmarkCaseRelease(swBenchmarkCase *benchmark)
+{
+  if (benchmark)
+  {
+    swMemoryFree(benchmark->samples);
+    benchmark->samples = NULL;
+  }
+}
+
+bool swBenchmarkCaseJSONPrint(swBenchmarkCase *benchmark, FILE *file)
+{
+  bool rtn = false;
+  if (benchmark && file)
+  {
+    swHistogram *histogram = &(benchmark->histogram);
+    if (fprintf(file, "{\"name\":\"%s\",\"samples\":%u,\"batchSize\":%lu,\"iterations\":%lu,"
+                      "\"mean\":%.3f,\"deviation\":%.3f,\"min\":%lu,\"p50\":%lu,\"p99\":%lu,\"p99.9\":%lu,\"max\":%lu,"
+                      "\"outliersLow\":%lu,\"outliersHigh\":%lu",
+                benchmark->name, benchmark->sampleSize, benchmark->batchSize, benchmark->iterations,
+                benchmark->mean, benchmark->deviation, histogram->min, swHistogramPercentileGet(histogram, 50),
+                swHistogramPercentileGet(histogram, 99), swHistogramPercentileGet(histogram, 99.9), histogram->max,
+                benchmark->outliersLow, benchmark->outliersHigh) > 0)
+    {
+      rtn = true;
+      for (uint32_t i = 0; rtn && (i < swPerfCounterMax); i++)
+      {
+        if ((benchmark->perfCountersAvailable & (1 << i)) && (fprintf(file, ",\"%s\":%.3f", swPerfCounterTextGet(i), benchmark->perfCounterValues[i]) <= 0))
+          rtn = false;
+      }
+      if (rtn && (fprintf(file, "}\n") <= 0))
+        rtn = false;
+    }
+  }
+  return rtn;
+}
+
+// counter columns are always there, empty when the counter is not available
+void swBenchmarkCaseCSVHeaderPrint(FILE *file)
+{
+  if (file)
+  {
+    fprintf(file, "name,samples,batch_size,iterations,mean_ns,deviation_ns,min_ns,p50_ns,p99_ns,p99.9_ns,max_ns,outliers_low,outliers_high");
+    for (uint32_t i = 0; i < swPerfCounterMax; i++)
+      fprintf(file, ",%s", swPerfCounterTextGet(i));
+    fprintf(file, "\n");
+  }
+}
+
+bool swBenchmarkCaseCSVPrint(swBenchmarkCase *benchmark, FILE *file)
+{
+  bool rtn = false;
+  if (benchmark && file)
+  {
+    swHistogram *histogram = &(benchmark->histogram);
+    if (fprintf(file, "%s,%u,%lu,%lu,%.3f,%.3f,%lu,%lu,%lu,%lu,%lu,%lu,%lu",
+                benchmark->name, benchmark->sampleSize, benchmark->batchSize, benchmark->iterations,
+                benchmark->mean, benchmark->deviation, histogram->min, swHistogramPercentileGet(histogram, 50),
+                swHistogramPercentileGet(histogram, 99), swHistogramPercentileGet(histogram, 99.9), histogram->max,
+                benchmark->outliersLow, benchmark->outliersHigh) > 0)
+    {
+      rtn = true;
+      for (uint32_t i = 0; rtn && (i < swPerfCounterMax); i++)
+      {
+        if (((benchmark->perfCountersAvailable & (1 << i))? fprintf(file, ",%.3f", benchmark->perfCounterValues[i]) : fprintf(file, ",")) <= 0)
+          rtn = false;
+      }
+      if (rtn && (fprintf(file, "\n") <= 0))
+        rtn = false;
+    }
+  }
+  return rtn;
+}
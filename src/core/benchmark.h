@@ -1,8 +1,12 @@
 #ifndef SW_CORE_BENCHMARK_H
 #define SW_CORE_BENCHMARK_H
 
+#include "core/histogram.h"
+#include "core/perf-counters.h"
+
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <time.h>
 
 typedef struct swBenchmark
@@ -26,4 +30,85 @@ bool swBenchmarkTicksRun(swBenchmark *benchmark);
 bool swBenchmarkTimeReset(swBenchmark *benchmark, clockid_t clockId, uint32_t sampleSize, void (*func)());
 bool swBenchmarkTimeRun(swBenchmark *benchmark);
 
+// benchmark of a function with a context: warmup calls first, then sampleSize batches are timed
+// and the time per call of every batch goes into the histogram; batch size is calibrated,
+// when not set, by doubling it till one batch takes at least batchTime, so the clock overhead
+// does not hide calls that take only a few nanoseconds
+
+typedef void (*swBenchmarkFunction)(void *context);
+
+#define SW_BENCHMARK_WARMUP_DEFAULT     1000
+#define SW_BENCHMARK_BATCH_TIME_DEFAULT 10000   // 10us
+#define SW_BENCHMARK_BATCH_SIZE_MAX     (1UL << 24)
+
+typedef struct swBenchmarkCase
+{
+  const char *name;
+  swBenchmarkFunction func;
+  void *context;
+  clockid_t clockId;
+  uint32_t warmupIterations;
+  uint32_t sampleSize;
+  uint64_t batchSize;
+  uint64_t batchTime;
+
+  // results, all times are per call in nanoseconds
+  swHistogram histogram;
+  uint64_t iterations;
+  uint64_t totalTime;
+  double mean;
+  double deviation;
+  // exact time per call of every batch, kept till the next run or release
+  double *samples;
+  // samples outside of the Tukey fences (1.5 interquartile ranges below p25 or above p75)
+  uint64_t outliersLow;
+  uint64_t outliersHigh;
+  // set perfCounters before the run to count hardware events per call over all the samples
+  // (the clock reads between the batches are included), only the available counters are reported
+  bool perfCounters;
+  uint32_t perfCountersAvailable;
+  double perfCounterValues[swPerfCounterMax];
+} swBenchmarkCase;
+
+bool swBenchmarkCaseInit(swBenchmarkCase *benchmark, const char *name, swBenchmarkFunction func, void *context, uint32_t sampleSize);
+bool swBenchmarkCaseRun(swBenchmarkCase *benchmark);
+void swBenchmarkCaseRelease(swBenchmarkCase *benchmark);
+
+// machine readable output, one line per benchmark
+bool swBenchmarkCaseJSONPrint(swBenchmarkCase *benchmark, FILE *file);
+void swBenchmarkCaseCSVHeaderPrint(FILE *file);
+bool swBenchmarkCaseCSVPrint(swBenchmarkCase *benchmark, FILE *file);
+
+// benchmarks declared with swBenchmarkDeclare are placed in the ".benchmark" section and picked up by
+// the runner (core/benchmark-runner.h), setup returns the context passed to every call and to teardown
+
+#define SW_BENCHMARK_DECLARATION_MAGIC (0xdeadbef5)
+
+typedef void *(*swBenchmarkSetupFunction)();
+typedef void (*swBenchmarkTeardownFunction)(void *context);
+
+typedef struct swBenchmarkDeclaration
+{
+  const char *name;
+  swBenchmarkSetupFunction setupFunc;
+  swBenchmarkTeardownFunction teardownFunc;
+  swBenchmarkFunction func;
+  uint32_t sampleSize;
+  uint32_t magic;
+// the section is walked by the structure size, it has to match the alignment of the static declarations
+} __attribute__ ((aligned(32))) swBenchmarkDeclaration;
+
+#define swBenchmarkDeclare(nameIn, setup, teardown, sampleSizeIn) \
+  void nameIn##Run(void *context); \
+  static swBenchmarkDeclaration nameIn##Declaration __attribute__ ((used, section(".benchmark"))) = \
+  { \
+    .name = #nameIn, \
+    .setupFunc = (swBenchmarkSetupFunction) setup, \
+    .teardownFunc = (swBenchmarkTeardownFunction) teardown, \
+    .func = nameIn##Run, \
+    .sampleSize = (sampleSizeIn), \
+    .magic = SW_BENCHMARK_DECLARATION_MAGIC \
+  }; \
+  void nameIn##Run(void *context)
+
 #endif // SW_CORE_BENCHMARK_H
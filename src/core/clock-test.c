@@ -0,0 +1,76 @@
+#include "core/clock.h"
+#include "core/stop-watch.h"
+
+#include "unittest/unittest.h"
+
+#include <stdlib.h>
+
+static void testFunction(void)
+{
+  struct timespec sleepTime = { .tv_sec = 0, .tv_nsec = swTimeMSecToNSec(10) };
+  nanosleep(&sleepTime, NULL);
+}
+
+// fallback clocks are used before the calibration
+swTestDeclare(ClockFallbackTest, NULL, NULL, swTestRun)
+{
+  ASSERT_FALSE(swClockTSCIsUsed());
+  uint64_t monotonic = swTimeGet(CLOCK_MONOTONIC);
+  uint64_t now = swClockNow();
+  ASSERT_TRUE(now >= monotonic);
+  ASSERT_TRUE(now - monotonic < swTimeMSecToNSec(100));
+  uint64_t realtime = swTimeGet(CLOCK_REALTIME);
+  ASSERT_TRUE(llabs((int64_t)(swClockRealtimeNow() - realtime)) < (int64_t)swTimeMSecToNSec(100));
+  ASSERT_TRUE(swClockCachedGet() >= now);
+  return true;
+}
+
+swTestDeclare(ClockCalibratedTest, NULL, NULL, swTestRun)
+{
+  ASSERT_TRUE(swClockInit(0));
+  swTestLogLine("TSC invariant = %s, used = %s, frequency = %lu Hz\n", swClockTSCIsInvariant()? "yes" : "no",
+                swClockTSCIsUsed()? "yes" : "no", swClockFrequencyGet());
+  ASSERT_TRUE(swClockFrequencyGet() > 0);
+
+  // both clocks agree within a millisecond and the TSC one does not go back
+  uint64_t previous = 0;
+  for (uint32_t i = 0; i < 1000; i++)
+  {
+    uint64_t now = swClockNow();
+    uint64_t monotonic = swTimeGet(CLOCK_MONOTONIC);
+    if ((now < previous) || (llabs((int64_t)(now - monotonic)) > (int64_t)SW_TIME_1M))
+    {
+      ASSERT_TRUE(now >= previous);
+      ASSERT_EQUAL(now, monotonic);
+    }
+    previous = now;
+  }
+  uint64_t realtime = swTimeGet(CLOCK_REALTIME);
+  ASSERT_TRUE(llabs((int64_t)(swClockRealtimeNow() - realtime)) < (int64_t)SW_TIME_1M);
+
+  // the cached value only moves on update
+  uint64_t cached = swClockCachedUpdate();
+  testFunction();
+  ASSERT_EQUAL(swClockCachedGet(), cached);
+  ASSERT_TRUE(swClockCachedUpdate() >= cached + swTimeMSecToNSec(10));
+  ASSERT_TRUE(llabs((int64_t)(swClockCachedRealtimeGet() - swTimeGet(CLOCK_REALTIME))) < (int64_t)SW_TIME_1M);
+
+  uint64_t beforeRecalibrate = swClockNow();
+  ASSERT_EQUAL(swClockRecalibrate(), swClockTSCIsUsed());
+  ASSERT_TRUE(swClockNow() >= beforeRecalibrate);
+  return true;
+}
+
+swTestDeclare(ClockStopWatchTest, NULL, NULL, swTestRun)
+{
+  swStopWatch watch = { 0 };
+  swStopWatchPrepare(&watch);
+  swStopWatchMeasure(&watch, testFunction);
+  uint64_t elapsed = swStopWatchNSecGet(&watch);
+  swTestLogLine("Stop watch ticks = %lu, %lu ns\n", watch.timeTicks, elapsed);
+  ASSERT_TRUE((elapsed >= swTimeMSecToNSec(9)) && (elapsed < swTimeMSecToNSec(100)));
+  return true;
+}
+
+swTestSuiteStructDeclare(ClockTest, NULL, NULL, swTestRun,
+                         &ClockFallbackTest, &ClockCalibratedTest, &ClockStopWatchTest);
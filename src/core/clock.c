@@ -0,0 +1,130 @@
+#include "core/clock.h"
+
+#include <cpuid.h>
+#include <errno.h>
+
+#define SW_CLOCK_ANCHOR_ATTEMPTS  8
+
+swClock swClockGlobal = { 0 };
+__thread swClockCache swClockThreadCache = { 0 };
+
+typedef struct swClockSample
+{
+  uint64_t tsc;
+  uint64_t monotonic;
+  uint64_t realtime;
+} swClockSample;
+
+// takes the reading with the fewest ticks around clock_gettime, so the TSC value is the one
+// of the moment the monotonic time was taken within a few ticks
+static bool swClockSampleTake(swClockSample *sample)
+{
+  bool rtn = false;
+  uint64_t bestWidth = UINT64_MAX;
+  for (uint32_t i = 0; i < SW_CLOCK_ANCHOR_ATTEMPTS; i++)
+  {
+    struct timespec monotonic = {0};
+    struct timespec realtime = {0};
+    uint64_t before = swClockTicks();
+    if (clock_gettime(CLOCK_MONOTONIC, &monotonic))
+      break;
+    uint64_t after = swClockTicks();
+    if (clock_gettime(CLOCK_REALTIME, &realtime))
+      break;
+    if ((after >= before) && ((after - before) < bestWidth))
+    {
+      bestWidth = after - before;
+      sample->tsc = before + ((after - before) >> 1);
+      sample->monotonic = swTimeSecToNSec(monotonic.tv_sec) + monotonic.tv_nsec;
+      sample->realtime = swTimeSecToNSec(realtime.tv_sec) + realtime.tv_nsec;
+      rtn = true;
+    }
+  }
+  return rtn;
+}
+
+bool swClockTSCIsInvariant()
+{
+  bool rtn = false;
+  unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+  if ((__get_cpuid_max(0x80000000, NULL) >= 0x80000007) && __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+    rtn = ((edx & (1 << 8)) != 0);
+  return rtn;
+}
+
+static void swClockAnchorSet(const swClockSample *sample, uint64_t monotonic, uint64_t multiplier)
+{
+  __atomic_store_n(&(swClockGlobal.sequence), swClockGlobal.sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  swClockGlobal.tscAnchor = sample->tsc;
+  swClockGlobal.monotonicAnchor = monotonic;
+  swClockGlobal.realtimeOffset = sample->realtime - sample->monotonic;
+  swClockGlobal.multiplier = multiplier;
+  __atomic_store_n(&(swClockGlobal.sequence), swClockGlobal.sequence + 1, __ATOMIC_RELEASE);
+}
+
+// nanoseconds per tick in fixed point and ticks per second between two samples
+static bool swClockRateGet(const swClockSample *first, const swClockSample *last, uint64_t *multiplier, uint64_t *frequency)
+{
+  bool rtn = false;
+  if ((last->tsc > first->tsc) && (last->monotonic > first->monotonic))
+  {
+    uint64_t ticks = last->tsc - first->tsc;
+    uint64_t nanoseconds = last->monotonic - first->monotonic;
+    *multiplier = (uint64_t)(((unsigned __int128)nanoseconds << SW_CLOCK_SHIFT) / ticks);
+    *frequency = (uint64_t)(((unsigned __int128)ticks * SW_TIME_1B) / nanoseconds);
+    rtn = (*multiplier != 0);
+  }
+  return rtn;
+}
+
+bool swClockInit(uint64_t calibrationTime)
+{
+  bool rtn = false;
+  swClockSample first = {0};
+  swClockGlobal.tsc = false;
+  if (!calibrationTime)
+    calibrationTime = SW_CLOCK_CALIBRATION_TIME;
+  if (swClockSampleTake(&first))
+  {
+    struct timespec sleepTime = { .tv_sec = swTimeNSecToSec(calibrationTime), .tv_nsec = swTimeNSecToSecRem(calibrationTime) };
+    swClockSample last = {0};
+    uint64_t multiplier = 0;
+    uint64_t frequency = 0;
+    // the sleep does not need to be exact, only the samples around it
+    while (nanosleep(&sleepTime, &sleepTime) && (errno == EINTR));
+    if (swClockSampleTake(&last) && swClockRateGet(&first, &last, &multiplier, &frequency))
+    {
+      swClockGlobal.tscBase = first.tsc;
+      swClockGlobal.monotonicBase = first.monotonic;
+      swClockGlobal.frequency = frequency;
+      swClockAnchorSet(&last, last.monotonic, multiplier);
+      // the rate is still known for converting tick differences when the TSC can not be used as a clock
+      swClockGlobal.tsc = swClockTSCIsInvariant();
+      swClockThreadCache.now = 0;
+      rtn = true;
+    }
+  }
+  return rtn;
+}
+
+bool swClockRecalibrate()
+{
+  bool rtn = false;
+  swClockSample sample = {0};
+  if (swClockGlobal.tsc && swClockSampleTake(&sample))
+  {
+    swClockSample base = { .tsc = swClockGlobal.tscBase, .monotonic = swClockGlobal.monotonicBase };
+    uint64_t multiplier = 0;
+    uint64_t frequency = 0;
+    if (swClockRateGet(&base, &sample, &multiplier, &frequency))
+    {
+      // a clock that ran ahead is held at its current value instead of stepping back
+      uint64_t current = swClockGlobal.monotonicAnchor + swClockTicksToNSec(sample.tsc - swClockGlobal.tscAnchor);
+      swClockGlobal.frequency = frequency;
+      swClockAnchorSet(&sample, (current > sample.monotonic)? current : sample.monotonic, multiplier);
+      rtn = true;
+    }
+  }
+  return rtn;
+}
@@ -0,0 +1,128 @@
+#ifndef SW_CORE_CLOCK_H
+#define SW_CORE_CLOCK_H
+
+#include "core/time.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// monotonic and realtime nanoseconds computed from the TSC, a few nanoseconds per call instead
+// of a clock_gettime; the TSC is used only when it is invariant (constant rate in all P and
+// C states), otherwise the functions fall back to clock_gettime transparently, the same happens
+// until swClockInit is called
+//
+// the TSC rate is measured against CLOCK_MONOTONIC, so the clocks drift apart with the NTP
+// adjustments, swClockRecalibrate re-anchors and refines the rate over the whole time
+// since swClockInit; the clock never goes backwards across the recalibrations
+
+#define SW_CLOCK_CALIBRATION_TIME   (10 * SW_TIME_1M)
+#define SW_CLOCK_SHIFT              32
+
+typedef struct swClock
+{
+  // odd while the anchor is updated
+  uint32_t sequence;
+  bool tsc;
+  uint64_t tscAnchor;
+  uint64_t monotonicAnchor;
+  // realtime - monotonic at the anchor
+  uint64_t realtimeOffset;
+  // nanoseconds per tick, fixed point with SW_CLOCK_SHIFT fractional bits
+  uint64_t multiplier;
+  // ticks per second
+  uint64_t frequency;
+  // first anchor, the rate gets more precise the further the recalibration is from it
+  uint64_t tscBase;
+  uint64_t monotonicBase;
+} swClock;
+
+extern swClock swClockGlobal;
+
+// per thread time of the last swClockCachedUpdate
+typedef struct swClockCache
+{
+  uint64_t now;
+  uint64_t realtime;
+} swClockCache;
+
+extern __thread swClockCache swClockThreadCache;
+
+// measures the TSC rate for calibrationTime nanoseconds (0 for SW_CLOCK_CALIBRATION_TIME),
+// has to be called before the threads using the clock are started
+bool swClockInit(uint64_t calibrationTime);
+bool swClockRecalibrate();
+// invariant TSC flag of CPUID
+bool swClockTSCIsInvariant();
+
+#define swClockTSCIsUsed()      (swClockGlobal.tsc)
+#define swClockFrequencyGet()   (swClockGlobal.frequency)
+
+static inline uint64_t swClockTicks()
+{
+  uint32_t low = 0;
+  uint32_t high = 0;
+  asm volatile ("RDTSC\n\t" : "=a" (low), "=d" (high));
+  return ((uint64_t)high << 32) | low;
+}
+
+// converts a tick difference, for example the one of swStopWatch, 0 before swClockInit
+static inline uint64_t swClockTicksToNSec(uint64_t ticks)
+{
+  return (uint64_t)(((unsigned __int128)ticks * swClockGlobal.multiplier) >> SW_CLOCK_SHIFT);
+}
+
+static inline uint64_t swClockNow()
+{
+  if (swClockGlobal.tsc)
+  {
+    uint64_t rtn = 0;
+    uint32_t sequence = 0;
+    do
+    {
+      sequence = __atomic_load_n(&(swClockGlobal.sequence), __ATOMIC_ACQUIRE);
+      uint64_t ticks = swClockTicks();
+      uint64_t tscAnchor = swClockGlobal.tscAnchor;
+      rtn = swClockGlobal.monotonicAnchor + swClockTicksToNSec((ticks > tscAnchor)? ticks - tscAnchor : 0);
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((sequence & 1) || (sequence != __atomic_load_n(&(swClockGlobal.sequence), __ATOMIC_RELAXED)));
+    return rtn;
+  }
+  return swTimeGet(CLOCK_MONOTONIC);
+}
+
+static inline uint64_t swClockRealtimeNow()
+{
+  if (swClockGlobal.tsc)
+    return swClockNow() + swClockGlobal.realtimeOffset;
+  return swTimeGet(CLOCK_REALTIME);
+}
+
+// meant to be called once per loop iteration or batch, the cached values are read for free
+static inline uint64_t swClockCachedUpdate()
+{
+  if (swClockGlobal.tsc)
+  {
+    swClockThreadCache.now = swClockNow();
+    swClockThreadCache.realtime = swClockThreadCache.now + swClockGlobal.realtimeOffset;
+  }
+  else
+  {
+    swClockThreadCache.now = swTimeGet(CLOCK_MONOTONIC);
+    swClockThreadCache.realtime = swTimeGet(CLOCK_REALTIME);
+  }
+  return swClockThreadCache.now;
+}
+
+static inline uint64_t swClockCachedGet()
+{
+  return (swClockThreadCache.now)? swClockThreadCache.now : swClockCachedUpdate();
+}
+
+static inline uint64_t swClockCachedRealtimeGet()
+{
+  if (!swClockThreadCache.now)
+    swClockCachedUpdate();
+  return swClockThreadCache.realtime;
+}
+
+#endif // SW_CORE_CLOCK_H
@@ -0,0 +1,75 @@
+#include "core/arena.h"
+#include "core/benchmark.h"
+#include "core/clock.h"
+#include "core/histogram.h"
+#include "core/memory.h"
+#include "core/memory-size-class.h"
+#include "core/time.h"
+
+#define SW_CORE_BENCHMARK_BLOCK_SIZE  64
+
+swBenchmarkDeclare(MemoryMallocFree, NULL, NULL, 10000)
+{
+  swMemoryFree(swMemoryMalloc(SW_CORE_BENCHMARK_BLOCK_SIZE));
+}
+
+swBenchmarkDeclare(SizeClassMallocFree, NULL, NULL, 10000)
+{
+  swMemorySizeClassFree(swMemorySizeClassMalloc(SW_CORE_BENCHMARK_BLOCK_SIZE));
+}
+
+static void *arenaSetup()
+{
+  return swArenaNew(0);
+}
+
+// resets the arena when the current chunk is full, so the benchmark stays in the first chunk
+swBenchmarkDeclare(ArenaAlloc, arenaSetup, swArenaDelete, 10000)
+{
+  swArena *arena = context;
+  if (arena->current && (arena->current->used + SW_CORE_BENCHMARK_BLOCK_SIZE > arena->current->size))
+    swArenaReset(arena);
+  swArenaAlloc(arena, SW_CORE_BENCHMARK_BLOCK_SIZE);
+}
+
+static void *histogramSetup()
+{
+  return swHistogramNew();
+}
+
+swBenchmarkDeclare(HistogramRecord, histogramSetup, swHistogramDelete, 10000)
+{
+  swHistogram *histogram = context;
+  swHistogramRecord(histogram, histogram->count);
+}
+
+swBenchmarkDeclare(TimeGetMonotonic, NULL, NULL, 10000)
+{
+  swTimeGet(CLOCK_MONOTONIC);
+}
+
+swBenchmarkDeclare(TimeGetMonotonicCoarse, NULL, NULL, 10000)
+{
+  swTimeGet(CLOCK_MONOTONIC_COARSE);
+}
+
+static void *clockSetup()
+{
+  swClockInit(0);
+  return NULL;
+}
+
+swBenchmarkDeclare(ClockNow, clockSetup, NULL, 10000)
+{
+  swClockNow();
+}
+
+swBenchmarkDeclare(ClockRealtimeNow, clockSetup, NULL, 10000)
+{
+  swClockRealtimeNow();
+}
+
+swBenchmarkDeclare(ClockCachedGet, clockSetup, NULL, 10000)
+{
+  swClockCachedGet();
+}
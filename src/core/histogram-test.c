@@ -0,0 +1,79 @@
+#include "core/histogram.h"
+
+#include "unittest/unittest.h"
+
+swTestDeclare(HistogramBucketTest, NULL, NULL, swTestRun)
+{
+  // exact below 2 * SW_HISTOGRAM_SUB_BUCKETS
+  for (uint64_t value = 0; value < (SW_HISTOGRAM_SUB_BUCKETS << 1); value++)
+  {
+    ASSERT_EQUAL(swHistogramBucketIndex(value), value);
+    ASSERT_EQUAL(swHistogramBucketLowGet(value), value);
+    ASSERT_EQUAL(swHistogramBucketHighGet(value), value);
+  }
+  // buckets cover the whole range without gaps and keep the relative error small
+  uint64_t previousHigh = (SW_HISTOGRAM_SUB_BUCKETS << 1) - 1;
+  for (uint32_t index = (SW_HISTOGRAM_SUB_BUCKETS << 1); index < SW_HISTOGRAM_BUCKET_COUNT; index++)
+  {
+    uint64_t low = swHistogramBucketLowGet(index);
+    uint64_t high = swHistogramBucketHighGet(index);
+    if ((low != previousHigh + 1) || (swHistogramBucketIndex(low) != index) || (swHistogramBucketIndex(high) != index)
+        || ((high - low) > (low / SW_HISTOGRAM_SUB_BUCKETS)))
+    {
+      ASSERT_EQUAL(low, previousHigh + 1);
+      ASSERT_EQUAL(swHistogramBucketIndex(low), index);
+      ASSERT_EQUAL(swHistogramBucketIndex(high), index);
+      break;
+    }
+    previousHigh = high;
+  }
+  ASSERT_EQUAL(previousHigh, UINT64_MAX);
+  ASSERT_EQUAL(swHistogramBucketIndex(UINT64_MAX), SW_HISTOGRAM_BUCKET_COUNT - 1);
+  return true;
+}
+
+swTestDeclare(HistogramPercentileTest, NULL, NULL, swTestRun)
+{
+  swHistogram *histogram = swHistogramNew();
+  ASSERT_NOT_NULL(histogram);
+  ASSERT_EQUAL(swHistogramPercentileGet(histogram, 50), 0);
+  for (uint64_t value = 1; value <= 10000; value++)
+    swHistogramRecord(histogram, value);
+  ASSERT_EQUAL(histogram->count, 10000);
+  ASSERT_EQUAL(histogram->min, 1);
+  ASSERT_EQUAL(histogram->max, 10000);
+  ASSERT_TRUE(swHistogramMeanGet(histogram) == 5000.5);
+
+  uint64_t p50 = swHistogramPercentileGet(histogram, 50);
+  uint64_t p99 = swHistogramPercentileGet(histogram, 99);
+  uint64_t p999 = swHistogramPercentileGet(histogram, 99.9);
+  swTestLogLine("p50 = %lu, p99 = %lu, p99.9 = %lu\n", p50, p99, p999);
+  ASSERT_TRUE((p50 >= 5000) && (p50 <= 5000 + 5000 / SW_HISTOGRAM_SUB_BUCKETS));
+  ASSERT_TRUE((p99 >= 9900) && (p99 <= 10000));
+  ASSERT_TRUE((p999 >= 9990) && (p999 <= 10000));
+  ASSERT_EQUAL(swHistogramPercentileGet(histogram, 100), 10000);
+  ASSERT_EQUAL(swHistogramPercentileGet(histogram, 0), 1);
+
+  ASSERT_EQUAL(swHistogramCountBelow(histogram, 11), 10);
+  ASSERT_EQUAL(swHistogramCountAbove(histogram, 10000), 0);
+  uint64_t countAbove = swHistogramCountAbove(histogram, 9000);
+  ASSERT_TRUE((countAbove <= 1000) && (countAbove >= 1000 - 9000 / SW_HISTOGRAM_SUB_BUCKETS));
+
+  swHistogram *other = swHistogramNew();
+  ASSERT_NOT_NULL(other);
+  swHistogramRecordCount(other, 1000000, 10);
+  swHistogramMerge(histogram, other);
+  ASSERT_EQUAL(histogram->count, 10010);
+  ASSERT_EQUAL(histogram->max, 1000000);
+  ASSERT_EQUAL(swHistogramPercentileGet(histogram, 99.95), 1000000);
+  ASSERT_EQUAL(swHistogramCountAbove(histogram, 10000), 10);
+
+  swHistogramClear(histogram);
+  ASSERT_EQUAL(histogram->count, 0);
+  swHistogramDelete(other);
+  swHistogramDelete(histogram);
+  return true;
+}
+
+swTestSuiteStructDeclare(HistogramTest, NULL, NULL, swTestRun,
+                         &HistogramBucketTest, &HistogramPercentileTest);
@@ -0,0 +1,132 @@
+#include "core/histogram.h"
+#include "core/memory.h"
+
+#include <string.h>
+
+swHistogram *swHistogramNew()
+{
+  return swMemoryCalloc(1, sizeof(swHistogram));
+}
+
+void swHistogramDelete(swHistogram *histogram)
+{
+  swMemoryFree(histogram);
+}
+
+void swHistogramClear(swHistogram *histogram)
+{
+  if (histogram)
+    memset(histogram, 0, sizeof(*histogram));
+}
+
+uint64_t swHistogramBucketLowGet(uint32_t index)
+{
+  uint64_t rtn = index;
+  if (index >= (SW_HISTOGRAM_SUB_BUCKETS << 1))
+  {
+    uint32_t shift = (index >> SW_HISTOGRAM_SUB_BUCKET_BITS) - 1;
+    rtn = ((uint64_t)((index & (SW_HISTOGRAM_SUB_BUCKETS - 1)) + SW_HISTOGRAM_SUB_BUCKETS)) << shift;
+  }
+  return rtn;
+}
+
+uint64_t swHistogramBucketHighGet(uint32_t index)
+{
+  uint64_t rtn = index;
+  if (index >= (SW_HISTOGRAM_SUB_BUCKETS << 1))
+  {
+    uint32_t shift = (index >> SW_HISTOGRAM_SUB_BUCKET_BITS) - 1;
+    // wraps around to UINT64_MAX for the very last bucket
+    rtn = (((uint64_t)((index & (SW_HISTOGRAM_SUB_BUCKETS - 1)) + SW_HISTOGRAM_SUB_BUCKETS + 1)) << shift) - 1;
+  }
+  return rtn;
+}
+
+void swHistogramMerge(swHistogram *histogram, const swHistogram *other)
+{
+  if (histogram && other && other->count)
+  {
+    if (histogram->count)
+    {
+      if (other->min < histogram->min)
+        histogram->min = other->min;
+      if (other->max > histogram->max)
+        histogram->max = other->max;
+    }
+    else
+    {
+      histogram->min = other->min;
+      histogram->max = other->max;
+    }
+    for (uint32_t i = 0; i < SW_HISTOGRAM_BUCKET_COUNT; i++)
+      histogram->buckets[i] += other->buckets[i];
+    histogram->count += other->count;
+    histogram->sum += other->sum;
+  }
+}
+
+uint64_t swHistogramPercentileGet(const swHistogram *histogram, double percentile)
+{
+  uint64_t rtn = 0;
+  if (histogram && histogram->count)
+  {
+    if (percentile >= 100.0)
+      rtn = histogram->max;
+    else
+    {
+      uint64_t target = (uint64_t)((percentile / 100.0) * histogram->count + 0.5);
+      uint64_t seen = 0;
+      if (!target)
+        target = 1;
+      for (uint32_t i = 0; i < SW_HISTOGRAM_BUCKET_COUNT; i++)
+      {
+        seen += histogram->buckets[i];
+        if (seen >= target)
+        {
+          rtn = swHistogramBucketHighGet(i);
+          break;
+        }
+      }
+      if (rtn > histogram->max)
+        rtn = histogram->max;
+      if (rtn < histogram->min)
+        rtn = histogram->min;
+    }
+  }
+  return rtn;
+}
+
+double swHistogramMeanGet(const swHistogram *histogram)
+{
+  return (histogram && histogram->count)? (double)histogram->sum / histogram->count : 0.0;
+}
+
+uint64_t swHistogramCountBelow(const swHistogram *histogram, uint64_t low)
+{
+  uint64_t rtn = 0;
+  if (histogram && histogram->count && (histogram->min < low))
+  {
+    for (uint32_t i = 0; i < SW_HISTOGRAM_BUCKET_COUNT; i++)
+    {
+      if (swHistogramBucketHighGet(i) >= low)
+        break;
+      rtn += histogram->buckets[i];
+    }
+  }
+  return rtn;
+}
+
+uint64_t swHistogramCountAbove(const swHistogram *histogram, uint64_t high)
+{
+  uint64_t rtn = 0;
+  if (histogram && histogram->count && (histogram->max > high))
+  {
+    for (uint32_t i = SW_HISTOGRAM_BUCKET_COUNT; i > 0; i--)
+    {
+      if (swHistogramBucketLowGet(i - 1) <= high)
+        break;
+      rtn += histogram->buckets[i - 1];
+    }
+  }
+  return rtn;
+}
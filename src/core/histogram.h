@@ -0,0 +1,74 @@
+#ifndef SW_CORE_HISTOGRAM_H
+#define SW_CORE_HISTOGRAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// HDR style log-linear histogram: values below 2 * SW_HISTOGRAM_SUB_BUCKETS are counted exactly,
+// every power of 2 above that is split into SW_HISTOGRAM_SUB_BUCKETS linear buckets, so the error
+// of any reported value is below 1/SW_HISTOGRAM_SUB_BUCKETS (~3%) for the whole uint64_t range
+
+#define SW_HISTOGRAM_SUB_BUCKET_BITS  5
+#define SW_HISTOGRAM_SUB_BUCKETS      (1 << SW_HISTOGRAM_SUB_BUCKET_BITS)
+#define SW_HISTOGRAM_BUCKET_COUNT     ((65 - SW_HISTOGRAM_SUB_BUCKET_BITS) * SW_HISTOGRAM_SUB_BUCKETS)
+
+typedef struct swHistogram
+{
+  uint64_t count;
+  uint64_t min;
+  uint64_t max;
+  uint64_t sum;
+  uint64_t buckets[SW_HISTOGRAM_BUCKET_COUNT];
+} swHistogram;
+
+swHistogram *swHistogramNew();
+void swHistogramDelete(swHistogram *histogram);
+void swHistogramClear(swHistogram *histogram);
+
+static inline uint32_t swHistogramBucketIndex(uint64_t value)
+{
+  uint32_t rtn = (uint32_t)value;
+  if (value >= (SW_HISTOGRAM_SUB_BUCKETS << 1))
+  {
+    uint32_t shift = (63 - __builtin_clzl(value)) - SW_HISTOGRAM_SUB_BUCKET_BITS;
+    rtn = (shift << SW_HISTOGRAM_SUB_BUCKET_BITS) + (uint32_t)(value >> shift);
+  }
+  return rtn;
+}
+
+// lowest and highest values counted in the bucket
+uint64_t swHistogramBucketLowGet(uint32_t index);
+uint64_t swHistogramBucketHighGet(uint32_t index);
+
+static inline void swHistogramRecordCount(swHistogram *histogram, uint64_t value, uint64_t count)
+{
+  if (histogram->count)
+  {
+    if (value < histogram->min)
+      histogram->min = value;
+    if (value > histogram->max)
+      histogram->max = value;
+  }
+  else
+    histogram->min = histogram->max = value;
+  histogram->buckets[swHistogramBucketIndex(value)] += count;
+  histogram->count += count;
+  histogram->sum += value * count;
+}
+
+static inline void swHistogramRecord(swHistogram *histogram, uint64_t value)
+{
+  swHistogramRecordCount(histogram, value, 1);
+}
+
+void swHistogramMerge(swHistogram *histogram, const swHistogram *other);
+
+// percentile is in 0-100 range, the highest value of the bucket the percentile falls into is reported
+// capped by the max recorded value, 0 when the histogram is empty
+uint64_t swHistogramPercentileGet(const swHistogram *histogram, double percentile);
+double swHistogramMeanGet(const swHistogram *histogram);
+// number of recorded values in the buckets that are entirely below low or above high
+uint64_t swHistogramCountBelow(const swHistogram *histogram, uint64_t low);
+uint64_t swHistogramCountAbove(const swHistogram *histogram, uint64_t high);
+
+#endif // SW_CORE_HISTOGRAM_H
@@ -0,0 +1,113 @@
+#include "core/huge-page.h"
+#include "collections/dynamic-array.h"
+#include "collections/hash-map-linear.h"
+
+#include "unittest/unittest.h"
+
+#include <string.h>
+
+swTestDeclare(HugePageAllocTest, NULL, NULL, swTestRun)
+{
+  size_t pageSize = swHugePageSizeGet();
+  ASSERT_TRUE(pageSize >= 2 * 1024 * 1024);
+  ASSERT_EQUAL(swHugePageRoundUp(1), pageSize);
+  ASSERT_EQUAL(swHugePageRoundUp(pageSize + 1), pageSize * 2);
+
+  swHugePageBacking backing = swHugePageBackingMax;
+  uint8_t *data = swHugePageAlloc(pageSize * 2 + 100, &backing);
+  ASSERT_NOT_NULL(data);
+  ASSERT_TRUE(backing < swHugePageBackingMax);
+  ASSERT_EQUAL(((uintptr_t)data) % pageSize, 0);
+  swTestLogLine("huge page size = %zu, backing = %s\n", pageSize, swHugePageBackingTextGet(backing));
+  ASSERT_EQUAL(data[pageSize], 0);
+  memset(data, 0xa5, pageSize * 2 + 100);
+  swHugePageFree(data, pageSize * 2 + 100);
+  ASSERT_NULL(swHugePageAlloc(0, NULL));
+  return true;
+}
+
+swTestDeclare(HugePageDoubleMapTest, NULL, NULL, swTestRun)
+{
+  bool hugePages[] = { false, true };
+  for (uint32_t i = 0; i < sizeof(hugePages)/sizeof(hugePages[0]); i++)
+  {
+    size_t size = 4096;
+    swHugePageBacking backing = swHugePageBackingMax;
+    uint8_t *buffer = swHugePageDoubleMap(&size, hugePages[i], &backing);
+    ASSERT_NOT_NULL(buffer);
+    if (buffer)
+    {
+      ASSERT_EQUAL(size, (hugePages[i])? swHugePageSizeGet() : 4096);
+      if (!hugePages[i])
+        ASSERT_EQUAL(backing, swHugePageBackingNone);
+      // writing past the end shows up at the start
+      memcpy(buffer + size - 4, "wrapped!", 8);
+      ASSERT_DATA("ped!", 4, (char *)buffer, 4);
+      swHugePageDoubleUnmap(buffer, size);
+    }
+  }
+  return true;
+}
+
+swTestDeclare(HugePageDynamicArrayTest, NULL, NULL, swTestRun)
+{
+  swDynamicArray array = swDynamicArrayInitEmpty(sizeof(uint64_t));
+  ASSERT_TRUE(swDynamicArrayInit(&array, sizeof(uint64_t), 16));
+  swDynamicArrayHugePagesSet(&array, true);
+  uint64_t count = (swHugePageSizeGet() / sizeof(uint64_t)) * 2;
+  for (uint64_t i = 0; i < count; i++)
+  {
+    if (!swDynamicArrayPush(&array, &i))
+      break;
+  }
+  ASSERT_EQUAL(swDynamicArrayCount(array), count);
+  ASSERT_TRUE(array.hugePageBacked);
+  for (uint64_t i = 0; i < count; i++)
+  {
+    if (*(uint64_t *)swDynamicArrayGet(&array, i) != i)
+    {
+      ASSERT_EQUAL(*(uint64_t *)swDynamicArrayGet(&array, i), i);
+      break;
+    }
+  }
+  // shrinking below the threshold moves the data back to regular memory
+  swDynamicArrayClear(&array);
+  uint64_t value = 42;
+  ASSERT_TRUE(swDynamicArrayPush(&array, &value));
+  ASSERT_TRUE(swDynamicArrayEnsureCapacity(&array, 2));
+  ASSERT_FALSE(array.hugePageBacked);
+  ASSERT_EQUAL(*(uint64_t *)swDynamicArrayGet(&array, 0), 42);
+  swDynamicArrayRelease(&array);
+  return true;
+}
+
+swTestDeclare(HugePageHashMapTest, NULL, NULL, swTestRun)
+{
+  swHashMapLinear map;
+  ASSERT_TRUE(swHashMapLinearInit(&map, NULL, NULL, NULL, NULL));
+  swHashMapLinearHugePagesSet(&map, true);
+  uintptr_t count = swHugePageSizeGet() / sizeof(void *);
+  for (uintptr_t i = 1; i <= count; i++)
+  {
+    if (!swHashMapLinearInsert(&map, (void *)i, (void *)(i * 2)))
+      break;
+  }
+  ASSERT_EQUAL(swHashMapLinearCount(&map), count);
+  ASSERT_TRUE(map.hugePageBacked);
+  for (uintptr_t i = 1; i <= count; i++)
+  {
+    void *value = NULL;
+    if (!swHashMapLinearValueGet(&map, (void *)i, &value) || (value != (void *)(i * 2)))
+    {
+      ASSERT_TRUE(value == (void *)(i * 2));
+      break;
+    }
+  }
+  swHashMapLinearClear(&map);
+  ASSERT_FALSE(map.hugePageBacked);
+  swHashMapLinearRelease(&map);
+  return true;
+}
+
+swTestSuiteStructDeclare(HugePageTest, NULL, NULL, swTestRun,
+                         &HugePageAllocTest, &HugePageDoubleMapTest, &HugePageDynamicArrayTest, &HugePageHashMapTest);
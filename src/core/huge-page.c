@@ -0,0 +1,172 @@
+#include "core/huge-page.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define SW_HUGEPAGE_SIZE_DEFAULT  (2 * 1024 * 1024)
+
+static const char *swHugePageBackingText[] =
+{
+  "none",
+  "transparent",
+  "hugetlb"
+};
+
+const char *swHugePageBackingTextGet(swHugePageBacking backing)
+{
+  return (backing < swHugePageBackingMax)? swHugePageBackingText[backing] : NULL;
+}
+
+static size_t hugePageSize = 0;
+
+size_t swHugePageSizeGet()
+{
+  if (!hugePageSize)
+  {
+    size_t size = SW_HUGEPAGE_SIZE_DEFAULT;
+    FILE *meminfo = fopen("/proc/meminfo", "r");
+    if (meminfo)
+    {
+      char line[128];
+      while (fgets(line, sizeof(line), meminfo))
+      {
+        unsigned long sizeKB = 0;
+        if (sscanf(line, "Hugepagesize: %lu kB", &sizeKB) == 1)
+        {
+          if (sizeKB)
+            size = sizeKB * 1024;
+          break;
+        }
+      }
+      fclose(meminfo);
+    }
+    hugePageSize = size;
+  }
+  return hugePageSize;
+}
+
+size_t swHugePageRoundUp(size_t size)
+{
+  size_t pageSize = swHugePageSizeGet();
+  return ((size + pageSize - 1) / pageSize) * pageSize;
+}
+
+// reserves address range aligned to the huge page size, so transparent huge pages can back all of it
+static uint8_t *swHugePageAlignedReserve(size_t size, int prot, int flags)
+{
+  uint8_t *rtn = NULL;
+  size_t pageSize = swHugePageSizeGet();
+  uint8_t *data = mmap(NULL, size + pageSize, prot, flags, -1, 0);
+  if (data != MAP_FAILED)
+  {
+    uint8_t *aligned = (uint8_t *)((((uintptr_t)data) + pageSize - 1) & ~((uintptr_t)pageSize - 1));
+    if (aligned > data)
+      munmap(data, aligned - data);
+    if (aligned + size < data + size + pageSize)
+      munmap(aligned + size, (data + size + pageSize) - (aligned + size));
+    rtn = aligned;
+  }
+  return rtn;
+}
+
+void *swHugePageAlloc(size_t size, swHugePageBacking *backing)
+{
+  void *rtn = NULL;
+  if (size)
+  {
+    swHugePageBacking currentBacking = swHugePageBackingNone;
+    size = swHugePageRoundUp(size);
+    if ((rtn = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0)) != MAP_FAILED)
+      currentBacking = swHugePageBackingHugeTLB;
+    else if ((rtn = swHugePageAlignedReserve(size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS)))
+    {
+      if (madvise(rtn, size, MADV_HUGEPAGE) == 0)
+        currentBacking = swHugePageBackingTransparent;
+    }
+    if (backing)
+      *backing = currentBacking;
+  }
+  return rtn;
+}
+
+void swHugePageFree(void *ptr, size_t size)
+{
+  if (ptr && size)
+    munmap(ptr, swHugePageRoundUp(size));
+}
+
+static bool swHugePageDoubleMapFd(uint8_t *buffer, size_t size, int fd)
+{
+  bool rtn = false;
+  if (ftruncate(fd, size) == 0)
+  {
+    if (mmap(buffer, size, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_SHARED, fd, 0) == buffer)
+    {
+      if (mmap(buffer + size, size, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_SHARED, fd, 0) == buffer + size)
+        rtn = true;
+    }
+  }
+  return rtn;
+}
+
+uint8_t *swHugePageDoubleMap(size_t *size, bool hugePages, swHugePageBacking *backing)
+{
+  uint8_t *rtn = NULL;
+  if (size && *size)
+  {
+    swHugePageBacking currentBacking = swHugePageBackingNone;
+    size_t mapSize = (hugePages)? swHugePageRoundUp(*size) : *size;
+    uint8_t *buffer = (hugePages)? swHugePageAlignedReserve(mapSize << 1, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE)
+                                 : mmap(NULL, mapSize << 1, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (buffer && (buffer != MAP_FAILED))
+    {
+      if (hugePages)
+      {
+        int fd = memfd_create("mpscbuffer", MFD_HUGETLB);
+        if (fd >= 0)
+        {
+          if (swHugePageDoubleMapFd(buffer, mapSize, fd))
+          {
+            currentBacking = swHugePageBackingHugeTLB;
+            rtn = buffer;
+          }
+          close(fd);
+        }
+      }
+      if (!rtn)
+      {
+        char tempFile[] = "/dev/shm/mpscbuffer-XXXXXX";
+        int fd = mkstemp(tempFile);
+        if (fd >= 0)
+        {
+          if ((unlink(tempFile) == 0) && swHugePageDoubleMapFd(buffer, mapSize, fd))
+          {
+            // shared memory uses transparent huge pages only when shmem_enabled allows it
+            if (hugePages && (madvise(buffer, mapSize << 1, MADV_HUGEPAGE) == 0))
+              currentBacking = swHugePageBackingTransparent;
+            rtn = buffer;
+          }
+          close(fd);
+        }
+      }
+      if (rtn)
+      {
+        *size = mapSize;
+        if (backing)
+          *backing = currentBacking;
+      }
+      else
+        munmap(buffer, mapSize << 1);
+    }
+  }
+  return rtn;
+}
+
+void swHugePageDoubleUnmap(uint8_t *buffer, size_t size)
+{
+  if (buffer && size)
+    munmap(buffer, size << 1);
+}
@@ -0,0 +1,37 @@
+#ifndef SW_CORE_HUGEPAGE_H
+#define SW_CORE_HUGEPAGE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// large region allocation backed by huge pages: MAP_HUGETLB is tried first (needs pages reserved
+// in /proc/sys/vm/nr_hugepages), then regular pages with madvise(MADV_HUGEPAGE) to let transparent
+// huge pages kick in; the sizes are always rounded up to the huge page size
+
+typedef enum swHugePageBacking
+{
+  swHugePageBackingNone = 0,    // regular pages
+  swHugePageBackingTransparent, // madvise(MADV_HUGEPAGE) succeeded
+  swHugePageBackingHugeTLB,     // MAP_HUGETLB
+  swHugePageBackingMax
+} swHugePageBacking;
+
+const char *swHugePageBackingTextGet(swHugePageBacking backing);
+
+// huge page size from /proc/meminfo, 2M if it can't be found
+size_t swHugePageSizeGet();
+size_t swHugePageRoundUp(size_t size);
+
+// memory is zeroed, backing is optional
+void *swHugePageAlloc(size_t size, swHugePageBacking *backing);
+// size has to be the same as the one passed to alloc
+void swHugePageFree(void *ptr, size_t size);
+
+// maps the same memory twice one after another, used by the ring buffers, so the data that wraps
+// around the end can be accessed as one piece; with hugePages set the size is rounded up to
+// the huge page size and updated
+uint8_t *swHugePageDoubleMap(size_t *size, bool hugePages, swHugePageBacking *backing);
+void swHugePageDoubleUnmap(uint8_t *buffer, size_t size);
+
+#endif // SW_CORE_HUGEPAGE_H
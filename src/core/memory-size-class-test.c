@@ -0,0 +1,224 @@
+#include "core/memory-size-class.h"
+#include "core/time.h"
+
+#include "unittest/unittest.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+
+swTestDeclare(SizeClassMallocTest, NULL, NULL, swTestRun)
+{
+  bool rtn = true;
+  size_t sizes[] = { 0, 1, 15, 16, 17, 100, 128, 129, 200, 1000, 4096, 5000, 32 * 1024, 32 * 1024 + 1, 1024 * 1024 };
+  void *ptrs[sizeof(sizes)/sizeof(sizes[0])] = { NULL };
+  for (uint32_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++)
+  {
+    ptrs[i] = swMemorySizeClassMalloc(sizes[i]);
+    ASSERT_NOT_NULL(ptrs[i]);
+    if (ptrs[i])
+    {
+      ASSERT_EQUAL(((uintptr_t)ptrs[i]) % 16, 0);
+      ASSERT_TRUE(swMemorySizeClassUsableSize(ptrs[i]) >= sizes[i]);
+      memset(ptrs[i], 0xa5, sizes[i]);
+    }
+    else
+      rtn = false;
+  }
+  for (uint32_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++)
+    swMemorySizeClassFree(ptrs[i]);
+  swMemorySizeClassFree(NULL);
+  return rtn;
+}
+
+swTestDeclare(SizeClassReuseTest, NULL, NULL, swTestRun)
+{
+  void *first = swMemorySizeClassMalloc(48);
+  ASSERT_NOT_NULL(first);
+  swMemorySizeClassFree(first);
+  void *second = swMemorySizeClassMalloc(40);
+  // same size class and thread cache is LIFO
+  ASSERT_TRUE(first == second);
+  swMemorySizeClassFree(second);
+  return true;
+}
+
+swTestDeclare(SizeClassCallocReallocTest, NULL, NULL, swTestRun)
+{
+  bool rtn = false;
+  uint8_t *data = swMemorySizeClassMalloc(64);
+  if (data)
+  {
+    memset(data, 0xff, 64);
+    swMemorySizeClassFree(data);
+    uint32_t *zeroed = swMemorySizeClassCalloc(16, sizeof(uint32_t));
+    if (zeroed)
+    {
+      for (uint32_t i = 0; i < 16; i++)
+        ASSERT_EQUAL(zeroed[i], 0);
+      for (uint32_t i = 0; i < 16; i++)
+        zeroed[i] = i;
+      // grow through small classes into large and back
+      size_t newSizes[] = { 100, 1000, 10000, 100000, 1000000, 200, 64 };
+      for (uint32_t j = 0; j < sizeof(newSizes)/sizeof(newSizes[0]); j++)
+      {
+        uint32_t *newData = swMemorySizeClassRealloc(zeroed, newSizes[j]);
+        ASSERT_NOT_NULL(newData);
+        if (!newData)
+          break;
+        zeroed = newData;
+        for (uint32_t i = 0; i < 16; i++)
+          ASSERT_EQUAL(zeroed[i], i);
+      }
+      ASSERT_NULL(swMemorySizeClassCalloc(SIZE_MAX, 2));
+      ASSERT_NULL(swMemorySizeClassRealloc(zeroed, 0));
+      rtn = true;
+    }
+  }
+  return rtn;
+}
+
+swTestDeclare(SizeClassAlignMallocTest, NULL, NULL, swTestRun)
+{
+  size_t alignments[] = { 8, 16, 32, 64, 4096 };
+  size_t sizes[] = { 1, 100, 40000 };
+  for (uint32_t i = 0; i < sizeof(alignments)/sizeof(alignments[0]); i++)
+  {
+    for (uint32_t j = 0; j < sizeof(sizes)/sizeof(sizes[0]); j++)
+    {
+      void *ptr = NULL;
+      ASSERT_EQUAL(swMemorySizeClassAlignMalloc(&ptr, alignments[i], sizes[j]), 0);
+      ASSERT_NOT_NULL(ptr);
+      ASSERT_EQUAL(((uintptr_t)ptr) % alignments[i], 0);
+      ASSERT_TRUE(swMemorySizeClassUsableSize(ptr) >= sizes[j]);
+      memset(ptr, 0, sizes[j]);
+      uint8_t *moved = swMemorySizeClassRealloc(ptr, sizes[j] * 2);
+      ASSERT_NOT_NULL(moved);
+      swMemorySizeClassFree(moved);
+    }
+  }
+  void *ptr = NULL;
+  ASSERT_EQUAL(swMemorySizeClassAlignMalloc(&ptr, 24, 100), EINVAL);
+  return true;
+}
+
+swTestDeclare(SizeClassManagerSetTest, NULL, NULL, swTestRun)
+{
+  swMemoryManagerSet(swMemorySizeClassManagerGet());
+  ASSERT_TRUE(swMemoryManagerGet() == swMemorySizeClassManagerGet());
+  void *ptr = swMemoryCacheAlignMalloc(100);
+  ASSERT_NOT_NULL(ptr);
+  ASSERT_EQUAL(((uintptr_t)ptr) % 64, 0);
+  swMemoryFree(ptr);
+  char *string = swMemoryDuplicate("size class", sizeof("size class"));
+  ASSERT_STR("size class", string);
+  swMemoryFree(string);
+  swMemoryManagerDefaultSet();
+  ASSERT_TRUE(swMemoryFree == free);
+  return true;
+}
+
+// benchmark: producers allocate small blocks of random sizes and pass them to the single consumer thread
+// that frees them, this is the pattern of the log consumer thread
+
+#define SW_SIZECLASS_TEST_PRODUCERS       4
+#define SW_SIZECLASS_TEST_ALLOCATIONS     1000000
+#define SW_SIZECLASS_TEST_QUEUE_SIZE      4096
+
+typedef struct swSizeClassTestQueue
+{
+  void *slots[SW_SIZECLASS_TEST_QUEUE_SIZE];
+  uint64_t head __attribute__ ((aligned(64)));
+  uint64_t tail __attribute__ ((aligned(64)));
+  swMemoryManager *manager;
+  uint32_t seed;
+} swSizeClassTestQueue;
+
+static void *swSizeClassTestProducer(swSizeClassTestQueue *queue)
+{
+  uint32_t seed = queue->seed;
+  for (uint32_t i = 0; i < SW_SIZECLASS_TEST_ALLOCATIONS; i++)
+  {
+    seed = seed * 1103515245 + 12345;
+    size_t size = 16 + ((seed >> 16) % 496);
+    void *ptr = queue->manager->malloc(size);
+    if (!ptr)
+      break;
+    *(uint8_t *)ptr = (uint8_t)i;
+    uint64_t tail = queue->tail;
+    while (tail - __atomic_load_n(&(queue->head), __ATOMIC_ACQUIRE) == SW_SIZECLASS_TEST_QUEUE_SIZE)
+      sched_yield();
+    queue->slots[tail % SW_SIZECLASS_TEST_QUEUE_SIZE] = ptr;
+    __atomic_store_n(&(queue->tail), tail + 1, __ATOMIC_RELEASE);
+  }
+  return NULL;
+}
+
+static void *swSizeClassTestConsumer(swSizeClassTestQueue *queues)
+{
+  uint64_t freed = 0;
+  while (freed < (uint64_t)SW_SIZECLASS_TEST_PRODUCERS * SW_SIZECLASS_TEST_ALLOCATIONS)
+  {
+    uint64_t iterationFreed = 0;
+    for (uint32_t i = 0; i < SW_SIZECLASS_TEST_PRODUCERS; i++)
+    {
+      swSizeClassTestQueue *queue = &(queues[i]);
+      uint64_t head = queue->head;
+      uint64_t tail = __atomic_load_n(&(queue->tail), __ATOMIC_ACQUIRE);
+      for (; head < tail; head++)
+        queue->manager->free(queue->slots[head % SW_SIZECLASS_TEST_QUEUE_SIZE]);
+      iterationFreed += head - queue->head;
+      __atomic_store_n(&(queue->head), head, __ATOMIC_RELEASE);
+    }
+    if (!iterationFreed)
+      sched_yield();
+    freed += iterationFreed;
+  }
+  return NULL;
+}
+
+static uint64_t swSizeClassTestCrossThreadRun(swMemoryManager *manager)
+{
+  uint64_t rtn = 0;
+  swSizeClassTestQueue *queues = NULL;
+  if (posix_memalign((void **)&queues, 64, sizeof(*queues) * SW_SIZECLASS_TEST_PRODUCERS) == 0)
+  {
+    memset(queues, 0, sizeof(*queues) * SW_SIZECLASS_TEST_PRODUCERS);
+    pthread_t consumer;
+    pthread_t producers[SW_SIZECLASS_TEST_PRODUCERS];
+    uint64_t startTime = swTimeGet(CLOCK_MONOTONIC_RAW);
+    if (pthread_create(&consumer, NULL, (void *(*)(void *))swSizeClassTestConsumer, queues) == 0)
+    {
+      for (uint32_t i = 0; i < SW_SIZECLASS_TEST_PRODUCERS; i++)
+      {
+        queues[i].manager = manager;
+        queues[i].seed = i + 1;
+        ASSERT_EQUAL(pthread_create(&(producers[i]), NULL, (void *(*)(void *))swSizeClassTestProducer, &(queues[i])), 0);
+      }
+      for (uint32_t i = 0; i < SW_SIZECLASS_TEST_PRODUCERS; i++)
+        pthread_join(producers[i], NULL);
+      pthread_join(consumer, NULL);
+      rtn = swTimeGet(CLOCK_MONOTONIC_RAW) - startTime;
+    }
+    free(queues);
+  }
+  return rtn;
+}
+
+swTestDeclare(SizeClassCrossThreadBenchmarkTest, NULL, NULL, swTestRun)
+{
+  swMemoryManager glibcManager = { malloc, calloc, realloc, free, posix_memalign };
+  uint64_t glibcTime = swSizeClassTestCrossThreadRun(&glibcManager);
+  uint64_t sizeClassTime = swSizeClassTestCrossThreadRun(swMemorySizeClassManagerGet());
+  ASSERT_NOT_EQUAL(glibcTime, 0);
+  ASSERT_NOT_EQUAL(sizeClassTime, 0);
+  swTestLogLine("%u producers x %u allocations freed by consumer thread: glibc = %lu ns (%lu ns/op), size class = %lu ns (%lu ns/op)\n",
+                SW_SIZECLASS_TEST_PRODUCERS, SW_SIZECLASS_TEST_ALLOCATIONS,
+                glibcTime, glibcTime / ((uint64_t)SW_SIZECLASS_TEST_PRODUCERS * SW_SIZECLASS_TEST_ALLOCATIONS),
+                sizeClassTime, sizeClassTime / ((uint64_t)SW_SIZECLASS_TEST_PRODUCERS * SW_SIZECLASS_TEST_ALLOCATIONS));
+  return (glibcTime && sizeClassTime);
+}
+
+swTestSuiteStructDeclare(MemorySizeClassTest, NULL, NULL, swTestRun,
+                         &SizeClassMallocTest, &SizeClassReuseTest, &SizeClassCallocReallocTest, &SizeClassAlignMallocTest,
+                         &SizeClassManagerSetTest, &SizeClassCrossThreadBenchmarkTest);
@@ -0,0 +1,412 @@
+#include "core/memory-size-class.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define SW_MEMORY_SIZECLASS_LARGE       UINT32_MAX
+#define SW_MEMORY_SIZECLASS_ALIGNMENT   16
+#define SW_MEMORY_SIZECLASS_BATCH_MAX   64
+
+// every block starts with the header, the pointer returned to the caller follows it;
+// offset is the distance from the returned pointer back to the beginning of the block,
+// it is different from the size of the header only for the blocks returned by swMemorySizeClassAlignMalloc,
+// those get the second header right in front of the aligned pointer
+typedef struct swMemorySizeClassHeader
+{
+  uint32_t offset;
+  uint32_t sizeClass;
+  size_t   size;      // mapping size for large blocks
+} swMemorySizeClassHeader;
+
+typedef struct swMemorySizeClassFreeBlock
+{
+  struct swMemorySizeClassFreeBlock *next;
+} swMemorySizeClassFreeBlock;
+
+typedef struct swMemorySizeClassCentral
+{
+  pthread_spinlock_t lock;
+  swMemorySizeClassFreeBlock *head;
+  uint64_t count;
+  uint64_t _fill[5];
+} swMemorySizeClassCentral;
+
+typedef struct swMemorySizeClassCacheList
+{
+  swMemorySizeClassFreeBlock *head;
+  uint32_t count;
+} swMemorySizeClassCacheList;
+
+typedef struct swMemorySizeClassThreadCache
+{
+  swMemorySizeClassCacheList lists[SW_MEMORY_SIZECLASS_COUNT];
+  bool registered;
+} swMemorySizeClassThreadCache;
+
+static swMemorySizeClassCentral centralLists[SW_MEMORY_SIZECLASS_COUNT] __attribute__ ((aligned(64)));
+static pthread_once_t centralOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t threadCacheKey;
+static __thread swMemorySizeClassThreadCache threadCache = { .registered = false };
+
+static swMemoryManager sizeClassManager =
+{
+  swMemorySizeClassMalloc,
+  swMemorySizeClassCalloc,
+  swMemorySizeClassRealloc,
+  swMemorySizeClassFree,
+  swMemorySizeClassAlignMalloc
+};
+
+swMemoryManager *swMemorySizeClassManagerGet()
+{
+  return &sizeClassManager;
+}
+
+// size classes: 16 byte steps up to 128 bytes, 4 steps per power of 2 after that up to SW_MEMORY_SIZECLASS_MAX
+static inline uint32_t swMemorySizeClassIndex(size_t size)
+{
+  if (size <= 128)
+    return (size)? (uint32_t)((size + 15) >> 4) - 1 : 0;
+  uint32_t power = 63 - __builtin_clzl(size - 1);
+  size_t step = 1UL << (power - 2);
+  uint32_t sub = (uint32_t)((size - (1UL << power) + step - 1) / step);
+  return 8 + (power - 7) * 4 + sub - 1;
+}
+
+static inline size_t swMemorySizeClassSize(uint32_t sizeClass)
+{
+  if (sizeClass < 8)
+    return (sizeClass + 1) << 4;
+  uint32_t power = 7 + (sizeClass - 8) / 4;
+  uint32_t sub = (sizeClass - 8) % 4 + 1;
+  return (1UL << power) + sub * (1UL << (power - 2));
+}
+
+static inline uint32_t swMemorySizeClassBatch(uint32_t sizeClass)
+{
+  size_t batch = SW_MEMORY_SIZECLASS_CHUNK_SIZE / (swMemorySizeClassSize(sizeClass) + sizeof(swMemorySizeClassHeader));
+  if (batch < 2)
+    batch = 2;
+  else if (batch > SW_MEMORY_SIZECLASS_BATCH_MAX)
+    batch = SW_MEMORY_SIZECLASS_BATCH_MAX;
+  return (uint32_t)batch;
+}
+
+static inline swMemorySizeClassHeader *swMemorySizeClassHeaderGet(void *ptr)
+{
+  swMemorySizeClassHeader *header = (swMemorySizeClassHeader *)ptr - 1;
+  return (swMemorySizeClassHeader *)((uint8_t *)ptr - header->offset);
+}
+
+static void swMemorySizeClassThreadCacheRelease(void *data)
+{
+  swMemorySizeClassThreadCache *cache = data;
+  if (cache)
+  {
+    for (uint32_t i = 0; i < SW_MEMORY_SIZECLASS_COUNT; i++)
+    {
+      swMemorySizeClassCacheList *list = &(cache->lists[i]);
+      if (list->head)
+      {
+        swMemorySizeClassFreeBlock *tail = list->head;
+        while (tail->next)
+          tail = tail->next;
+        swMemorySizeClassCentral *central = &(centralLists[i]);
+        pthread_spin_lock(&(central->lock));
+        tail->next = central->head;
+        central->head = list->head;
+        central->count += list->count;
+        pthread_spin_unlock(&(central->lock));
+        list->head = NULL;
+        list->count = 0;
+      }
+    }
+    cache->registered = false;
+  }
+}
+
+static void swMemorySizeClassCentralInit()
+{
+  for (uint32_t i = 0; i < SW_MEMORY_SIZECLASS_COUNT; i++)
+    pthread_spin_init(&(centralLists[i].lock), PTHREAD_PROCESS_PRIVATE);
+  pthread_key_create(&threadCacheKey, swMemorySizeClassThreadCacheRelease);
+}
+
+static inline swMemorySizeClassThreadCache *swMemorySizeClassThreadCacheGet()
+{
+  swMemorySizeClassThreadCache *cache = &threadCache;
+  if (!cache->registered)
+  {
+    pthread_once(&centralOnce, swMemorySizeClassCentralInit);
+    // the key is only needed to flush the cache on thread exit
+    pthread_setspecific(threadCacheKey, cache);
+    cache->registered = true;
+  }
+  return cache;
+}
+
+// carves a new chunk into blocks and returns them as a linked list
+static swMemorySizeClassFreeBlock *swMemorySizeClassChunkCarve(uint32_t sizeClass, swMemorySizeClassFreeBlock **tail, uint32_t *count)
+{
+  swMemorySizeClassFreeBlock *rtn = NULL;
+  size_t blockSize = swMemorySizeClassSize(sizeClass) + sizeof(swMemorySizeClassHeader);
+  size_t chunkSize = blockSize * swMemorySizeClassBatch(sizeClass);
+  size_t pageSize = getpagesize();
+  if (chunkSize < SW_MEMORY_SIZECLASS_CHUNK_SIZE)
+    chunkSize = SW_MEMORY_SIZECLASS_CHUNK_SIZE;
+  chunkSize = (chunkSize + pageSize - 1) & ~(pageSize - 1);
+  uint8_t *chunk = mmap(NULL, chunkSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  if (chunk != MAP_FAILED)
+  {
+    uint32_t blockCount = chunkSize / blockSize;
+    for (uint32_t i = blockCount; i > 0; i--)
+    {
+      swMemorySizeClassHeader *header = (swMemorySizeClassHeader *)(chunk + (i - 1) * blockSize);
+      header->offset = sizeof(swMemorySizeClassHeader);
+      header->sizeClass = sizeClass;
+      header->size = 0;
+      swMemorySizeClassFreeBlock *block = (swMemorySizeClassFreeBlock *)(header + 1);
+      block->next = rtn;
+      if (!rtn)
+        *tail = block;
+      rtn = block;
+    }
+    *count = blockCount;
+  }
+  return rtn;
+}
+
+// moves up to one batch of blocks from the central list into the thread cache,
+// new chunk is carved and placed on the central list if it is empty
+static bool swMemorySizeClassCacheRefill(swMemorySizeClassCacheList *list, uint32_t sizeClass)
+{
+  bool rtn = false;
+  uint32_t batch = swMemorySizeClassBatch(sizeClass);
+  swMemorySizeClassCentral *central = &(centralLists[sizeClass]);
+  pthread_spin_lock(&(central->lock));
+  if (!central->head)
+  {
+    pthread_spin_unlock(&(central->lock));
+    swMemorySizeClassFreeBlock *chunkTail = NULL;
+    uint32_t chunkCount = 0;
+    swMemorySizeClassFreeBlock *chunkHead = swMemorySizeClassChunkCarve(sizeClass, &chunkTail, &chunkCount);
+    pthread_spin_lock(&(central->lock));
+    if (chunkHead)
+    {
+      chunkTail->next = central->head;
+      central->head = chunkHead;
+      central->count += chunkCount;
+    }
+  }
+  if (central->head)
+  {
+    swMemorySizeClassFreeBlock *head = central->head;
+    swMemorySizeClassFreeBlock *tail = head;
+    uint32_t count = 1;
+    while (count < batch && tail->next)
+    {
+      tail = tail->next;
+      count++;
+    }
+    central->head = tail->next;
+    central->count -= count;
+    tail->next = list->head;
+    list->head = head;
+    list->count += count;
+    rtn = true;
+  }
+  pthread_spin_unlock(&(central->lock));
+  return rtn;
+}
+
+static void swMemorySizeClassCacheOverflow(swMemorySizeClassCacheList *list, uint32_t sizeClass)
+{
+  uint32_t batch = swMemorySizeClassBatch(sizeClass);
+  swMemorySizeClassFreeBlock *head = list->head;
+  swMemorySizeClassFreeBlock *tail = head;
+  for (uint32_t i = 1; i < batch; i++)
+    tail = tail->next;
+  list->head = tail->next;
+  list->count -= batch;
+  swMemorySizeClassCentral *central = &(centralLists[sizeClass]);
+  pthread_spin_lock(&(central->lock));
+  tail->next = central->head;
+  central->head = head;
+  central->count += batch;
+  pthread_spin_unlock(&(central->lock));
+}
+
+static void *swMemorySizeClassLargeMalloc(size_t size)
+{
+  void *rtn = NULL;
+  size_t pageSize = getpagesize();
+  size_t mapSize = (size + sizeof(swMemorySizeClassHeader) + pageSize - 1) & ~(pageSize - 1);
+  if (mapSize > size)
+  {
+    swMemorySizeClassHeader *header = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (header != MAP_FAILED)
+    {
+      header->offset = sizeof(swMemorySizeClassHeader);
+      header->sizeClass = SW_MEMORY_SIZECLASS_LARGE;
+      header->size = mapSize;
+      rtn = header + 1;
+    }
+  }
+  if (!rtn)
+    errno = ENOMEM;
+  return rtn;
+}
+
+void *swMemorySizeClassMalloc(size_t size)
+{
+  void *rtn = NULL;
+  if (size <= SW_MEMORY_SIZECLASS_MAX)
+  {
+    uint32_t sizeClass = swMemorySizeClassIndex(size);
+    swMemorySizeClassCacheList *list = &(swMemorySizeClassThreadCacheGet()->lists[sizeClass]);
+    if (list->head || swMemorySizeClassCacheRefill(list, sizeClass))
+    {
+      swMemorySizeClassFreeBlock *block = list->head;
+      list->head = block->next;
+      list->count--;
+      rtn = block;
+    }
+    else
+      errno = ENOMEM;
+  }
+  else
+    rtn = swMemorySizeClassLargeMalloc(size);
+  return rtn;
+}
+
+void *swMemorySizeClassCalloc(size_t nmemb, size_t size)
+{
+  void *rtn = NULL;
+  size_t total = 0;
+  if (!__builtin_mul_overflow(nmemb, size, &total))
+  {
+    if ((rtn = swMemorySizeClassMalloc(total)))
+    {
+      // fresh mmap regions are already zeroed
+      if (swMemorySizeClassHeaderGet(rtn)->sizeClass != SW_MEMORY_SIZECLASS_LARGE)
+        memset(rtn, 0, total);
+    }
+  }
+  else
+    errno = ENOMEM;
+  return rtn;
+}
+
+void swMemorySizeClassFree(void *ptr)
+{
+  if (ptr)
+  {
+    swMemorySizeClassHeader *header = swMemorySizeClassHeaderGet(ptr);
+    if (header->sizeClass != SW_MEMORY_SIZECLASS_LARGE)
+    {
+      uint32_t sizeClass = header->sizeClass;
+      swMemorySizeClassCacheList *list = &(swMemorySizeClassThreadCacheGet()->lists[sizeClass]);
+      swMemorySizeClassFreeBlock *block = (swMemorySizeClassFreeBlock *)(header + 1);
+      block->next = list->head;
+      list->head = block;
+      list->count++;
+      if (list->count > (swMemorySizeClassBatch(sizeClass) << 1))
+        swMemorySizeClassCacheOverflow(list, sizeClass);
+    }
+    else
+      munmap(header, header->size);
+  }
+}
+
+size_t swMemorySizeClassUsableSize(void *ptr)
+{
+  size_t rtn = 0;
+  if (ptr)
+  {
+    swMemorySizeClassHeader *header = swMemorySizeClassHeaderGet(ptr);
+    size_t blockSize = (header->sizeClass != SW_MEMORY_SIZECLASS_LARGE)?
+        (swMemorySizeClassSize(header->sizeClass) + sizeof(swMemorySizeClassHeader)) : header->size;
+    rtn = blockSize - (size_t)((uint8_t *)ptr - (uint8_t *)header);
+  }
+  return rtn;
+}
+
+void *swMemorySizeClassRealloc(void *ptr, size_t size)
+{
+  void *rtn = NULL;
+  if (ptr)
+  {
+    if (size)
+    {
+      swMemorySizeClassHeader *header = swMemorySizeClassHeaderGet(ptr);
+      size_t usableSize = swMemorySizeClassUsableSize(ptr);
+      if (size <= usableSize && (header->sizeClass != SW_MEMORY_SIZECLASS_LARGE || size > SW_MEMORY_SIZECLASS_MAX))
+        rtn = ptr;
+      else if (header->sizeClass == SW_MEMORY_SIZECLASS_LARGE && size > SW_MEMORY_SIZECLASS_MAX && (uint8_t *)ptr == (uint8_t *)(header + 1))
+      {
+        size_t pageSize = getpagesize();
+        size_t mapSize = (size + sizeof(swMemorySizeClassHeader) + pageSize - 1) & ~(pageSize - 1);
+        swMemorySizeClassHeader *newHeader = mremap(header, header->size, mapSize, MREMAP_MAYMOVE);
+        if (newHeader != MAP_FAILED)
+        {
+          newHeader->size = mapSize;
+          rtn = newHeader + 1;
+        }
+        else
+          errno = ENOMEM;
+      }
+      else if ((rtn = swMemorySizeClassMalloc(size)))
+      {
+        memcpy(rtn, ptr, ((size < usableSize)? size : usableSize));
+        swMemorySizeClassFree(ptr);
+      }
+    }
+    else
+      swMemorySizeClassFree(ptr);
+  }
+  else
+    rtn = swMemorySizeClassMalloc(size);
+  return rtn;
+}
+
+int swMemorySizeClassAlignMalloc(void **memptr, size_t alignment, size_t size)
+{
+  int rtn = EINVAL;
+  if (memptr && alignment && !(alignment & (alignment - 1)) && !(alignment % sizeof(void *)))
+  {
+    rtn = ENOMEM;
+    if (alignment <= SW_MEMORY_SIZECLASS_ALIGNMENT)
+    {
+      if ((*memptr = swMemorySizeClassMalloc(size)))
+        rtn = 0;
+    }
+    else if (size + alignment > size)
+    {
+      uint8_t *ptr = swMemorySizeClassMalloc(size + alignment);
+      if (ptr)
+      {
+        uint8_t *alignedPtr = (uint8_t *)(((uintptr_t)ptr + alignment - 1) & ~(alignment - 1));
+        if (alignedPtr != ptr)
+        {
+          swMemorySizeClassHeader *header = (swMemorySizeClassHeader *)(ptr) - 1;
+          swMemorySizeClassHeader *alignedHeader = (swMemorySizeClassHeader *)(alignedPtr) - 1;
+          alignedHeader->offset = (uint32_t)(alignedPtr - (uint8_t *)header);
+          alignedHeader->sizeClass = header->sizeClass;
+          alignedHeader->size = header->size;
+        }
+        *memptr = alignedPtr;
+        rtn = 0;
+      }
+    }
+  }
+  return rtn;
+}
+
+void swMemorySizeClassThreadCacheFlush()
+{
+  if (threadCache.registered)
+    swMemorySizeClassThreadCacheRelease(&threadCache);
+}
@@ -0,0 +1,35 @@
+#ifndef SW_CORE_MEMORYSIZECLASS_H
+#define SW_CORE_MEMORYSIZECLASS_H
+
+#include "core/memory.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// size class allocator that can be plugged in with swMemoryManagerSet(swMemorySizeClassManagerGet())
+// small allocations are rounded up to one of the size classes and served from a per thread cache,
+// the cache is refilled from (and overflows into) the central free list of the size class, so
+// the memory freed by one thread (log consumer for example) ends up being reused by the threads that
+// allocate it; allocations bigger than SW_MEMORY_SIZECLASS_MAX are served by mmap directly
+
+// WARNING: the manager has to be set before any allocation is made, memory allocated by one manager
+// can't be released by another
+
+#define SW_MEMORY_SIZECLASS_MAX         (32 * 1024)
+#define SW_MEMORY_SIZECLASS_COUNT       40
+#define SW_MEMORY_SIZECLASS_CHUNK_SIZE  (64 * 1024)
+
+swMemoryManager *swMemorySizeClassManagerGet();
+
+void *swMemorySizeClassMalloc(size_t size);
+void *swMemorySizeClassCalloc(size_t nmemb, size_t size);
+void *swMemorySizeClassRealloc(void *ptr, size_t size);
+void  swMemorySizeClassFree(void *ptr);
+int   swMemorySizeClassAlignMalloc(void **memptr, size_t alignment, size_t size);
+
+size_t swMemorySizeClassUsableSize(void *ptr);
+// returns all the blocks cached by the calling thread to the central free lists,
+// done automatically when the thread exits
+void swMemorySizeClassThreadCacheFlush();
+
+#endif // SW_CORE_MEMORYSIZECLASS_H
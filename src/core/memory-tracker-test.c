@@ -0,0 +1,157 @@
+#include "core/memory-tracker.h"
+
+#include "unittest/unittest.h"
+
+#include <string.h>
+
+static void swMemoryTrackerTestSetup(swTestSuite *suite)
+{
+  swMemoryTrackerInstall();
+}
+
+static void swMemoryTrackerTestTeardown(swTestSuite *suite)
+{
+  swMemoryTrackerUninstall();
+}
+
+swTestDeclare(TrackerTagCountersTest, NULL, NULL, swTestRun)
+{
+  uint32_t tag = swMemoryTagRegister("counters", 0);
+  ASSERT_NOT_EQUAL(tag, SW_MEMORY_TAG_MAX);
+  ASSERT_EQUAL(swMemoryTagRegister("counters", 0), tag);
+  ASSERT_TRUE(swMemoryManagerGet() == swMemoryTrackerManagerGet());
+
+  uint32_t previousTag = swMemoryTagSet(tag);
+  ASSERT_EQUAL(previousTag, SW_MEMORY_TAG_DEFAULT);
+  void *first = swMemoryMalloc(100);
+  void *second = swMemoryCalloc(10, 20);
+  void *aligned = swMemoryCacheAlignMalloc(300);
+  ASSERT_NOT_NULL(first);
+  ASSERT_NOT_NULL(second);
+  ASSERT_NOT_NULL(aligned);
+  ASSERT_EQUAL(((uintptr_t)aligned) % 64, 0);
+  swMemoryTagSet(previousTag);
+
+  swMemoryTagStats stats = { NULL };
+  ASSERT_TRUE(swMemoryTagStatsGet(tag, &stats));
+  ASSERT_STR(stats.name, "counters");
+  ASSERT_EQUAL(stats.bytes, 600);
+  ASSERT_EQUAL(stats.allocations, 3);
+  ASSERT_EQUAL(stats.total, 3);
+
+  // realloc keeps the tag of the block
+  first = swMemoryRealloc(first, 1000);
+  ASSERT_NOT_NULL(first);
+  aligned = swMemoryRealloc(aligned, 100);
+  ASSERT_NOT_NULL(aligned);
+  ASSERT_TRUE(swMemoryTagStatsGet(tag, &stats));
+  ASSERT_EQUAL(stats.bytes, 1300);
+  ASSERT_EQUAL(stats.allocations, 3);
+  // the aligned block is moved to a new one, the grown one is not counted again
+  ASSERT_EQUAL(stats.total, 4);
+  ASSERT_EQUAL(stats.peak, 1600);
+
+  swMemoryFree(first);
+  swMemoryFree(second);
+  swMemoryFree(aligned);
+  ASSERT_TRUE(swMemoryTagStatsGet(tag, &stats));
+  ASSERT_EQUAL(stats.bytes, 0);
+  ASSERT_EQUAL(stats.allocations, 0);
+  ASSERT_EQUAL(stats.peak, 1600);
+  return true;
+}
+
+swTestDeclare(TrackerTaggedTest, NULL, NULL, swTestRun)
+{
+  uint32_t firstTag = swMemoryTagRegister("first", 0);
+  uint32_t secondTag = swMemoryTagRegister("second", 0);
+  char *data = swMemoryTaggedMalloc(firstTag, 10);
+  ASSERT_NOT_NULL(data);
+  strcpy(data, "tagged");
+  // explicit tagged realloc moves the block to the other tag
+  data = swMemoryTaggedRealloc(secondTag, data, 20);
+  ASSERT_STR(data, "tagged");
+  swMemoryTagStats stats = { NULL };
+  ASSERT_TRUE(swMemoryTagStatsGet(firstTag, &stats));
+  ASSERT_EQUAL(stats.bytes, 0);
+  ASSERT_TRUE(swMemoryTagStatsGet(secondTag, &stats));
+  ASSERT_EQUAL(stats.bytes, 20);
+  swMemoryFree(data);
+  ASSERT_TRUE(swMemoryTagStatsGet(secondTag, &stats));
+  ASSERT_EQUAL(stats.bytes, 0);
+  ASSERT_FALSE(swMemoryTagStatsGet(SW_MEMORY_TAG_MAX, &stats));
+  return true;
+}
+
+static uint32_t budgetCalls = 0;
+
+static bool swMemoryTrackerTestBudget(uint32_t tag, size_t size, uint64_t bytes, uint64_t budget)
+{
+  budgetCalls++;
+  // refuse allocations that take the tag 2x above the budget
+  return (bytes <= budget * 2);
+}
+
+swTestDeclare(TrackerBudgetTest, NULL, NULL, swTestRun)
+{
+  uint32_t tag = swMemoryTagRegister("budget", 1000);
+  swMemoryTagBudgetFunctionSet(swMemoryTrackerTestBudget);
+  void *first = swMemoryTaggedMalloc(tag, 800);
+  ASSERT_NOT_NULL(first);
+  ASSERT_EQUAL(budgetCalls, 0);
+  void *second = swMemoryTaggedMalloc(tag, 800);
+  ASSERT_NOT_NULL(second);
+  ASSERT_EQUAL(budgetCalls, 1);
+  void *third = swMemoryTaggedMalloc(tag, 800);
+  ASSERT_NULL(third);
+  ASSERT_EQUAL(budgetCalls, 2);
+  swMemoryTagStats stats = { NULL };
+  ASSERT_TRUE(swMemoryTagStatsGet(tag, &stats));
+  ASSERT_EQUAL(stats.bytes, 1600);
+  ASSERT_EQUAL(stats.overBudget, 2);
+  // a refused realloc leaves the block and the counters as they were
+  ASSERT_NULL(swMemoryRealloc(first, 1300));
+  ASSERT_EQUAL(budgetCalls, 3);
+  ASSERT_TRUE(swMemoryTagStatsGet(tag, &stats));
+  ASSERT_EQUAL(stats.bytes, 1600);
+  ASSERT_EQUAL(stats.peak, 1600);
+  ASSERT_EQUAL(stats.allocations, 2);
+  ASSERT_EQUAL(stats.total, 2);
+  swMemoryFree(first);
+  swMemoryFree(second);
+  swMemoryTagBudgetFunctionSet(NULL);
+  return true;
+}
+
+static void *__attribute__ ((noinline)) swMemoryTrackerTestAllocate(size_t size)
+{
+  return swMemoryMalloc(size);
+}
+
+swTestDeclare(TrackerCallSiteTest, NULL, NULL, swTestRun)
+{
+  uint32_t tag = swMemoryTagRegister("call sites", 0);
+  uint32_t previousTag = swMemoryTagSet(tag);
+  swMemoryCallSiteSampleRateSet(1);
+  void *ptrs[20] = { NULL };
+  for (uint32_t i = 0; i < 10; i++)
+    ptrs[i] = swMemoryTrackerTestAllocate(100);
+  for (uint32_t i = 10; i < 20; i++)
+    ptrs[i] = swMemoryMalloc(10);
+  swMemoryCallSiteSampleRateSet(0);
+  swMemoryTagSet(previousTag);
+  for (uint32_t i = 0; i < 20; i++)
+    swMemoryFree(ptrs[i]);
+
+  swMemoryCallSite sites[4];
+  ASSERT_EQUAL(swMemoryCallSitesGet(tag, sites, 4), 2);
+  // sorted by bytes
+  ASSERT_EQUAL(sites[0].samples, 10);
+  ASSERT_EQUAL(sites[0].bytes, 1000);
+  ASSERT_EQUAL(sites[1].bytes, 100);
+  ASSERT_TRUE((uintptr_t)sites[0].address > (uintptr_t)swMemoryTrackerTestAllocate);
+  return true;
+}
+
+swTestSuiteStructDeclare(MemoryTrackerTest, swMemoryTrackerTestSetup, swMemoryTrackerTestTeardown, swTestRun,
+                         &TrackerTagCountersTest, &TrackerTaggedTest, &TrackerBudgetTest, &TrackerCallSiteTest);
@@ -0,0 +1,412 @@
+#include "core/memory-tracker.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SW_MEMORY_TAG_NAME_SIZE 32
+
+typedef struct swMemoryTag
+{
+  uint64_t bytes;
+  uint64_t peak;
+  uint64_t allocations;
+  uint64_t total;
+  uint64_t budget;
+  uint64_t overBudget;
+  char name[SW_MEMORY_TAG_NAME_SIZE];
+  bool callSitesLock;
+  swMemoryCallSite callSites[SW_MEMORY_CALLSITE_MAX];
+} __attribute__ ((aligned(64))) swMemoryTag;
+
+typedef struct swMemoryTrackerHeader
+{
+  uint32_t tag;
+  uint32_t offset;  // distance from the header back to the start of the block allocated by the wrapped manager
+  size_t size;
+} swMemoryTrackerHeader;
+
+static swMemoryTag tags[SW_MEMORY_TAG_MAX] = { { .name = "default" } };
+static uint32_t tagCount = 1;
+static pthread_mutex_t tagMutex = PTHREAD_MUTEX_INITIALIZER;
+static swMemoryBudgetFunction budgetFunc = NULL;
+static uint32_t sampleRate = 0;
+
+static __thread uint32_t currentTag = SW_MEMORY_TAG_DEFAULT;
+static __thread uint32_t sampleCounter = 0;
+
+static swMemoryManager *wrappedManager = NULL;
+
+uint32_t swMemoryTagRegister(const char *name, uint64_t budget)
+{
+  uint32_t rtn = SW_MEMORY_TAG_MAX;
+  if (name)
+  {
+    pthread_mutex_lock(&tagMutex);
+    for (uint32_t i = 0; i < tagCount; i++)
+    {
+      if (strncmp(tags[i].name, name, SW_MEMORY_TAG_NAME_SIZE - 1) == 0)
+      {
+        rtn = i;
+        break;
+      }
+    }
+    if ((rtn == SW_MEMORY_TAG_MAX) && (tagCount < SW_MEMORY_TAG_MAX))
+    {
+      rtn = tagCount;
+      strncpy(tags[rtn].name, name, SW_MEMORY_TAG_NAME_SIZE - 1);
+      __atomic_store_n(&(tagCount), tagCount + 1, __ATOMIC_RELEASE);
+    }
+    if (rtn < SW_MEMORY_TAG_MAX)
+      __atomic_store_n(&(tags[rtn].budget), budget, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&tagMutex);
+  }
+  return rtn;
+}
+
+bool swMemoryTagBudgetSet(uint32_t tag, uint64_t budget)
+{
+  bool rtn = false;
+  if (tag < swMemoryTagCount())
+  {
+    __atomic_store_n(&(tags[tag].budget), budget, __ATOMIC_RELAXED);
+    rtn = true;
+  }
+  return rtn;
+}
+
+void swMemoryTagBudgetFunctionSet(swMemoryBudgetFunction func)
+{
+  budgetFunc = func;
+}
+
+uint32_t swMemoryTagCount()
+{
+  return __atomic_load_n(&tagCount, __ATOMIC_ACQUIRE);
+}
+
+bool swMemoryTagStatsGet(uint32_t tag, swMemoryTagStats *stats)
+{
+  bool rtn = false;
+  if (stats && (tag < swMemoryTagCount()))
+  {
+    swMemoryTag *memoryTag = &(tags[tag]);
+    stats->name        = memoryTag->name;
+    stats->bytes       = __atomic_load_n(&(memoryTag->bytes), __ATOMIC_RELAXED);
+    stats->peak        = __atomic_load_n(&(memoryTag->peak), __ATOMIC_RELAXED);
+    stats->allocations = __atomic_load_n(&(memoryTag->allocations), __ATOMIC_RELAXED);
+    stats->total       = __atomic_load_n(&(memoryTag->total), __ATOMIC_RELAXED);
+    stats->budget      = __atomic_load_n(&(memoryTag->budget), __ATOMIC_RELAXED);
+    stats->overBudget  = __atomic_load_n(&(memoryTag->overBudget), __ATOMIC_RELAXED);
+    rtn = true;
+  }
+  return rtn;
+}
+
+uint32_t swMemoryTagSet(uint32_t tag)
+{
+  uint32_t rtn = currentTag;
+  currentTag = (tag < SW_MEMORY_TAG_MAX)? tag : SW_MEMORY_TAG_DEFAULT;
+  return rtn;
+}
+
+uint32_t swMemoryTagGet()
+{
+  return currentTag;
+}
+
+void swMemoryCallSiteSampleRateSet(uint32_t rate)
+{
+  sampleRate = rate;
+}
+
+static void swMemoryCallSiteRecord(swMemoryTag *memoryTag, void *address, size_t size)
+{
+  while (__atomic_test_and_set(&(memoryTag->callSitesLock), __ATOMIC_ACQUIRE))
+    __builtin_ia32_pause();
+  uint32_t index = (uint32_t)(((uintptr_t)address >> 2) * 2654435761U) % SW_MEMORY_CALLSITE_MAX;
+  for (uint32_t i = 0; i < SW_MEMORY_CALLSITE_MAX; i++)
+  {
+    swMemoryCallSite *site = &(memoryTag->callSites[(index + i) % SW_MEMORY_CALLSITE_MAX]);
+    if (!site->address)
+      site->address = address;
+    if (site->address == address)
+    {
+      site->samples++;
+      site->bytes += size;
+      break;
+    }
+  }
+  // the site is dropped when the table is full
+  __atomic_clear(&(memoryTag->callSitesLock), __ATOMIC_RELEASE);
+}
+
+static int swMemoryCallSiteCompare(const void *first, const void *second)
+{
+  uint64_t firstBytes = ((const swMemoryCallSite *)first)->bytes;
+  uint64_t secondBytes = ((const swMemoryCallSite *)second)->bytes;
+  return (firstBytes < secondBytes)? 1 : ((firstBytes > secondBytes)? -1 : 0);
+}
+
+uint32_t swMemoryCallSitesGet(uint32_t tag, swMemoryCallSite *sites, uint32_t count)
+{
+  uint32_t rtn = 0;
+  if (sites && count && (tag < swMemoryTagCount()))
+  {
+    swMemoryCallSite allSites[SW_MEMORY_CALLSITE_MAX];
+    uint32_t allCount = 0;
+    swMemoryTag *memoryTag = &(tags[tag]);
+    while (__atomic_test_and_set(&(memoryTag->callSitesLock), __ATOMIC_ACQUIRE))
+      __builtin_ia32_pause();
+    for (uint32_t i = 0; i < SW_MEMORY_CALLSITE_MAX; i++)
+    {
+      if (memoryTag->callSites[i].address)
+        allSites[allCount++] = memoryTag->callSites[i];
+    }
+    __atomic_clear(&(memoryTag->callSitesLock), __ATOMIC_RELEASE);
+    qsort(allSites, allCount, sizeof(swMemoryCallSite), swMemoryCallSiteCompare);
+    rtn = (allCount < count)? allCount : count;
+    memcpy(sites, allSites, rtn * sizeof(swMemoryCallSite));
+  }
+  return rtn;
+}
+
+// checks the budget and reserves the bytes before the memory is allocated, bytes is the new
+// amount of the tag
+static bool swMemoryTagReserve(uint32_t tag, size_t size, uint64_t *bytesPtr)
+{
+  bool rtn = true;
+  swMemoryTag *memoryTag = &(tags[tag]);
+  uint64_t budget = __atomic_load_n(&(memoryTag->budget), __ATOMIC_RELAXED);
+  uint64_t bytes = __atomic_add_fetch(&(memoryTag->bytes), size, __ATOMIC_RELAXED);
+  if (budget && (bytes > budget))
+  {
+    __atomic_add_fetch(&(memoryTag->overBudget), 1, __ATOMIC_RELAXED);
+    if (budgetFunc && !budgetFunc(tag, size, bytes, budget))
+    {
+      __atomic_sub_fetch(&(memoryTag->bytes), size, __ATOMIC_RELAXED);
+      rtn = false;
+    }
+  }
+  *bytesPtr = bytes;
+  return rtn;
+}
+
+// updates the rest of the counters once the memory is allocated, a block that only grew is not
+// counted again
+static void swMemoryTagCommit(uint32_t tag, size_t size, uint64_t bytes, void *address, bool newBlock)
+{
+  swMemoryTag *memoryTag = &(tags[tag]);
+  uint64_t peak = __atomic_load_n(&(memoryTag->peak), __ATOMIC_RELAXED);
+  while ((bytes > peak) && !__atomic_compare_exchange_n(&(memoryTag->peak), &peak, bytes, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  if (newBlock)
+  {
+    __atomic_add_fetch(&(memoryTag->allocations), 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&(memoryTag->total), 1, __ATOMIC_RELAXED);
+  }
+  if (sampleRate && (++sampleCounter >= sampleRate))
+  {
+    sampleCounter = 0;
+    swMemoryCallSiteRecord(memoryTag, address, size);
+  }
+}
+
+static void swMemoryTagRemove(uint32_t tag, size_t size)
+{
+  swMemoryTag *memoryTag = &(tags[tag]);
+  __atomic_sub_fetch(&(memoryTag->bytes), size, __ATOMIC_RELAXED);
+  __atomic_sub_fetch(&(memoryTag->allocations), 1, __ATOMIC_RELAXED);
+}
+
+static void *swMemoryTrackerAllocate(uint32_t tag, size_t alignment, size_t size, bool zero, void *address)
+{
+  void *rtn = NULL;
+  size_t padding = (alignment > sizeof(swMemoryTrackerHeader))? alignment : sizeof(swMemoryTrackerHeader);
+  uint64_t bytes = 0;
+  if ((size + padding > size) && swMemoryTagReserve(tag, size, &bytes))
+  {
+    uint8_t *data = NULL;
+    if (padding == sizeof(swMemoryTrackerHeader))
+      data = (zero)? wrappedManager->calloc(1, size + padding) : wrappedManager->malloc(size + padding);
+    else if (wrappedManager->alignMalloc((void **)&data, alignment, size + padding) != 0)
+      data = NULL;
+    if (data)
+    {
+      swMemoryTrackerHeader *header = (swMemoryTrackerHeader *)(data + padding) - 1;
+      header->tag = tag;
+      header->offset = (uint8_t *)header - data;
+      header->size = size;
+      rtn = data + padding;
+      swMemoryTagCommit(tag, size, bytes, address, true);
+    }
+    else
+      __atomic_sub_fetch(&(tags[tag].bytes), size, __ATOMIC_RELAXED);
+  }
+  if (!rtn)
+    errno = ENOMEM;
+  return rtn;
+}
+
+static void swMemoryTrackerRelease(void *ptr)
+{
+  if (ptr)
+  {
+    swMemoryTrackerHeader *header = (swMemoryTrackerHeader *)ptr - 1;
+    swMemoryTagRemove(header->tag, header->size);
+    wrappedManager->free((uint8_t *)header - header->offset);
+  }
+}
+
+static void *swMemoryTrackerReallocate(uint32_t tag, void *ptr, size_t size, void *address)
+{
+  void *rtn = NULL;
+  if (ptr)
+  {
+    if (size)
+    {
+      swMemoryTrackerHeader *header = (swMemoryTrackerHeader *)ptr - 1;
+      if (tag == SW_MEMORY_TAG_MAX)
+        tag = header->tag;
+      if (!header->offset && (tag == header->tag) && (size + sizeof(swMemoryTrackerHeader) > size))
+      {
+        size_t oldSize = header->size;
+        bool grow = (size > oldSize);
+        uint64_t bytes = 0;
+        // only the difference is accounted, the block is still counted once
+        if (!grow || swMemoryTagReserve(tag, size - oldSize, &bytes))
+        {
+          swMemoryTrackerHeader *newHeader = wrappedManager->realloc(header, size + sizeof(swMemoryTrackerHeader));
+          if (newHeader)
+          {
+            if (grow)
+              swMemoryTagCommit(tag, size - oldSize, bytes, address, false);
+            else
+              __atomic_sub_fetch(&(tags[tag].bytes), oldSize - size, __ATOMIC_RELAXED);
+            newHeader->size = size;
+            rtn = newHeader + 1;
+          }
+          else if (grow)
+            __atomic_sub_fetch(&(tags[tag].bytes), size - oldSize, __ATOMIC_RELAXED);
+        }
+        if (!rtn)
+          errno = ENOMEM;
+      }
+      else if ((rtn = swMemoryTrackerAllocate(tag, sizeof(swMemoryTrackerHeader), size, false, address)))
+      {
+        memcpy(rtn, ptr, (size < header->size)? size : header->size);
+        swMemoryTrackerRelease(ptr);
+      }
+    }
+    else
+      swMemoryTrackerRelease(ptr);
+  }
+  else
+    rtn = swMemoryTrackerAllocate((tag == SW_MEMORY_TAG_MAX)? currentTag : tag, sizeof(swMemoryTrackerHeader), size, false, address);
+  return rtn;
+}
+
+static void *swMemoryTrackerMalloc(size_t size)
+{
+  return swMemoryTrackerAllocate(currentTag, sizeof(swMemoryTrackerHeader), size, false, __builtin_return_address(0));
+}
+
+static void *swMemoryTrackerCalloc(size_t nmemb, size_t size)
+{
+  void *rtn = NULL;
+  size_t total = 0;
+  if (!__builtin_mul_overflow(nmemb, size, &total))
+    rtn = swMemoryTrackerAllocate(currentTag, sizeof(swMemoryTrackerHeader), total, true, __builtin_return_address(0));
+  else
+    errno = ENOMEM;
+  return rtn;
+}
+
+static void *swMemoryTrackerRealloc(void *ptr, size_t size)
+{
+  // realloc keeps the tag of the block
+  return swMemoryTrackerReallocate(SW_MEMORY_TAG_MAX, ptr, size, __builtin_return_address(0));
+}
+
+static int swMemoryTrackerAlignMalloc(void **memptr, size_t alignment, size_t size)
+{
+  int rtn = EINVAL;
+  if (memptr && alignment && !(alignment & (alignment - 1)) && !(alignment % sizeof(void *)))
+  {
+    *memptr = swMemoryTrackerAllocate(currentTag, alignment, size, false, __builtin_return_address(0));
+    rtn = (*memptr)? 0 : ENOMEM;
+  }
+  return rtn;
+}
+
+void *swMemoryTaggedMalloc(uint32_t tag, size_t size)
+{
+  void *rtn = NULL;
+  if (wrappedManager && (tag < swMemoryTagCount()))
+    rtn = swMemoryTrackerAllocate(tag, sizeof(swMemoryTrackerHeader), size, false, __builtin_return_address(0));
+  else
+    rtn = swMemoryMalloc(size);
+  return rtn;
+}
+
+void *swMemoryTaggedCalloc(uint32_t tag, size_t nmemb, size_t size)
+{
+  void *rtn = NULL;
+  if (wrappedManager && (tag < swMemoryTagCount()))
+  {
+    size_t total = 0;
+    if (!__builtin_mul_overflow(nmemb, size, &total))
+      rtn = swMemoryTrackerAllocate(tag, sizeof(swMemoryTrackerHeader), total, true, __builtin_return_address(0));
+    else
+      errno = ENOMEM;
+  }
+  else
+    rtn = swMemoryCalloc(nmemb, size);
+  return rtn;
+}
+
+void *swMemoryTaggedRealloc(uint32_t tag, void *ptr, size_t size)
+{
+  void *rtn = NULL;
+  if (wrappedManager && (tag < swMemoryTagCount()))
+    rtn = swMemoryTrackerReallocate(tag, ptr, size, __builtin_return_address(0));
+  else
+    rtn = swMemoryRealloc(ptr, size);
+  return rtn;
+}
+
+static swMemoryManager trackerManager = { swMemoryTrackerMalloc, swMemoryTrackerCalloc, swMemoryTrackerRealloc, swMemoryTrackerRelease, swMemoryTrackerAlignMalloc };
+
+bool swMemoryTrackerInstall()
+{
+  bool rtn = false;
+  if (!wrappedManager)
+  {
+    wrappedManager = swMemoryManagerGet();
+    swMemoryManagerSet(&trackerManager);
+    rtn = true;
+  }
+  else
+    rtn = (swMemoryManagerGet() == &trackerManager);
+  return rtn;
+}
+
+void swMemoryTrackerUninstall()
+{
+  if (wrappedManager)
+  {
+    if (swMemoryManagerGet() == &trackerManager)
+      swMemoryManagerSet(wrappedManager);
+    wrappedManager = NULL;
+  }
+}
+
+bool swMemoryTrackerIsInstalled()
+{
+  return (wrappedManager != NULL);
+}
+
+swMemoryManager *swMemoryTrackerManagerGet()
+{
+  return &trackerManager;
+}
@@ -0,0 +1,70 @@
+#ifndef SW_CORE_MEMORYTRACKER_H
+#define SW_CORE_MEMORYTRACKER_H
+
+#include "core/memory.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// instrumented memory manager that wraps another manager and accounts every allocation to a tag,
+// the tag comes from the thread local current tag (swMemoryTagSet) or from the explicit tagged calls;
+// every block carries a small header with its tag and size, so free and realloc update the right counters
+
+// WARNING: the tracker has to be installed before any allocation is made, memory allocated before
+// can't be released through it
+
+#define SW_MEMORY_TAG_MAX         64
+#define SW_MEMORY_TAG_DEFAULT     0
+#define SW_MEMORY_CALLSITE_MAX    64
+
+typedef struct swMemoryTagStats
+{
+  const char *name;
+  uint64_t bytes;         // bytes currently allocated
+  uint64_t peak;          // max value of bytes
+  uint64_t allocations;   // blocks currently allocated
+  uint64_t total;         // blocks allocated over time
+  uint64_t budget;        // soft budget in bytes, 0 means no budget
+  uint64_t overBudget;    // allocations made (or refused) above the budget
+} swMemoryTagStats;
+
+typedef struct swMemoryCallSite
+{
+  void *address;
+  uint64_t samples;
+  uint64_t bytes;
+} swMemoryCallSite;
+
+// called when allocation takes the tag above its budget, returning false fails the allocation
+typedef bool (*swMemoryBudgetFunction)(uint32_t tag, size_t size, uint64_t bytes, uint64_t budget);
+
+// wraps the current manager (usually the default one) and sets itself as the current manager
+bool swMemoryTrackerInstall();
+// sets the wrapped manager back
+void swMemoryTrackerUninstall();
+bool swMemoryTrackerIsInstalled();
+swMemoryManager *swMemoryTrackerManagerGet();
+
+// returns the tag id or SW_MEMORY_TAG_MAX when no more tags can be registered,
+// tag registered twice with the same name returns the same id
+uint32_t swMemoryTagRegister(const char *name, uint64_t budget);
+bool swMemoryTagBudgetSet(uint32_t tag, uint64_t budget);
+void swMemoryTagBudgetFunctionSet(swMemoryBudgetFunction func);
+uint32_t swMemoryTagCount();
+bool swMemoryTagStatsGet(uint32_t tag, swMemoryTagStats *stats);
+
+// returns the previous tag of the calling thread
+uint32_t swMemoryTagSet(uint32_t tag);
+uint32_t swMemoryTagGet();
+
+void *swMemoryTaggedMalloc(uint32_t tag, size_t size);
+void *swMemoryTaggedCalloc(uint32_t tag, size_t nmemb, size_t size);
+void *swMemoryTaggedRealloc(uint32_t tag, void *ptr, size_t size);
+
+// every n-th allocation (per thread) records the return address of the allocation call,
+// 0 switches sampling off
+void swMemoryCallSiteSampleRateSet(uint32_t rate);
+// fills at most count entries sorted by sampled bytes, returns the number of entries filled
+uint32_t swMemoryCallSitesGet(uint32_t tag, swMemoryCallSite *sites, uint32_t count);
+
+#endif // SW_CORE_MEMORYTRACKER_H
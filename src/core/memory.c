@@ -28,7 +28,7 @@ void swMemoryManagerSet(swMemoryManager *manager)
 
 void swMemoryManagerDefaultSet()
 {
-  currentManager = &defaultManager;
+  swMemoryManagerSet(&defaultManager);
 }
 
 swMemoryManager *swMemoryManagerGet()
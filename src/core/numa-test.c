@@ -0,0 +1,177 @@
+#include "core/numa.h"
+#include "core/time.h"
+
+#include "unittest/unittest.h"
+
+#include <string.h>
+#include <unistd.h>
+
+swTestDeclare(NumaTopologyTest, NULL, NULL, swTestRun)
+{
+  int nodeCount = swNumaNodeCount();
+  ASSERT_TRUE(nodeCount >= 1);
+  ASSERT_TRUE(nodeCount <= SW_NUMA_NODE_MAX);
+  swTestLogLine("nodes = %d, current node = %d\n", nodeCount, swNumaCurrentNodeGet());
+  int cpuTotal = 0;
+  for (int node = 0; node < nodeCount; node++)
+  {
+    cpu_set_t cpuSet;
+    if (swNumaNodeCPUSetGet(node, &cpuSet))
+    {
+      cpuTotal += CPU_COUNT(&cpuSet);
+      for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+      {
+        if (CPU_ISSET(cpu, &cpuSet))
+          ASSERT_EQUAL(swNumaCPUNodeGet(cpu), node);
+      }
+    }
+  }
+  ASSERT_TRUE(cpuTotal > 0);
+  ASSERT_TRUE(swNumaCurrentNodeGet() < nodeCount);
+  ASSERT_FALSE(swNumaNodeCPUSetGet(nodeCount, NULL));
+  ASSERT_EQUAL(swNumaCPUNodeGet(-1), SW_NUMA_NODE_ANY);
+  return true;
+}
+
+swTestDeclare(NumaAllocTest, NULL, NULL, swTestRun)
+{
+  size_t size = getpagesize() * 16;
+  for (int node = 0; node < swNumaNodeCount(); node++)
+  {
+    uint8_t *data = swNumaAlloc(size, node);
+    ASSERT_NOT_NULL(data);
+    memset(data, 0xa5, size);
+    ASSERT_EQUAL(swNumaMemoryNodeGet(data), node);
+    ASSERT_EQUAL(swNumaMemoryNodeGet(data + size - 1), node);
+    ASSERT_TRUE(swNumaMemoryBind(data, size, node));
+    swNumaFree(data, size);
+  }
+  ASSERT_NULL(swNumaAlloc(size, swNumaNodeCount()));
+  ASSERT_NULL(swNumaAlloc(0, 0));
+  return true;
+}
+
+swTestDeclare(NumaThreadNodeTest, NULL, NULL, swTestRun)
+{
+  int node = swNumaNodeCount() - 1;
+  ASSERT_EQUAL(swNumaThreadNodeGet(), SW_NUMA_NODE_ANY);
+  ASSERT_TRUE(swNumaThreadNodeSet(node));
+  ASSERT_EQUAL(swNumaThreadNodeGet(), node);
+  ASSERT_FALSE(swNumaThreadNodeSet(swNumaNodeCount()));
+  ASSERT_EQUAL(swNumaThreadNodeGet(), node);
+  ASSERT_TRUE(swNumaThreadNodeReset());
+  ASSERT_EQUAL(swNumaThreadNodeGet(), SW_NUMA_NODE_ANY);
+  return true;
+}
+
+swTestDeclare(NumaMemoryManagerTest, NULL, NULL, swTestRun)
+{
+  swMemoryManager *manager = swNumaMemoryManagerGet();
+  ASSERT_NOT_NULL(manager);
+  int node = swNumaNodeCount() - 1;
+  ASSERT_TRUE(swNumaThreadNodeSet(node));
+
+  // small blocks come from the wrapped manager
+  uint8_t *small = manager->malloc(100);
+  ASSERT_NOT_NULL(small);
+  memset(small, 1, 100);
+  ASSERT_NOT_NULL((small = manager->realloc(small, 200)));
+  ASSERT_EQUAL(small[99], 1);
+
+  // big blocks are mapped on the node
+  uint8_t *big = manager->calloc(1, SW_NUMA_MANAGER_BIND_SIZE);
+  ASSERT_NOT_NULL(big);
+  ASSERT_EQUAL(big[SW_NUMA_MANAGER_BIND_SIZE - 1], 0);
+  ASSERT_EQUAL(swNumaMemoryNodeGet(big), node);
+
+  // small block grows into a mapped one and the other way around
+  ASSERT_NOT_NULL((small = manager->realloc(small, SW_NUMA_MANAGER_BIND_SIZE * 2)));
+  ASSERT_EQUAL(small[99], 1);
+  ASSERT_EQUAL(swNumaMemoryNodeGet(small), node);
+  small[SW_NUMA_MANAGER_BIND_SIZE * 2 - 1] = 2;
+  ASSERT_NOT_NULL((small = manager->realloc(small, 100)));
+  ASSERT_EQUAL(small[99], 1);
+  manager->free(small);
+  manager->free(big);
+
+  void *aligned = NULL;
+  ASSERT_EQUAL(manager->alignMalloc(&aligned, 256, SW_NUMA_MANAGER_BIND_SIZE), 0);
+  ASSERT_EQUAL(((uintptr_t)aligned) % 256, 0);
+  manager->free(aligned);
+  ASSERT_EQUAL(manager->alignMalloc(&aligned, 64, 64), 0);
+  ASSERT_EQUAL(((uintptr_t)aligned) % 64, 0);
+  manager->free(aligned);
+  ASSERT_NOT_EQUAL(manager->alignMalloc(&aligned, 24, 64), 0);
+
+  ASSERT_TRUE(swNumaThreadNodeReset());
+  return true;
+}
+
+#define SW_NUMA_BENCHMARK_SIZE  (64 * 1024 * 1024)
+#define SW_NUMA_BENCHMARK_CHASE (4 * 1024 * 1024)
+
+// sequential read bandwidth and dependent load latency of the memory on memoryNode from the CPUs of cpuNode
+static bool swNumaBenchmarkRun(int cpuNode, int memoryNode)
+{
+  bool rtn = false;
+  cpu_set_t cpuSet;
+  cpu_set_t savedCPUSet;
+  if (swNumaNodeCPUSetGet(cpuNode, &cpuSet) && !sched_getaffinity(0, sizeof(savedCPUSet), &savedCPUSet)
+      && !sched_setaffinity(0, sizeof(cpuSet), &cpuSet))
+  {
+    uint64_t *data = swNumaAlloc(SW_NUMA_BENCHMARK_SIZE, memoryNode);
+    if (data)
+    {
+      size_t count = SW_NUMA_BENCHMARK_SIZE / sizeof(uint64_t);
+      for (size_t i = 0; i < count; i++)
+        data[i] = i;
+
+      uint64_t start = swTimeGet(CLOCK_MONOTONIC);
+      volatile uint64_t sum = 0;
+      for (size_t i = 0; i < count; i++)
+        sum += data[i];
+      uint64_t readTime = swTimeGet(CLOCK_MONOTONIC) - start;
+
+      // random cycle through cache line sized steps defeats the prefetcher
+      size_t lineCount = SW_NUMA_BENCHMARK_SIZE / 64;
+      size_t step = 8;
+      for (size_t i = 0; i < lineCount; i++)
+        data[i * step] = ((i * 2654435761UL + 1) % lineCount) * step;
+      start = swTimeGet(CLOCK_MONOTONIC);
+      uint64_t position = 0;
+      for (size_t i = 0; i < SW_NUMA_BENCHMARK_CHASE; i++)
+        position = data[position];
+      uint64_t chaseTime = swTimeGet(CLOCK_MONOTONIC) - start;
+      sum += position;
+
+      swTestLogLine("cpu node %d, memory node %d (%s): read %.2f GB/s, load latency %.1f ns\n",
+                    cpuNode, memoryNode, (cpuNode == memoryNode)? "local" : "remote",
+                    (double)SW_NUMA_BENCHMARK_SIZE / (readTime? readTime : 1),
+                    (double)chaseTime / SW_NUMA_BENCHMARK_CHASE);
+      swNumaFree(data, SW_NUMA_BENCHMARK_SIZE);
+      rtn = true;
+    }
+    sched_setaffinity(0, sizeof(savedCPUSet), &savedCPUSet);
+  }
+  return rtn;
+}
+
+swTestDeclare(NumaLocalRemoteBenchmark, NULL, NULL, swTestRun)
+{
+  int nodeCount = swNumaNodeCount();
+  if (nodeCount == 1)
+    swTestLogLine("single NUMA node, remote access can't be measured (boot with numa=fake=<N> to get more nodes)\n");
+  for (int cpuNode = 0; cpuNode < nodeCount; cpuNode++)
+  {
+    cpu_set_t cpuSet;
+    // memory only nodes have nothing to run on
+    if (!swNumaNodeCPUSetGet(cpuNode, &cpuSet) || !CPU_COUNT(&cpuSet))
+      continue;
+    for (int memoryNode = 0; memoryNode < nodeCount; memoryNode++)
+      ASSERT_TRUE(swNumaBenchmarkRun(cpuNode, memoryNode));
+  }
+  return true;
+}
+
+swTestSuiteStructDeclare(NumaTest, NULL, NULL, swTestRun,
+                         &NumaTopologyTest, &NumaAllocTest, &NumaThreadNodeTest, &NumaMemoryManagerTest, &NumaLocalRemoteBenchmark);
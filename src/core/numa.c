@@ -0,0 +1,357 @@
+#include "core/numa.h"
+
+#include <errno.h>
+#include <linux/mempolicy.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// parses lists like "0-3,8,10-11" calling the function for every number
+static bool swNumaListParse(const char *path, void (*func)(long value, void *data), void *data)
+{
+  bool rtn = false;
+  FILE *file = fopen(path, "r");
+  if (file)
+  {
+    char line[1024];
+    if (fgets(line, sizeof(line), file))
+    {
+      char *position = line;
+      rtn = true;
+      while (*position && (*position != '\n'))
+      {
+        char *end = NULL;
+        long first = strtol(position, &end, 10);
+        long last = first;
+        if (end == position)
+        {
+          rtn = false;
+          break;
+        }
+        if (*end == '-')
+        {
+          position = end + 1;
+          last = strtol(position, &end, 10);
+        }
+        for (long value = first; value <= last; value++)
+          func(value, data);
+        position = (*end == ',')? end + 1 : end;
+      }
+    }
+    fclose(file);
+  }
+  return rtn;
+}
+
+static void swNumaNodeMaxUpdate(long value, void *data)
+{
+  int *nodeMax = data;
+  if (value + 1 > *nodeMax)
+    *nodeMax = value + 1;
+}
+
+static int nodeCount = 0;
+
+int swNumaNodeCount()
+{
+  if (!nodeCount)
+  {
+    int count = 0;
+    if (!swNumaListParse("/sys/devices/system/node/online", swNumaNodeMaxUpdate, &count) || !count)
+      count = 1;
+    nodeCount = (count < SW_NUMA_NODE_MAX)? count : SW_NUMA_NODE_MAX;
+  }
+  return nodeCount;
+}
+
+static void swNumaCPUSetAdd(long value, void *data)
+{
+  if (value < CPU_SETSIZE)
+    CPU_SET(value, (cpu_set_t *)data);
+}
+
+bool swNumaNodeCPUSetGet(int node, cpu_set_t *cpuSet)
+{
+  bool rtn = false;
+  if (cpuSet && (node >= 0) && (node < swNumaNodeCount()))
+  {
+    char path[128];
+    CPU_ZERO(cpuSet);
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    if (!(rtn = swNumaListParse(path, swNumaCPUSetAdd, cpuSet)) && !node)
+    {
+      // no NUMA support in the kernel, node 0 has all the CPUs
+      long cpuCount = sysconf(_SC_NPROCESSORS_CONF);
+      for (long cpu = 0; cpu < cpuCount; cpu++)
+        swNumaCPUSetAdd(cpu, cpuSet);
+      rtn = true;
+    }
+  }
+  return rtn;
+}
+
+int swNumaCPUNodeGet(int cpu)
+{
+  int rtn = SW_NUMA_NODE_ANY;
+  if (cpu >= 0)
+  {
+    int count = swNumaNodeCount();
+    for (int node = 0; node < count; node++)
+    {
+      cpu_set_t cpuSet;
+      if (swNumaNodeCPUSetGet(node, &cpuSet) && (cpu < CPU_SETSIZE) && CPU_ISSET(cpu, &cpuSet))
+      {
+        rtn = node;
+        break;
+      }
+    }
+  }
+  return rtn;
+}
+
+int swNumaCurrentNodeGet()
+{
+  unsigned cpu = 0;
+  unsigned node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0)
+    node = 0;
+  return (int)node;
+}
+
+static __thread int threadNode = SW_NUMA_NODE_ANY;
+
+static long swNumaPolicySet(int mode, int node)
+{
+  unsigned long nodeMask = (node >= 0)? (1UL << node) : 0;
+  return syscall(SYS_set_mempolicy, mode, (node >= 0)? &nodeMask : NULL, (node >= 0)? SW_NUMA_NODE_MAX + 1 : 0);
+}
+
+bool swNumaThreadNodeSet(int node)
+{
+  bool rtn = false;
+  if ((node >= 0) && (node < swNumaNodeCount()) && (swNumaPolicySet(MPOL_PREFERRED, node) == 0))
+  {
+    threadNode = node;
+    rtn = true;
+  }
+  return rtn;
+}
+
+bool swNumaThreadNodeReset()
+{
+  bool rtn = false;
+  if (swNumaPolicySet(MPOL_DEFAULT, SW_NUMA_NODE_ANY) == 0)
+  {
+    threadNode = SW_NUMA_NODE_ANY;
+    rtn = true;
+  }
+  return rtn;
+}
+
+int swNumaThreadNodeGet()
+{
+  return threadNode;
+}
+
+bool swNumaMemoryBind(void *address, size_t size, int node)
+{
+  bool rtn = false;
+  if (address && size && (node >= 0) && (node < swNumaNodeCount()))
+  {
+    unsigned long nodeMask = 1UL << node;
+    if (syscall(SYS_mbind, address, size, MPOL_BIND, &nodeMask, SW_NUMA_NODE_MAX + 1, MPOL_MF_MOVE) == 0)
+      rtn = true;
+  }
+  return rtn;
+}
+
+int swNumaMemoryNodeGet(void *address)
+{
+  int rtn = SW_NUMA_NODE_ANY;
+  if (address)
+  {
+    int node = 0;
+    if (syscall(SYS_get_mempolicy, &node, NULL, 0, address, MPOL_F_NODE | MPOL_F_ADDR) == 0)
+      rtn = node;
+  }
+  return rtn;
+}
+
+void *swNumaAlloc(size_t size, int node)
+{
+  void *rtn = NULL;
+  if (size && (node >= SW_NUMA_NODE_ANY) && (node < swNumaNodeCount()))
+  {
+    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data != MAP_FAILED)
+    {
+      // without mbind (ENOSYS, EPERM in containers) the pages are placed on first touch
+      if (node != SW_NUMA_NODE_ANY)
+        swNumaMemoryBind(data, size, node);
+      rtn = data;
+    }
+  }
+  return rtn;
+}
+
+void swNumaFree(void *ptr, size_t size)
+{
+  if (ptr && size)
+    munmap(ptr, size);
+}
+
+// memory manager interface, the header keeps the size of the block and tells mapped blocks
+// from the blocks allocated by the wrapped manager
+
+#define SW_NUMA_BLOCK_MAPPED  1
+
+typedef struct swNumaBlockHeader
+{
+  uint32_t offset;  // distance from the header back to the start of the allocated memory
+  uint32_t flags;
+  size_t size;
+} swNumaBlockHeader;
+
+static swMemoryManager *wrappedManager = NULL;
+static size_t pageSize = 0;
+// wrapped when the NUMA manager is already the current one
+static swMemoryManager systemManager = { malloc, calloc, realloc, free, posix_memalign };
+
+static inline size_t swNumaMappedSize(swNumaBlockHeader *header)
+{
+  return ((header->size + header->offset + sizeof(swNumaBlockHeader) + pageSize - 1) / pageSize) * pageSize;
+}
+
+static void *swNumaBlockAlloc(size_t alignment, size_t size, bool zero)
+{
+  void *rtn = NULL;
+  size_t padding = (alignment > sizeof(swNumaBlockHeader))? alignment : sizeof(swNumaBlockHeader);
+  if ((size + padding > size) && (size + padding + pageSize > size))
+  {
+    uint8_t *data = NULL;
+    uint32_t flags = 0;
+    if ((size >= SW_NUMA_MANAGER_BIND_SIZE) && (alignment <= pageSize))
+    {
+      size_t mapSize = ((size + padding + pageSize - 1) / pageSize) * pageSize;
+      int node = (threadNode != SW_NUMA_NODE_ANY)? threadNode : swNumaCurrentNodeGet();
+      if ((data = swNumaAlloc(mapSize, node)))
+        flags = SW_NUMA_BLOCK_MAPPED;
+      // mapped memory is already zeroed
+      zero = false;
+    }
+    else if (padding == sizeof(swNumaBlockHeader))
+      data = (zero)? wrappedManager->calloc(1, size + padding) : wrappedManager->malloc(size + padding);
+    else if (wrappedManager->alignMalloc((void **)&data, alignment, size + padding) != 0)
+      data = NULL;
+    if (data)
+    {
+      swNumaBlockHeader *header = (swNumaBlockHeader *)(data + padding) - 1;
+      header->offset = (uint8_t *)header - data;
+      header->flags = flags;
+      header->size = size;
+      rtn = data + padding;
+      if (zero)
+        memset(rtn, 0, size);
+    }
+  }
+  if (!rtn)
+    errno = ENOMEM;
+  return rtn;
+}
+
+static void *swNumaManagerMalloc(size_t size)
+{
+  return swNumaBlockAlloc(sizeof(swNumaBlockHeader), size, false);
+}
+
+static void *swNumaManagerCalloc(size_t nmemb, size_t size)
+{
+  void *rtn = NULL;
+  size_t total = 0;
+  if (!__builtin_mul_overflow(nmemb, size, &total))
+    rtn = swNumaBlockAlloc(sizeof(swNumaBlockHeader), total, true);
+  else
+    errno = ENOMEM;
+  return rtn;
+}
+
+static void swNumaManagerFree(void *ptr)
+{
+  if (ptr)
+  {
+    swNumaBlockHeader *header = (swNumaBlockHeader *)ptr - 1;
+    if (header->flags & SW_NUMA_BLOCK_MAPPED)
+      swNumaFree((uint8_t *)header - header->offset, swNumaMappedSize(header));
+    else
+      wrappedManager->free((uint8_t *)header - header->offset);
+  }
+}
+
+static void *swNumaManagerRealloc(void *ptr, size_t size)
+{
+  void *rtn = NULL;
+  if (ptr)
+  {
+    if (size)
+    {
+      swNumaBlockHeader *header = (swNumaBlockHeader *)ptr - 1;
+      size_t mappedSize = swNumaMappedSize(header);
+      if ((header->flags & SW_NUMA_BLOCK_MAPPED) && (size >= SW_NUMA_MANAGER_BIND_SIZE)
+          && (size + header->offset + sizeof(swNumaBlockHeader) <= mappedSize)
+          && (size + header->offset + sizeof(swNumaBlockHeader) + pageSize > mappedSize))
+      {
+        // still needs exactly the pages that are mapped
+        header->size = size;
+        rtn = ptr;
+      }
+      else if (!(header->flags & SW_NUMA_BLOCK_MAPPED) && !header->offset && (size < SW_NUMA_MANAGER_BIND_SIZE))
+      {
+        if ((size + sizeof(swNumaBlockHeader) > size) && (header = wrappedManager->realloc(header, size + sizeof(swNumaBlockHeader))))
+        {
+          header->size = size;
+          rtn = header + 1;
+        }
+        else
+          errno = ENOMEM;
+      }
+      else if ((rtn = swNumaManagerMalloc(size)))
+      {
+        memcpy(rtn, ptr, (size < header->size)? size : header->size);
+        swNumaManagerFree(ptr);
+      }
+    }
+    else
+      swNumaManagerFree(ptr);
+  }
+  else
+    rtn = swNumaManagerMalloc(size);
+  return rtn;
+}
+
+static int swNumaManagerAlignMalloc(void **memptr, size_t alignment, size_t size)
+{
+  int rtn = EINVAL;
+  if (memptr && alignment && !(alignment & (alignment - 1)) && !(alignment % sizeof(void *)))
+  {
+    *memptr = swNumaBlockAlloc(alignment, size, false);
+    rtn = (*memptr)? 0 : ENOMEM;
+  }
+  return rtn;
+}
+
+static swMemoryManager numaManager = { swNumaManagerMalloc, swNumaManagerCalloc, swNumaManagerRealloc, swNumaManagerFree, swNumaManagerAlignMalloc };
+
+swMemoryManager *swNumaMemoryManagerGet()
+{
+  if (!wrappedManager)
+  {
+    pageSize = getpagesize();
+    wrappedManager = swMemoryManagerGet();
+    if (wrappedManager == &numaManager)
+      wrappedManager = &systemManager;
+  }
+  return &numaManager;
+}
@@ -0,0 +1,49 @@
+#ifndef SW_CORE_NUMA_H
+#define SW_CORE_NUMA_H
+
+#include "core/memory.h"
+
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// NUMA topology from /sys/devices/system/node and memory placement with mbind/set_mempolicy/get_mempolicy
+// called through syscall(), so there is no libnuma dependency; on a machine without NUMA everything
+// reports a single node 0 and the policy calls still succeed
+// fake NUMA nodes for testing can be created with numa=fake=<N> kernel boot parameter
+
+#define SW_NUMA_NODE_ANY  -1
+#define SW_NUMA_NODE_MAX  64
+
+// number of online nodes, max node id + 1
+int swNumaNodeCount();
+bool swNumaNodeCPUSetGet(int node, cpu_set_t *cpuSet);
+int swNumaCPUNodeGet(int cpu);
+// node of the CPU the calling thread runs on
+int swNumaCurrentNodeGet();
+
+// memory policy of the calling thread, all the pages it touches after the call come from the node
+// (MPOL_PREFERRED, falls back to other nodes when the node is out of memory)
+bool swNumaThreadNodeSet(int node);
+bool swNumaThreadNodeReset();
+// node set by swNumaThreadNodeSet or SW_NUMA_NODE_ANY
+int swNumaThreadNodeGet();
+
+// binds the range (has to be page aligned) to the node, pages already allocated are moved
+bool swNumaMemoryBind(void *address, size_t size, int node);
+// node of the page the address belongs to, the page is faulted in if needed
+int swNumaMemoryNodeGet(void *address);
+
+// page aligned region allocated on the node, when the kernel does not let it be bound the
+// region is still returned and its pages follow the thread policy
+void *swNumaAlloc(size_t size, int node);
+void swNumaFree(void *ptr, size_t size);
+
+// memory manager that places blocks of SW_NUMA_MANAGER_BIND_SIZE and bigger on the node set by
+// swNumaThreadNodeSet (or the node of the current CPU) with mbind, smaller blocks come from
+// the wrapped (current at the time of the first call) manager and follow the thread policy
+// WARNING: the manager has to be set before any allocation is made
+#define SW_NUMA_MANAGER_BIND_SIZE (64 * 1024)
+swMemoryManager *swNumaMemoryManagerGet();
+
+#endif // SW_CORE_NUMA_H
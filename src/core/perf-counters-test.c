@@ -0,0 +1,57 @@
+#include "core/perf-counters.h"
+
+#include "unittest/unittest.h"
+
+static volatile uint64_t testSum = 0;
+
+static void testFunction()
+{
+  for (uint32_t i = 0; i < 100000; i++)
+    testSum += i;
+}
+
+swTestDeclare(PerfCountersTextTest, NULL, NULL, swTestRun)
+{
+  ASSERT_NOT_NULL(swPerfCounterTextGet(swPerfCounterCycles));
+  ASSERT_NOT_NULL(swPerfCounterTextGet(swPerfCounterDTLBMisses));
+  ASSERT_NULL(swPerfCounterTextGet(swPerfCounterMax));
+  return true;
+}
+
+swTestDeclare(PerfCountersMeasureTest, NULL, NULL, swTestRun)
+{
+  swPerfCounters counters;
+  ASSERT_FALSE(swPerfCountersInit(NULL));
+  if (swPerfCountersInit(&counters))
+  {
+    ASSERT_TRUE(swPerfCountersMeasure(&counters, testFunction));
+    for (uint32_t i = 0; i < swPerfCounterMax; i++)
+    {
+      if (swPerfCountersAvailable(&counters, i))
+        swTestLogLine("%s = %lu%s\n", swPerfCounterTextGet(i), counters.values[i], (counters.multiplexed)? " (scaled)" : "");
+      else
+        swTestLogLine("%s is not available\n", swPerfCounterTextGet(i));
+    }
+    // the loop can not run in less instructions than iterations
+    if (swPerfCountersAvailable(&counters, swPerfCounterInstructions))
+      ASSERT_TRUE(counters.values[swPerfCounterInstructions] >= 100000);
+    // counting starts over
+    ASSERT_TRUE(swPerfCountersStart(&counters));
+    ASSERT_TRUE(swPerfCountersStop(&counters));
+    if (swPerfCountersAvailable(&counters, swPerfCounterInstructions))
+      ASSERT_TRUE(counters.values[swPerfCounterInstructions] < 100000);
+  }
+  else
+  {
+    // nothing to count with, everything has to fail cleanly
+    swTestLogLine("perf counters are not available\n");
+    ASSERT_EQUAL(counters.available, 0);
+    ASSERT_FALSE(swPerfCountersStart(&counters));
+    ASSERT_FALSE(swPerfCountersStop(&counters));
+  }
+  swPerfCountersRelease(&counters);
+  return true;
+}
+
+swTestSuiteStructDeclare(PerfCountersTest, NULL, NULL, swTestRun,
+                         &PerfCountersTextTest, &PerfCountersMeasureTest);
@@ -0,0 +1,129 @@
+#include "core/perf-counters.h"
+
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const char *swPerfCounterText[] =
+{
+  "cycles",
+  "instructions",
+  "l1dMisses",
+  "llcMisses",
+  "branchMisses",
+  "dtlbMisses"
+};
+
+const char *swPerfCounterTextGet(swPerfCounter counter)
+{
+  return (counter < swPerfCounterMax)? swPerfCounterText[counter] : NULL;
+}
+
+#define SW_PERF_CACHE_MISS(cache) ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static const struct
+{
+  uint32_t type;
+  uint64_t config;
+} swPerfCounterConfig[] =
+{
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+  { PERF_TYPE_HW_CACHE, SW_PERF_CACHE_MISS(PERF_COUNT_HW_CACHE_L1D) },
+  { PERF_TYPE_HW_CACHE, SW_PERF_CACHE_MISS(PERF_COUNT_HW_CACHE_LL) },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+  { PERF_TYPE_HW_CACHE, SW_PERF_CACHE_MISS(PERF_COUNT_HW_CACHE_DTLB) }
+};
+
+bool swPerfCountersInit(swPerfCounters *counters)
+{
+  bool rtn = false;
+  if (counters)
+  {
+    memset(counters, 0, sizeof(*counters));
+    counters->groupFd = -1;
+    for (uint32_t i = 0; i < swPerfCounterMax; i++)
+    {
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = swPerfCounterConfig[i].type;
+      attr.config = swPerfCounterConfig[i].config;
+      attr.disabled = (counters->groupFd < 0);
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      counters->fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, counters->groupFd, 0);
+      if (counters->fds[i] >= 0)
+      {
+        if (counters->groupFd < 0)
+          counters->groupFd = counters->fds[i];
+        counters->available |= 1 << i;
+      }
+    }
+    rtn = (counters->available != 0);
+  }
+  return rtn;
+}
+
+void swPerfCountersRelease(swPerfCounters *counters)
+{
+  if (counters)
+  {
+    for (uint32_t i = 0; i < swPerfCounterMax; i++)
+    {
+      if (swPerfCountersAvailable(counters, i))
+        close(counters->fds[i]);
+      counters->fds[i] = -1;
+    }
+    counters->groupFd = -1;
+    counters->available = 0;
+  }
+}
+
+bool swPerfCountersStart(swPerfCounters *counters)
+{
+  bool rtn = false;
+  if (counters && (counters->groupFd >= 0))
+  {
+    if ((ioctl(counters->groupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP) == 0)
+        && (ioctl(counters->groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) == 0))
+      rtn = true;
+  }
+  return rtn;
+}
+
+bool swPerfCountersStop(swPerfCounters *counters)
+{
+  bool rtn = false;
+  if (counters && (counters->groupFd >= 0) && (ioctl(counters->groupFd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP) == 0))
+  {
+    // nr, time enabled, time running and the values in the order the counters joined the group
+    uint64_t data[3 + swPerfCounterMax];
+    ssize_t size = read(counters->groupFd, data, sizeof(data));
+    if ((size >= (ssize_t)(3 * sizeof(uint64_t))) && (data[0] <= swPerfCounterMax) && (size >= (ssize_t)((3 + data[0]) * sizeof(uint64_t))))
+    {
+      uint64_t enabled = data[1];
+      uint64_t running = data[2];
+      uint32_t position = 3;
+      memset(counters->values, 0, sizeof(counters->values));
+      counters->multiplexed = (running < enabled);
+      // a group that never made it to the PMU counted nothing
+      if (running)
+      {
+        for (uint32_t i = 0; i < swPerfCounterMax; i++)
+        {
+          if (swPerfCountersAvailable(counters, i))
+          {
+            counters->values[i] = (counters->multiplexed)? (uint64_t)((double)data[position] * enabled / running) : data[position];
+            position++;
+          }
+        }
+        rtn = true;
+      }
+    }
+  }
+  return rtn;
+}
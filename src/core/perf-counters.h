@@ -0,0 +1,56 @@
+#ifndef SW_CORE_PERFCOUNTERS_H
+#define SW_CORE_PERFCOUNTERS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// hardware counters of the calling thread opened as one perf_event_open group, so all of them
+// count over exactly the same instructions; the counters the kernel or the hardware does not
+// provide (VMs, containers with perf_event_paranoid > 2, seccomp) are left out, the rest still work
+
+typedef enum swPerfCounter
+{
+  swPerfCounterCycles = 0,
+  swPerfCounterInstructions,
+  swPerfCounterL1DMisses,
+  swPerfCounterLLCMisses,
+  swPerfCounterBranchMisses,
+  swPerfCounterDTLBMisses,
+  swPerfCounterMax
+} swPerfCounter;
+
+const char *swPerfCounterTextGet(swPerfCounter counter);
+
+typedef struct swPerfCounters
+{
+  int fds[swPerfCounterMax];
+  int groupFd;
+  // bit per counter that was opened
+  uint32_t available;
+  // set when the group was not on the PMU all the time and the values are scaled
+  bool multiplexed;
+  // counted between the last start and stop
+  uint64_t values[swPerfCounterMax];
+} swPerfCounters;
+
+// false when no counter could be opened, the structure can be released either way
+bool swPerfCountersInit(swPerfCounters *counters);
+void swPerfCountersRelease(swPerfCounters *counters);
+
+#define swPerfCountersAvailable(c, counter)  (((c)->available & (1 << (counter))) != 0)
+
+bool swPerfCountersStart(swPerfCounters *counters);
+bool swPerfCountersStop(swPerfCounters *counters);
+
+static inline bool swPerfCountersMeasure(swPerfCounters *counters, void (*func)())
+{
+  bool rtn = false;
+  if (swPerfCountersStart(counters))
+  {
+    func();
+    rtn = swPerfCountersStop(counters);
+  }
+  return rtn;
+}
+
+#endif // SW_CORE_PERFCOUNTERS_H
@@ -30,6 +30,26 @@ swTestDeclare(StopWatchMeasureTest, NULL, NULL, swTestRun)
   return true;
 }
 
+swTestDeclare(StopWatchPerfCountersTest, NULL, NULL, swTestRun)
+{
+  swStopWatch watch = { 0 };
+  swPerfCounters counters;
+  if (swPerfCountersInit(&counters))
+  {
+    swStopWatchPerfCountersSet(&watch, &counters);
+    swStopWatchPrepare(&watch);
+    swStopWatchMeasure(&watch, testFunction);
+    swTestLogLine("Stop watch ticks = %lu, cycles = %lu, instructions = %lu\n", watch.timeTicks,
+                  counters.values[swPerfCounterCycles], counters.values[swPerfCounterInstructions]);
+    if (swPerfCountersAvailable(&counters, swPerfCounterInstructions))
+      ASSERT_TRUE(counters.values[swPerfCounterInstructions] > 0);
+  }
+  else
+    swTestLogLine("perf counters are not available, skipping\n");
+  swPerfCountersRelease(&counters);
+  return true;
+}
+
 swTestSuiteStructDeclare(StopWatchTest, NULL, NULL, swTestRun,
-                         &StopWatchBasicTest, &StopWatchMeasureTest);
+                         &StopWatchBasicTest, &StopWatchMeasureTest, &StopWatchPerfCountersTest);
 
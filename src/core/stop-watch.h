@@ -1,6 +1,9 @@
 #ifndef SW_CORE_STOPWATCH_H
 #define SW_CORE_STOPWATCH_H
 
+#include "core/clock.h"
+#include "core/perf-counters.h"
+
 #include <stdint.h>
 #include <limits.h>
 
@@ -11,8 +14,16 @@ typedef struct swStopWatch
   uint32_t startHigh;
   uint32_t finishLow;
   uint32_t finishHigh;
+  // optional, set with swStopWatchPerfCountersSet, counted over the same span as the ticks
+  swPerfCounters *counters;
 } swStopWatch;
 
+static inline void swStopWatchPerfCountersSet(swStopWatch *stopWatch, swPerfCounters *counters)
+{
+  if (stopWatch)
+    stopWatch->counters = counters;
+}
+
 // TODO: I see no clear way yet on how turn off interrupts and preemtion in the user space like kernel
 // allows us to do using the following functions
 //    preempt_disable();
@@ -50,6 +61,11 @@ static inline void swStopWatchStart(swStopWatch *stopWatch)
       "CPUID\n\t" : "=r" (stopWatch->finishHigh), "=r" (stopWatch->finishLow) :: "%rax", "%rbx", "%rcx", "%rdx"
     );
 
+    // the counters are enabled before the start and disabled after the finish timestamp, the
+    // system calls stay out of the ticks
+    if (stopWatch->counters)
+      swPerfCountersStart(stopWatch->counters);
+
     // collect start data
     asm volatile (
       "CPUID\n\t"
@@ -69,6 +85,8 @@ static inline void swStopWatchStop(swStopWatch *stopWatch)
     "mov %%eax, %1\n\t"
     "CPUID\n\t" : "=r" (stopWatch->finishHigh), "=r" (stopWatch->finishLow) :: "%rax", "%rbx", "%rcx", "%rdx"
   );
+  if (stopWatch->counters)
+    swPerfCountersStop(stopWatch->counters);
   uint64_t start = ( ((uint64_t)stopWatch->startHigh << 32) | stopWatch->startLow );
   uint64_t finish = ( ((uint64_t)stopWatch->finishHigh << 32) | stopWatch->finishLow );
   stopWatch->timeTicks = (finish > start) ? (finish - start) : (ULONG_MAX - start + finish);
@@ -108,6 +126,9 @@ static inline void swStopWatchPrepare(swStopWatch *stopWatch)
 
 static inline void swStopWatchMeasure(swStopWatch *stopWatch, void (*func)())
 {
+  if (stopWatch->counters)
+    swPerfCountersStart(stopWatch->counters);
+
   // collect start data
   asm volatile (
     "CPUID\n\t"
@@ -125,9 +146,17 @@ static inline void swStopWatchMeasure(swStopWatch *stopWatch, void (*func)())
     "mov %%eax, %1\n\t"
     "CPUID\n\t" : "=r" (stopWatch->finishHigh), "=r" (stopWatch->finishLow) :: "%rax", "%rbx", "%rcx", "%rdx"
   );
+  if (stopWatch->counters)
+    swPerfCountersStop(stopWatch->counters);
   uint64_t start = ( ((uint64_t)stopWatch->startHigh << 32) | stopWatch->startLow );
   uint64_t finish = ( ((uint64_t)stopWatch->finishHigh << 32) | stopWatch->finishLow );
   stopWatch->timeTicks = (finish > start) ? (finish - start) : (ULONG_MAX - start + finish);
 }
 
+// needs swClockInit to have calibrated the tick rate
+static inline uint64_t swStopWatchNSecGet(swStopWatch *stopWatch)
+{
+  return swClockTicksToNSec(stopWatch->timeTicks);
+}
+
 #endif // SW_CORE_STOPWATCH_H
@@ -0,0 +1,72 @@
+#include "init/init-clock.h"
+
+#include "command-line/option-category.h"
+#include "core/clock.h"
+#include "io/edge-timer.h"
+#include "log/log-manager.h"
+
+swLoggerDeclareWithLevel(clockLogger, "Clock", swLogLevelInfo);
+
+int64_t clockCalibrationTime = 10;
+int64_t clockRecalibrationInterval = 60000;
+
+swOptionCategoryModuleDeclare(swClockOptions, "Clock Options",
+  swOptionDeclareScalar("clock-calibration-time",    "Amount of time in milliseconds to measure the TSC rate for at startup, 0 to use clock_gettime",
+    NULL,   &clockCalibrationTime,                   swOptionValueTypeInt, false),
+  swOptionDeclareScalar("clock-recalibration-interval", "Interval in milliseconds for re-anchoring the TSC clock to the monotonic clock, 0 to disable",
+    NULL,   &clockRecalibrationInterval,             swOptionValueTypeInt, false)
+);
+
+static swEdgeTimer clockTimer = { .watcher = { .fd = -1 } };
+static swEdgeLoop **clockLoopPtr = NULL;
+
+static void swClockTimerCallback(swEdgeTimer *timer, uint64_t expiredCount, uint32_t events)
+{
+  if (!swClockRecalibrate())
+    SW_LOG_WARNING(&clockLogger, "Clock recalibration failed");
+}
+
+// without a calibration time the clock is left on clock_gettime, the state it has before swClockInit
+static bool swInitClockStart()
+{
+  bool rtn = false;
+  if (clockCalibrationTime <= 0)
+  {
+    SW_LOG_INFO(&clockLogger, "Clock: not calibrated, using clock_gettime");
+    rtn = true;
+  }
+  else if (swClockInit(swTimeMSecToNSec((uint64_t)clockCalibrationTime)))
+  {
+    SW_LOG_INFO(&clockLogger, "Clock: TSC %s, frequency = %lu Hz", (swClockTSCIsUsed()? "used" : "not invariant, using clock_gettime"), swClockFrequencyGet());
+    rtn = true;
+    if (swClockTSCIsUsed() && (clockRecalibrationInterval > 0) && clockLoopPtr && *clockLoopPtr)
+    {
+      rtn = false;
+      if (swEdgeTimerInit(&clockTimer, swClockTimerCallback, false))
+      {
+        if (swEdgeTimerStart(&clockTimer, *clockLoopPtr, clockRecalibrationInterval, clockRecalibrationInterval, false))
+          rtn = true;
+        else
+          swEdgeTimerClose(&clockTimer);
+      }
+    }
+  }
+  return rtn;
+}
+
+static void swInitClockStop()
+{
+  if (clockTimer.watcher.loop)
+    swEdgeTimerStop(&clockTimer);
+  if (clockTimer.watcher.fd >= 0)
+    swEdgeTimerClose(&clockTimer);
+  clockLoopPtr = NULL;
+}
+
+static swInitData clockData = {.startFunc = swInitClockStart, .stopFunc = swInitClockStop, .name = "Clock"};
+
+swInitData *swInitClockDataGet(swEdgeLoop **loopPtr)
+{
+  clockLoopPtr = loopPtr;
+  return &clockData;
+}
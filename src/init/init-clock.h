@@ -0,0 +1,11 @@
+#ifndef SW_INIT_INITCLOCK_H
+#define SW_INIT_INITCLOCK_H
+
+#include "init/init.h"
+#include "io/edge-loop.h"
+
+// calibrates swClock and recalibrates it periodically on the loop, goes before the stages that
+// start threads or take timestamps so they all use the calibrated clock
+swInitData *swInitClockDataGet(swEdgeLoop **loopPtr);
+
+#endif // SW_INIT_INITCLOCK_H
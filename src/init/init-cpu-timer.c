@@ -1,12 +1,26 @@
 #include "init/init-cpu-timer.h"
 
+#include "command-line/option-category.h"
+#include "core/memory-tracker.h"
 #include "core/time.h"
 #include "io/edge-timer.h"
 #include "log/log-manager.h"
 
+#include <dlfcn.h>
 #include <string.h>
 
 swLoggerDeclareWithLevel(cpuLogger, "CPUUtilization", swLogLevelInfo);
+swLoggerDeclareWithLevel(memoryLogger, "MemoryUsage", swLogLevelInfo);
+swLoggerDeclareWithLevel(loopLogger, "LoopStats", swLogLevelInfo);
+
+bool loopStats = false;
+
+swOptionCategoryModuleDeclare(swCPUTimerOptions, "CPU Timer Options",
+  swOptionDeclareScalar("loop-stats",   "Measure the event loop callbacks and report them with the CPU utilization",
+    NULL,   &loopStats,             swOptionValueTypeBool, false)
+);
+
+#define SW_CPU_TIMER_CALLSITES_REPORTED 3
 
 typedef struct swCPUTimerData
 {
@@ -17,6 +31,60 @@ typedef struct swCPUTimerData
 
 static swCPUTimerData timerData = { .timer = {.watcher = { .fd = -1 } } };
 
+static void swCPUTimerMemoryReport()
+{
+  uint32_t tagCount = swMemoryTagCount();
+  for (uint32_t tag = 0; tag < tagCount; tag++)
+  {
+    swMemoryTagStats stats = { NULL };
+    if (swMemoryTagStatsGet(tag, &stats) && stats.total)
+    {
+      SW_LOG_INFO(&memoryLogger, "Memory '%s': bytes = %lu, peak = %lu, allocations = %lu, total = %lu, budget = %lu, over budget = %lu",
+                  stats.name, stats.bytes, stats.peak, stats.allocations, stats.total, stats.budget, stats.overBudget);
+      swMemoryCallSite sites[SW_CPU_TIMER_CALLSITES_REPORTED];
+      uint32_t siteCount = swMemoryCallSitesGet(tag, sites, SW_CPU_TIMER_CALLSITES_REPORTED);
+      for (uint32_t i = 0; i < siteCount; i++)
+      {
+        Dl_info info = { NULL };
+        if (dladdr(sites[i].address, &info) && info.dli_sname)
+          SW_LOG_INFO(&memoryLogger, "Memory '%s': call site %s+0x%lx: samples = %lu, bytes = %lu",
+                      stats.name, info.dli_sname, (uintptr_t)sites[i].address - (uintptr_t)info.dli_saddr, sites[i].samples, sites[i].bytes);
+        else
+          SW_LOG_INFO(&memoryLogger, "Memory '%s': call site %p: samples = %lu, bytes = %lu", stats.name, sites[i].address, sites[i].samples, sites[i].bytes);
+      }
+    }
+  }
+}
+
+static void swCPUTimerLoopReport(swEdgeLoop *loop, swEdgeLoopStats *stats)
+{
+  uint64_t totalTime = stats->blockedTime + stats->busyTime;
+  SW_LOG_INFO(&loopLogger, "Loop: iterations = %lu, events = %lu, events per wait p50/p99/max = %lu/%lu/%lu, busy = %.2f%%, iteration p50/p99/max = %lu/%lu/%lu ns",
+              stats->iterations, stats->events, swHistogramPercentileGet(stats->eventsPerWait, 50), swHistogramPercentileGet(stats->eventsPerWait, 99),
+              stats->eventsPerWait->max, ((totalTime)? (double)stats->busyTime * 100 / totalTime : 0.0),
+              swHistogramPercentileGet(stats->iterationTime, 50), swHistogramPercentileGet(stats->iterationTime, 99), stats->iterationTime->max);
+  for (uint32_t type = swWatcherTypeNone + 1; type < swWatcherTypeMax; type++)
+  {
+    swHistogram *histogram = stats->callbackTime[type];
+    if (histogram->count)
+      SW_LOG_INFO(&loopLogger, "Loop '%s' callbacks: count = %lu, mean = %.0f ns, p50/p99/max = %lu/%lu/%lu ns", swWatcherTypeTextGet(type), histogram->count,
+                  swHistogramMeanGet(histogram), swHistogramPercentileGet(histogram, 50), swHistogramPercentileGet(histogram, 99), histogram->max);
+  }
+  for (uint32_t tag = 1; tag < SW_EDGELOOP_TAG_MAX; tag++)
+  {
+    swHistogram *histogram = stats->tagCallbackTime[tag];
+    if (histogram->count)
+      SW_LOG_INFO(&loopLogger, "Loop tag '%s' callbacks: count = %lu, mean = %.0f ns, p50/p99/max = %lu/%lu/%lu ns",
+                  ((swEdgeLoopTagNameGet(loop, tag))? swEdgeLoopTagNameGet(loop, tag) : "unnamed"), histogram->count,
+                  swHistogramMeanGet(histogram), swHistogramPercentileGet(histogram, 50), swHistogramPercentileGet(histogram, 99), histogram->max);
+  }
+  if (stats->busyPollHits || stats->busyPollMisses)
+    SW_LOG_INFO(&loopLogger, "Loop busy poll: hits = %lu, misses = %lu", stats->busyPollHits, stats->busyPollMisses);
+  if (stats->longestCallback)
+    SW_LOG_INFO(&loopLogger, "Loop longest callback: %lu ns, type '%s', tag %u", stats->longestCallback,
+                swWatcherTypeTextGet(stats->longestCallbackType), stats->longestCallbackTag);
+}
+
 static void swCPUTimerCallback(swEdgeTimer *timer, uint64_t expiredCount, uint32_t events)
 {
   if (timer)
@@ -28,6 +96,15 @@ static void swCPUTimerCallback(swEdgeTimer *timer, uint64_t expiredCount, uint32
     timerData->lastCPUTimeStamp = swTimeGet(CLOCK_PROCESS_CPUTIME_ID);
     double cpuUtilization = ((double)(timerData->lastCPUTimeStamp - lastCPUTimeStamp)) * 100 / ((double)(timerData->lastMonotonicTimeStamp - lastMonotonicTimeStamp));
     SW_LOG_INFO(&cpuLogger, "CPU Utilization: %.2f%%", cpuUtilization);
+    if (swMemoryTrackerIsInstalled())
+      swCPUTimerMemoryReport();
+    swEdgeLoop *loop = swEdgeWatcherLoopGet(timer);
+    swEdgeLoopStats *stats = swEdgeLoopStatsGet(loop);
+    if (stats)
+    {
+      swCPUTimerLoopReport(loop, stats);
+      swEdgeLoopStatsReset(loop);
+    }
   }
 }
 
@@ -40,7 +117,7 @@ static bool swInitCPUTimerStart()
   uint64_t *timerInterval = (uint64_t *)cpuTimerArrayData[1];
   if (loop && *loop && timerInterval)
   {
-    if (swEdgeTimerInit(&(timerData.timer), swCPUTimerCallback, false))
+    if ((!loopStats || swEdgeLoopStatsEnable(*loop)) && swEdgeTimerInit(&(timerData.timer), swCPUTimerCallback, false))
     {
       timerData.lastMonotonicTimeStamp = swTimeGet(CLOCK_MONOTONIC_RAW);
       timerData.lastCPUTimeStamp = swTimeGet(CLOCK_PROCESS_CPUTIME_ID);
@@ -58,6 +135,9 @@ static bool swInitCPUTimerStart()
 
 static void swInitCPUTimerStop()
 {
+  swEdgeLoop **loop = (swEdgeLoop **)cpuTimerArrayData[0];
+  if (loopStats && loop && *loop)
+    swEdgeLoopStatsDisable(*loop);
   if (timerData.timer.watcher.loop)
     swEdgeTimerStop(&(timerData.timer));
   if (timerData.timer.watcher.fd >= 0)
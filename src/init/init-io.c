@@ -1,20 +1,78 @@
 #include "init/init-io.h"
+#include "command-line/option-category.h"
+#include "io/edge-prepare.h"
 #include "io/edge-signal.h"
+#include "log/log-manager.h"
 
+#include <pthread.h>
+#include <sched.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <string.h>
 
+swLoggerDeclareWithLevel(ioLogger, "IO", swLogLevelInfo);
+
+int64_t busyPollTime = 0;
+int64_t socketBusyPoll = 0;
+bool preferBusyPoll = false;
+int64_t loopCPU = -1;
+int64_t ioBudget = 0;
+
+swOptionCategoryModuleDeclare(swInitIOOptions, "Event Loop Options",
+  swOptionDeclareScalar("busy-poll",          "Time in microseconds the event loop polls for events before it blocks",
+    NULL,   &busyPollTime,          swOptionValueTypeInt, false),
+  swOptionDeclareScalar("socket-busy-poll",   "SO_BUSY_POLL time in microseconds for the sockets of the event loop",
+    NULL,   &socketBusyPoll,        swOptionValueTypeInt, false),
+  swOptionDeclareScalar("prefer-busy-poll",   "Set SO_PREFER_BUSY_POLL on the sockets of the event loop",
+    NULL,   &preferBusyPoll,        swOptionValueTypeBool, false),
+  swOptionDeclareScalar("loop-cpu",           "CPU to pin the event loop thread to, -1 for none",
+    NULL,   &loopCPU,               swOptionValueTypeInt, false),
+  swOptionDeclareScalar("io-budget",          "Bytes a connection can read or write in one event loop iteration, 0 for no limit",
+    NULL,   &ioBudget,              swOptionValueTypeInt, false)
+);
+
 static void *edgeLoopArrayData[1] = {NULL};
+static swEdgePrepare loopCPUWatcher = {.prepareCB = NULL};
+
+// the threads inherit the affinity of the thread that creates them, so the event loop thread is
+// pinned in the first iteration of the loop, once the other init stages have started theirs
+static void loopCPUCallback(swEdgePrepare *prepareWatcher)
+{
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  CPU_SET(loopCPU, &cpuSet);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet))
+    SW_LOG_WARNING(&ioLogger, "failed to pin the event loop thread to CPU %ld", loopCPU);
+  swEdgePrepareStop(prepareWatcher);
+}
 
 static bool swInitIOEdgeLoopStart()
 {
   bool rtn = false;
   swEdgeLoop **loopPtr = edgeLoopArrayData[0];
-  if (loopPtr)
+  // the options have no validators, a CPU past the set would only fail to pin once the loop runs
+  if (loopCPU >= CPU_SETSIZE)
+    SW_LOG_ERROR(&ioLogger, "loop-cpu %ld is out of range, it has to be below %d", loopCPU, CPU_SETSIZE);
+  else if (loopPtr)
   {
     if ((*loopPtr = swEdgeLoopNew()))
+    {
+      // a spinning loop without its own CPU takes the time from the rest of the threads
+      if (loopCPU >= 0)
+      {
+        if (!swEdgePrepareInit(&loopCPUWatcher, loopCPUCallback) || !swEdgePrepareStart(&loopCPUWatcher, *loopPtr))
+          SW_LOG_WARNING(&ioLogger, "failed to pin the event loop thread to CPU %ld", loopCPU);
+      }
+      else if (busyPollTime > 0)
+        SW_LOG_WARNING(&ioLogger, "busy poll is set without loop-cpu, the event loop thread is not pinned");
+      if (busyPollTime > 0)
+        swEdgeLoopBusyPollSet(*loopPtr, swTimeUSecToNSec(busyPollTime));
+      if (socketBusyPoll > 0)
+        swEdgeLoopSocketBusyPollSet(*loopPtr, socketBusyPoll, preferBusyPoll);
+      if (ioBudget > 0)
+        swEdgeLoopIOBudgetSet(*loopPtr, ioBudget);
       rtn = true;
+    }
   }
   return rtn;
 }
@@ -24,6 +82,8 @@ static void swInitIOEdgeLoopStop()
   swEdgeLoop **loopPtr = (swEdgeLoop **)edgeLoopArrayData[0];
   if (loopPtr && *loopPtr)
   {
+    swEdgePrepareStop(&loopCPUWatcher);
+    swEdgePrepareClose(&loopCPUWatcher);
     swEdgeLoopDelete(*loopPtr);
     edgeLoopArrayData[0] = NULL;
   }
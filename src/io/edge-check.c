@@ -0,0 +1,48 @@
+#include "edge-check.h"
+
+#include <string.h>
+
+bool swEdgeCheckInit(swEdgeCheck *checkWatcher, swEdgeCheckCallback cb)
+{
+  bool rtn = false;
+  if (checkWatcher && cb)
+  {
+    memset(checkWatcher, 0, sizeof(swEdgeCheck));
+    swEdgeWatcher *watcher = (swEdgeWatcher *)checkWatcher;
+    watcher->type = swWatcherTypeCheck;
+    watcher->fd = -1;
+    checkWatcher->checkCB = cb;
+    rtn = true;
+  }
+  return rtn;
+}
+
+bool swEdgeCheckStart(swEdgeCheck *checkWatcher, swEdgeLoop *loop)
+{
+  bool rtn = false;
+  swEdgeWatcher *watcher = (swEdgeWatcher *)checkWatcher;
+  if (checkWatcher && loop && !watcher->loop)
+  {
+    if (swEdgeLoopWatcherAdd(loop, watcher))
+    {
+      watcher->loop = loop;
+      rtn = true;
+    }
+  }
+  return rtn;
+}
+
+void swEdgeCheckStop(swEdgeCheck *checkWatcher)
+{
+  swEdgeWatcher *watcher = (swEdgeWatcher *)checkWatcher;
+  if (checkWatcher && watcher->loop)
+  {
+    swEdgeLoopWatcherRemove(watcher->loop, watcher);
+    watcher->loop = NULL;
+  }
+}
+
+void swEdgeCheckClose(swEdgeCheck *checkWatcher)
+{
+  swEdgeCheckStop(checkWatcher);
+}
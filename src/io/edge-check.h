@@ -0,0 +1,26 @@
+#ifndef SW_IO_EDGECHECK_H
+#define SW_IO_EDGECHECK_H
+
+#include "edge-loop.h"
+
+// called at the end of every loop iteration, after the callbacks of the events the poll
+// returned, the place to coalesce the work the callbacks queued up (flush the writes of a
+// connection with one call, commit a batch of records, ...)
+
+struct swEdgeCheck;
+
+typedef void (*swEdgeCheckCallback)(struct swEdgeCheck *checkWatcher);
+
+typedef struct swEdgeCheck
+{
+  swEdgeWatcher watcher;
+
+  swEdgeCheckCallback checkCB;
+} swEdgeCheck;
+
+bool swEdgeCheckInit(swEdgeCheck *checkWatcher, swEdgeCheckCallback cb);
+bool swEdgeCheckStart(swEdgeCheck *checkWatcher, swEdgeLoop *loop);
+void swEdgeCheckStop(swEdgeCheck *checkWatcher);
+void swEdgeCheckClose(swEdgeCheck *checkWatcher);
+
+#endif // SW_IO_EDGECHECK_H
@@ -0,0 +1,48 @@
+#include "edge-idle.h"
+
+#include <string.h>
+
+bool swEdgeIdleInit(swEdgeIdle *idleWatcher, swEdgeIdleCallback cb)
+{
+  bool rtn = false;
+  if (idleWatcher && cb)
+  {
+    memset(idleWatcher, 0, sizeof(swEdgeIdle));
+    swEdgeWatcher *watcher = (swEdgeWatcher *)idleWatcher;
+    watcher->type = swWatcherTypeIdle;
+    watcher->fd = -1;
+    idleWatcher->idleCB = cb;
+    rtn = true;
+  }
+  return rtn;
+}
+
+bool swEdgeIdleStart(swEdgeIdle *idleWatcher, swEdgeLoop *loop)
+{
+  bool rtn = false;
+  swEdgeWatcher *watcher = (swEdgeWatcher *)idleWatcher;
+  if (idleWatcher && loop && !watcher->loop)
+  {
+    if (swEdgeLoopWatcherAdd(loop, watcher))
+    {
+      watcher->loop = loop;
+      rtn = true;
+    }
+  }
+  return rtn;
+}
+
+void swEdgeIdleStop(swEdgeIdle *idleWatcher)
+{
+  swEdgeWatcher *watcher = (swEdgeWatcher *)idleWatcher;
+  if (idleWatcher && watcher->loop)
+  {
+    swEdgeLoopWatcherRemove(watcher->loop, watcher);
+    watcher->loop = NULL;
+  }
+}
+
+void swEdgeIdleClose(swEdgeIdle *idleWatcher)
+{
+  swEdgeIdleStop(idleWatcher);
+}
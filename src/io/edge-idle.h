@@ -0,0 +1,25 @@
+#ifndef SW_IO_EDGEIDLE_H
+#define SW_IO_EDGEIDLE_H
+
+#include "edge-loop.h"
+
+// called in the loop iterations without any events, the loop does not block while an idle
+// watcher is running, so it keeps calling it till there is something else to do
+
+struct swEdgeIdle;
+
+typedef void (*swEdgeIdleCallback)(struct swEdgeIdle *idleWatcher);
+
+typedef struct swEdgeIdle
+{
+  swEdgeWatcher watcher;
+
+  swEdgeIdleCallback idleCB;
+} swEdgeIdle;
+
+bool swEdgeIdleInit(swEdgeIdle *idleWatcher, swEdgeIdleCallback cb);
+bool swEdgeIdleStart(swEdgeIdle *idleWatcher, swEdgeLoop *loop);
+void swEdgeIdleStop(swEdgeIdle *idleWatcher);
+void swEdgeIdleClose(swEdgeIdle *idleWatcher);
+
+#endif // SW_IO_EDGEIDLE_H
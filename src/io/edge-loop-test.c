@@ -3,15 +3,27 @@
 #include "io/edge-signal.h"
 #include "io/edge-async.h"
 #include "io/edge-io.h"
+#include "io/edge-prepare.h"
+#include "io/edge-check.h"
+#include "io/edge-idle.h"
+#include "io/edge-mailbox.h"
+#include "io/socket-io.h"
+#include "io/read-ring.h"
+#include "io/frame-decoder.h"
 
 #include "unittest/unittest.h"
 
+#include <pthread.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdio.h>
 #include <sys/socket.h>
 #include <errno.h>
 #include <string.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
 
 void edgeLoopSetup(swTestSuite *suite)
 {
@@ -378,5 +390,1170 @@ swTestDeclare(EdgeIOUDPTest, NULL, NULL, swTestRun)
   return runIOTest(suite, test, SOCK_DGRAM);
 }
 
+static uint64_t loopTimes[3] = { 0 };
+static uint32_t loopTimeCount = 0;
+
+void loopTimeCallback(swEdgeTimer *timer, uint64_t expiredCount, uint32_t events)
+{
+  swEdgeLoop *loop = swEdgeWatcherLoopGet(timer);
+  loopTimes[loopTimeCount++] = swEdgeLoopNow(loop);
+  if (loopTimeCount == 3)
+    swEdgeLoopBreak(loop);
+}
+
+swTestDeclare(EdgeLoopNowTest, NULL, NULL, swTestRun)
+{
+  swEdgeLoop *loop = swTestSuiteDataGet(suite);
+  ASSERT_NOT_NULL(loop);
+  uint64_t before = swEdgeLoopNow(loop);
+  ASSERT_TRUE(before > 0);
+  ASSERT_TRUE(swEdgeLoopNowUpdate(loop) >= before);
+  ASSERT_EQUAL(swEdgeLoopNow(loop), swClockCachedGet());
+
+  swEdgeTimer timer = {.timerCB = NULL};
+  ASSERT_TRUE(swEdgeTimerInit(&timer, loopTimeCallback, false));
+  ASSERT_TRUE(swEdgeTimerStart(&timer, loop, 100, 100, false));
+  // restarting on the same loop keeps the registration
+  ASSERT_TRUE(swEdgeTimerStart(&timer, loop, 50, 50, false));
+  uint64_t start = swEdgeLoopNowUpdate(loop);
+  swEdgeLoopRun(loop, false);
+  swEdgeTimerClose(&timer);
+  ASSERT_EQUAL(loopTimeCount, 3);
+  swTestLogLine("loop times %lu, %lu, %lu ns after the start\n", loopTimes[0] - start, loopTimes[1] - start, loopTimes[2] - start);
+  // the loop time is taken after the wait, so it is never before the timer expiration
+  for (uint32_t i = 0; i < 3; i++)
+    ASSERT_TRUE(loopTimes[i] >= start + swTimeMSecToNSec(50 * (i + 1)) - swTimeMSecToNSec(1));
+  return true;
+}
+
+swTestDeclare(EdgeLoopStatsTest, NULL, NULL, swTestRun)
+{
+  swEdgeLoop *loop = swTestSuiteDataGet(suite);
+  ASSERT_NOT_NULL(loop);
+  ASSERT_NULL(swEdgeLoopStatsGet(loop));
+  ASSERT_TRUE(swEdgeLoopStatsEnable(loop));
+  swEdgeLoopStats *stats = swEdgeLoopStatsGet(loop);
+  ASSERT_NOT_NULL(stats);
+  ASSERT_TRUE(swEdgeLoopTagNameSet(loop, 1, "test timer"));
+  ASSERT_FALSE(swEdgeLoopTagNameSet(loop, SW_EDGELOOP_TAG_MAX, "invalid"));
+
+  swEdgeTimer timer = {.timerCB = NULL};
+  swEdgeTimer *timerPtr = &timer;
+  ASSERT_TRUE(swEdgeTimerInit(timerPtr, loopTimeCallback, false));
+  swEdgeWatcherTagSet(timerPtr, 1);
+  ASSERT_TRUE(swEdgeTimerStart(timerPtr, loop, 20, 20, false));
+  loopTimeCount = 0;
+  swEdgeLoopRun(loop, false);
+  swEdgeTimerClose(timerPtr);
+
+  swTestLogLine("iterations = %lu, events = %lu, blocked = %lu ns, busy = %lu ns, timer p50 = %lu ns, longest = %lu ns\n",
+                stats->iterations, stats->events, stats->blockedTime, stats->busyTime,
+                swHistogramPercentileGet(stats->callbackTime[swWatcherTypeTimer], 50), stats->longestCallback);
+  ASSERT_TRUE(stats->iterations >= 3);
+  ASSERT_TRUE(stats->events >= 3);
+  ASSERT_EQUAL(stats->eventsPerWait->count, stats->iterations);
+  ASSERT_EQUAL(stats->iterationTime->count, stats->iterations);
+  ASSERT_EQUAL(stats->callbackTime[swWatcherTypeTimer]->count, 3);
+  ASSERT_EQUAL(stats->tagCallbackTime[1]->count, 3);
+  ASSERT_STR(swEdgeLoopTagNameGet(loop, 1), "test timer");
+  ASSERT_EQUAL(stats->longestCallbackType, swWatcherTypeTimer);
+  ASSERT_EQUAL(stats->longestCallbackTag, 1);
+  // the loop mostly waits for the timer
+  ASSERT_TRUE(stats->blockedTime > stats->busyTime);
+  ASSERT_TRUE(stats->blockedTime >= swTimeMSecToNSec(59));
+
+  swEdgeLoopStatsReset(loop);
+  ASSERT_EQUAL(stats->iterations, 0);
+  ASSERT_EQUAL(stats->callbackTime[swWatcherTypeTimer]->count, 0);
+  swEdgeLoopStatsDisable(loop);
+  ASSERT_NULL(swEdgeLoopStatsGet(loop));
+  return true;
+}
+
+swTestDeclare(EdgeLoopBusyPollTest, NULL, NULL, swTestRun)
+{
+  swEdgeLoop *loop = swTestSuiteDataGet(suite);
+  ASSERT_NOT_NULL(loop);
+  ASSERT_TRUE(swEdgeLoopStatsEnable(loop));
+  swEdgeLoopStats *stats = swEdgeLoopStatsGet(loop);
+  ASSERT_NOT_NULL(stats);
+
+  swEdgeTimer timer = {.timerCB = NULL};
+  swEdgeTimer *timerPtr = &timer;
+  ASSERT_TRUE(swEdgeTimerInit(timerPtr, loopTimeCallback, false));
+
+  // the timer expires while the loop is still polling
+  ASSERT_TRUE(swEdgeLoopBusyPollSet(loop, swTimeMSecToNSec(50)));
+  ASSERT_EQUAL(swEdgeLoopBusyPollTimeGet(loop), swTimeMSecToNSec(50));
+  ASSERT_TRUE(swEdgeTimerStart(timerPtr, loop, 5, 5, false));
+  loopTimeCount = 0;
+  swEdgeLoopRun(loop, false);
+  swTestLogLine("long busy poll: hits = %lu, misses = %lu\n", stats->busyPollHits, stats->busyPollMisses);
+  ASSERT_EQUAL(loopTimeCount, 3);
+  ASSERT_EQUAL(stats->busyPollHits, 3);
+  ASSERT_EQUAL(stats->busyPollMisses, 0);
+
+  // the polling ends long before the timer expires
+  swEdgeLoopStatsReset(loop);
+  ASSERT_TRUE(swEdgeLoopBusyPollSet(loop, swTimeUSecToNSec(10)));
+  ASSERT_TRUE(swEdgeTimerStart(timerPtr, loop, 20, 20, false));
+  loopTimeCount = 0;
+  swEdgeLoopRun(loop, false);
+  swTestLogLine("short busy poll: hits = %lu, misses = %lu\n", stats->busyPollHits, stats->busyPollMisses);
+  ASSERT_EQUAL(loopTimeCount, 3);
+  ASSERT_EQUAL(stats->busyPollMisses, 3);
+
+  swEdgeTimerClose(timerPtr);
+  ASSERT_TRUE(swEdgeLoopBusyPollSet(loop, 0));
+  swEdgeLoopStatsDisable(loop);
+  return true;
+}
+
+static uint32_t readTimeouts = 0;
+static uint64_t readTimeoutTime = 0;
+static bool ioClosed = false;
+
+bool socketIOReadTimeout(swSocketIO *io)
+{
+  readTimeouts++;
+  readTimeoutTime = swEdgeLoopNow(io->loop);
+  // keep waiting after the first one
+  return (readTimeouts == 1);
+}
+
+void socketIOClose(swSocketIO *io)
+{
+  ioClosed = true;
+  swEdgeLoopBreak(io->loop);
+}
+
+void socketIOReadReady(swSocketIO *io)
+{
+  char data[64];
+  swStaticBuffer buffer = swStaticBufferDefine(data);
+  ssize_t bytesRead = 0;
+  while (swSocketIORead(io, &buffer, &bytesRead) == swSocketReturnOK);
+}
+
+swTestDeclare(SocketIOReadTimeoutTest, NULL, NULL, swTestRun)
+{
+  swEdgeLoop *loop = swTestSuiteDataGet(suite);
+  ASSERT_NOT_NULL(loop);
+  int fd[2];
+  ASSERT_EQUAL(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fd), 0);
+  swSocketIO *io = swSocketIONew();
+  ASSERT_NOT_NULL(io);
+  ASSERT_TRUE(swSocketInitFromFD((swSocket *)io, fd[0]));
+  swSocketIOReadTimeoutSet(io, 100);
+  swSocketIOReadTimeoutFuncSet(io, socketIOReadTimeout);
+  swSocketIOReadReadyFuncSet(io, socketIOReadReady);
+  swSocketIOCloseFuncSet(io, socketIOClose);
+  ASSERT_TRUE(swSocketIOStart(io, loop));
+  uint64_t start = swEdgeLoopNowUpdate(loop);
+  // nothing to read, which starts the read timeout
+  socketIOReadReady(io);
+  swEdgeLoopRun(loop, false);
+  // the timeout only moves the deadline, the second one closes the socket
+  ASSERT_TRUE(ioClosed);
+  ASSERT_EQUAL(readTimeouts, 2);
+  swTestLogLine("second read timeout after %lu ns\n", readTimeoutTime - start);
+  ASSERT_TRUE(readTimeoutTime >= start + swTimeMSecToNSec(199));
+  ASSERT_TRUE(readTimeoutTime < start + swTimeMSecToNSec(1000));
+  swSocketIODelete(io);
+  close(fd[1]);
+  return true;
+}
+
+#define SW_BUDGET_TEST_DATA_SIZE  (64 * 1024)
+#define SW_BUDGET_TEST_BUDGET     4096
+#define SW_BUDGET_TEST_CALLS_MAX  64
+
+typedef struct swBudgetTestData
+{
+  uint64_t received;
+  uint64_t callbackBytes[SW_BUDGET_TEST_CALLS_MAX];
+  uint32_t calls;
+} swBudgetTestData;
+
+static swBudgetTestData budgetData[2] = {{0}};
+static int budgetCallOrder[2 * SW_BUDGET_TEST_CALLS_MAX] = {0};
+static uint32_t budgetCallCount = 0;
+
+void budgetReadReady(swSocketIO *io)
+{
+  swBudgetTestData *data = swSocketIODataGet(io);
+  char buffer[1024];
+  swStaticBuffer staticBuffer = swStaticBufferDefine(buffer);
+  ssize_t bytesRead = 0;
+  uint64_t callbackBytes = 0;
+  // reads everything it can, the budget is what stops it
+  while (swSocketIORead(io, &staticBuffer, &bytesRead) == swSocketReturnOK)
+    callbackBytes += bytesRead;
+  data->received += callbackBytes;
+  if (callbackBytes && (data->calls < SW_BUDGET_TEST_CALLS_MAX))
+    data->callbackBytes[data->calls++] = callbackBytes;
+  if (callbackBytes && (budgetCallCount < 2 * SW_BUDGET_TEST_CALLS_MAX))
+    budgetCallOrder[budgetCallCount++] = (data == &budgetData[0])? 0 : 1;
+  if ((budgetData[0].received == SW_BUDGET_TEST_DATA_SIZE) && (budgetData[1].received == SW_BUDGET_TEST_DATA_SIZE))
+    swEdgeLoopBreak(io->loop);
+}
+
+swTestDeclare(SocketIOBudgetTest, NULL, NULL, swTestRun)
+{
+  swEdgeLoop *loop = swTestSuiteDataGet(suite);
+  ASSERT_NOT_NULL(loop);
+  swEdgeLoopIOBudgetSet(loop, SW_BUDGET_TEST_BUDGET);
+  int fd[2][2];
+  swSocketIO *io[2] = {NULL};
+  char data[SW_BUDGET_TEST_DATA_SIZE] = {0};
+  for (uint32_t i = 0; i < 2; i++)
+  {
+    ASSERT_EQUAL(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fd[i]), 0);
+    int bufferSize = 4 * SW_BUDGET_TEST_DATA_SIZE;
+    ASSERT_EQUAL(setsockopt(fd[i][1], SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize)), 0);
+    ASSERT_EQUAL(setsockopt(fd[i][0], SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize)), 0);
+    ASSERT_EQUAL(write(fd[i][1], data, sizeof(data)), sizeof(data));
+    ASSERT_NOT_NULL((io[i] = swSocketIONew()));
+    ASSERT_TRUE(swSocketInitFromFD((swSocket *)io[i], fd[i][0]));
+    swSocketIODataSet(io[i], &budgetData[i]);
+    swSocketIOReadReadyFuncSet(io[i], budgetReadReady);
+    ASSERT_TRUE(swSocketIOStart(io[i], loop));
+  }
+  swEdgeLoopRun(loop, false);
+
+  swTestLogLine("callbacks %u and %u\n", budgetData[0].calls, budgetData[1].calls);
+  for (uint32_t i = 0; i < 2; i++)
+  {
+    ASSERT_EQUAL(budgetData[i].received, SW_BUDGET_TEST_DATA_SIZE);
+    ASSERT_EQUAL(budgetData[i].calls, SW_BUDGET_TEST_DATA_SIZE / SW_BUDGET_TEST_BUDGET);
+    for (uint32_t j = 0; j < budgetData[i].calls; j++)
+      ASSERT_EQUAL(budgetData[i].callbackBytes[j], SW_BUDGET_TEST_BUDGET);
+  }
+  // neither socket gets a second turn before the other one had its own
+  for (uint32_t i = 1; i < budgetCallCount; i++)
+    ASSERT_NOT_EQUAL(budgetCallOrder[i], budgetCallOrder[i - 1]);
+
+  swEdgeLoopIOBudgetSet(loop, 0);
+  for (uint32_t i = 0; i < 2; i++)
+  {
+    swSocketIODelete(io[i]);
+    close(fd[i][1]);
+  }
+  return true;
+}
+
+static uint32_t drainCalls = 0;
+
+void drainReadReady(swSocketIO *io)
+{
+  char buffer[1024];
+  swStaticBuffer staticBuffer = swStaticBufferDefine(buffer);
+  ssize_t bytesRead = 0;
+  drainCalls++;
+  while (swSocketIORead(io, &staticBuffer, &bytesRead) == swSocketReturnOK);
+}
+
+void drainTimerCallback(swEdgeTimer *timer, uint64_t expiredCount, uint32_t events)
+{
+  swEdgeLoopBreak(swEdgeWatcherLoopGet(timer));
+}
+
+// without a budget the socket read to the end is left alone till epoll reports it again
+swTestDeclare(SocketIODrainTest, NULL, NULL, swTestRun)
+{
+  swEdgeLoop *loop = swTestSuiteDataGet(suite);
+  ASSERT_NOT_NULL(loop);
+  int fd[2];
+  char data[SW_BUDGET_TEST_DATA_SIZE / 4] = {0};
+  swEdgeTimer timer;
+  swSocketIO *io = NULL;
+  ASSERT_EQUAL(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fd), 0);
+  ASSERT_EQUAL(write(fd[1], data, sizeof(data)), sizeof(data));
+  ASSERT_NOT_NULL((io = swSocketIONew()));
+  ASSERT_TRUE(swSocketInitFromFD((swSocket *)io, fd[0]));
+  swSocketIOReadReadyFuncSet(io, drainReadReady);
+  ASSERT_TRUE(swSocketIOStart(io, loop));
+  ASSERT_TRUE(swEdgeTimerInit(&timer, drainTimerCallback, false));
+  ASSERT_TRUE(swEdgeTimerStart(&timer, loop, 100, 0, false));
+  swEdgeLoopRun(loop, false);
+
+  ASSERT_EQUAL(drainCalls, 1);
+  swEdgeTimerClose(&timer);
+  swSocketIODelete(io);
+  close(fd[1]);
+  return true;
+}
+
+#define SW_QUEUE_TEST_BUFFERS       2000
+#define SW_QUEUE_TEST_BUFFER_SIZE   100
+#define SW_QUEUE_TEST_HIGH          (64 * 1024)
+#define SW_QUEUE_TEST_LOW           (16 * 1024)
+
+static uint8_t queueData[SW_QUEUE_TEST_BUFFERS][SW_QUEUE_TEST_BUFFER_SIZE];
+static swStaticBuffer queueBuffers[SW_QUEUE_TEST_BUFFERS];
+static uint8_t queueReceived[SW_QUEUE_TEST_BUFFERS * SW_QUEUE_TEST_BUFFER_SIZE];
+static size_t queueReceivedSize = 0;
+static uint32_t queueWritten = 0;
+static uint32_t queueDropped = 0;
+static uint32_t queueHighCalls = 0;
+static uint32_t queueLowCalls = 0;
+static bool queueReleaseInOrder = true;
+
+static void queueBufferRelease(swSocketIO *io, swStaticBuffer *buffer, swSocketIOBufferState state)
+{
+  if (state == swSocketIOBufferWritten)
+  {
+    if (buffer != &queueBuffers[queueWritten])
+      queueReleaseInOrder = false;
+    queueWritten++;
+  }
+  else
+    queueDropped++;
+}
+
+static void queueHighWatermark(swSocketIO *io)
+{
+  queueHighCalls++;
+}
+
+static void queueLowWatermark(swSocketIO *io)
+{
+  queueLowCalls++;
+}
+
+static void queueReadReady(swSocketIO *io)
+{
+  swStaticBuffer buffer = { .data = queueReceived + queueReceivedSize, .len = sizeof(queueReceived) - queueReceivedSize };
+  ssize_t bytesRead = 0;
+  if (buffer.len && (swSocketIORead(io, &buffer, &bytesRead) == swSocketReturnOK))
+  {
+    queueReceivedSize += bytesRead;
+    if (queueReceivedSize == sizeof(queueReceived))
+      swEdgeLoopBreak(io->loop);
+  }
+}
+
+swTestDeclare(SocketIOOutputQueueTest, NULL, NULL, swTestRun)
+{
+  swEdgeLoop *loop = swEdgeLoopNew();
+  ASSERT_NOT_NULL(loop);
+  int fd[2] = {-1, -1};
+  swSocketIO *writer = NULL;
+  swSocketIO *reader = NULL;
+  ASSERT_EQUAL(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fd), 0);
+  // small enough for the writes to stop half way through a buffer
+  int bufferSize = 4096;
+  ASSERT_EQUAL(setsockopt(fd[0], SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize)), 0);
+  ASSERT_NOT_NULL((writer = swSocketIONew()));
+  ASSERT_NOT_NULL((reader = swSocketIONew()));
+  ASSERT_TRUE(swSocketInitFromFD((swSocket *)writer, fd[0]));
+  ASSERT_TRUE(swSocketInitFromFD((swSocket *)reader, fd[1]));
+  swSocketIOBufferReleaseFuncSet(writer, queueBufferRelease);
+  swSocketIOHighWatermarkFuncSet(writer, queueHighWatermark);
+  swSocketIOLowWatermarkFuncSet(writer, queueLowWatermark);
+  swSocketIOWatermarksSet(writer, SW_QUEUE_TEST_LOW, SW_QUEUE_TEST_HIGH);
+  swSocketIOReadReadyFuncSet(reader, queueReadReady);
+  ASSERT_TRUE(swSocketIOStart(writer, loop));
+  ASSERT_TRUE(swSocketIOStart(reader, loop));
+
+  for (uint32_t i = 0; i < SW_QUEUE_TEST_BUFFERS; i++)
+  {
+    for (uint32_t j = 0; j < SW_QUEUE_TEST_BUFFER_SIZE; j++)
+      queueData[i][j] = (uint8_t)(i + j);
+    queueBuffers[i].data = queueData[i];
+    queueBuffers[i].len = SW_QUEUE_TEST_BUFFER_SIZE;
+    ASSERT_TRUE(swSocketIOQueueWrite(writer, &queueBuffers[i]));
+  }
+  ASSERT_EQUAL(swSocketIOQueuedBytesGet(writer), sizeof(queueReceived));
+  ASSERT_EQUAL(queueHighCalls, 1);
+  swEdgeLoopRun(loop, false);
+
+  swTestLogLine("written %u, high %u, low %u\n", queueWritten, queueHighCalls, queueLowCalls);
+  ASSERT_EQUAL(queueReceivedSize, sizeof(queueReceived));
+  ASSERT_EQUAL(memcmp(queueReceived, queueData, sizeof(queueReceived)), 0);
+  ASSERT_EQUAL(queueWritten, SW_QUEUE_TEST_BUFFERS);
+  ASSERT_TRUE(queueReleaseInOrder);
+  ASSERT_EQUAL(queueLowCalls, 1);
+  ASSERT_EQUAL(swSocketIOQueuedBytesGet(writer), 0);
+
+  // the buffers still queued are handed back on close
+  ASSERT_TRUE(swSocketIOQueueWrite(writer, &queueBuffers[0]));
+  ASSERT_TRUE(swSocketIOQueueWrite(writer, &queueBuffers[1]));
+  swSocketIOClose(writer, swSocketIOErrorNone);
+  ASSERT_EQUAL(queueDropped, 2);
+  ASSERT_EQUAL(queueWritten, SW_QUEUE_TEST_BUFFERS);
+  ASSERT_FALSE(swSocketIOQueueWrite(writer, &queueBuffers[0]));
+
+  swSocketIODelete(writer);
+  swSocketIODelete(reader);
+  swEdgeLoopDelete(loop);
+  return true;
+}
+
+static uint32_t queueWriteReadyCalls = 0;
+static uint32_t queueWriteReadyReleased = 0;
+
+static void queueWriteReady(swSocketIO *io)
+{
+  // the buffer queued by the first call goes out without asking for more
+  if (!queueWriteReadyCalls++)
+    swSocketIOQueueWrite(io, &queueBuffers[0]);
+}
+
+static void queueWriteReadyRelease(swSocketIO *io, swStaticBuffer *buffer, swSocketIOBufferState state)
+{
+  if (state == swSocketIOBufferWritten)
+    queueWriteReadyReleased++;
+}
+
+swTestDeclare(SocketIOQueueWriteReadyTest, NULL, NULL, swTestRun)
+{
+  swEdgeLoop *loop = swEdgeLoopNew();
+  ASSERT_NOT_NULL(loop);
+  int fd[2] = {-1, -1};
+  swSocketIO *writer = NULL;
+  ASSERT_EQUAL(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fd), 0);
+  ASSERT_NOT_NULL((writer = swSocketIONew()));
+  ASSERT_TRUE(swSocketInitFromFD((swSocket *)writer, fd[0]));
+  swSocketIOWriteReadyFuncSet(writer, queueWriteReady);
+  swSocketIOBufferReleaseFuncSet(writer, queueWriteReadyRelease);
+  ASSERT_TRUE(swSocketIOStart(writer, loop));
+  // the write event of the start, then the flush
+  swEdgeLoopRun(loop, true);
+  swEdgeLoopRun(loop, true);
+  ASSERT_EQUAL(queueWriteReadyReleased, 1);
+  ASSERT_EQUAL(queueWriteReadyCalls, 1);
+
+  swSocketIODelete(writer);
+  close(fd[1]);
+  swEdgeLoopDelete(loop);
+  return true;
+}
+
+#define SW_FRAME_TEST_FRAMES  1000
+
+typedef struct swFrameTestData
+{
+  swReadRing *ring;
+  swFrameDecoder decoder;
+  uint32_t frames;
+  bool valid;
+} swFrameTestData;
+
+// frame i is i % 251 bytes of the value i
+static bool frameTestFrame(swFrameDecoder *decoder, swStaticBuffer *frame)
+{
+  swFrameTestData *data = swFrameDecoderDataGet(decoder);
+  uint32_t expected = data->frames % 251;
+  if (frame->len != expected)
+    data->valid = false;
+  for (size_t i = 0; i < frame->len; i++)
+  {
+    if (frame->data[i] != (uint8_t)data->frames)
+      data->valid = false;
+  }
+  // a view into the ring, not a copy
+  if ((frame->data < data->ring->buffer) || ((frame->data + frame->len) > (data->ring->buffer + 2 * data->ring->size)))
+    data->valid = false;
+  data->frames++;
+  return true;
+}
+
+static void frameTestReadReady(swSocketIO *io)
+{
+  swFrameTestData *data = swSocketIODataGet(io);
+  while (swReadRingRead(data->ring, io, NULL) == swSocketReturnOK)
+  {
+    if (!swFrameDecoderDecode(&(data->decoder), data->ring, NULL))
+      data->valid = false;
+  }
+  if (data->frames == SW_FRAME_TEST_FRAMES)
+    swEdgeLoopBreak(io->loop);
+}
+
+static void frameTestWriteReady(swSocketIO *io)
+{
+  static uint32_t frame = 0;
+  uint8_t buffer[256 + 2] = {0};
+  while (frame < SW_FRAME_TEST_FRAMES)
+  {
+    uint16_t length = frame % 251;
+    buffer[0] = (uint8_t)(length >> 8);
+    buffer[1] = (uint8_t)length;
+    memset(buffer + 2, (uint8_t)frame, length);
+    // one frame at a time, the small ones are not worth a queue here
+    if (write(((swSocket *)io)->fd, buffer, length + 2) != (length + 2))
+      break;
+    frame++;
+  }
+}
+
+static char frameCollected[64] = {0};
+
+static bool frameCollect(swFrameDecoder *decoder, swStaticBuffer *frame)
+{
+  size_t len = strlen(frameCollected);
+  snprintf(frameCollected + len, sizeof(frameCollected) - len, "[%.*s]", (int)frame->len, (char *)frame->data);
+  return true;
+}
+
+// the literals can have zeros in them
+#define frameTestFeed(r, d, t)  frameTestFeedWithLength((r), (d), (t), sizeof(t) - 1)
+
+static bool frameTestFeedWithLength(swReadRing *ring, swFrameDecoder *decoder, const char *text, size_t len)
+{
+  swStaticBuffer space = swStaticBufferDefineEmpty;
+  if (!swReadRingReserve(ring, &space) || (space.len < len))
+    return false;
+  memcpy(space.data, text, len);
+  swReadRingProduce(ring, len);
+  return swFrameDecoderDecode(decoder, ring, NULL);
+}
+
+swTestDeclare(FrameDecoderTest, NULL, NULL, swTestRun)
+{
+  swReadRing *ring = swReadRingNew(1, false);
+  ASSERT_NOT_NULL(ring);
+  swFrameDecoder decoder;
+  swFrameDecoder *decoderPtr = &decoder;
+  swStaticBuffer delimiter = swStaticBufferDefineWithLength("\r\n", 2);
+
+  // the delimiter split across the reads
+  ASSERT_TRUE(swFrameDecoderInitDelimiter(decoderPtr, &delimiter, 16, frameCollect));
+  ASSERT_TRUE(frameTestFeed(ring, decoderPtr, "abc\r"));
+  ASSERT_TRUE(frameTestFeed(ring, decoderPtr, "\ndef\r\n\r\ngh"));
+  ASSERT_TRUE(frameTestFeed(ring, decoderPtr, "i\r\n"));
+  ASSERT_STR(frameCollected, "[abc][def][][ghi]");
+  ASSERT_EQUAL(swReadRingUsedGet(ring), 0);
+  // longer than the maximum without a delimiter
+  ASSERT_FALSE(frameTestFeed(ring, decoderPtr, "0123456789abcdefgh"));
+  swReadRingConsume(ring, swReadRingUsedGet(ring));
+
+  frameCollected[0] = 0;
+  ASSERT_TRUE(swFrameDecoderInitFixed(decoderPtr, 3, frameCollect));
+  ASSERT_TRUE(frameTestFeed(ring, decoderPtr, "abcd"));
+  ASSERT_TRUE(frameTestFeed(ring, decoderPtr, "efghi"));
+  ASSERT_STR(frameCollected, "[abc][def][ghi]");
+
+  frameCollected[0] = 0;
+  ASSERT_TRUE(swFrameDecoderInitLengthPrefixed(decoderPtr, 4, true, 0, frameCollect));
+  ASSERT_TRUE(frameTestFeed(ring, decoderPtr, "\x02"));
+  ASSERT_TRUE(frameTestFeed(ring, decoderPtr, "\x00\x00\x00xy\x01\x00\x00\x00z"));
+  ASSERT_STR(frameCollected, "[xy][z]");
+  // more than the ring can hold
+  ASSERT_FALSE(frameTestFeed(ring, decoderPtr, "\x00\x00\x01\x00"));
+
+  swReadRingDelete(ring);
+  return true;
+}
+
+swTestDeclare(SocketIOReadRingTest, NULL, NULL, swTestRun)
+{
+  swEdgeLoop *loop = swEdgeLoopNew();
+  ASSERT_NOT_NULL(loop);
+  int fd[2] = {-1, -1};
+  swSocketIO *writer = NULL;
+  swSocketIO *reader = NULL;
+  swFrameTestData data = {.valid = true};
+  swFrameDecoder *decoderPtr = &(data.decoder);
+  ASSERT_EQUAL(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fd), 0);
+  // one page, the frames keep wrapping around its end
+  ASSERT_NOT_NULL((data.ring = swReadRingNew(1, false)));
+  ASSERT_TRUE(swFrameDecoderInitLengthPrefixed(decoderPtr, 2, false, 0, frameTestFrame));
+  swFrameDecoderDataSet(decoderPtr, &data);
+  ASSERT_NOT_NULL((writer = swSocketIONew()));
+  ASSERT_NOT_NULL((reader = swSocketIONew()));
+  ASSERT_TRUE(swSocketInitFromFD((swSocket *)writer, fd[0]));
+  ASSERT_TRUE(swSocketInitFromFD((swSocket *)reader, fd[1]));
+  swSocketIODataSet(reader, &data);
+  swSocketIOReadReadyFuncSet(reader, frameTestReadReady);
+  swSocketIOWriteReadyFuncSet(writer, frameTestWriteReady);
+  ASSERT_TRUE(swSocketIOStart(writer, loop));
+  ASSERT_TRUE(swSocketIOStart(reader, loop));
+  swEdgeLoopRun(loop, false);
+
+  ASSERT_EQUAL(data.frames, SW_FRAME_TEST_FRAMES);
+  ASSERT_TRUE(data.valid);
+  ASSERT_EQUAL(swReadRingUsedGet(data.ring), 0);
+
+  swSocketIODelete(writer);
+  swSocketIODelete(reader);
+  swReadRingDelete(data.ring);
+  swEdgeLoopDelete(loop);
+  return true;
+}
+
+#define SW_ZERO_COPY_TEST_BUFFERS      8
+#define SW_ZERO_COPY_TEST_BUFFER_SIZE  (256 * 1024)
+#define SW_ZERO_COPY_TEST_THRESHOLD    (64 * 1024)
+
+typedef struct swZeroCopyTestData
+{
+  swEdgeLoop *loop;
+  uint32_t released;
+  size_t received;
+  uint8_t readBuffer[65536];
+} swZeroCopyTestData;
+
+static void zeroCopyTestDoneCheck(swZeroCopyTestData *data)
+{
+  if ((data->released == SW_ZERO_COPY_TEST_BUFFERS) && (data->received == SW_ZERO_COPY_TEST_BUFFERS * SW_ZERO_COPY_TEST_BUFFER_SIZE))
+    swEdgeLoopBreak(data->loop);
+}
+
+static void zeroCopyTestRelease(swSocketIO *io, swStaticBuffer *buffer, swSocketIOBufferState state)
+{
+  swZeroCopyTestData *data = swSocketIODataGet(io);
+  if (state == swSocketIOBufferWritten)
+    data->released++;
+  zeroCopyTestDoneCheck(data);
+}
+
+static void zeroCopyTestReadReady(swSocketIO *io)
+{
+  swZeroCopyTestData *data = swSocketIODataGet(io);
+  swStaticBuffer buffer = swStaticBufferDefine(data->readBuffer);
+  ssize_t bytesRead = 0;
+  while (swSocketIORead(io, &buffer, &bytesRead) == swSocketReturnOK)
+    data->received += bytesRead;
+  zeroCopyTestDoneCheck(data);
+}
+
+// connected pair of TCP sockets over loopback
+static bool zeroCopyTestConnect(int fd[2])
+{
+  bool rtn = false;
+  struct sockaddr_in address = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+  socklen_t addressSize = sizeof(address);
+  int listenFD = socket(AF_INET, SOCK_STREAM, 0);
+  if (listenFD >= 0)
+  {
+    if (!bind(listenFD, (struct sockaddr *)&address, sizeof(address)) && !listen(listenFD, 1)
+        && !getsockname(listenFD, (struct sockaddr *)&address, &addressSize)
+        && ((fd[0] = socket(AF_INET, SOCK_STREAM, 0)) >= 0)
+        && !connect(fd[0], (struct sockaddr *)&address, sizeof(address))
+        && ((fd[1] = accept4(listenFD, NULL, NULL, SOCK_NONBLOCK)) >= 0))
+      rtn = !fcntl(fd[0], F_SETFL, O_NONBLOCK);
+    close(listenFD);
+  }
+  return rtn;
+}
+
+swTestDeclare(SocketIOZeroCopyTest, NULL, NULL, swTestRun)
+{
+  static uint8_t payload[SW_ZERO_COPY_TEST_BUFFERS][SW_ZERO_COPY_TEST_BUFFER_SIZE];
+  static swZeroCopyTestData data = {0};
+  swStaticBuffer buffers[SW_ZERO_COPY_TEST_BUFFERS];
+  int fd[2] = {-1, -1};
+  swSocketIO *writer = NULL;
+  swSocketIO *reader = NULL;
+  ASSERT_NOT_NULL((data.loop = swEdgeLoopNew()));
+  ASSERT_TRUE(zeroCopyTestConnect(fd));
+  // several sends, some of them ending in the middle of a buffer
+  int bufferSize = 100 * 1024;
+  ASSERT_EQUAL(setsockopt(fd[0], SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize)), 0);
+  ASSERT_NOT_NULL((writer = swSocketIONew()));
+  ASSERT_NOT_NULL((reader = swSocketIONew()));
+  ASSERT_TRUE(swSocketInitFromFD((swSocket *)writer, fd[0]));
+  ASSERT_TRUE(swSocketInitFromFD((swSocket *)reader, fd[1]));
+  if (!swSocketIOZeroCopySet(writer, SW_ZERO_COPY_TEST_THRESHOLD))
+  {
+    swTestLogLine("MSG_ZEROCOPY is not supported, skipping\n");
+    swSocketIODelete(writer);
+    swSocketIODelete(reader);
+    swEdgeLoopDelete(data.loop);
+    return true;
+  }
+  swSocketIODataSet(writer, &data);
+  swSocketIODataSet(reader, &data);
+  swSocketIOBufferReleaseFuncSet(writer, zeroCopyTestRelease);
+  swSocketIOReadReadyFuncSet(reader, zeroCopyTestReadReady);
+  ASSERT_TRUE(swSocketIOStart(writer, data.loop));
+  ASSERT_TRUE(swSocketIOStart(reader, data.loop));
+  for (uint32_t i = 0; i < SW_ZERO_COPY_TEST_BUFFERS; i++)
+  {
+    buffers[i].data = payload[i];
+    buffers[i].len = SW_ZERO_COPY_TEST_BUFFER_SIZE;
+    ASSERT_TRUE(swSocketIOQueueWrite(writer, &buffers[i]));
+  }
+  swEdgeLoopRun(data.loop, false);
+
+  swTestLogLine("sends %lu, completions %lu, copied %lu\n", writer->zeroCopySends, writer->zeroCopyCompletions, writer->zeroCopyCopied);
+  ASSERT_EQUAL(data.received, SW_ZERO_COPY_TEST_BUFFERS * SW_ZERO_COPY_TEST_BUFFER_SIZE);
+  ASSERT_EQUAL(data.released, SW_ZERO_COPY_TEST_BUFFERS);
+  ASSERT_TRUE(writer->zeroCopySends > 0);
+  ASSERT_EQUAL(writer->zeroCopyCompletions, writer->zeroCopySends);
+  ASSERT_EQUAL(writer->zeroCopy.count, 0);
+
+  swSocketIODelete(writer);
+  swSocketIODelete(reader);
+  swEdgeLoopDelete(data.loop);
+  return true;
+}
+
+static uint32_t zeroCopyCloseReleased[swSocketIOBufferInFlight + 1] = {0};
+static bool zeroCopyCloseInOrder = true;
+
+// the buffers go back in the order they were queued, the written ones first
+static void zeroCopyCloseRelease(swSocketIO *io, swStaticBuffer *buffer, swSocketIOBufferState state)
+{
+  swStaticBuffer *buffers = swSocketIODataGet(io);
+  uint32_t released = zeroCopyCloseReleased[swSocketIOBufferNotWritten] + zeroCopyCloseReleased[swSocketIOBufferWritten] + zeroCopyCloseReleased[swSocketIOBufferInFlight];
+  if ((buffer != &buffers[released]) || (zeroCopyCloseReleased[swSocketIOBufferInFlight] && (state == swSocketIOBufferWritten)))
+    zeroCopyCloseInOrder = false;
+  zeroCopyCloseReleased[state]++;
+}
+
+// the sends completed when the socket closes give their buffers back as written, the ones the
+// peer did not take yet as in flight
+swTestDeclare(SocketIOZeroCopyCloseTest, NULL, NULL, swTestRun)
+{
+  static uint8_t payload[SW_ZERO_COPY_TEST_BUFFERS][SW_ZERO_COPY_TEST_BUFFER_SIZE];
+  swStaticBuffer buffers[SW_ZERO_COPY_TEST_BUFFERS];
+  swEdgeLoop *loop = NULL;
+  int fd[2] = {-1, -1};
+  swSocketIO *writer = NULL;
+  ASSERT_NOT_NULL((loop = swEdgeLoopNew()));
+  ASSERT_TRUE(zeroCopyTestConnect(fd));
+  // the peer does not read, the sends past its receive window are left in the send queue
+  int bufferSize = 64 * 1024;
+  ASSERT_EQUAL(setsockopt(fd[1], SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize)), 0);
+  ASSERT_NOT_NULL((writer = swSocketIONew()));
+  ASSERT_TRUE(swSocketInitFromFD((swSocket *)writer, fd[0]));
+  if (swSocketIOZeroCopySet(writer, SW_ZERO_COPY_TEST_THRESHOLD))
+  {
+    swSocketIODataSet(writer, buffers);
+    swSocketIOBufferReleaseFuncSet(writer, zeroCopyCloseRelease);
+    ASSERT_TRUE(swSocketIOStart(writer, loop));
+    for (uint32_t i = 0; i < SW_ZERO_COPY_TEST_BUFFERS; i++)
+    {
+      buffers[i].data = payload[i];
+      buffers[i].len = SW_ZERO_COPY_TEST_BUFFER_SIZE;
+    }
+    // the first send is read by the peer after the second one, its completion is still queued
+    // when the socket closes
+    ASSERT_TRUE(swSocketIOQueueWrite(writer, &buffers[0]));
+    ASSERT_NOT_EQUAL(swSocketIOFlush(writer, NULL), swSocketReturnError);
+    for (uint32_t i = 1; i < SW_ZERO_COPY_TEST_BUFFERS; i++)
+      ASSERT_TRUE(swSocketIOQueueWrite(writer, &buffers[i]));
+    ASSERT_NOT_EQUAL(swSocketIOFlush(writer, NULL), swSocketReturnError);
+    ASSERT_TRUE(writer->zeroCopy.count > 0);
+    ASSERT_EQUAL(writer->zeroCopyCompletions, 0);
+    size_t received = 0;
+    struct pollfd readPoll = { .fd = fd[1], .events = POLLIN };
+    while ((received < SW_ZERO_COPY_TEST_BUFFER_SIZE) && (poll(&readPoll, 1, 1000) > 0))
+    {
+      ssize_t bytesRead = read(fd[1], payload[SW_ZERO_COPY_TEST_BUFFERS - 1], SW_ZERO_COPY_TEST_BUFFER_SIZE - received);
+      if (bytesRead > 0)
+        received += bytesRead;
+    }
+    ASSERT_EQUAL(received, SW_ZERO_COPY_TEST_BUFFER_SIZE);
+    swSocketIOClose(writer, swSocketIOErrorNone);
+    swTestLogLine("sends %lu, completions %lu, written %u, in flight %u, not written %u\n", writer->zeroCopySends, writer->zeroCopyCompletions,
+                  zeroCopyCloseReleased[swSocketIOBufferWritten], zeroCopyCloseReleased[swSocketIOBufferInFlight], zeroCopyCloseReleased[swSocketIOBufferNotWritten]);
+    ASSERT_EQUAL(zeroCopyCloseReleased[swSocketIOBufferNotWritten] + zeroCopyCloseReleased[swSocketIOBufferWritten] + zeroCopyCloseReleased[swSocketIOBufferInFlight], SW_ZERO_COPY_TEST_BUFFERS);
+    ASSERT_TRUE(zeroCopyCloseInOrder);
+    // the completions queued before the close were read
+    ASSERT_TRUE(writer->zeroCopyCompletions > 0);
+    ASSERT_TRUE(zeroCopyCloseReleased[swSocketIOBufferWritten] > 0);
+    ASSERT_TRUE(zeroCopyCloseReleased[swSocketIOBufferInFlight] > 0);
+  }
+  else
+    swTestLogLine("MSG_ZEROCOPY is not supported, skipping\n");
+  swSocketIODelete(writer);
+  close(fd[1]);
+  swEdgeLoopDelete(loop);
+  return true;
+}
+
+#define SW_SEND_FILE_TEST_SIZE       (1024 * 1024 + 123)
+#define SW_SEND_FILE_TEST_OFFSET     1000
+#define SW_SEND_FILE_TEST_PIPE_SIZE  (32 * 1024)
+
+typedef struct swSendFileTestData
+{
+  swEdgeLoop *loop;
+  uint8_t *received;
+  size_t receivedSize;
+  size_t expectedSize;
+  size_t bytesSent;
+  uint32_t sentCalls;
+  bool complete;
+} swSendFileTestData;
+
+static void sendFileTestDoneCheck(swSendFileTestData *data)
+{
+  if (data->sentCalls && (data->receivedSize == data->expectedSize))
+    swEdgeLoopBreak(data->loop);
+}
+
+static void sendFileTestSent(swSocketIO *io, int fd, size_t bytesSent, bool complete)
+{
+  swSendFileTestData *data = swSocketIODataGet(io);
+  data->sentCalls++;
+  data->bytesSent = bytesSent;
+  data->complete = complete;
+  sendFileTestDoneCheck(data);
+}
+
+static void sendFileTestReadReady(swSocketIO *io)
+{
+  swSendFileTestData *data = swSocketIODataGet(io);
+  swStaticBuffer buffer = { .data = data->received + data->receivedSize, .len = SW_SEND_FILE_TEST_SIZE - data->receivedSize };
+  ssize_t bytesRead = 0;
+  while (buffer.len && (swSocketIORead(io, &buffer, &bytesRead) == swSocketReturnOK))
+  {
+    data->receivedSize += bytesRead;
+    buffer.data += bytesRead;
+    buffer.len -= bytesRead;
+  }
+  sendFileTestDoneCheck(data);
+}
+
+swTestDeclare(SocketIOSendFileTest, NULL, NULL, swTestRun)
+{
+  static uint8_t content[SW_SEND_FILE_TEST_SIZE];
+  static uint8_t received[SW_SEND_FILE_TEST_SIZE];
+  swSendFileTestData data = { .received = received };
+  char fileName[] = "/tmp/send-file-test-XXXXXX";
+  int fd[2] = {-1, -1};
+  int pipeFD[2] = {-1, -1};
+  swSocketIO *writer = NULL;
+  swSocketIO *reader = NULL;
+  int fileFD = mkstemp(fileName);
+  ASSERT_TRUE(fileFD >= 0);
+  unlink(fileName);
+  for (size_t i = 0; i < sizeof(content); i++)
+    content[i] = (uint8_t)(i * 7 + (i >> 10));
+  ASSERT_EQUAL(write(fileFD, content, sizeof(content)), sizeof(content));
+
+  ASSERT_NOT_NULL((data.loop = swEdgeLoopNew()));
+  ASSERT_EQUAL(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fd), 0);
+  int bufferSize = 64 * 1024;
+  ASSERT_EQUAL(setsockopt(fd[0], SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize)), 0);
+  ASSERT_NOT_NULL((writer = swSocketIONew()));
+  ASSERT_NOT_NULL((reader = swSocketIONew()));
+  ASSERT_TRUE(swSocketInitFromFD((swSocket *)writer, fd[0]));
+  ASSERT_TRUE(swSocketInitFromFD((swSocket *)reader, fd[1]));
+  swSocketIODataSet(writer, &data);
+  swSocketIODataSet(reader, &data);
+  swSocketIOFileSentFuncSet(writer, sendFileTestSent);
+  swSocketIOReadReadyFuncSet(reader, sendFileTestReadReady);
+  ASSERT_TRUE(swSocketIOStart(writer, data.loop));
+  ASSERT_TRUE(swSocketIOStart(reader, data.loop));
+
+  // the rest of the file from the offset, more than the socket takes at once
+  data.expectedSize = SW_SEND_FILE_TEST_SIZE - SW_SEND_FILE_TEST_OFFSET;
+  ASSERT_EQUAL(swSocketIOSendFile(writer, fileFD, SW_SEND_FILE_TEST_OFFSET, 0), swSocketReturnNotReady);
+  ASSERT_EQUAL(swSocketIOSendFile(writer, fileFD, 0, 0), swSocketReturnNone);
+  swEdgeLoopRun(data.loop, false);
+  ASSERT_EQUAL(data.sentCalls, 1);
+  ASSERT_TRUE(data.complete);
+  ASSERT_EQUAL(data.bytesSent, data.expectedSize);
+  ASSERT_EQUAL(data.receivedSize, data.expectedSize);
+  ASSERT_EQUAL(memcmp(received, content + SW_SEND_FILE_TEST_OFFSET, data.expectedSize), 0);
+
+  // a pipe till its write end is closed
+  data.receivedSize = 0;
+  data.sentCalls = 0;
+  ASSERT_EQUAL(pipe(pipeFD), 0);
+  ASSERT_EQUAL(write(pipeFD[1], content, SW_SEND_FILE_TEST_PIPE_SIZE), SW_SEND_FILE_TEST_PIPE_SIZE);
+  close(pipeFD[1]);
+  data.expectedSize = SW_SEND_FILE_TEST_PIPE_SIZE;
+  ASSERT_EQUAL(swSocketIOSendFile(writer, pipeFD[0], 0, 0), swSocketReturnOK);
+  swEdgeLoopRun(data.loop, false);
+  ASSERT_EQUAL(data.sentCalls, 1);
+  ASSERT_TRUE(data.complete);
+  ASSERT_EQUAL(data.bytesSent, SW_SEND_FILE_TEST_PIPE_SIZE);
+  ASSERT_EQUAL(memcmp(received, content, SW_SEND_FILE_TEST_PIPE_SIZE), 0);
+
+  // the file ends before the length, the socket is left open
+  data.sentCalls = 0;
+  ASSERT_EQUAL(swSocketIOSendFile(writer, fileFD, SW_SEND_FILE_TEST_SIZE - 10, 100), swSocketReturnInvalidBuffer);
+  ASSERT_EQUAL(data.sentCalls, 1);
+  ASSERT_FALSE(data.complete);
+  ASSERT_EQUAL(data.bytesSent, 10);
+  ASSERT_TRUE(((swSocket *)writer)->fd >= 0);
+
+  close(pipeFD[0]);
+  close(fileFD);
+  swSocketIODelete(writer);
+  swSocketIODelete(reader);
+  swEdgeLoopDelete(data.loop);
+  return true;
+}
+
+#define SW_SEND_PIPE_TEST_CHUNK     4096
+#define SW_SEND_PIPE_TEST_CHUNKS    8
+// the producer is slower than the write timeout of the socket
+#define SW_SEND_PIPE_TEST_INTERVAL  20
+#define SW_SEND_PIPE_TEST_TIMEOUT   30
+
+typedef struct swSendPipeTestProducer
+{
+  const uint8_t *content;
+  int fd;
+  uint32_t chunks;
+} swSendPipeTestProducer;
+
+static void sendPipeTestProducerCallback(swEdgeTimer *timer, uint64_t expiredCount, uint32_t events)
+{
+  swSendPipeTestProducer *producer = swEdgeWatcherDataGet(timer);
+  if ((expiredCount > 0) && (producer->fd >= 0))
+  {
+    if (write(producer->fd, producer->content + producer->chunks * SW_SEND_PIPE_TEST_CHUNK, SW_SEND_PIPE_TEST_CHUNK) == SW_SEND_PIPE_TEST_CHUNK)
+      producer->chunks++;
+    if (producer->chunks == SW_SEND_PIPE_TEST_CHUNKS)
+    {
+      close(producer->fd);
+      producer->fd = -1;
+      swEdgeTimerStop(timer);
+    }
+  }
+}
+
+static void sendPipeTestClose(swSocketIO *io)
+{
+  swSendFileTestData *data = swSocketIODataGet(io);
+  swEdgeLoopBreak(data->loop);
+}
+
+// the pipe runs empty while its write end is still open, the send waits for the producer
+// instead of the socket and does not time out
+swTestDeclare(SocketIOSendFilePipeTest, NULL, NULL, swTestRun)
+{
+  static uint8_t content[SW_SEND_PIPE_TEST_CHUNK * SW_SEND_PIPE_TEST_CHUNKS];
+  static uint8_t received[SW_SEND_FILE_TEST_SIZE];
+  swSendFileTestData data = { .received = received, .expectedSize = sizeof(content) };
+  int fd[2] = {-1, -1};
+  int pipeFD[2] = {-1, -1};
+  swEdgeTimer producerTimer;
+  swSocketIO *writer = NULL;
+  swSocketIO *reader = NULL;
+  for (size_t i = 0; i < sizeof(content); i++)
+    content[i] = (uint8_t)(i * 13 + (i >> 8));
+
+  ASSERT_NOT_NULL((data.loop = swEdgeLoopNew()));
+  ASSERT_EQUAL(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fd), 0);
+  ASSERT_EQUAL(pipe(pipeFD), 0);
+  swSendPipeTestProducer producer = { .content = content, .fd = pipeFD[1] };
+  ASSERT_NOT_NULL((writer = swSocketIONew()));
+  ASSERT_NOT_NULL((reader = swSocketIONew()));
+  ASSERT_TRUE(swSocketInitFromFD((swSocket *)writer, fd[0]));
+  ASSERT_TRUE(swSocketInitFromFD((swSocket *)reader, fd[1]));
+  swSocketIOWriteTimeoutSet(writer, SW_SEND_PIPE_TEST_TIMEOUT);
+  swSocketIODataSet(writer, &data);
+  swSocketIODataSet(reader, &data);
+  swSocketIOFileSentFuncSet(writer, sendFileTestSent);
+  swSocketIOCloseFuncSet(writer, sendPipeTestClose);
+  swSocketIOReadReadyFuncSet(reader, sendFileTestReadReady);
+  ASSERT_TRUE(swSocketIOStart(writer, data.loop));
+  ASSERT_TRUE(swSocketIOStart(reader, data.loop));
+  ASSERT_TRUE(swEdgeTimerInit(&producerTimer, sendPipeTestProducerCallback, false));
+  swEdgeWatcherDataSet(&producerTimer, &producer);
+  ASSERT_TRUE(swEdgeTimerStart(&producerTimer, data.loop, SW_SEND_PIPE_TEST_INTERVAL, SW_SEND_PIPE_TEST_INTERVAL, false));
+
+  ASSERT_EQUAL(swSocketIOSendFile(writer, pipeFD[0], 0, 0), swSocketReturnNotReady);
+  ASSERT_EQUAL(writer->writeDeadline, 0);
+  swEdgeLoopRun(data.loop, false);
+  ASSERT_EQUAL(producer.chunks, SW_SEND_PIPE_TEST_CHUNKS);
+  ASSERT_EQUAL(data.sentCalls, 1);
+  ASSERT_TRUE(data.complete);
+  ASSERT_EQUAL(data.bytesSent, sizeof(content));
+  ASSERT_EQUAL(data.receivedSize, sizeof(content));
+  ASSERT_EQUAL(memcmp(received, content, sizeof(content)), 0);
+  ASSERT_TRUE(((swSocket *)writer)->fd >= 0);
+  ASSERT_NULL(swEdgeWatcherLoopGet((swEdgeWatcher *)&(writer->fileSendEvent)));
+
+  swEdgeTimerClose(&producerTimer);
+  close(pipeFD[0]);
+  swSocketIODelete(writer);
+  swSocketIODelete(reader);
+  swEdgeLoopDelete(data.loop);
+  return true;
+}
+
+static char iterationOrder[64] = {0};
+static uint32_t iterationOrderCount = 0;
+static uint32_t idleCalls = 0;
+
+static void iterationOrderAdd(char c)
+{
+  if (iterationOrderCount < sizeof(iterationOrder) - 1)
+    iterationOrder[iterationOrderCount++] = c;
+}
+
+void prepareCallback(swEdgePrepare *prepareWatcher)
+{
+  iterationOrderAdd('P');
+}
+
+void checkCallback(swEdgeCheck *checkWatcher)
+{
+  iterationOrderAdd('C');
+}
+
+void idleCallback(swEdgeIdle *idleWatcher)
+{
+  iterationOrderAdd('I');
+  // the loop blocks once there is no idle watcher
+  if (++idleCalls == 3)
+    swEdgeIdleStop(idleWatcher);
+}
+
+void iterationTimerCallback(swEdgeTimer *timer, uint64_t expiredCount, uint32_t events)
+{
+  iterationOrderAdd('T');
+  swEdgeLoopBreak(swEdgeWatcherLoopGet(timer));
+}
+
+swTestDeclare(EdgeIterationWatchersTest, NULL, NULL, swTestRun)
+{
+  // a loop of its own, without the leftovers of the other tests in the pending queue
+  swEdgeLoop *loop = swEdgeLoopNew();
+  ASSERT_NOT_NULL(loop);
+  swEdgePrepare prepareWatcher;
+  swEdgeCheck checkWatcher;
+  swEdgeIdle idleWatcher;
+  swEdgeTimer timer = {.timerCB = NULL};
+  swEdgePrepare *preparePtr = &prepareWatcher;
+  swEdgeCheck *checkPtr = &checkWatcher;
+  swEdgeIdle *idlePtr = &idleWatcher;
+  swEdgeTimer *timerPtr = &timer;
+  ASSERT_TRUE(swEdgePrepareInit(preparePtr, prepareCallback));
+  ASSERT_TRUE(swEdgeCheckInit(checkPtr, checkCallback));
+  ASSERT_TRUE(swEdgeIdleInit(idlePtr, idleCallback));
+  ASSERT_TRUE(swEdgeTimerInit(timerPtr, iterationTimerCallback, false));
+  ASSERT_TRUE(swEdgePrepareStart(preparePtr, loop));
+  ASSERT_FALSE(swEdgePrepareStart(preparePtr, loop));
+  ASSERT_TRUE(swEdgeCheckStart(checkPtr, loop));
+  ASSERT_TRUE(swEdgeIdleStart(idlePtr, loop));
+  ASSERT_EQUAL(loop->idleCount, 1);
+  ASSERT_TRUE(swEdgeTimerStart(timerPtr, loop, 20, 0, false));
+  swEdgeLoopRun(loop, false);
+
+  swTestLogLine("order %s\n", iterationOrder);
+  ASSERT_STR(iterationOrder, "PCIPCIPCIPTC");
+  ASSERT_EQUAL(loop->idleCount, 0);
+
+  // the stopped watchers are squeezed out at the end of the next pass
+  swEdgeCheckStop(checkPtr);
+  ASSERT_TRUE(swEdgeIdleStart(idlePtr, loop));
+  iterationOrderCount = 0;
+  memset(iterationOrder, 0, sizeof(iterationOrder));
+  swEdgeLoopRun(loop, true);
+  ASSERT_STR(iterationOrder, "PI");
+  ASSERT_EQUAL(swFastArrayCount(loop->iterationWatchers[swWatcherTypeCheck - swWatcherTypePrepare]), 0);
+
+  swEdgeTimerClose(timerPtr);
+  swEdgePrepareClose(preparePtr);
+  swEdgeCheckClose(checkPtr);
+  swEdgeIdleClose(idlePtr);
+  ASSERT_EQUAL(loop->idleCount, 0);
+  swEdgeLoopDelete(loop);
+  return true;
+}
+
+#define SW_MAILBOX_TEST_PRODUCERS  4
+#define SW_MAILBOX_TEST_MESSAGES   10000
+
+typedef struct swMailboxTestMessage
+{
+  swEdgeMailboxMessage message;
+  uint32_t producer;
+  uint32_t sequence;
+} swMailboxTestMessage;
+
+typedef struct swMailboxTestProducer
+{
+  swEdgeMailbox *mailbox;
+  swMailboxTestMessage *messages;
+  uint32_t producer;
+  uint32_t failures;
+} swMailboxTestProducer;
+
+static uint32_t mailboxExpected[SW_MAILBOX_TEST_PRODUCERS] = {0};
+static uint32_t mailboxReceived = 0;
+static uint32_t mailboxOutOfOrder = 0;
+
+void mailboxCallback(swEdgeMailbox *mailbox, swEdgeMailboxMessage *message)
+{
+  swMailboxTestMessage *testMessage = (swMailboxTestMessage *)message;
+  if (testMessage->sequence != mailboxExpected[testMessage->producer])
+    mailboxOutOfOrder++;
+  mailboxExpected[testMessage->producer] = testMessage->sequence + 1;
+  if (++mailboxReceived == SW_MAILBOX_TEST_PRODUCERS * SW_MAILBOX_TEST_MESSAGES)
+    swEdgeLoopBreak(swEdgeWatcherLoopGet(mailbox));
+}
+
+static void *mailboxProducerRun(void *data)
+{
+  swMailboxTestProducer *producer = data;
+  for (uint32_t i = 0; i < SW_MAILBOX_TEST_MESSAGES; i++)
+  {
+    producer->messages[i].producer = producer->producer;
+    producer->messages[i].sequence = i;
+    if (!swEdgeMailboxPost(producer->mailbox, &(producer->messages[i].message)))
+      producer->failures++;
+  }
+  return NULL;
+}
+
+swTestDeclare(EdgeMailboxTest, NULL, NULL, swTestRun)
+{
+  swEdgeLoop *loop = swEdgeLoopNew();
+  ASSERT_NOT_NULL(loop);
+  swEdgeMailbox *mailbox = malloc(sizeof(*mailbox));
+  swMailboxTestMessage *messages = malloc(SW_MAILBOX_TEST_PRODUCERS * SW_MAILBOX_TEST_MESSAGES * sizeof(*messages));
+  ASSERT_NOT_NULL(mailbox);
+  ASSERT_NOT_NULL(messages);
+  ASSERT_TRUE(swEdgeMailboxInit(mailbox, mailboxCallback));
+  ASSERT_TRUE(swEdgeMailboxStart(mailbox, loop));
+
+  pthread_t threads[SW_MAILBOX_TEST_PRODUCERS];
+  swMailboxTestProducer producers[SW_MAILBOX_TEST_PRODUCERS];
+  for (uint32_t i = 0; i < SW_MAILBOX_TEST_PRODUCERS; i++)
+  {
+    producers[i] = (swMailboxTestProducer){.mailbox = mailbox, .messages = &messages[i * SW_MAILBOX_TEST_MESSAGES], .producer = i};
+    ASSERT_EQUAL(pthread_create(&threads[i], NULL, mailboxProducerRun, &producers[i]), 0);
+  }
+  swEdgeLoopRun(loop, false);
+  for (uint32_t i = 0; i < SW_MAILBOX_TEST_PRODUCERS; i++)
+  {
+    pthread_join(threads[i], NULL);
+    ASSERT_EQUAL(producers[i].failures, 0);
+    ASSERT_EQUAL(mailboxExpected[i], SW_MAILBOX_TEST_MESSAGES);
+  }
+
+  swTestLogLine("messages = %lu, batches = %lu, wakeups = %lu\n", mailbox->messages, mailbox->batches, mailbox->wakeups);
+  ASSERT_EQUAL(mailboxReceived, SW_MAILBOX_TEST_PRODUCERS * SW_MAILBOX_TEST_MESSAGES);
+  ASSERT_EQUAL(mailboxOutOfOrder, 0);
+  ASSERT_EQUAL(mailbox->messages, mailboxReceived);
+  // only the posts into an empty mailbox wake the loop up
+  ASSERT_TRUE(mailbox->wakeups < mailbox->messages);
+  ASSERT_TRUE(mailbox->batches < mailbox->messages);
+  ASSERT_EQUAL(swEdgeMailboxDrain(mailbox), 0);
+
+  // the posts before the start are delivered once the mailbox is started
+  swEdgeMailboxStop(mailbox);
+  mailboxReceived = 0;
+  messages[0].producer = 0;
+  messages[0].sequence = mailboxExpected[0];
+  ASSERT_FALSE(swEdgeMailboxPost(mailbox, &(messages[0].message)));
+  ASSERT_TRUE(swEdgeMailboxStart(mailbox, loop));
+  swEdgeLoopRun(loop, true);
+  ASSERT_EQUAL(mailboxReceived, 1);
+
+  swEdgeMailboxClose(mailbox);
+  swEdgeLoopDelete(loop);
+  free(messages);
+  free(mailbox);
+  return true;
+}
+
 swTestSuiteStructDeclare(EdgeEventLoopTest, edgeLoopSetup, edgeLoopTeardown, swTestRun,
-                         &EdgeTimerTest, &EdgeSignalTest, &EdgeAsyncTest, &EdgeIOTCPTest, &EdgeIOUDPTest);
+                         &EdgeTimerTest, &EdgeSignalTest, &EdgeAsyncTest, &EdgeIOTCPTest, &EdgeIOUDPTest,
+                         &EdgeLoopNowTest, &EdgeLoopStatsTest, &EdgeLoopBusyPollTest, &SocketIOReadTimeoutTest,
+                         &SocketIOBudgetTest, &SocketIODrainTest, &EdgeIterationWatchersTest, &EdgeMailboxTest, &SocketIOOutputQueueTest, &SocketIOQueueWriteReadyTest,
+                         &FrameDecoderTest, &SocketIOReadRingTest, &SocketIOZeroCopyTest, &SocketIOZeroCopyCloseTest,
+                         &SocketIOSendFileTest, &SocketIOSendFilePipeTest);
@@ -3,6 +3,9 @@
 #include "io/edge-signal.h"
 #include "io/edge-async.h"
 #include "io/edge-io.h"
+#include "io/edge-prepare.h"
+#include "io/edge-check.h"
+#include "io/edge-idle.h"
 #include "core/memory.h"
 
 #include <unistd.h>
@@ -10,6 +13,7 @@
 #include <signal.h>
 
 #define SW_EPOLLEVENTS_SIZE 64
+#define SW_ITERATION_WATCHERS_SIZE 4
 
 static const char const *swWatcherTypeText[swWatcherTypeMax] =
 {
@@ -18,6 +22,9 @@ static const char const *swWatcherTypeText[swWatcherTypeMax] =
   [swWatcherTypeSignal]         = "Signal",
   [swWatcherTypeAsync]          = "Async",
   [swWatcherTypeIO]             = "IO",
+  [swWatcherTypePrepare]        = "Prepare",
+  [swWatcherTypeCheck]          = "Check",
+  [swWatcherTypeIdle]           = "Idle",
 };
 
 const char const *swWatcherTypeTextGet(swWatcherType watcherType)
@@ -145,11 +152,17 @@ swEdgeLoop *swEdgeLoopNew()
   {
     if (swFastArrayInit(&(newLoop->epollEvents), sizeof(struct epoll_event), SW_EPOLLEVENTS_SIZE))
     {
-      if (swFastArrayInit(&(newLoop->pendingEvents[0]), sizeof(swEdgeWatcher *), SW_EPOLLEVENTS_SIZE) &&
-          swFastArrayInit(&(newLoop->pendingEvents[1]), sizeof(swEdgeWatcher *), SW_EPOLLEVENTS_SIZE))
+      bool success = swFastArrayInit(&(newLoop->pendingEvents[0]), sizeof(swEdgeWatcher *), SW_EPOLLEVENTS_SIZE) &&
+                     swFastArrayInit(&(newLoop->pendingEvents[1]), sizeof(swEdgeWatcher *), SW_EPOLLEVENTS_SIZE);
+      for (uint32_t i = 0; success && (i < SW_EDGELOOP_ITERATION_TYPES); i++)
+        success = swFastArrayInit(&(newLoop->iterationWatchers[i]), sizeof(swEdgeWatcher *), SW_ITERATION_WATCHERS_SIZE);
+      if (success)
       {
         if ((newLoop->fd = epoll_create1(EPOLL_CLOEXEC)) >= 0)
+        {
+          swEdgeLoopNowUpdate(newLoop);
           rtn = newLoop;
+        }
       }
     }
     if (!rtn)
@@ -168,18 +181,62 @@ void swEdgeLoopDelete(swEdgeLoop *loop)
       swFastArrayClear(&(loop->pendingEvents[0]));
     if (swFastArraySize(loop->pendingEvents[1]))
       swFastArrayClear(&(loop->pendingEvents[1]));
+    for (uint32_t i = 0; i < SW_EDGELOOP_ITERATION_TYPES; i++)
+    {
+      if (swFastArraySize(loop->iterationWatchers[i]))
+        swFastArrayClear(&(loop->iterationWatchers[i]));
+    }
     if (loop->fd >= 0)
       close(loop->fd);
+    swEdgeLoopStatsDisable(loop);
     swMemoryFree(loop);
   }
 }
 
+#define swEdgeLoopIsIterationWatcher(w) (((w)->type >= swWatcherTypePrepare) && ((w)->type <= swWatcherTypeIdle))
+#define swEdgeLoopIterationWatchers(l, w) (&((l)->iterationWatchers[(w)->type - swWatcherTypePrepare]))
+#define swEdgeLoopIterationWatcherCount(l, t) swFastArrayCount((l)->iterationWatchers[(t) - swWatcherTypePrepare])
+
+// the position in the array is kept in pendingPosition, the iteration watchers are never pending
+static bool swEdgeLoopIterationWatcherAdd(swEdgeLoop *loop, swEdgeWatcher *watcher)
+{
+  bool rtn = false;
+  swFastArray *watchers = swEdgeLoopIterationWatchers(loop, watcher);
+  if (swFastArrayPush(*watchers, watcher))
+  {
+    watcher->pendingPosition = swFastArrayCount(*watchers) - 1;
+    if (watcher->type == swWatcherTypeIdle)
+      loop->idleCount++;
+    rtn = true;
+  }
+  return rtn;
+}
+
+static bool swEdgeLoopIterationWatcherRemove(swEdgeLoop *loop, swEdgeWatcher *watcher)
+{
+  bool rtn = false;
+  swFastArray *watchers = swEdgeLoopIterationWatchers(loop, watcher);
+  swEdgeWatcher *current = NULL;
+  if (swFastArrayGet(*watchers, watcher->pendingPosition, current) && (current == watcher))
+  {
+    // the array can be in the middle of a pass, so the slot is only emptied
+    swFastArraySet(*watchers, watcher->pendingPosition, NULL);
+    loop->iterationWatchersRemoved[watcher->type - swWatcherTypePrepare]++;
+    if (watcher->type == swWatcherTypeIdle)
+      loop->idleCount--;
+    rtn = true;
+  }
+  return rtn;
+}
+
 bool swEdgeLoopWatcherAdd(swEdgeLoop* loop, swEdgeWatcher* watcher)
 {
   bool rtn = false;
   if (loop && watcher)
   {
-    if (epoll_ctl(loop->fd, EPOLL_CTL_ADD, watcher->fd, &(watcher->event)) == 0)
+    if (swEdgeLoopIsIterationWatcher(watcher))
+      rtn = swEdgeLoopIterationWatcherAdd(loop, watcher);
+    else if (epoll_ctl(loop->fd, EPOLL_CTL_ADD, watcher->fd, &(watcher->event)) == 0)
       rtn = true;
   }
   return rtn;
@@ -190,7 +247,9 @@ bool swEdgeLoopWatcherRemove(swEdgeLoop *loop, swEdgeWatcher *watcher)
   bool rtn = false;
   if (loop && watcher)
   {
-    if (epoll_ctl(loop->fd, EPOLL_CTL_DEL, watcher->fd, &(watcher->event)) == 0)
+    if (swEdgeLoopIsIterationWatcher(watcher))
+      rtn = swEdgeLoopIterationWatcherRemove(loop, watcher);
+    else if (epoll_ctl(loop->fd, EPOLL_CTL_DEL, watcher->fd, &(watcher->event)) == 0)
     {
       if (!watcher->pendingEvents)
         rtn = true;
@@ -227,7 +286,13 @@ bool swEdgeWatcherPendingSet(swEdgeWatcher *watcher, uint32_t events)
   swEdgeLoop *loop = swEdgeWatcherLoopGet(watcher);
   if (loop && watcher && watcher->type == swWatcherTypeIO)
   {
-    if (watcher->pendingEvents)
+    // the slot of the running watcher is reused after the callback
+    if (watcher == loop->processing)
+    {
+      loop->processingEvents |= events;
+      rtn = true;
+    }
+    else if (watcher->pendingEvents)
     {
       watcher->pendingEvents |= events;
       rtn = true;
@@ -246,6 +311,110 @@ bool swEdgeWatcherPendingSet(swEdgeWatcher *watcher, uint32_t events)
   return rtn;
 }
 
+static inline void swEdgeLoopCallbackRecord(swEdgeLoopStats *stats, swWatcherType type, uint32_t tag, uint64_t duration)
+{
+  swHistogramRecord(stats->callbackTime[type], duration);
+  if (tag)
+    swHistogramRecord(stats->tagCallbackTime[tag], duration);
+  if (duration > stats->longestCallback)
+  {
+    stats->longestCallback = duration;
+    stats->longestCallbackType = type;
+    stats->longestCallbackTag = tag;
+  }
+}
+
+static inline void swEdgeLoopIterationCallback(swEdgeWatcher *watcher)
+{
+  switch (watcher->type)
+  {
+    case swWatcherTypePrepare:
+      ((swEdgePrepare *)watcher)->prepareCB((swEdgePrepare *)watcher);
+      break;
+    case swWatcherTypeCheck:
+      ((swEdgeCheck *)watcher)->checkCB((swEdgeCheck *)watcher);
+      break;
+    case swWatcherTypeIdle:
+      ((swEdgeIdle *)watcher)->idleCB((swEdgeIdle *)watcher);
+      break;
+    default:
+      break;
+  }
+}
+
+// calls the watchers of the type started before the pass, returns the time of the last callback
+// end when the stats are enabled, start otherwise
+static uint64_t swEdgeLoopIterationWatchersRun(swEdgeLoop *loop, swWatcherType type, uint64_t start)
+{
+  uint32_t index = type - swWatcherTypePrepare;
+  swFastArray *watchers = &(loop->iterationWatchers[index]);
+  uint32_t count = swFastArrayCount(*watchers);
+  for (uint32_t i = 0; i < count; i++)
+  {
+    swEdgeWatcher *watcher = NULL;
+    if (swFastArrayGet(*watchers, i, watcher) && watcher)
+    {
+      uint32_t tag = watcher->tag;
+      swEdgeLoopIterationCallback(watcher);
+      swEdgeLoopStats *stats = loop->stats;
+      if (stats)
+      {
+        uint64_t end = swClockNow();
+        if (start)
+          swEdgeLoopCallbackRecord(stats, type, tag, end - start);
+        start = end;
+      }
+    }
+  }
+  // squeezes out the slots of the stopped watchers keeping the order
+  if (loop->iterationWatchersRemoved[index])
+  {
+    uint32_t position = 0;
+    for (uint32_t i = 0; i < swFastArrayCount(*watchers); i++)
+    {
+      swEdgeWatcher *watcher = NULL;
+      if (swFastArrayGet(*watchers, i, watcher) && watcher)
+      {
+        swFastArraySet(*watchers, position, watcher);
+        watcher->pendingPosition = position++;
+      }
+    }
+    watchers->count = position;
+    loop->iterationWatchersRemoved[index] = 0;
+  }
+  return start;
+}
+
+static inline int swEdgeLoopWait(swEdgeLoop *loop, int timeout, swEdgeLoopStats *stats)
+{
+  int rtn = 0;
+  struct epoll_event *events = (struct epoll_event *)swFastArrayData(loop->epollEvents);
+  int eventsSize = swFastArraySize(loop->epollEvents);
+  bool wait = true;
+  if (timeout && loop->busyPollTime)
+  {
+    uint64_t deadline = swClockNow() + loop->busyPollTime;
+    do
+    {
+      // events or an error end the polling
+      if ((rtn = epoll_wait(loop->fd, events, eventsSize, 0)))
+        wait = false;
+      else
+        __builtin_ia32_pause();
+    } while (wait && (swClockNow() < deadline));
+    if (stats)
+    {
+      if (rtn > 0)
+        stats->busyPollHits++;
+      else if (wait)
+        stats->busyPollMisses++;
+    }
+  }
+  if (wait)
+    rtn = epoll_wait(loop->fd, events, eventsSize, timeout);
+  return rtn;
+}
+
 void swEdgeLoopRun(swEdgeLoop *loop, bool once)
 {
   if (loop)
@@ -253,10 +422,37 @@ void swEdgeLoopRun(swEdgeLoop *loop, bool once)
     loop->shutdown = false;
     int defaultTimeout = 1000;  // 1 second
     bool run = true;
+    uint64_t waitStart = (loop->stats)? swClockNow() : 0;
     while (run)
     {
+      // before the pending count, the prepare watchers can queue work for the iteration
+      if (swEdgeLoopIterationWatcherCount(loop, swWatcherTypePrepare))
+      {
+        uint64_t prepareEnd = swEdgeLoopIterationWatchersRun(loop, swWatcherTypePrepare, waitStart);
+        if (waitStart && loop->stats)
+        {
+          loop->stats->busyTime += prepareEnd - waitStart;
+          waitStart = prepareEnd;
+        }
+      }
       uint32_t pendingCount = swFastArrayCount(loop->pendingEvents[loop->currentPending]);
-      int eventCount = epoll_wait(loop->fd, (struct epoll_event *)swFastArrayData(loop->epollEvents), swFastArraySize(loop->epollEvents), ((pendingCount)? 0 : defaultTimeout));
+      // the blocked time is only known when the stats were enabled before the wait
+      swEdgeLoopStats *stats = (waitStart)? loop->stats : NULL;
+      int eventCount = swEdgeLoopWait(loop, ((pendingCount || loop->idleCount)? 0 : defaultTimeout), stats);
+      swEdgeLoopNowUpdate(loop);
+      loop->iteration++;
+      if (stats)
+      {
+        stats->iterations++;
+        stats->blockedTime += loop->now - waitStart;
+        if (eventCount > 0)
+        {
+          stats->events += eventCount;
+          swHistogramRecord(stats->eventsPerWait, eventCount);
+        }
+        else
+          swHistogramRecord(stats->eventsPerWait, 0);
+      }
       if (eventCount >= 0)
       {
         // first pass: transfer all events to pending
@@ -286,6 +482,8 @@ void swEdgeLoopRun(swEdgeLoop *loop, bool once)
         run = false;
 
       // second pass: run all pending events
+      uint64_t callbackStart = loop->now;
+      uint64_t busyEnd = 0;
       pendingCount = swFastArrayCount(loop->pendingEvents[loop->currentPending]);
       if (pendingCount)
       {
@@ -297,18 +495,50 @@ void swEdgeLoopRun(swEdgeLoop *loop, bool once)
           // TODO: this works, but I am not happy with the logic, not sure how to make it more elegant
           if (swFastArrayGet(loop->pendingEvents[lastPending], i, watcher) && watcher && watcherProcess[watcher->type])
           {
+            // the watcher can be gone after the callback
+            swWatcherType type = watcher->type;
+            uint32_t tag = watcher->tag;
+            loop->processing = watcher;
+            loop->processingEvents = 0;
             while (watcherProcess[watcher->type](watcher, watcher->pendingEvents))
             {
               if (swFastArrayGet(loop->pendingEvents[lastPending], i, watcher) && watcher)
                 continue;
               break;
             }
+            loop->processing = NULL;
             if (swFastArrayGet(loop->pendingEvents[lastPending], i, watcher) && watcher)
+            {
               watcher->pendingEvents = 0;
+              // the watcher that did not finish its work goes to the back of the queue instead of
+              // waiting for the next epoll event, which does not come for the data already there
+              if (loop->processingEvents)
+                swEdgeWatcherPendingSet(watcher, loop->processingEvents);
+            }
+            // the callback can enable or disable the stats
+            if ((stats = loop->stats))
+            {
+              // one clock read per callback, the end of one is the start of the next
+              uint64_t callbackEnd = swClockNow();
+              swEdgeLoopCallbackRecord(stats, type, tag, callbackEnd - callbackStart);
+              callbackStart = busyEnd = callbackEnd;
+            }
           }
         }
         loop->pendingEvents[lastPending].count = 0;
       }
+      if (swEdgeLoopIterationWatcherCount(loop, swWatcherTypeCheck))
+        busyEnd = callbackStart = swEdgeLoopIterationWatchersRun(loop, swWatcherTypeCheck, callbackStart);
+      if (!eventCount && !pendingCount && loop->idleCount)
+        busyEnd = callbackStart = swEdgeLoopIterationWatchersRun(loop, swWatcherTypeIdle, callbackStart);
+      if ((stats = loop->stats))
+      {
+        waitStart = (busyEnd)? busyEnd : swClockNow();
+        stats->busyTime += waitStart - loop->now;
+        swHistogramRecord(stats->iterationTime, waitStart - loop->now);
+      }
+      else
+        waitStart = 0;
       if (loop->shutdown)
         run = !loop->shutdown;
       if (once)
@@ -317,6 +547,115 @@ void swEdgeLoopRun(swEdgeLoop *loop, bool once)
   }
 }
 
+bool swEdgeLoopStatsEnable(swEdgeLoop *loop)
+{
+  bool rtn = false;
+  if (loop)
+  {
+    if (!loop->stats)
+    {
+      swEdgeLoopStats *stats = swMemoryCalloc(1, sizeof(*stats));
+      if (stats)
+      {
+        bool success = (stats->eventsPerWait = swHistogramNew()) && (stats->iterationTime = swHistogramNew());
+        for (uint32_t i = 0; success && (i < swWatcherTypeMax); i++)
+          success = ((stats->callbackTime[i] = swHistogramNew()) != NULL);
+        for (uint32_t i = 1; success && (i < SW_EDGELOOP_TAG_MAX); i++)
+          success = ((stats->tagCallbackTime[i] = swHistogramNew()) != NULL);
+        loop->stats = stats;
+        if (!success)
+          swEdgeLoopStatsDisable(loop);
+      }
+    }
+    rtn = (loop->stats != NULL);
+  }
+  return rtn;
+}
+
+void swEdgeLoopStatsDisable(swEdgeLoop *loop)
+{
+  if (loop && loop->stats)
+  {
+    swEdgeLoopStats *stats = loop->stats;
+    loop->stats = NULL;
+    if (stats->eventsPerWait)
+      swHistogramDelete(stats->eventsPerWait);
+    if (stats->iterationTime)
+      swHistogramDelete(stats->iterationTime);
+    for (uint32_t i = 0; i < swWatcherTypeMax; i++)
+    {
+      if (stats->callbackTime[i])
+        swHistogramDelete(stats->callbackTime[i]);
+    }
+    for (uint32_t i = 0; i < SW_EDGELOOP_TAG_MAX; i++)
+    {
+      if (stats->tagCallbackTime[i])
+        swHistogramDelete(stats->tagCallbackTime[i]);
+    }
+    swMemoryFree(stats);
+  }
+}
+
+void swEdgeLoopStatsReset(swEdgeLoop *loop)
+{
+  if (loop && loop->stats)
+  {
+    swEdgeLoopStats *stats = loop->stats;
+    stats->iterations = stats->events = stats->blockedTime = stats->busyTime = 0;
+    stats->longestCallback = 0;
+    stats->longestCallbackType = swWatcherTypeNone;
+    stats->longestCallbackTag = 0;
+    stats->busyPollHits = stats->busyPollMisses = 0;
+    swHistogramClear(stats->eventsPerWait);
+    swHistogramClear(stats->iterationTime);
+    for (uint32_t i = 0; i < swWatcherTypeMax; i++)
+      swHistogramClear(stats->callbackTime[i]);
+    for (uint32_t i = 1; i < SW_EDGELOOP_TAG_MAX; i++)
+      swHistogramClear(stats->tagCallbackTime[i]);
+  }
+}
+
+bool swEdgeLoopTagNameSet(swEdgeLoop *loop, uint32_t tag, const char *name)
+{
+  bool rtn = false;
+  if (loop && tag && (tag < SW_EDGELOOP_TAG_MAX))
+  {
+    loop->tagNames[tag] = name;
+    rtn = true;
+  }
+  return rtn;
+}
+
+const char *swEdgeLoopTagNameGet(swEdgeLoop *loop, uint32_t tag)
+{
+  if (loop && (tag < SW_EDGELOOP_TAG_MAX))
+    return loop->tagNames[tag];
+  return NULL;
+}
+
+bool swEdgeLoopBusyPollSet(swEdgeLoop *loop, uint64_t busyPollTime)
+{
+  bool rtn = false;
+  if (loop)
+  {
+    loop->busyPollTime = busyPollTime;
+    rtn = true;
+  }
+  return rtn;
+}
+
+bool swEdgeLoopSocketBusyPollSet(swEdgeLoop *loop, uint32_t socketBusyPoll, bool prefer)
+{
+  bool rtn = false;
+  if (loop)
+  {
+    loop->socketBusyPoll = socketBusyPoll;
+    loop->socketPreferBusyPoll = prefer;
+    rtn = true;
+  }
+  return rtn;
+}
+
 void swEdgeLoopBreak(swEdgeLoop *loop)
 {
   if (loop)
@@ -6,6 +6,8 @@
 #include <sys/epoll.h>
 
 #include "collections/fast-array.h"
+#include "core/clock.h"
+#include "core/histogram.h"
 
 typedef enum swWatcherType
 {
@@ -16,6 +18,9 @@ typedef enum swWatcherType
   // swWatcherTypeFile,            // inotify
   swWatcherTypeAsync,           // eventfd
   swWatcherTypeIO,              // socket
+  swWatcherTypePrepare,         // before the poll
+  swWatcherTypeCheck,           // after the callbacks of the polled events
+  swWatcherTypeIdle,            // iterations without events
   swWatcherTypeMax
 } swWatcherType;
 
@@ -30,13 +35,61 @@ typedef enum swEdgeEvents
 } swEdgeEvents;
 
 
+// watchers can be tagged for the loop stats, tag 0 is for the watchers without a tag
+#define SW_EDGELOOP_TAG_MAX  16
+
+// loop stats, all the times are in nanoseconds; the histograms are allocated when the
+// stats are enabled, so a loop without stats pays for a single branch per iteration
+typedef struct swEdgeLoopStats
+{
+  uint64_t iterations;
+  uint64_t events;
+  // time spent in epoll_wait and time spent processing the events
+  uint64_t blockedTime;
+  uint64_t busyTime;
+  swHistogram *eventsPerWait;
+  swHistogram *iterationTime;
+  swHistogram *callbackTime[swWatcherTypeMax];
+  swHistogram *tagCallbackTime[SW_EDGELOOP_TAG_MAX];
+  uint64_t longestCallback;
+  swWatcherType longestCallbackType;
+  uint32_t longestCallbackTag;
+  // busy poll waits that found events while spinning and the ones that ended up blocking
+  uint64_t busyPollHits;
+  uint64_t busyPollMisses;
+} swEdgeLoopStats;
+
+// the watchers of the loop iteration itself, without a file descriptor
+#define SW_EDGELOOP_ITERATION_TYPES   (swWatcherTypeIdle - swWatcherTypePrepare + 1)
+
 typedef struct swEdgeLoop
 {
   swFastArray epollEvents;
   swFastArray pendingEvents[2];
+  // prepare, check and idle watchers in the order they were started, a stopped watcher leaves
+  // an empty slot till the end of the next pass over the array
+  swFastArray iterationWatchers[SW_EDGELOOP_ITERATION_TYPES];
+  uint32_t iterationWatchersRemoved[SW_EDGELOOP_ITERATION_TYPES];
+  uint32_t idleCount;
+  // monotonic nanoseconds sampled after every epoll_wait
+  uint64_t now;
+  swEdgeLoopStats *stats;
+  const char *tagNames[SW_EDGELOOP_TAG_MAX];
+  // nanoseconds spent polling before the loop blocks in epoll_wait, 0 to block right away
+  uint64_t busyPollTime;
+  // SO_BUSY_POLL microseconds for the sockets of swSocketIO started on the loop
+  uint32_t socketBusyPoll;
+  // bytes a swSocketIO can read or write in one iteration before it is queued for the next
+  // one, so a busy connection can not starve the rest, 0 for no limit
+  uint64_t ioBudget;
+  uint64_t iteration;
+  // watcher in its callback and the events it queued for the next iteration
+  struct swEdgeWatcher *processing;
+  uint32_t processingEvents;
   int fd;
   unsigned int currentPending : 1;
   unsigned int shutdown : 1;
+  unsigned int socketPreferBusyPoll : 1;
 } swEdgeLoop;
 
 #define SWEDGELOOP_PENDINGBITS 31
@@ -45,6 +98,7 @@ typedef struct swEdgeLoop
 typedef struct swEdgeWatcher
 {
   struct epoll_event event;
+  uint32_t tag;
   swEdgeLoop *loop;
   void *data;
 
@@ -64,6 +118,37 @@ bool swEdgeLoopWatcherRemove(swEdgeLoop *loop, swEdgeWatcher *watcher);
 bool swEdgeLoopWatcherModify(swEdgeLoop *loop, swEdgeWatcher *watcher);
 bool swEdgeLoopPendingSet(swEdgeLoop *loop, swEdgeWatcher *watcher, uint32_t events);
 
+// busy poll mode for latency sensitive loops: instead of sleeping in epoll_wait right away the
+// loop keeps polling with a zero timeout for busyPollTime nanoseconds, saving the wake up of the
+// thread when the events come within the time; it burns the CPU, so the loop thread should be
+// pinned to a CPU of its own (see init/init-io.h)
+bool swEdgeLoopBusyPollSet(swEdgeLoop *loop, uint64_t busyPollTime);
+// the sockets also poll the device queue for socketBusyPoll microseconds on reads without data
+// and, with prefer set, keep polling instead of waiting for the interrupts under load
+bool swEdgeLoopSocketBusyPollSet(swEdgeLoop *loop, uint32_t socketBusyPoll, bool prefer);
+
+#define swEdgeLoopBusyPollTimeGet(l)    ((l)->busyPollTime)
+#define swEdgeLoopIOBudgetSet(l, b)     do { if ((l)) (l)->ioBudget = (b); } while(0)
+#define swEdgeLoopIOBudgetGet(l)        ((l)->ioBudget)
+#define swEdgeLoopIterationGet(l)       ((l)->iteration)
+
+// time of the current loop iteration, the same for all the callbacks of the iteration, which
+// is usually precise enough for timeouts and stats; callbacks that run long can update it
+static inline uint64_t swEdgeLoopNow(swEdgeLoop *loop)
+{
+  if (loop)
+    return loop->now;
+  return 0;
+}
+
+// also updates the swClock per thread cache, the loop thread reads the same time from both
+static inline uint64_t swEdgeLoopNowUpdate(swEdgeLoop *loop)
+{
+  if (loop)
+    return (loop->now = swClockCachedUpdate());
+  return 0;
+}
+
 static inline void *swEdgeWatcherDataGet(swEdgeWatcher *watcher)
 {
   if (watcher)
@@ -84,8 +169,27 @@ static inline swEdgeLoop *swEdgeWatcherLoopGet(swEdgeWatcher *watcher)
   return NULL;
 }
 
+// queues the watcher callback with the events, a watcher queued from its own callback is called
+// again in the next iteration, after the events epoll returned for the other watchers
 bool swEdgeWatcherPendingSet(swEdgeWatcher *watcher, uint32_t events);
 
+#define swEdgeWatcherTagSet(t, g)   do { if ((t) && ((g) < SW_EDGELOOP_TAG_MAX)) ((swEdgeWatcher *)(t))->tag = (g); } while(0)
+#define swEdgeWatcherTagGet(t)      (((swEdgeWatcher *)(t))->tag)
+
+bool swEdgeLoopStatsEnable(swEdgeLoop *loop);
+void swEdgeLoopStatsDisable(swEdgeLoop *loop);
+void swEdgeLoopStatsReset(swEdgeLoop *loop);
+// the name is not copied
+bool swEdgeLoopTagNameSet(swEdgeLoop *loop, uint32_t tag, const char *name);
+const char *swEdgeLoopTagNameGet(swEdgeLoop *loop, uint32_t tag);
+
+static inline swEdgeLoopStats *swEdgeLoopStatsGet(swEdgeLoop *loop)
+{
+  if (loop)
+    return loop->stats;
+  return NULL;
+}
+
 #define swEdgeWatcherDataGet(t)     swEdgeWatcherDataGet((swEdgeWatcher *)(t))
 #define swEdgeWatcherDataSet(t, d)  swEdgeWatcherDataSet((swEdgeWatcher *)(t), (void *)(d))
 #define swEdgeWatcherLoopGet(t)     swEdgeWatcherLoopGet((swEdgeWatcher *)(t))
@@ -0,0 +1,102 @@
+#include "edge-mailbox.h"
+
+#include <string.h>
+
+static void swEdgeMailboxAsyncCallback(swEdgeAsync *asyncWatcher, eventfd_t eventCount, uint32_t events)
+{
+  swEdgeMailboxDrain((swEdgeMailbox *)asyncWatcher);
+}
+
+bool swEdgeMailboxInit(swEdgeMailbox *mailbox, swEdgeMailboxCallback cb)
+{
+  bool rtn = false;
+  if (mailbox && cb)
+  {
+    memset(mailbox, 0, sizeof(swEdgeMailbox));
+    if (swEdgeAsyncInit(&(mailbox->async), swEdgeMailboxAsyncCallback))
+    {
+      mailbox->messageCB = cb;
+      rtn = true;
+    }
+  }
+  return rtn;
+}
+
+bool swEdgeMailboxStart(swEdgeMailbox *mailbox, swEdgeLoop *loop)
+{
+  bool rtn = false;
+  if (mailbox && loop && swEdgeAsyncStart(&(mailbox->async), loop))
+  {
+    // the posts that came before the start could not wake the loop up
+    if (__atomic_load_n(&(mailbox->head), __ATOMIC_ACQUIRE))
+      swEdgeAsyncSend(&(mailbox->async));
+    rtn = true;
+  }
+  return rtn;
+}
+
+bool swEdgeMailboxPost(swEdgeMailbox *mailbox, swEdgeMailboxMessage *message)
+{
+  bool rtn = false;
+  if (mailbox && message)
+  {
+    swEdgeMailboxMessage *head = __atomic_load_n(&(mailbox->head), __ATOMIC_RELAXED);
+    do
+    {
+      message->next = head;
+    } while (!__atomic_compare_exchange_n(&(mailbox->head), &head, message, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    // only the post that finds the mailbox empty wakes the loop up, the loop takes all the
+    // messages posted till then in one go
+    if (!head)
+    {
+      __atomic_add_fetch(&(mailbox->wakeups), 1, __ATOMIC_RELAXED);
+      rtn = swEdgeAsyncSend(&(mailbox->async));
+    }
+    else
+      rtn = true;
+  }
+  return rtn;
+}
+
+uint32_t swEdgeMailboxDrain(swEdgeMailbox *mailbox)
+{
+  uint32_t rtn = 0;
+  if (mailbox)
+  {
+    swEdgeMailboxMessage *stack = __atomic_exchange_n(&(mailbox->head), NULL, __ATOMIC_ACQUIRE);
+    if (stack)
+    {
+      // the stack has the last posted message on top
+      swEdgeMailboxMessage *queue = NULL;
+      while (stack)
+      {
+        swEdgeMailboxMessage *next = stack->next;
+        stack->next = queue;
+        queue = stack;
+        stack = next;
+      }
+      while (queue)
+      {
+        // the callback can release the message
+        swEdgeMailboxMessage *next = queue->next;
+        mailbox->messageCB(mailbox, queue);
+        queue = next;
+        rtn++;
+      }
+      mailbox->batches++;
+      mailbox->messages += rtn;
+    }
+  }
+  return rtn;
+}
+
+void swEdgeMailboxStop(swEdgeMailbox *mailbox)
+{
+  if (mailbox)
+    swEdgeAsyncStop(&(mailbox->async));
+}
+
+void swEdgeMailboxClose(swEdgeMailbox *mailbox)
+{
+  swEdgeMailboxStop(mailbox);
+}
@@ -0,0 +1,49 @@
+#ifndef SW_IO_EDGEMAILBOX_H
+#define SW_IO_EDGEMAILBOX_H
+
+#include "edge-async.h"
+
+// multiple producer, single consumer message queue of a loop; any thread can post, the messages
+// are delivered in the loop thread in the order every producer posted them
+//
+// the queue is a lock free stack the loop takes over as a whole, so the eventfd is only written
+// by the post that finds the mailbox empty and a single wake up delivers everything posted
+// till the loop gets to it, instead of one system call on each side per message
+//
+// the messages are intrusive, embed swEdgeMailboxMessage in the structure that gets posted,
+// the mailbox does not own them, the callback does whatever is needed to release them
+
+typedef struct swEdgeMailboxMessage
+{
+  struct swEdgeMailboxMessage *next;
+} swEdgeMailboxMessage;
+
+struct swEdgeMailbox;
+
+typedef void (*swEdgeMailboxCallback)(struct swEdgeMailbox *mailbox, swEdgeMailboxMessage *message);
+
+typedef struct swEdgeMailbox
+{
+  swEdgeAsync async;
+
+  swEdgeMailboxCallback messageCB;
+  // last message posted, the stack is reversed when the loop takes it over
+  swEdgeMailboxMessage *head;
+  // eventfd writes by the producers, batches and messages delivered by the loop
+  uint64_t wakeups;
+  uint64_t batches;
+  uint64_t messages;
+} swEdgeMailbox;
+
+bool swEdgeMailboxInit(swEdgeMailbox *mailbox, swEdgeMailboxCallback cb);
+bool swEdgeMailboxStart(swEdgeMailbox *mailbox, swEdgeLoop *loop);
+// can be called from any thread; false when the message was queued, but the loop could not be
+// woken up, the mailbox delivers it the next time it is started or drained
+bool swEdgeMailboxPost(swEdgeMailbox *mailbox, swEdgeMailboxMessage *message);
+// delivers the messages posted so far, the loop does it on every wake up; returns the number of messages
+uint32_t swEdgeMailboxDrain(swEdgeMailbox *mailbox);
+// the messages left in the mailbox stay there till it is started or drained again
+void swEdgeMailboxStop(swEdgeMailbox *mailbox);
+void swEdgeMailboxClose(swEdgeMailbox *mailbox);
+
+#endif // SW_IO_EDGEMAILBOX_H
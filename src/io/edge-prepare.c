@@ -0,0 +1,48 @@
+#include "edge-prepare.h"
+
+#include <string.h>
+
+bool swEdgePrepareInit(swEdgePrepare *prepareWatcher, swEdgePrepareCallback cb)
+{
+  bool rtn = false;
+  if (prepareWatcher && cb)
+  {
+    memset(prepareWatcher, 0, sizeof(swEdgePrepare));
+    swEdgeWatcher *watcher = (swEdgeWatcher *)prepareWatcher;
+    watcher->type = swWatcherTypePrepare;
+    watcher->fd = -1;
+    prepareWatcher->prepareCB = cb;
+    rtn = true;
+  }
+  return rtn;
+}
+
+bool swEdgePrepareStart(swEdgePrepare *prepareWatcher, swEdgeLoop *loop)
+{
+  bool rtn = false;
+  swEdgeWatcher *watcher = (swEdgeWatcher *)prepareWatcher;
+  if (prepareWatcher && loop && !watcher->loop)
+  {
+    if (swEdgeLoopWatcherAdd(loop, watcher))
+    {
+      watcher->loop = loop;
+      rtn = true;
+    }
+  }
+  return rtn;
+}
+
+void swEdgePrepareStop(swEdgePrepare *prepareWatcher)
+{
+  swEdgeWatcher *watcher = (swEdgeWatcher *)prepareWatcher;
+  if (prepareWatcher && watcher->loop)
+  {
+    swEdgeLoopWatcherRemove(watcher->loop, watcher);
+    watcher->loop = NULL;
+  }
+}
+
+void swEdgePrepareClose(swEdgePrepare *prepareWatcher)
+{
+  swEdgePrepareStop(prepareWatcher);
+}
@@ -0,0 +1,24 @@
+#ifndef SW_IO_EDGEPREPARE_H
+#define SW_IO_EDGEPREPARE_H
+
+#include "edge-loop.h"
+
+// called at the start of every loop iteration, before the loop polls for events
+
+struct swEdgePrepare;
+
+typedef void (*swEdgePrepareCallback)(struct swEdgePrepare *prepareWatcher);
+
+typedef struct swEdgePrepare
+{
+  swEdgeWatcher watcher;
+
+  swEdgePrepareCallback prepareCB;
+} swEdgePrepare;
+
+bool swEdgePrepareInit(swEdgePrepare *prepareWatcher, swEdgePrepareCallback cb);
+bool swEdgePrepareStart(swEdgePrepare *prepareWatcher, swEdgeLoop *loop);
+void swEdgePrepareStop(swEdgePrepare *prepareWatcher);
+void swEdgePrepareClose(swEdgePrepare *prepareWatcher);
+
+#endif // SW_IO_EDGEPREPARE_H
@@ -29,8 +29,13 @@ bool swEdgeTimerStart(swEdgeTimer *timer, swEdgeLoop *loop, uint64_t offset, uin
   if (timer && loop && (offset || interval))
   {
     swEdgeWatcher *watcher = (swEdgeWatcher *)timer;
-    if (watcher->loop)
+    // restarting on the same loop only needs the new time, the watcher stays registered
+    bool registered = (watcher->loop == loop);
+    if (watcher->loop && !registered)
+    {
       swEdgeLoopWatcherRemove(watcher->loop, watcher);
+      watcher->loop = NULL;
+    }
 
     timer->timerSpec.it_value.tv_sec      = swTimeMSecToSec(offset);
     timer->timerSpec.it_value.tv_nsec     = swTimeMSecToNSec( swTimeMSecToSecRem(offset) );
@@ -39,7 +44,7 @@ bool swEdgeTimerStart(swEdgeTimer *timer, swEdgeLoop *loop, uint64_t offset, uin
 
     if (timerfd_settime(watcher->fd, ((absolute)? TFD_TIMER_ABSTIME : 0), &(timer->timerSpec), NULL) == 0)
     {
-      if (swEdgeLoopWatcherAdd(loop, watcher))
+      if (registered || swEdgeLoopWatcherAdd(loop, watcher))
       {
         watcher->loop = loop;
         rtn = true;
@@ -0,0 +1,174 @@
+#include "io/frame-decoder.h"
+
+#include <string.h>
+
+typedef enum swFrameDecoderResult
+{
+  swFrameDecoderResultMore = 0,
+  swFrameDecoderResultFrame,
+  swFrameDecoderResultInvalid
+} swFrameDecoderResult;
+
+static bool swFrameDecoderInit(swFrameDecoder *decoder, swFrameDecoderType type, size_t maxFrameSize, swFrameDecoderFrameFunc frameFunc)
+{
+  bool rtn = false;
+  if (decoder && frameFunc)
+  {
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->type = type;
+    decoder->maxFrameSize = maxFrameSize;
+    decoder->frameFunc = frameFunc;
+    rtn = true;
+  }
+  return rtn;
+}
+
+bool swFrameDecoderInitLengthPrefixed(swFrameDecoder *decoder, uint8_t lengthSize, bool littleEndian, size_t maxFrameSize, swFrameDecoderFrameFunc frameFunc)
+{
+  bool rtn = false;
+  if (((lengthSize == 1) || (lengthSize == 2) || (lengthSize == 4) || (lengthSize == 8))
+      && swFrameDecoderInit(decoder, swFrameDecoderTypeLengthPrefixed, maxFrameSize, frameFunc))
+  {
+    decoder->lengthPrefixed.lengthSize = lengthSize;
+    decoder->lengthPrefixed.littleEndian = littleEndian;
+    rtn = true;
+  }
+  return rtn;
+}
+
+bool swFrameDecoderInitDelimiter(swFrameDecoder *decoder, swStaticBuffer *delimiter, size_t maxFrameSize, swFrameDecoderFrameFunc frameFunc)
+{
+  bool rtn = false;
+  if (delimiter && delimiter->data && delimiter->len && swFrameDecoderInit(decoder, swFrameDecoderTypeDelimiter, maxFrameSize, frameFunc))
+  {
+    decoder->delimiter.delimiter = *delimiter;
+    rtn = true;
+  }
+  return rtn;
+}
+
+bool swFrameDecoderInitFixed(swFrameDecoder *decoder, size_t frameSize, swFrameDecoderFrameFunc frameFunc)
+{
+  bool rtn = false;
+  if (frameSize && swFrameDecoderInit(decoder, swFrameDecoderTypeFixed, frameSize, frameFunc))
+  {
+    decoder->fixed.frameSize = frameSize;
+    rtn = true;
+  }
+  return rtn;
+}
+
+// largest frame that can be complete in the ring next to the overhead bytes
+static inline size_t swFrameDecoderLimitGet(swFrameDecoder *decoder, size_t ringSize, size_t overhead)
+{
+  size_t rtn = (ringSize > overhead)? (ringSize - overhead) : 0;
+  if (decoder->maxFrameSize && (decoder->maxFrameSize < rtn))
+    rtn = decoder->maxFrameSize;
+  return rtn;
+}
+
+static swFrameDecoderResult swFrameDecoderLengthPrefixedNext(swFrameDecoder *decoder, swStaticBuffer *view, size_t ringSize, swStaticBuffer *frame, size_t *consumed)
+{
+  swFrameDecoderResult rtn = swFrameDecoderResultMore;
+  uint8_t lengthSize = decoder->lengthPrefixed.lengthSize;
+  if (view->len >= lengthSize)
+  {
+    uint64_t length = 0;
+    for (uint8_t i = 0; i < lengthSize; i++)
+    {
+      uint8_t byte = view->data[(decoder->lengthPrefixed.littleEndian)? (lengthSize - 1 - i) : i];
+      length = (length << 8) | byte;
+    }
+    if (length > swFrameDecoderLimitGet(decoder, ringSize, lengthSize))
+      rtn = swFrameDecoderResultInvalid;
+    else if (view->len >= (lengthSize + length))
+    {
+      frame->data = view->data + lengthSize;
+      frame->len = length;
+      *consumed = lengthSize + length;
+      rtn = swFrameDecoderResultFrame;
+    }
+  }
+  return rtn;
+}
+
+static swFrameDecoderResult swFrameDecoderDelimiterNext(swFrameDecoder *decoder, swStaticBuffer *view, size_t ringSize, swStaticBuffer *frame, size_t *consumed)
+{
+  swFrameDecoderResult rtn = swFrameDecoderResultMore;
+  swStaticBuffer *delimiter = &(decoder->delimiter.delimiter);
+  size_t scanned = decoder->delimiter.scanned;
+  uint8_t *found = NULL;
+  if ((scanned < view->len) && (found = memmem(view->data + scanned, view->len - scanned, delimiter->data, delimiter->len)))
+  {
+    frame->data = view->data;
+    frame->len = found - view->data;
+    *consumed = frame->len + delimiter->len;
+    decoder->delimiter.scanned = 0;
+    rtn = (frame->len > swFrameDecoderLimitGet(decoder, ringSize, delimiter->len))? swFrameDecoderResultInvalid : swFrameDecoderResultFrame;
+  }
+  else
+  {
+    // the start of the delimiter can be at the end of the data
+    decoder->delimiter.scanned = (view->len >= delimiter->len)? (view->len - delimiter->len + 1) : 0;
+    if (view->len >= (swFrameDecoderLimitGet(decoder, ringSize, delimiter->len) + delimiter->len))
+      rtn = swFrameDecoderResultInvalid;
+  }
+  return rtn;
+}
+
+static swFrameDecoderResult swFrameDecoderFixedNext(swFrameDecoder *decoder, swStaticBuffer *view, size_t ringSize, swStaticBuffer *frame, size_t *consumed)
+{
+  swFrameDecoderResult rtn = swFrameDecoderResultMore;
+  if (decoder->fixed.frameSize > ringSize)
+    rtn = swFrameDecoderResultInvalid;
+  else if (view->len >= decoder->fixed.frameSize)
+  {
+    frame->data = view->data;
+    frame->len = decoder->fixed.frameSize;
+    *consumed = frame->len;
+    rtn = swFrameDecoderResultFrame;
+  }
+  return rtn;
+}
+
+bool swFrameDecoderDecode(swFrameDecoder *decoder, swReadRing *ring, uint32_t *frames)
+{
+  bool rtn = false;
+  if (decoder && ring && (decoder->type > swFrameDecoderTypeNone) && (decoder->type < swFrameDecoderTypeMax))
+  {
+    swStaticBuffer view = swStaticBufferDefineEmpty;
+    uint32_t count = 0;
+    rtn = true;
+    while (rtn && swReadRingPeek(ring, &view))
+    {
+      swStaticBuffer frame = swStaticBufferDefineEmpty;
+      size_t consumed = 0;
+      swFrameDecoderResult result = swFrameDecoderResultMore;
+      switch (decoder->type)
+      {
+        case swFrameDecoderTypeLengthPrefixed:
+          result = swFrameDecoderLengthPrefixedNext(decoder, &view, ring->size, &frame, &consumed);
+          break;
+        case swFrameDecoderTypeDelimiter:
+          result = swFrameDecoderDelimiterNext(decoder, &view, ring->size, &frame, &consumed);
+          break;
+        default:
+          result = swFrameDecoderFixedNext(decoder, &view, ring->size, &frame, &consumed);
+          break;
+      }
+      if (result == swFrameDecoderResultMore)
+        break;
+      if (result == swFrameDecoderResultInvalid)
+        rtn = false;
+      else
+      {
+        count++;
+        rtn = decoder->frameFunc(decoder, &frame);
+        swReadRingConsume(ring, consumed);
+      }
+    }
+    if (frames)
+      *frames = count;
+  }
+  return rtn;
+}
@@ -0,0 +1,69 @@
+#ifndef SW_IO_FRAMEDECODER_H
+#define SW_IO_FRAMEDECODER_H
+
+#include "io/read-ring.h"
+
+// splits the data of a read ring into frames and hands every complete one to the callback as
+// a view into the ring, the frame is consumed when the callback returns; a partial frame is
+// left in the ring till the rest of it arrives, the delimiter decoder remembers how far it
+// searched, so the bytes are looked at only once
+
+typedef enum swFrameDecoderType
+{
+  swFrameDecoderTypeNone = 0,
+  // length in network byte order (optionally little endian) followed by the payload,
+  // the frame is the payload
+  swFrameDecoderTypeLengthPrefixed,
+  // frames end with the delimiter, the frame does not include it
+  swFrameDecoderTypeDelimiter,
+  // frames of the same size
+  swFrameDecoderTypeFixed,
+  swFrameDecoderTypeMax
+} swFrameDecoderType;
+
+struct swFrameDecoder;
+
+// the view is valid only inside the callback; false stops the decoding, the frame is consumed anyway
+typedef bool (*swFrameDecoderFrameFunc)(struct swFrameDecoder *decoder, swStaticBuffer *frame);
+
+typedef struct swFrameDecoder
+{
+  swFrameDecoderType type;
+  swFrameDecoderFrameFunc frameFunc;
+  void *data;
+  // frames longer than this are an error, 0 is anything that fits into the ring
+  size_t maxFrameSize;
+  union
+  {
+    struct
+    {
+      uint8_t lengthSize;
+      bool littleEndian;
+    } lengthPrefixed;
+    struct
+    {
+      swStaticBuffer delimiter;
+      // bytes from the head of the ring searched without finding the delimiter
+      size_t scanned;
+    } delimiter;
+    struct
+    {
+      size_t frameSize;
+    } fixed;
+  };
+} swFrameDecoder;
+
+// lengthSize is 1, 2, 4 or 8 bytes
+bool swFrameDecoderInitLengthPrefixed(swFrameDecoder *decoder, uint8_t lengthSize, bool littleEndian, size_t maxFrameSize, swFrameDecoderFrameFunc frameFunc);
+// the delimiter memory has to stay valid while the decoder is used
+bool swFrameDecoderInitDelimiter(swFrameDecoder *decoder, swStaticBuffer *delimiter, size_t maxFrameSize, swFrameDecoderFrameFunc frameFunc);
+bool swFrameDecoderInitFixed(swFrameDecoder *decoder, size_t frameSize, swFrameDecoderFrameFunc frameFunc);
+
+#define swFrameDecoderDataSet(d, v)  (d)->data = (void *)(v)
+#define swFrameDecoderDataGet(d)     (d)->data
+
+// delivers the complete frames in the ring, false when the callback stopped it or when a frame
+// can not fit (larger than maxFrameSize or the ring), the connection is beyond repair then
+bool swFrameDecoderDecode(swFrameDecoder *decoder, swReadRing *ring, uint32_t *frames);
+
+#endif // SW_IO_FRAMEDECODER_H
@@ -0,0 +1,429 @@
+#include "core/benchmark.h"
+#include "core/memory.h"
+#include "core/time.h"
+#include "io/edge-async.h"
+#include "io/edge-io.h"
+#include "io/edge-loop.h"
+#include "io/socket-io.h"
+#include "io/tcp-server.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// round trip of a small datagram between two loops over loopback, the echo loop runs in a thread
+// of its own, which is pinned to another CPU when there is one; with busy poll both loops spin,
+// so on a single CPU the busy poll numbers only show the cost of the two threads fighting for it
+
+#define SW_IO_BENCHMARK_MESSAGE_SIZE    64
+#define SW_IO_BENCHMARK_BUSY_POLL_TIME  swTimeUSecToNSec(100)
+
+typedef struct swPingPong
+{
+  swEdgeLoop *loop;
+  swEdgeLoop *echoLoop;
+  swEdgeIO pingIO;
+  swEdgeIO echoIO;
+  swEdgeAsync stopAsync;
+  pthread_t echoThread;
+  int pingFD;
+  int echoFD;
+  bool received;
+  bool threadStarted;
+  char message[SW_IO_BENCHMARK_MESSAGE_SIZE];
+} swPingPong;
+
+static void pingCallback(swEdgeIO *ioWatcher, uint32_t events)
+{
+  swPingPong *pingPong = swEdgeWatcherDataGet(ioWatcher);
+  char buffer[SW_IO_BENCHMARK_MESSAGE_SIZE];
+  // edge triggered, has to be read till EAGAIN
+  while (recv(pingPong->pingFD, buffer, sizeof(buffer), 0) > 0)
+    pingPong->received = true;
+}
+
+static void echoCallback(swEdgeIO *ioWatcher, uint32_t events)
+{
+  swPingPong *pingPong = swEdgeWatcherDataGet(ioWatcher);
+  char buffer[SW_IO_BENCHMARK_MESSAGE_SIZE];
+  ssize_t size = 0;
+  while ((size = recv(pingPong->echoFD, buffer, sizeof(buffer), 0)) > 0)
+    send(pingPong->echoFD, buffer, size, 0);
+}
+
+static void stopCallback(swEdgeAsync *asyncWatcher, eventfd_t eventCount, uint32_t events)
+{
+  swEdgeLoopBreak(swEdgeWatcherLoopGet(asyncWatcher));
+}
+
+static void *echoThreadRun(void *data)
+{
+  swPingPong *pingPong = data;
+  swEdgeLoopRun(pingPong->echoLoop, false);
+  return NULL;
+}
+
+// bound to an ephemeral port of 127.0.0.1
+static int pingPongSocketNew(struct sockaddr_in *address)
+{
+  int rtn = -1;
+  int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd >= 0)
+  {
+    socklen_t addressSize = sizeof(*address);
+    address->sin_family = AF_INET;
+    address->sin_port = 0;
+    address->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (!bind(fd, (struct sockaddr *)address, sizeof(*address)) && !getsockname(fd, (struct sockaddr *)address, &addressSize))
+      rtn = fd;
+    else
+      close(fd);
+  }
+  return rtn;
+}
+
+static void pingPongTeardown(swPingPong *pingPong)
+{
+  if (pingPong)
+  {
+    if (pingPong->threadStarted)
+    {
+      swEdgeAsyncSend(&(pingPong->stopAsync));
+      pthread_join(pingPong->echoThread, NULL);
+    }
+    swEdgeAsyncClose(&(pingPong->stopAsync));
+    swEdgeIOClose(&(pingPong->pingIO));
+    swEdgeIOClose(&(pingPong->echoIO));
+    if (pingPong->pingFD >= 0)
+      close(pingPong->pingFD);
+    if (pingPong->echoFD >= 0)
+      close(pingPong->echoFD);
+    swEdgeLoopDelete(pingPong->loop);
+    swEdgeLoopDelete(pingPong->echoLoop);
+    swMemoryFree(pingPong);
+  }
+}
+
+static swPingPong *pingPongSetup(uint64_t busyPollTime)
+{
+  swPingPong *rtn = NULL;
+  swPingPong *pingPong = swMemoryCalloc(1, sizeof(*pingPong));
+  if (pingPong)
+  {
+    struct sockaddr_in pingAddress = {0};
+    struct sockaddr_in echoAddress = {0};
+    pingPong->pingFD = pingPongSocketNew(&pingAddress);
+    pingPong->echoFD = pingPongSocketNew(&echoAddress);
+    if ((pingPong->pingFD >= 0) && (pingPong->echoFD >= 0)
+        && !connect(pingPong->pingFD, (struct sockaddr *)&echoAddress, sizeof(echoAddress))
+        && !connect(pingPong->echoFD, (struct sockaddr *)&pingAddress, sizeof(pingAddress))
+        && (pingPong->loop = swEdgeLoopNew()) && (pingPong->echoLoop = swEdgeLoopNew())
+        && swEdgeIOInit(&(pingPong->pingIO), pingCallback) && swEdgeIOInit(&(pingPong->echoIO), echoCallback)
+        && swEdgeAsyncInit(&(pingPong->stopAsync), stopCallback))
+    {
+      swEdgeWatcherDataSet(&(pingPong->pingIO), pingPong);
+      swEdgeWatcherDataSet(&(pingPong->echoIO), pingPong);
+      swEdgeLoopBusyPollSet(pingPong->loop, busyPollTime);
+      swEdgeLoopBusyPollSet(pingPong->echoLoop, busyPollTime);
+      if (swEdgeIOStart(&(pingPong->pingIO), pingPong->loop, pingPong->pingFD, swEdgeEventRead)
+          && swEdgeIOStart(&(pingPong->echoIO), pingPong->echoLoop, pingPong->echoFD, swEdgeEventRead)
+          && swEdgeAsyncStart(&(pingPong->stopAsync), pingPong->echoLoop))
+      {
+        pthread_attr_t attr;
+        if (!pthread_attr_init(&attr))
+        {
+          long cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+          int cpu = sched_getcpu();
+          if ((cpuCount > 1) && (cpu >= 0))
+          {
+            cpu_set_t cpuSet;
+            CPU_ZERO(&cpuSet);
+            CPU_SET((cpu + 1) % cpuCount, &cpuSet);
+            pthread_attr_setaffinity_np(&attr, sizeof(cpuSet), &cpuSet);
+          }
+          if (!pthread_create(&(pingPong->echoThread), &attr, echoThreadRun, pingPong))
+          {
+            pingPong->threadStarted = true;
+            rtn = pingPong;
+          }
+          pthread_attr_destroy(&attr);
+        }
+      }
+    }
+    if (!rtn)
+      pingPongTeardown(pingPong);
+  }
+  return rtn;
+}
+
+static void *pingPongBlockingSetup()
+{
+  return pingPongSetup(0);
+}
+
+static void *pingPongBusyPollSetup()
+{
+  return pingPongSetup(SW_IO_BENCHMARK_BUSY_POLL_TIME);
+}
+
+static void pingPongRun(swPingPong *pingPong)
+{
+  if (pingPong && (send(pingPong->pingFD, pingPong->message, sizeof(pingPong->message), 0) > 0))
+  {
+    pingPong->received = false;
+    while (!pingPong->received)
+      swEdgeLoopRun(pingPong->loop, true);
+  }
+}
+
+swBenchmarkDeclare(EdgeLoopPingPongBlocking, pingPongBlockingSetup, pingPongTeardown, 1000)
+{
+  pingPongRun(context);
+}
+
+swBenchmarkDeclare(EdgeLoopPingPongBusyPoll, pingPongBusyPollSetup, pingPongTeardown, 1000)
+{
+  pingPongRun(context);
+}
+
+// one message over a loopback TCP connection per call, sent from the output queue of the
+// socket with or without MSG_ZEROCOPY and read in the same loop; a call ends when the whole
+// message arrived and the buffer was released, which for zero copy means the completion, so
+// the numbers include the completion round trip; loopback makes the kernel copy the data
+// on the receive side anyway, a real NIC gets the full benefit of not copying on the send side
+
+#define SW_IO_BENCHMARK_ZERO_COPY_THRESHOLD  (32 * 1024)
+
+typedef struct swBulkSend
+{
+  swEdgeLoop *loop;
+  swSocketIO *writer;
+  swSocketIO *reader;
+  swStaticBuffer message;
+  size_t received;
+  bool released;
+  uint8_t readBuffer[256 * 1024];
+} swBulkSend;
+
+static void bulkSendDoneCheck(swBulkSend *bulkSend)
+{
+  if (bulkSend->released && (bulkSend->received == bulkSend->message.len))
+    swEdgeLoopBreak(bulkSend->loop);
+}
+
+static void bulkSendRelease(swSocketIO *io, swStaticBuffer *buffer, swSocketIOBufferState state)
+{
+  swBulkSend *bulkSend = swSocketIODataGet(io);
+  bulkSend->released = true;
+  bulkSendDoneCheck(bulkSend);
+}
+
+static void bulkSendReadReady(swSocketIO *io)
+{
+  swBulkSend *bulkSend = swSocketIODataGet(io);
+  swStaticBuffer buffer = swStaticBufferDefine(bulkSend->readBuffer);
+  ssize_t bytesRead = 0;
+  while (swSocketIORead(io, &buffer, &bytesRead) == swSocketReturnOK)
+    bulkSend->received += bytesRead;
+  bulkSendDoneCheck(bulkSend);
+}
+
+static void bulkSendTeardown(swBulkSend *bulkSend)
+{
+  if (bulkSend)
+  {
+    swSocketIODelete(bulkSend->writer);
+    swSocketIODelete(bulkSend->reader);
+    swEdgeLoopDelete(bulkSend->loop);
+    swMemoryFree(bulkSend->message.data);
+    swMemoryFree(bulkSend);
+  }
+}
+
+static swBulkSend *bulkSendSetup(size_t size, bool zeroCopy)
+{
+  swBulkSend *rtn = NULL;
+  swBulkSend *bulkSend = swMemoryCalloc(1, sizeof(*bulkSend));
+  if (bulkSend)
+  {
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addressSize = sizeof(address);
+    int listenFD = socket(AF_INET, SOCK_STREAM, 0);
+    int fd[2] = {-1, -1};
+    if ((listenFD >= 0) && !bind(listenFD, (struct sockaddr *)&address, sizeof(address)) && !listen(listenFD, 1)
+        && !getsockname(listenFD, (struct sockaddr *)&address, &addressSize)
+        && ((fd[0] = socket(AF_INET, SOCK_STREAM, 0)) >= 0)
+        && !connect(fd[0], (struct sockaddr *)&address, sizeof(address))
+        && ((fd[1] = accept4(listenFD, NULL, NULL, SOCK_NONBLOCK)) >= 0)
+        && !fcntl(fd[0], F_SETFL, O_NONBLOCK)
+        && (bulkSend->message.data = swMemoryCalloc(1, size))
+        && (bulkSend->loop = swEdgeLoopNew()) && (bulkSend->writer = swSocketIONew()) && (bulkSend->reader = swSocketIONew())
+        && swSocketInitFromFD((swSocket *)bulkSend->writer, fd[0]))
+    {
+      fd[0] = -1;
+      if (swSocketInitFromFD((swSocket *)bulkSend->reader, fd[1]))
+      {
+        fd[1] = -1;
+        bulkSend->message.len = size;
+        swSocketIODataSet(bulkSend->writer, bulkSend);
+        swSocketIODataSet(bulkSend->reader, bulkSend);
+        swSocketIOBufferReleaseFuncSet(bulkSend->writer, bulkSendRelease);
+        swSocketIOReadReadyFuncSet(bulkSend->reader, bulkSendReadReady);
+        if ((!zeroCopy || swSocketIOZeroCopySet(bulkSend->writer, SW_IO_BENCHMARK_ZERO_COPY_THRESHOLD))
+            && swSocketIOStart(bulkSend->writer, bulkSend->loop) && swSocketIOStart(bulkSend->reader, bulkSend->loop))
+          rtn = bulkSend;
+      }
+    }
+    if (listenFD >= 0)
+      close(listenFD);
+    if (fd[0] >= 0)
+      close(fd[0]);
+    if (fd[1] >= 0)
+      close(fd[1]);
+    if (!rtn)
+      bulkSendTeardown(bulkSend);
+  }
+  return rtn;
+}
+
+static void bulkSendRun(swBulkSend *bulkSend)
+{
+  if (bulkSend)
+  {
+    bulkSend->received = 0;
+    bulkSend->released = false;
+    if (swSocketIOQueueWrite(bulkSend->writer, &(bulkSend->message)))
+      swEdgeLoopRun(bulkSend->loop, false);
+  }
+}
+
+#define swBulkSendBenchmarkDeclare(name, size, zeroCopy, sampleSize) \
+  static void *name##Setup() { return bulkSendSetup((size), (zeroCopy)); } \
+  swBenchmarkDeclare(name, name##Setup, bulkSendTeardown, sampleSize) { bulkSendRun(context); }
+
+swBulkSendBenchmarkDeclare(SocketIOSendCopy64K,      (64 * 1024),        false, 1000)
+swBulkSendBenchmarkDeclare(SocketIOSendZeroCopy64K,  (64 * 1024),        true,  1000)
+swBulkSendBenchmarkDeclare(SocketIOSendCopy1M,       (1024 * 1024),      false, 200)
+swBulkSendBenchmarkDeclare(SocketIOSendZeroCopy1M,   (1024 * 1024),      true,  200)
+swBulkSendBenchmarkDeclare(SocketIOSendCopy8M,       (8 * 1024 * 1024),  false, 50)
+swBulkSendBenchmarkDeclare(SocketIOSendZeroCopy8M,   (8 * 1024 * 1024),  true,  50)
+
+// a storm of loopback connections arriving at an acceptor at once, a call connects all the
+// clients and runs the loop till every one of them is accepted and set up; the clients reset
+// the connections when they close, so the calls do not fill the port range with TIME_WAIT
+
+#define SW_IO_BENCHMARK_STORM_SIZE  256
+
+typedef struct swAcceptStorm
+{
+  swEdgeLoop *loop;
+  swTCPServerAcceptor *acceptor;
+  struct sockaddr_in address;
+  uint32_t accepted;
+  swTCPServer *servers[SW_IO_BENCHMARK_STORM_SIZE];
+  int clients[SW_IO_BENCHMARK_STORM_SIZE];
+} swAcceptStorm;
+
+static bool acceptStormSetupFunc(swTCPServerAcceptor *serverAcceptor, swTCPServer *server)
+{
+  bool rtn = false;
+  swAcceptStorm *storm = swTCPServerAcceptorDataGet(serverAcceptor);
+  if (storm->accepted < SW_IO_BENCHMARK_STORM_SIZE)
+  {
+    storm->servers[storm->accepted++] = server;
+    if (storm->accepted == SW_IO_BENCHMARK_STORM_SIZE)
+      swEdgeLoopBreak(storm->loop);
+    rtn = true;
+  }
+  return rtn;
+}
+
+static void acceptStormClose(swAcceptStorm *storm)
+{
+  struct linger linger = { .l_onoff = 1, .l_linger = 0 };
+  for (uint32_t i = 0; i < SW_IO_BENCHMARK_STORM_SIZE; i++)
+  {
+    if (storm->clients[i] >= 0)
+    {
+      setsockopt(storm->clients[i], SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+      close(storm->clients[i]);
+      storm->clients[i] = -1;
+    }
+  }
+  for (uint32_t i = 0; i < storm->accepted; i++)
+  {
+    swTCPServerDelete(storm->servers[i]);
+    storm->servers[i] = NULL;
+  }
+  storm->accepted = 0;
+}
+
+static void acceptStormTeardown(swAcceptStorm *storm)
+{
+  if (storm)
+  {
+    acceptStormClose(storm);
+    swTCPServerAcceptorDelete(storm->acceptor);
+    swEdgeLoopDelete(storm->loop);
+    swMemoryFree(storm);
+  }
+}
+
+static swAcceptStorm *acceptStormSetup(uint32_t acceptBatch)
+{
+  swAcceptStorm *rtn = NULL;
+  swAcceptStorm *storm = swMemoryCalloc(1, sizeof(*storm));
+  if (storm)
+  {
+    swSocketAddress address = { 0 };
+    socklen_t addressSize = sizeof(storm->address);
+    for (uint32_t i = 0; i < SW_IO_BENCHMARK_STORM_SIZE; i++)
+      storm->clients[i] = -1;
+    if ((storm->loop = swEdgeLoopNew()) && (storm->acceptor = swTCPServerAcceptorNew())
+        && swSocketAddressInitInet(&address, "127.0.0.1", 0))
+    {
+      swTCPServerAcceptorDataSet(storm->acceptor, storm);
+      swTCPServerAcceptorSetupFuncSet(storm->acceptor, acceptStormSetupFunc);
+      swTCPServerAcceptorAcceptBatchSet(storm->acceptor, acceptBatch);
+      if (swTCPServerAcceptorStart(storm->acceptor, storm->loop, &address)
+          && !getsockname(storm->acceptor->socket.fd, (struct sockaddr *)&(storm->address), &addressSize))
+        rtn = storm;
+    }
+    if (!rtn)
+      acceptStormTeardown(storm);
+  }
+  return rtn;
+}
+
+static void acceptStormRun(swAcceptStorm *storm)
+{
+  if (storm)
+  {
+    uint32_t connected = 0;
+    for (; connected < SW_IO_BENCHMARK_STORM_SIZE; connected++)
+    {
+      int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+      if (fd < 0)
+        break;
+      storm->clients[connected] = fd;
+      if (connect(fd, (struct sockaddr *)&(storm->address), sizeof(storm->address)) && (errno != EINPROGRESS))
+        break;
+    }
+    if (connected == SW_IO_BENCHMARK_STORM_SIZE)
+      swEdgeLoopRun(storm->loop, false);
+    acceptStormClose(storm);
+  }
+}
+
+#define swAcceptStormBenchmarkDeclare(name, acceptBatch, sampleSize) \
+  static void *name##Setup() { return acceptStormSetup((acceptBatch)); } \
+  swBenchmarkDeclare(name, name##Setup, acceptStormTeardown, sampleSize) { acceptStormRun(context); }
+
+swAcceptStormBenchmarkDeclare(TCPAcceptStormBatchAll, 0,   50)
+swAcceptStormBenchmarkDeclare(TCPAcceptStormBatch16,  16,  50)
+swAcceptStormBenchmarkDeclare(TCPAcceptStormBatch1,   1,   50)
@@ -0,0 +1,69 @@
+#include "io/read-ring.h"
+
+#include "core/memory.h"
+
+#include <string.h>
+#include <unistd.h>
+
+swReadRing *swReadRingNew(uint32_t pages, bool hugePages)
+{
+  swReadRing *rtn = swMemoryMalloc(sizeof(swReadRing));
+  if (rtn && !swReadRingInit(rtn, pages, hugePages))
+  {
+    swMemoryFree(rtn);
+    rtn = NULL;
+  }
+  return rtn;
+}
+
+bool swReadRingInit(swReadRing *ring, uint32_t pages, bool hugePages)
+{
+  bool rtn = false;
+  if (ring && pages)
+  {
+    memset(ring, 0, sizeof(*ring));
+    ring->size = getpagesize() * pages;
+    if ((ring->buffer = swHugePageDoubleMap(&(ring->size), hugePages, &(ring->backing))))
+      rtn = true;
+    else
+      ring->size = 0;
+  }
+  return rtn;
+}
+
+void swReadRingRelease(swReadRing *ring)
+{
+  if (ring && ring->buffer)
+  {
+    swHugePageDoubleUnmap(ring->buffer, ring->size);
+    memset(ring, 0, sizeof(*ring));
+  }
+}
+
+void swReadRingDelete(swReadRing *ring)
+{
+  if (ring)
+  {
+    swReadRingRelease(ring);
+    swMemoryFree(ring);
+  }
+}
+
+swSocketReturnType swReadRingRead(swReadRing *ring, swSocketIO *io, ssize_t *bytesRead)
+{
+  swSocketReturnType rtn = swSocketReturnNone;
+  if (ring && ring->buffer && io)
+  {
+    swStaticBuffer view = swStaticBufferDefineEmpty;
+    ssize_t bytes = 0;
+    if (!swReadRingReserve(ring, &view))
+      rtn = swSocketReturnInvalidBuffer;
+    else if ((rtn = swSocketIORead(io, &view, &bytes)) == swSocketReturnOK)
+    {
+      swReadRingProduce(ring, bytes);
+      if (bytesRead)
+        *bytesRead = bytes;
+    }
+  }
+  return rtn;
+}
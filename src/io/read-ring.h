@@ -0,0 +1,68 @@
+#ifndef SW_IO_READRING_H
+#define SW_IO_READRING_H
+
+#include "io/socket-io.h"
+
+#include "core/huge-page.h"
+
+// per connection read buffer, the memory is mapped twice one after another like the one of
+// swMPSCRingBuffer, so both the data and the free space are always one piece no matter where
+// they wrap around; the socket reads straight into the free space and the data is looked at
+// in place, nothing is moved or copied to keep a partial message together
+
+typedef struct swReadRing
+{
+  uint8_t *buffer;
+  size_t size;
+  // offset of the first byte not consumed yet and the number of bytes after it
+  size_t head;
+  size_t used;
+  swHugePageBacking backing;
+} swReadRing;
+
+// the size is a number of pages, hugePages rounds it up to the huge page size
+swReadRing *swReadRingNew(uint32_t pages, bool hugePages);
+bool swReadRingInit(swReadRing *ring, uint32_t pages, bool hugePages);
+void swReadRingRelease(swReadRing *ring);
+void swReadRingDelete(swReadRing *ring);
+
+#define swReadRingUsedGet(r)  ((r)->used)
+#define swReadRingFreeGet(r)  ((r)->size - (r)->used)
+#define swReadRingSizeGet(r)  ((r)->size)
+
+// the view stays valid till the data is consumed, false when the ring is empty
+static inline bool swReadRingPeek(swReadRing *ring, swStaticBuffer *view)
+{
+  view->data = ring->buffer + ring->head;
+  view->len = ring->used;
+  return (ring->used != 0);
+}
+
+static inline void swReadRingConsume(swReadRing *ring, size_t size)
+{
+  if (size > ring->used)
+    size = ring->used;
+  ring->used -= size;
+  // an empty ring starts over, the next reads are less likely to cross the end of the mapping
+  ring->head = (ring->used)? ((ring->head + size) % ring->size) : 0;
+}
+
+// space for the caller to write into, followed by swReadRingProduce with the bytes written
+static inline bool swReadRingReserve(swReadRing *ring, swStaticBuffer *view)
+{
+  view->data = ring->buffer + ((ring->head + ring->used) % ring->size);
+  view->len = ring->size - ring->used;
+  return (view->len != 0);
+}
+
+static inline void swReadRingProduce(swReadRing *ring, size_t size)
+{
+  if (size > (ring->size - ring->used))
+    size = ring->size - ring->used;
+  ring->used += size;
+}
+
+// swSocketIORead into the free space, swSocketReturnInvalidBuffer when the ring is full
+swSocketReturnType swReadRingRead(swReadRing *ring, swSocketIO *io, ssize_t *bytesRead);
+
+#endif // SW_IO_READRING_H
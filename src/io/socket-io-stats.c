@@ -0,0 +1,193 @@
+#include "io/socket-io-stats.h"
+
+#include <core/memory.h>
+
+#include <string.h>
+
+#define swSocketIOStatsSocketGet(s, i)  (*swFastArrayGetExistingPtr((s)->sockets, (i), swSocketIO *))
+
+static void swSocketIOCountersAdd(swSocketIOCounters *counters, const swSocketIOCounters *other)
+{
+  counters->bytesRead += other->bytesRead;
+  counters->bytesWritten += other->bytesWritten;
+  counters->reads += other->reads;
+  counters->writes += other->writes;
+  counters->syscalls += other->syscalls;
+  counters->readNotReady += other->readNotReady;
+  counters->writeNotReady += other->writeNotReady;
+  counters->readTimeouts += other->readTimeouts;
+  counters->writeTimeouts += other->writeTimeouts;
+  counters->retransmits += other->retransmits;
+}
+
+// nothing for the sockets that are not TCP, the retransmits of a socket opened again start from 0
+static void swSocketIOStatsSocketSample(swSocketIOStats *stats, swSocketIO *io)
+{
+  swSocketTCPInfo info = {0};
+  if ((((swSocket *)io)->fd >= 0) && swSocketTCPInfoGet((swSocket *)io, &info))
+  {
+    swSocketIOCounters *counters = io->counters;
+    counters->retransmits += (info.retransmits >= counters->socketRetransmits)? (info.retransmits - counters->socketRetransmits) : info.retransmits;
+    counters->socketRetransmits = info.retransmits;
+    // no round trip measured yet while the connection is being opened
+    if (info.rtt)
+    {
+      swHistogramRecord(&(stats->rtt), info.rtt);
+      swHistogramRecord(&(stats->rttVar), info.rttVar);
+      swHistogramRecord(&(stats->cwnd), info.cwnd);
+      if (info.deliveryRate)
+        swHistogramRecord(&(stats->deliveryRate), info.deliveryRate);
+      stats->samples++;
+    }
+  }
+}
+
+static void swSocketIOStatsSampleTimerCallback(swEdgeTimer *timer, uint64_t expiredCount, uint32_t events)
+{
+  swSocketIOStats *stats = swEdgeWatcherDataGet(timer);
+  if (stats && (expiredCount > 0))
+    swSocketIOStatsSample(stats);
+}
+
+swSocketIOStats *swSocketIOStatsNew()
+{
+  swSocketIOStats *rtn = swMemoryMalloc(sizeof(swSocketIOStats));
+  if (rtn)
+  {
+    if (!swSocketIOStatsInit(rtn))
+    {
+      swMemoryFree(rtn);
+      rtn = NULL;
+    }
+  }
+  return rtn;
+}
+
+bool swSocketIOStatsInit(swSocketIOStats *stats)
+{
+  bool rtn = false;
+  if (stats)
+  {
+    memset(stats, 0, sizeof(swSocketIOStats));
+    if (swFastArrayInit(&(stats->sockets), sizeof(swSocketIO *), 0))
+    {
+      if (swEdgeTimerInit(&(stats->sampleTimer), swSocketIOStatsSampleTimerCallback, false))
+      {
+        swEdgeWatcherDataSet(&(stats->sampleTimer), stats);
+        rtn = true;
+      }
+      else
+        swFastArrayClear(&(stats->sockets));
+    }
+  }
+  return rtn;
+}
+
+void swSocketIOStatsCleanup(swSocketIOStats *stats)
+{
+  if (stats)
+  {
+    swSocketIOStatsStop(stats);
+    // the counters stay with the sockets, they are freed with them
+    uint32_t count = swFastArrayCount(stats->sockets);
+    for (uint32_t i = 0; i < count; i++)
+      swSocketIOStatsSocketGet(stats, i)->stats = NULL;
+    swEdgeTimerClose(&(stats->sampleTimer));
+    swFastArrayClear(&(stats->sockets));
+  }
+}
+
+void swSocketIOStatsDelete(swSocketIOStats *stats)
+{
+  if (stats)
+  {
+    swSocketIOStatsCleanup(stats);
+    swMemoryFree(stats);
+  }
+}
+
+bool swSocketIOStatsStart(swSocketIOStats *stats, swEdgeLoop *loop, uint64_t interval)
+{
+  bool rtn = false;
+  if (stats && !stats->loop && loop)
+  {
+    if (!interval || swEdgeTimerStart(&(stats->sampleTimer), loop, interval, interval, false))
+    {
+      stats->loop = loop;
+      stats->interval = interval;
+      rtn = true;
+    }
+  }
+  return rtn;
+}
+
+void swSocketIOStatsStop(swSocketIOStats *stats)
+{
+  if (stats && stats->loop)
+  {
+    swEdgeTimerStop(&(stats->sampleTimer));
+    stats->loop = NULL;
+  }
+}
+
+bool swSocketIOStatsAdd(swSocketIOStats *stats, swSocketIO *io)
+{
+  bool rtn = false;
+  if (stats && io && !io->stats && swSocketIOCountersSet(io, true))
+  {
+    io->statsPosition = swFastArrayCount(stats->sockets);
+    if (swFastArrayPush(stats->sockets, io))
+    {
+      io->stats = stats;
+      rtn = true;
+    }
+  }
+  return rtn;
+}
+
+void swSocketIOStatsRemove(swSocketIO *io)
+{
+  if (io && io->stats)
+  {
+    swSocketIOStats *stats = io->stats;
+    swSocketIO *moved = NULL;
+    swSocketIOCountersAdd(&(stats->removedCounters), io->counters);
+    if (swFastRemove(stats->sockets, swSocketIO *, io->statsPosition) && (io->statsPosition < swFastArrayCount(stats->sockets))
+        && swFastArrayGet(stats->sockets, io->statsPosition, moved))
+      moved->statsPosition = io->statsPosition;
+    io->stats = NULL;
+  }
+}
+
+void swSocketIOStatsSample(swSocketIOStats *stats)
+{
+  if (stats)
+  {
+    uint32_t count = swFastArrayCount(stats->sockets);
+    for (uint32_t i = 0; i < count; i++)
+      swSocketIOStatsSocketSample(stats, swSocketIOStatsSocketGet(stats, i));
+  }
+}
+
+const swSocketIOCounters *swSocketIOStatsCountersGet(swSocketIOStats *stats)
+{
+  const swSocketIOCounters *rtn = NULL;
+  if (stats)
+  {
+    uint32_t count = swFastArrayCount(stats->sockets);
+    stats->counters = stats->removedCounters;
+    for (uint32_t i = 0; i < count; i++)
+      swSocketIOCountersAdd(&(stats->counters), swSocketIOStatsSocketGet(stats, i)->counters);
+    rtn = &(stats->counters);
+  }
+  return rtn;
+}
+
+void swSocketIOStatsSocketClosing(swSocketIO *io)
+{
+  if (io && io->stats)
+  {
+    swSocketIOStatsSocketSample(io->stats, io);
+    io->counters->socketRetransmits = 0;
+  }
+}
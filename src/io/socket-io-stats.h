@@ -0,0 +1,55 @@
+#ifndef SW_IO_SOCKETIOSTATS_H
+#define SW_IO_SOCKETIOSTATS_H
+
+#include "io/socket-io.h"
+
+#include "collections/fast-array.h"
+
+// transport stats of a group of connections: the counters of the sockets added are summed into
+// one set and the TCP ones are sampled with TCP_INFO every interval by a timer of the loop, the
+// samples of all of them go to the same histograms; every socket is sampled once more when it
+// closes, so the short connections are not missed; a socket leaves the stats when it is removed
+// or cleaned up, its counters stay in the totals
+
+struct swSocketIOStats
+{
+  swEdgeLoop *loop;
+  swEdgeTimer sampleTimer;
+  // swSocketIO pointers
+  swFastArray sockets;
+  // counters of the sockets that left, swSocketIOStatsCountersGet adds the others to them
+  swSocketIOCounters removedCounters;
+  swSocketIOCounters counters;
+  // rtt and rttvar in microseconds, cwnd in segments, delivery rate in bytes per second
+  swHistogram rtt;
+  swHistogram rttVar;
+  swHistogram cwnd;
+  swHistogram deliveryRate;
+  uint64_t samples;
+  // milliseconds
+  uint64_t interval;
+};
+
+swSocketIOStats *swSocketIOStatsNew();
+bool swSocketIOStatsInit(swSocketIOStats *stats);
+void swSocketIOStatsCleanup(swSocketIOStats *stats);
+void swSocketIOStatsDelete(swSocketIOStats *stats);
+
+// samples the sockets every interval milliseconds, 0 for the counters and the close samples only
+bool swSocketIOStatsStart(swSocketIOStats *stats, swEdgeLoop *loop, uint64_t interval);
+void swSocketIOStatsStop(swSocketIOStats *stats);
+
+// turns the counters of the socket on, a socket is in one stats at a time; the sockets of
+// a stats are used by the loop of the stats only
+bool swSocketIOStatsAdd(swSocketIOStats *stats, swSocketIO *io);
+void swSocketIOStatsRemove(swSocketIO *io);
+
+// TCP_INFO of all the sockets now, the timer calls it every interval
+void swSocketIOStatsSample(swSocketIOStats *stats);
+// sum of the counters of the sockets in the stats and the ones that left
+const swSocketIOCounters *swSocketIOStatsCountersGet(swSocketIOStats *stats);
+
+// the last sample of a socket, called by swSocketIOClose before the socket is closed
+void swSocketIOStatsSocketClosing(swSocketIO *io);
+
+#endif  // SW_IO_SOCKETIOSTATS_H
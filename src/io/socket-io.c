@@ -1,6 +1,21 @@
 #include "io/socket-io.h"
+#include "io/socket-io-stats.h"
 
+#include <core/clock.h>
 #include <core/memory.h>
+#include <core/time.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+
+#define SW_SOCKETIO_OUTPUT_QUEUE_INITIAL_SIZE  16
+// the most sendfile and splice move in one call
+#define SW_SOCKETIO_SEND_FILE_MAX              0x7ffff000
+// buffers in one sendmsg of the flush, a 1K vector on the stack instead of IOV_MAX (16K)
+#define SW_SOCKETIO_FLUSH_BATCH                64
 
 static const char const *swSocketIOErrorText[swSocketIOErrorMax] =
 {
@@ -32,6 +47,53 @@ static inline void swSocketIOSocketCleanup(swSocketIO *io)
   swSocketClose(sock);
 }
 
+static void swSocketIOFileSendDone(swSocketIO *io, bool complete)
+{
+  swSocketIOFileSend *fileSend = &(io->fileSend);
+  int fd = fileSend->fd;
+  size_t sent = fileSend->sent;
+  swEdgeIOStop(&(io->fileSendEvent));
+  memset(fileSend, 0, sizeof(*fileSend));
+  fileSend->fd = -1;
+  if (io->fileSentFunc)
+    io->fileSentFunc(io, fd, sent, complete);
+}
+
+// the buffers not written yet are handed back when the socket closes, after the completions
+// queued till then were read; the zero copy sends left can still be reading their buffers
+static void swSocketIOOutputQueueDrop(swSocketIO *io)
+{
+  swSocketIOOutputQueue *queue = &(io->outputQueue);
+  swSocketIOZeroCopyQueue *zeroCopy = &(io->zeroCopy);
+  while (zeroCopy->count)
+  {
+    swStaticBuffer *buffer = zeroCopy->entries[zeroCopy->head].buffer;
+    zeroCopy->head = (zeroCopy->head + 1) & (zeroCopy->size - 1);
+    zeroCopy->count--;
+    if (io->bufferReleaseFunc)
+      io->bufferReleaseFunc(io, buffer, swSocketIOBufferInFlight);
+  }
+  while (queue->count)
+  {
+    swStaticBuffer *buffer = queue->buffers[queue->head];
+    // the first buffer can be partly sent by a zero copy send that did not complete
+    bool inFlight = zeroCopy->headPending && ((int32_t)(zeroCopy->headSend - zeroCopy->completed) >= 0);
+    zeroCopy->headPending = false;
+    queue->head = (queue->head + 1) & (queue->size - 1);
+    queue->count--;
+    if (io->bufferReleaseFunc)
+      io->bufferReleaseFunc(io, buffer, (inFlight? swSocketIOBufferInFlight : swSocketIOBufferNotWritten));
+  }
+  queue->head = 0;
+  queue->offset = 0;
+  queue->bytes = 0;
+  io->aboveHighWatermark = false;
+  zeroCopy->head = zeroCopy->nextSend = zeroCopy->completed = 0;
+  zeroCopy->headPending = false;
+}
+
+static void swSocketIOErrorQueueDrain(swSocketIO *io);
+
 void swSocketIOClose(swSocketIO *io, swSocketIOErrorType errorCode)
 {
   if (io)
@@ -45,7 +107,17 @@ void swSocketIOClose(swSocketIO *io, swSocketIOErrorType errorCode)
       swEdgeIOStop(&(io->ioEvent));
       swEdgeTimerStop(&(io->readTimer));
       swEdgeTimerStop(&(io->writeTimer));
+      io->readDeadline = io->writeDeadline = 0;
+      // the last TCP_INFO of the socket before it is gone
+      if (io->stats)
+        swSocketIOStatsSocketClosing(io);
+      // the completions are gone with the socket, the sends that did complete are written
+      if (io->zeroCopy.count || io->zeroCopy.headPending)
+        swSocketIOErrorQueueDrain(io);
       io->socketCleanupFunc(io);
+      swSocketIOOutputQueueDrop(io);
+      if (io->fileSend.active)
+        swSocketIOFileSendDone(io, false);
       if (io->closeFunc)
         io->closeFunc(io);
     }
@@ -54,18 +126,41 @@ void swSocketIOClose(swSocketIO *io, swSocketIOErrorType errorCode)
   }
 }
 
+// called when a timeout timer fires: true when the deadline passed, otherwise the timer is moved
+// to the deadline, or stopped when the socket became ready in the meantime
+static bool swSocketIODeadlineCheck(swSocketIO *io, swEdgeTimer *timer, uint64_t *deadline)
+{
+  bool rtn = false;
+  uint64_t now = swEdgeLoopNow(io->loop);
+  if (*deadline && (now < *deadline))
+  {
+    if (!swEdgeTimerStart(timer, io->loop, swTimeNSecToMSec(*deadline - now) + 1, 0, false))
+      swSocketIOClose(io, swSocketIOErrorOtherError);
+  }
+  else
+  {
+    rtn = (*deadline != 0);
+    *deadline = 0;
+    swEdgeTimerStop(timer);
+  }
+  return rtn;
+}
+
 static void swSocketIOReadTimerCallback(swEdgeTimer *timer, uint64_t expiredCount, uint32_t events)
 {
   swSocketIO *io = swEdgeWatcherDataGet(timer);
   if (io && (((swSocket*)io)->fd >= 0))
   {
-    if ((expiredCount > 0) && (events & swEdgeEventRead))
+    if ((expiredCount > 0) && (events & swEdgeEventRead) && swSocketIODeadlineCheck(io, timer, &(io->readDeadline)))
     {
       bool rtn = false;
+      swSocketIOCount(io, readTimeouts);
       if (io->readTimeoutFunc)
         rtn = io->readTimeoutFunc(io);
       if (!rtn)
         swSocketIOClose(io, swSocketIOErrorReadTimeout);
+      else if ((((swSocket*)io)->fd >= 0) && !swSocketIOReadTimerStart(io))
+        swSocketIOClose(io, swSocketIOErrorOtherError);
     }
   }
 }
@@ -75,36 +170,84 @@ static void swSocketIOWriteTimerCallback(swEdgeTimer *timer, uint64_t expiredCou
   swSocketIO *io = swEdgeWatcherDataGet(timer);
   if (io && (((swSocket*)io)->fd >= 0))
   {
-    if (expiredCount > 0 && (events & swEdgeEventRead))
+    if (expiredCount > 0 && (events & swEdgeEventRead) && swSocketIODeadlineCheck(io, timer, &(io->writeDeadline)))
     {
       bool rtn = false;
+      swSocketIOCount(io, writeTimeouts);
       if (io->writeTimeoutFunc)
         rtn = io->writeTimeoutFunc(io);
       if (!rtn)
         swSocketIOClose(io, swSocketIOErrorWriteTimeout);
+      else if ((((swSocket*)io)->fd >= 0) && !swSocketIOWriteTimerStart(io))
+        swSocketIOClose(io, swSocketIOErrorOtherError);
     }
   }
 }
 
+static swSocketReturnType swSocketIOFileSendContinue(swSocketIO *io);
+
+// more data in the pipe sent, or its write end closed; a send waiting for the socket is picked
+// up by the write event instead
+static void swSocketIOFileSendEventCallback(swEdgeIO *ioWatcher, uint32_t events)
+{
+  swSocketIO *io = swEdgeWatcherDataGet(ioWatcher);
+  if (io && io->fileSend.active && !io->writeDeadline && (((swSocket*)io)->fd >= 0))
+    swSocketIOFileSendContinue(io);
+}
+
+// taken before the send, the kernel stamps the data before the send call returns on loopback
+static inline uint64_t swSocketIOTimestampSendTime(swSocketIO *io)
+{
+  return (io->timestamps && io->timestamps->send)? swClockRealtimeNow() : 0;
+}
+
+// the time of a datagram sent, its timestamp comes later with the same number
+static inline void swSocketIOTimestampSent(swSocketIO *io, uint64_t sendTime)
+{
+  swSocketIOTimestamps *timestamps = io->timestamps;
+  if (timestamps && timestamps->send)
+    timestamps->sendTimes[(timestamps->sends++) & (SW_SOCKETIO_TIMESTAMP_SENDS - 1)] = sendTime;
+}
+
 static void swSocketIOIOEventCallback(swEdgeIO *ioWatcher, uint32_t events)
 {
   swSocketIO *io = swEdgeWatcherDataGet(ioWatcher);
   if (io && (((swSocket*)io)->fd >= 0))
   {
+    if ((events & swEdgeEventError) && (io->zeroCopyThreshold || io->zeroCopy.count || (io->timestamps && io->timestamps->send)))
+    {
+      int error = 0;
+      swSocketIOErrorQueueDrain(io);
+      // the completions and the timestamps in the error queue raise the error event too, only a
+      // socket error is fatal
+      if (swSocketIsConnected((swSocket *)io, &error))
+        events &= ~swEdgeEventError;
+    }
+    if (io->hangUpRead && ((events & (swEdgeEventError | swEdgeEventHungUp)) == swEdgeEventHungUp))
+      events = (events & ~swEdgeEventHungUp) | swEdgeEventRead;
     if (!(events & (swEdgeEventError | swEdgeEventHungUp)))
     {
       io->insideIOEventCallback = true;
+      // the timers are left running, they stop themselves when they find no deadline
       if (events & swEdgeEventRead)
       {
-        swEdgeTimerStop(&(io->readTimer));
+        io->readDeadline = 0;
         if (io->readReadyFunc)
           io->readReadyFunc(io);
       }
       if ((io->lastError == swSocketIOErrorNone) && (events & swEdgeEventWrite))
       {
-        swEdgeTimerStop(&(io->writeTimer));
-        if (io->writeReadyFunc)
-          io->writeReadyFunc(io);
+        io->writeDeadline = 0;
+        // the queued buffers go out first, the writer is asked for more once they are all written,
+        // unless the socket was writable all along and the event only flushed them
+        if ((!io->outputQueue.count || (swSocketIOFlush(io, NULL) == swSocketReturnOK))
+            && (!io->fileSend.active || (swSocketIOFileSendContinue(io) == swSocketReturnOK)))
+        {
+          bool writeReady = !io->flushQueued;
+          io->flushQueued = false;
+          if (writeReady && io->writeReadyFunc)
+            io->writeReadyFunc(io);
+        }
       }
       io->insideIOEventCallback = false;
       if (io->lastError > swSocketIOErrorNone)
@@ -141,11 +284,13 @@ bool swSocketIOInit(swSocketIO *io)
       if (swEdgeTimerInit(&(io->writeTimer), swSocketIOWriteTimerCallback, false))
       {
         swEdgeWatcherDataSet(&(io->writeTimer), io);
-        if (swEdgeIOInit(&(io->ioEvent), swSocketIOIOEventCallback))
+        if (swEdgeIOInit(&(io->ioEvent), swSocketIOIOEventCallback) && swEdgeIOInit(&(io->fileSendEvent), swSocketIOFileSendEventCallback))
         {
           swEdgeWatcherDataSet(&(io->ioEvent), io);
+          swEdgeWatcherDataSet(&(io->fileSendEvent), io);
           io->readTimeout = io->writeTimeout = SW_SOCKETIO_DEFAULT_TIMEOUT;
           io->socketCleanupFunc = swSocketIOSocketCleanup;
+          io->fileSend.fd = -1;
           rtn = true;
         }
       }
@@ -162,8 +307,18 @@ void swSocketIOCleanup(swSocketIO *io)
     if (((swSocket*)io)->fd >= 0)
       swSocketIOClose(io, swSocketIOErrorNone);
     swEdgeIOClose(&(io->ioEvent));
+    swEdgeIOClose(&(io->fileSendEvent));
     swEdgeTimerClose(&(io->writeTimer));
     swEdgeTimerClose(&(io->readTimer));
+    swMemoryFree(io->outputQueue.buffers);
+    memset(&(io->outputQueue), 0, sizeof(io->outputQueue));
+    swMemoryFree(io->zeroCopy.entries);
+    memset(&(io->zeroCopy), 0, sizeof(io->zeroCopy));
+    swMemoryFree(io->timestamps);
+    io->timestamps = NULL;
+    swSocketIOStatsRemove(io);
+    swMemoryFree(io->counters);
+    io->counters = NULL;
     io->cleaning = false;
   }
 }
@@ -187,22 +342,56 @@ bool swSocketIOStart(swSocketIO *io, swEdgeLoop *loop)
     if (swEdgeIOStart(&(io->ioEvent), loop, ((swSocket *)io)->fd, (swEdgeEventRead | swEdgeEventWrite)))
     {
       io->loop = loop;
+      // best effort, the socket works the same without it
+      if (loop->socketBusyPoll)
+        swSocketBusyPollSet((swSocket *)io, loop->socketBusyPoll, loop->socketPreferBusyPoll);
       rtn = true;
     }
   }
   return rtn;
 }
 
+static inline bool swSocketIOTimerStart(swSocketIO *io, swEdgeTimer *timer, uint64_t *deadline, uint64_t timeout)
+{
+  bool rtn = false;
+  if (timeout)
+  {
+    *deadline = swEdgeLoopNow(io->loop) + swTimeMSecToNSec(timeout);
+    // a running timer fires at or before the new deadline and moves itself
+    rtn = (((swEdgeWatcher *)timer)->loop == io->loop) || swEdgeTimerStart(timer, io->loop, timeout, 0, false);
+  }
+  return rtn;
+}
+
+bool swSocketIOReadTimerStart(swSocketIO *io)
+{
+  return io && swSocketIOTimerStart(io, &(io->readTimer), &(io->readDeadline), io->readTimeout);
+}
+
+bool swSocketIOWriteTimerStart(swSocketIO *io)
+{
+  return io && swSocketIOTimerStart(io, &(io->writeTimer), &(io->writeDeadline), io->writeTimeout);
+}
+
 swSocketReturnType swSocketIORead(swSocketIO *io, swStaticBuffer *buffer, ssize_t *bytesRead)
 {
   swSocketReturnType rtn = swSocketReturnNone;
   if (io)
   {
-    if ((rtn = swSocketReceive((swSocket *)io, buffer, bytesRead)) == swSocketReturnOK)
-      swEdgeWatcherPendingSet((swEdgeWatcher *)&(io->ioEvent), swEdgeEventRead);
+    ssize_t bytes = 0;
+    swSocketIOCount(io, reads);
+    if (swSocketIOBudgetExhausted(io, swEdgeEventRead))
+      rtn = swSocketReturnNotReady;
+    else if ((rtn = swSocketIOReadCount(io, swSocketReceive((swSocket *)io, buffer, &bytes), &bytes)) == swSocketReturnOK)
+    {
+      io->budgetUsed += bytes;
+      if (bytesRead)
+        *bytesRead = bytes;
+      swSocketIOReadyQueue(io, swEdgeEventRead);
+    }
     else if (rtn == swSocketReturnNotReady)
     {
-      if (!swEdgeTimerStart(&(io->readTimer), io->loop, io->readTimeout, io->readTimeout, false))
+      if (!swSocketIOReadTimerStart(io))
         swSocketIOClose(io, swSocketIOErrorOtherError);
     }
     else
@@ -216,11 +405,22 @@ swSocketReturnType swSocketIOWrite(swSocketIO *io, swStaticBuffer *buffer, ssize
   swSocketReturnType rtn = swSocketReturnNone;
   if (io)
   {
-    if ((rtn = swSocketSend((swSocket *)io, buffer, bytesWritten)) == swSocketReturnOK)
-      swEdgeWatcherPendingSet((swEdgeWatcher *)&(io->ioEvent), swEdgeEventWrite);
+    ssize_t bytes = 0;
+    uint64_t sendTime = swSocketIOTimestampSendTime(io);
+    swSocketIOCount(io, writes);
+    if (swSocketIOBudgetExhausted(io, swEdgeEventWrite))
+      rtn = swSocketReturnNotReady;
+    else if ((rtn = swSocketIOWriteCount(io, swSocketSend((swSocket *)io, buffer, &bytes), &bytes)) == swSocketReturnOK)
+    {
+      swSocketIOTimestampSent(io, sendTime);
+      io->budgetUsed += bytes;
+      if (bytesWritten)
+        *bytesWritten = bytes;
+      swSocketIOReadyQueue(io, swEdgeEventWrite);
+    }
     else if (rtn == swSocketReturnNotReady)
     {
-      if (!swEdgeTimerStart(&(io->writeTimer), io->loop, io->writeTimeout, io->writeTimeout, false))
+      if (!swSocketIOWriteTimerStart(io))
         swSocketIOClose(io, swSocketIOErrorOtherError);
     }
     else
@@ -234,11 +434,68 @@ swSocketReturnType swSocketIOReadFrom(swSocketIO *io, swStaticBuffer *buffer, sw
   swSocketReturnType rtn = swSocketReturnNone;
   if (io)
   {
-    if ((rtn = swSocketReceiveFrom((swSocket *)io, buffer, address, bytesRead)) == swSocketReturnOK)
-      swEdgeWatcherPendingSet((swEdgeWatcher *)&(io->ioEvent), swEdgeEventRead);
+    ssize_t bytes = 0;
+    swSocketIOCount(io, reads);
+    if (swSocketIOBudgetExhausted(io, swEdgeEventRead))
+      rtn = swSocketReturnNotReady;
+    else if ((rtn = swSocketIOReadCount(io, swSocketReceiveFrom((swSocket *)io, buffer, address, &bytes), &bytes)) == swSocketReturnOK)
+    {
+      io->budgetUsed += bytes;
+      if (bytesRead)
+        *bytesRead = bytes;
+      swSocketIOReadyQueue(io, swEdgeEventRead);
+    }
+    else if (rtn == swSocketReturnNotReady)
+    {
+      if (!swSocketIOReadTimerStart(io))
+        swSocketIOClose(io, swSocketIOErrorOtherError);
+    }
+    else
+      swSocketIOClose(io, ((rtn == swSocketReturnClose)? swSocketIOErrorSocketClose : swSocketIOErrorSocketError));
+  }
+  return rtn;
+}
+
+// the receive timestamp splits the time till the read into the part before the loop woke up
+// and the part after it, data that arrived while the loop was already running has only the latter
+static void swSocketIOTimestampReceived(swSocketIO *io, swSocketReceiveInfo *info)
+{
+  swSocketIOTimestamps *timestamps = io->timestamps;
+  uint64_t received = (info->softwareTime)? info->softwareTime : info->hardwareTime;
+  if (received)
+  {
+    uint64_t wakeUp = swClockCachedRealtimeGet();
+    uint64_t now = swClockRealtimeNow();
+    uint64_t start = (wakeUp > received)? wakeUp : received;
+    swHistogramRecord(&(timestamps->kernelLatency), start - received);
+    swHistogramRecord(&(timestamps->loopLatency), (now > start)? (now - start) : 0);
+  }
+}
+
+swSocketReturnType swSocketIOReadWithInfo(swSocketIO *io, swStaticBuffer *buffer, swSocketAddress *address, ssize_t *bytesRead, swSocketReceiveInfo *info)
+{
+  swSocketReturnType rtn = swSocketReturnNone;
+  if (io)
+  {
+    swSocketReceiveInfo localInfo;
+    ssize_t bytes = 0;
+    if (!info)
+      info = &localInfo;
+    swSocketIOCount(io, reads);
+    if (swSocketIOBudgetExhausted(io, swEdgeEventRead))
+      rtn = swSocketReturnNotReady;
+    else if ((rtn = swSocketIOReadCount(io, swSocketReceiveWithInfo((swSocket *)io, buffer, address, &bytes, info), &bytes)) == swSocketReturnOK)
+    {
+      if (io->timestamps && io->timestamps->receive)
+        swSocketIOTimestampReceived(io, info);
+      io->budgetUsed += bytes;
+      if (bytesRead)
+        *bytesRead = bytes;
+      swSocketIOReadyQueue(io, swEdgeEventRead);
+    }
     else if (rtn == swSocketReturnNotReady)
     {
-      if (!swEdgeTimerStart(&(io->readTimer), io->loop, io->readTimeout, io->readTimeout, false))
+      if (!swSocketIOReadTimerStart(io))
         swSocketIOClose(io, swSocketIOErrorOtherError);
     }
     else
@@ -252,11 +509,22 @@ swSocketReturnType swSocketIOWriteTo(swSocketIO *io, swStaticBuffer *buffer, swS
   swSocketReturnType rtn = swSocketReturnNone;
   if (io)
   {
-    if ((rtn = swSocketSendTo((swSocket *)io, buffer, address, bytesWritten)) == swSocketReturnOK)
-      swEdgeWatcherPendingSet((swEdgeWatcher *)&(io->ioEvent), swEdgeEventWrite);
+    ssize_t bytes = 0;
+    uint64_t sendTime = swSocketIOTimestampSendTime(io);
+    swSocketIOCount(io, writes);
+    if (swSocketIOBudgetExhausted(io, swEdgeEventWrite))
+      rtn = swSocketReturnNotReady;
+    else if ((rtn = swSocketIOWriteCount(io, swSocketSendTo((swSocket *)io, buffer, address, &bytes), &bytes)) == swSocketReturnOK)
+    {
+      swSocketIOTimestampSent(io, sendTime);
+      io->budgetUsed += bytes;
+      if (bytesWritten)
+        *bytesWritten = bytes;
+      swSocketIOReadyQueue(io, swEdgeEventWrite);
+    }
     else if (rtn == swSocketReturnNotReady)
     {
-      if (!swEdgeTimerStart(&(io->writeTimer), io->loop, io->writeTimeout, io->writeTimeout, false))
+      if (!swSocketIOWriteTimerStart(io))
         swSocketIOClose(io, swSocketIOErrorOtherError);
     }
     else
@@ -270,11 +538,20 @@ swSocketReturnType swSocketIOReadSplice  (swSocketIO *io, int pipefd[2], size_t
   swSocketReturnType rtn = swSocketReturnNone;
   if (io)
   {
-    if ((rtn = swSocketReadSplice((swSocket *)io, pipefd, len, bytesRead)) == swSocketReturnOK)
-      swEdgeWatcherPendingSet((swEdgeWatcher *)&(io->ioEvent), swEdgeEventRead);
+    ssize_t bytes = 0;
+    swSocketIOCount(io, reads);
+    if (swSocketIOBudgetExhausted(io, swEdgeEventRead))
+      rtn = swSocketReturnNotReady;
+    else if ((rtn = swSocketIOReadCount(io, swSocketReadSplice((swSocket *)io, pipefd, len, &bytes), &bytes)) == swSocketReturnOK)
+    {
+      io->budgetUsed += bytes;
+      if (bytesRead)
+        *bytesRead = bytes;
+      swSocketIOReadyQueue(io, swEdgeEventRead);
+    }
     else if (rtn == swSocketReturnNotReady)
     {
-      if (!swEdgeTimerStart(&(io->readTimer), io->loop, io->readTimeout, io->readTimeout, false))
+      if (!swSocketIOReadTimerStart(io))
         swSocketIOClose(io, swSocketIOErrorOtherError);
     }
     else
@@ -289,11 +566,20 @@ swSocketReturnType swSocketIOWriteSplice (swSocketIO *io, int pipefd[2], size_t
   swSocketReturnType rtn = swSocketReturnNone;
   if (io)
   {
-    if ((rtn = swSocketWriteSplice((swSocket *)io, pipefd, len, bytesWritten)) == swSocketReturnOK)
-      swEdgeWatcherPendingSet((swEdgeWatcher *)&(io->ioEvent), swEdgeEventWrite);
+    ssize_t bytes = 0;
+    swSocketIOCount(io, writes);
+    if (swSocketIOBudgetExhausted(io, swEdgeEventWrite))
+      rtn = swSocketReturnNotReady;
+    else if ((rtn = swSocketIOWriteCount(io, swSocketWriteSplice((swSocket *)io, pipefd, len, &bytes), &bytes)) == swSocketReturnOK)
+    {
+      io->budgetUsed += bytes;
+      if (bytesWritten)
+        *bytesWritten = bytes;
+      swSocketIOReadyQueue(io, swEdgeEventWrite);
+    }
     else if (rtn == swSocketReturnNotReady)
     {
-      if (!swEdgeTimerStart(&(io->writeTimer), io->loop, io->writeTimeout, io->writeTimeout, false))
+      if (!swSocketIOWriteTimerStart(io))
         swSocketIOClose(io, swSocketIOErrorOtherError);
     }
     else
@@ -301,3 +587,410 @@ swSocketReturnType swSocketIOWriteSplice (swSocketIO *io, int pipefd[2], size_t
   }
   return rtn;
 }
+
+// the ring size is a power of 2, the buffers are moved to the start of the new one
+static bool swSocketIOOutputQueueGrow(swSocketIOOutputQueue *queue)
+{
+  bool rtn = false;
+  uint32_t size = (queue->size)? (queue->size << 1) : SW_SOCKETIO_OUTPUT_QUEUE_INITIAL_SIZE;
+  swStaticBuffer **buffers = swMemoryMalloc(size * sizeof(swStaticBuffer *));
+  if (buffers)
+  {
+    for (uint32_t i = 0; i < queue->count; i++)
+      buffers[i] = queue->buffers[(queue->head + i) & (queue->size - 1)];
+    swMemoryFree(queue->buffers);
+    queue->buffers = buffers;
+    queue->size = size;
+    queue->head = 0;
+    rtn = true;
+  }
+  return rtn;
+}
+
+bool swSocketIOQueueWrite(swSocketIO *io, swStaticBuffer *buffer)
+{
+  bool rtn = false;
+  if (io && buffer && buffer->data && buffer->len && (((swSocket *)io)->fd >= 0))
+  {
+    swSocketIOOutputQueue *queue = &(io->outputQueue);
+    if ((queue->count < queue->size) || swSocketIOOutputQueueGrow(queue))
+    {
+      queue->buffers[(queue->head + queue->count) & (queue->size - 1)] = buffer;
+      queue->count++;
+      queue->bytes += buffer->len;
+      // everything queued in this iteration goes out with one flush at the start of the next one;
+      // a writer waiting for the socket still gets the write ready call after it
+      if (queue->count == 1)
+      {
+        if (!io->writeDeadline)
+          io->flushQueued = true;
+        swEdgeWatcherPendingSet((swEdgeWatcher *)&(io->ioEvent), swEdgeEventWrite);
+      }
+      if (io->highWatermark && !io->aboveHighWatermark && (queue->bytes >= io->highWatermark))
+      {
+        io->aboveHighWatermark = true;
+        if (io->highWatermarkFunc)
+          io->highWatermarkFunc(io);
+      }
+      rtn = true;
+    }
+  }
+  return rtn;
+}
+
+// room for count more buffers waiting for their zero copy sends to complete
+static bool swSocketIOZeroCopyReserve(swSocketIOZeroCopyQueue *zeroCopy, uint32_t count)
+{
+  bool rtn = true;
+  if ((zeroCopy->count + count) > zeroCopy->size)
+  {
+    uint32_t size = (zeroCopy->size)? zeroCopy->size : SW_SOCKETIO_OUTPUT_QUEUE_INITIAL_SIZE;
+    while (size < (zeroCopy->count + count))
+      size <<= 1;
+    swSocketIOZeroCopyEntry *entries = swMemoryMalloc(size * sizeof(swSocketIOZeroCopyEntry));
+    if (entries)
+    {
+      for (uint32_t i = 0; i < zeroCopy->count; i++)
+        entries[i] = zeroCopy->entries[(zeroCopy->head + i) & (zeroCopy->size - 1)];
+      swMemoryFree(zeroCopy->entries);
+      zeroCopy->entries = entries;
+      zeroCopy->size = size;
+      zeroCopy->head = 0;
+    }
+    else
+      rtn = false;
+  }
+  return rtn;
+}
+
+// releases the buffers of the completed zero copy sends and records the send timestamps
+static void swSocketIOErrorQueueDrain(swSocketIO *io)
+{
+  swSocketIOZeroCopyQueue *zeroCopy = &(io->zeroCopy);
+  swSocketIOTimestamps *timestamps = io->timestamps;
+  swSocketErrorQueueEntry entry;
+  while (swSocketErrorQueueReceive((swSocket *)io, &entry) == swSocketReturnOK)
+  {
+    if (entry.type == swSocketErrorQueueZeroCopy)
+    {
+      io->zeroCopyCompletions += entry.last - entry.first + 1;
+      if (entry.copied)
+        io->zeroCopyCopied += entry.last - entry.first + 1;
+      if ((int32_t)(entry.last + 1 - zeroCopy->completed) > 0)
+        zeroCopy->completed = entry.last + 1;
+    }
+    else if ((entry.type == swSocketErrorQueueTimestamp) && timestamps && entry.time)
+    {
+      // the slot of the send is taken by a later one once the timestamps fall too far behind
+      if ((uint32_t)(timestamps->sends - entry.id) <= SW_SOCKETIO_TIMESTAMP_SENDS)
+      {
+        uint64_t sent = timestamps->sendTimes[entry.id & (SW_SOCKETIO_TIMESTAMP_SENDS - 1)];
+        swHistogramRecord(&(timestamps->sendLatency), (entry.time > sent)? (entry.time - sent) : 0);
+      }
+      else
+        timestamps->sendsMissed++;
+    }
+  }
+  while (zeroCopy->count && ((int32_t)(zeroCopy->entries[zeroCopy->head].send - zeroCopy->completed) < 0))
+  {
+    swStaticBuffer *buffer = zeroCopy->entries[zeroCopy->head].buffer;
+    zeroCopy->head = (zeroCopy->head + 1) & (zeroCopy->size - 1);
+    zeroCopy->count--;
+    if (io->bufferReleaseFunc)
+      io->bufferReleaseFunc(io, buffer, swSocketIOBufferWritten);
+  }
+}
+
+// releases the buffers covered by the bytes written, the ones a zero copy send took a part of
+// wait for its completion; the room for them is reserved before the send
+static void swSocketIOOutputQueueConsume(swSocketIO *io, size_t bytes, bool zeroCopy, uint32_t send)
+{
+  swSocketIOOutputQueue *queue = &(io->outputQueue);
+  swSocketIOZeroCopyQueue *zeroCopyQueue = &(io->zeroCopy);
+  queue->bytes -= bytes;
+  while (bytes && queue->count)
+  {
+    swStaticBuffer *buffer = queue->buffers[queue->head];
+    size_t left = buffer->len - queue->offset;
+    if (bytes >= left)
+    {
+      bytes -= left;
+      queue->offset = 0;
+      queue->head = (queue->head + 1) & (queue->size - 1);
+      queue->count--;
+      if (zeroCopy || zeroCopyQueue->headPending)
+      {
+        swSocketIOZeroCopyEntry *entry = &(zeroCopyQueue->entries[(zeroCopyQueue->head + zeroCopyQueue->count) & (zeroCopyQueue->size - 1)]);
+        entry->buffer = buffer;
+        entry->send = (zeroCopy)? send : zeroCopyQueue->headSend;
+        zeroCopyQueue->count++;
+        zeroCopyQueue->headPending = false;
+      }
+      else if (io->bufferReleaseFunc)
+        io->bufferReleaseFunc(io, buffer, swSocketIOBufferWritten);
+    }
+    else
+    {
+      queue->offset += bytes;
+      bytes = 0;
+      if (zeroCopy)
+      {
+        zeroCopyQueue->headPending = true;
+        zeroCopyQueue->headSend = send;
+      }
+    }
+  }
+  if (io->aboveHighWatermark && (queue->bytes <= io->lowWatermark))
+  {
+    io->aboveHighWatermark = false;
+    if (io->lowWatermarkFunc)
+      io->lowWatermarkFunc(io);
+  }
+}
+
+swSocketReturnType swSocketIOFlush(swSocketIO *io, ssize_t *bytesWritten)
+{
+  swSocketReturnType rtn = swSocketReturnNone;
+  if (io)
+  {
+    swSocketIOOutputQueue *queue = &(io->outputQueue);
+    ssize_t total = 0;
+    bool zeroCopyAllowed = (io->zeroCopyThreshold != 0);
+    rtn = swSocketReturnOK;
+    swSocketIOCount(io, writes);
+    while (queue->count && (((swSocket *)io)->fd >= 0))
+    {
+      bool zeroCopy = false;
+      struct iovec vector[SW_SOCKETIO_FLUSH_BATCH];
+      int count = 0;
+      size_t requested = 0;
+      size_t offset = queue->offset;
+      ssize_t bytes = 0;
+      if (swSocketIOBudgetExhausted(io, swEdgeEventWrite))
+      {
+        rtn = swSocketReturnNotReady;
+        break;
+      }
+      for (uint32_t i = 0; (i < queue->count) && (count < SW_SOCKETIO_FLUSH_BATCH); i++, count++)
+      {
+        swStaticBuffer *buffer = queue->buffers[(queue->head + i) & (queue->size - 1)];
+        vector[count].iov_base = buffer->data + offset;
+        vector[count].iov_len = buffer->len - offset;
+        requested += vector[count].iov_len;
+        offset = 0;
+      }
+      // the buffers of a zero copy send need a place to wait for the completion
+      zeroCopy = zeroCopyAllowed && (requested >= io->zeroCopyThreshold) && swSocketIOZeroCopyReserve(&(io->zeroCopy), count);
+      if (!zeroCopy && io->zeroCopy.headPending && !swSocketIOZeroCopyReserve(&(io->zeroCopy), 1))
+      {
+        rtn = swSocketReturnError;
+        swSocketIOClose(io, swSocketIOErrorOtherError);
+        break;
+      }
+      uint64_t sendTime = swSocketIOTimestampSendTime(io);
+      if ((rtn = swSocketIOWriteCount(io, swSocketSendVector((swSocket *)io, vector, count, (zeroCopy? MSG_ZEROCOPY : 0), &bytes), &bytes)) == swSocketReturnOK)
+      {
+        swSocketIOTimestampSent(io, sendTime);
+        uint32_t send = 0;
+        if (zeroCopy)
+        {
+          send = io->zeroCopy.nextSend++;
+          io->zeroCopySends++;
+        }
+        io->budgetUsed += bytes;
+        total += bytes;
+        swSocketIOOutputQueueConsume(io, bytes, zeroCopy, send);
+        // a short write means the socket buffer is full, the write event comes when there is room
+        if ((size_t)bytes < requested)
+          rtn = swSocketReturnNotReady;
+      }
+      if (rtn == swSocketReturnNotReady)
+      {
+        // the writer is asked for more once the socket drains the rest
+        io->flushQueued = false;
+        if (!swSocketIOWriteTimerStart(io))
+          swSocketIOClose(io, swSocketIOErrorOtherError);
+        break;
+      }
+      else if ((rtn == swSocketReturnError) && zeroCopy && (errno == ENOBUFS))
+      {
+        // out of the memory for pinning the pages (net.core.optmem_max), the rest goes out copied
+        zeroCopyAllowed = false;
+        rtn = swSocketReturnOK;
+      }
+      else if (rtn != swSocketReturnOK)
+      {
+        swSocketIOClose(io, swSocketIOErrorSocketError);
+        break;
+      }
+    }
+    if (bytesWritten)
+      *bytesWritten = total;
+  }
+  return rtn;
+}
+
+bool swSocketIOZeroCopySet(swSocketIO *io, size_t threshold)
+{
+  bool rtn = false;
+  if (io)
+  {
+    // the buffers already sent still get their completions
+    if (!threshold || swSocketZeroCopySet((swSocket *)io, true))
+    {
+      io->zeroCopyThreshold = threshold;
+      rtn = true;
+    }
+  }
+  return rtn;
+}
+
+// splice does not tell whether the pipe or the socket was not ready; the pipe is empty when
+// it has nothing to read, otherwise the splice is tried once more with the data already there
+static swSocketReturnType swSocketIOFileSendContinue(swSocketIO *io)
+{
+  swSocketReturnType rtn = swSocketReturnOK;
+  swSocketIOFileSend *fileSend = &(io->fileSend);
+  bool pipeReady = false;
+  while (fileSend->active && (((swSocket *)io)->fd >= 0))
+  {
+    size_t len = (fileSend->untilEnd || (fileSend->left > SW_SOCKETIO_SEND_FILE_MAX))? SW_SOCKETIO_SEND_FILE_MAX : fileSend->left;
+    ssize_t bytes = 0;
+    if (swSocketIOBudgetExhausted(io, swEdgeEventWrite))
+    {
+      rtn = swSocketReturnNotReady;
+      break;
+    }
+    if (fileSend->pipe)
+      rtn = swSocketWriteSplice((swSocket *)io, (int[2]){fileSend->fd, -1}, len, &bytes);
+    else
+      rtn = swSocketSendFile((swSocket *)io, fileSend->fd, &(fileSend->offset), len, &bytes);
+    swSocketIOWriteCount(io, rtn, &bytes);
+    if ((rtn == swSocketReturnOK) && bytes)
+    {
+      pipeReady = false;
+      io->budgetUsed += bytes;
+      fileSend->sent += bytes;
+      if (!fileSend->untilEnd && !(fileSend->left -= bytes))
+      {
+        swSocketIOFileSendDone(io, true);
+        swEdgeWatcherPendingSet((swEdgeWatcher *)&(io->ioEvent), swEdgeEventWrite);
+      }
+    }
+    else if ((rtn == swSocketReturnOK) || (rtn == swSocketReturnClose))
+    {
+      // the end of the source, early unless it was sent till the end
+      rtn = (fileSend->untilEnd)? swSocketReturnOK : swSocketReturnInvalidBuffer;
+      swSocketIOFileSendDone(io, (rtn == swSocketReturnOK));
+      if (rtn == swSocketReturnOK)
+        swEdgeWatcherPendingSet((swEdgeWatcher *)&(io->ioEvent), swEdgeEventWrite);
+    }
+    else if (rtn == swSocketReturnNotReady)
+    {
+      int available = 0;
+      if (fileSend->pipe && !pipeReady)
+      {
+        if (ioctl(fileSend->fd, FIONREAD, &available))
+        {
+          swSocketIOClose(io, swSocketIOErrorOtherError);
+          break;
+        }
+        if (available)
+        {
+          pipeReady = true;
+          continue;
+        }
+        // edge triggered, the read event comes with the next write to the pipe
+        if (!((swEdgeWatcher *)&(io->fileSendEvent))->loop && !swEdgeIOStart(&(io->fileSendEvent), io->loop, fileSend->fd, swEdgeEventRead))
+          swSocketIOClose(io, swSocketIOErrorOtherError);
+      }
+      else if (!swSocketIOWriteTimerStart(io))
+        swSocketIOClose(io, swSocketIOErrorOtherError);
+      break;
+    }
+    else
+    {
+      swSocketIOClose(io, swSocketIOErrorSocketError);
+      break;
+    }
+  }
+  return rtn;
+}
+
+swSocketReturnType swSocketIOSendFile(swSocketIO *io, int fd, off_t offset, size_t len)
+{
+  swSocketReturnType rtn = swSocketReturnNone;
+  struct stat fileStat = {0};
+  if (io && (fd >= 0) && (offset >= 0) && !io->fileSend.active && (((swSocket *)io)->fd >= 0) && !fstat(fd, &fileStat))
+  {
+    swSocketIOFileSend *fileSend = &(io->fileSend);
+    swSocketIOCount(io, writes);
+    fileSend->fd = fd;
+    fileSend->offset = offset;
+    fileSend->left = len;
+    fileSend->sent = 0;
+    fileSend->pipe = S_ISFIFO(fileStat.st_mode);
+    fileSend->untilEnd = fileSend->pipe && !len;
+    if (!len && !fileSend->pipe)
+      fileSend->left = (fileStat.st_size > offset)? (fileStat.st_size - offset) : 0;
+    if (fileSend->left || fileSend->untilEnd)
+    {
+      fileSend->active = true;
+      // after the buffers queued before it
+      if (io->outputQueue.count)
+      {
+        swEdgeWatcherPendingSet((swEdgeWatcher *)&(io->ioEvent), swEdgeEventWrite);
+        rtn = swSocketReturnNotReady;
+      }
+      else
+        rtn = swSocketIOFileSendContinue(io);
+    }
+    else
+    {
+      swSocketIOFileSendDone(io, true);
+      rtn = swSocketReturnOK;
+    }
+  }
+  return rtn;
+}
+
+bool swSocketIOTimestampsSet(swSocketIO *io, bool receive, bool send)
+{
+  bool rtn = false;
+  if (io && (!send || ((((swSocket *)io)->type & ~(SOCK_NONBLOCK | SOCK_CLOEXEC)) == SOCK_DGRAM)))
+  {
+    if (!receive && !send)
+    {
+      rtn = swSocketTimestampingSet((swSocket *)io, false, false);
+      swMemoryFree(io->timestamps);
+      io->timestamps = NULL;
+    }
+    else if ((io->timestamps || (io->timestamps = swMemoryCalloc(1, sizeof(swSocketIOTimestamps))))
+             && swSocketTimestampingSet((swSocket *)io, receive, send))
+    {
+      // the kernel numbers the sends from 0 again
+      io->timestamps->sends = 0;
+      io->timestamps->receive = receive;
+      io->timestamps->send = send;
+      rtn = true;
+    }
+  }
+  return rtn;
+}
+
+bool swSocketIOCountersSet(swSocketIO *io, bool enable)
+{
+  bool rtn = false;
+  if (io)
+  {
+    if (enable)
+      rtn = (io->counters || (io->counters = swMemoryCalloc(1, sizeof(swSocketIOCounters))));
+    else if (!io->stats)
+    {
+      swMemoryFree(io->counters);
+      io->counters = NULL;
+      rtn = true;
+    }
+  }
+  return rtn;
+}
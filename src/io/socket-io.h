@@ -7,9 +7,14 @@
 #include "io/edge-io.h"
 #include "io/edge-timer.h"
 
+#include "core/histogram.h"
+
 #define SW_SOCKETIO_DEFAULT_TIMEOUT  60000 // 60s
+// sends waiting for their kernel timestamp, power of 2
+#define SW_SOCKETIO_TIMESTAMP_SENDS  64
 
 typedef struct swSocketIO  swSocketIO;
+typedef struct swSocketIOStats  swSocketIOStats;
 
 typedef enum swSocketIOErrorType
 {
@@ -41,6 +46,112 @@ typedef void (*swSocketIOCloseFunc)       (swSocketIO *io);
 
 typedef void (*swSocketIOSocketCleanupFunc)(swSocketIO *io);
 
+// what became of a buffer handed back by the release function
+typedef enum swSocketIOBufferState
+{
+  // dropped when the socket closed, the buffer can be reused
+  swSocketIOBufferNotWritten = 0,
+  swSocketIOBufferWritten,
+  // a zero copy send of the buffer had not completed when the socket closed, the kernel can still
+  // be sending from its pages and no completion comes for it anymore: the memory can be unmapped,
+  // but not written again or given back to an allocator that hands it out again
+  swSocketIOBufferInFlight
+} swSocketIOBufferState;
+
+typedef void (*swSocketIOBufferReleaseFunc)(swSocketIO *io, swStaticBuffer *buffer, swSocketIOBufferState state);
+typedef void (*swSocketIOWatermarkFunc)   (swSocketIO *io);
+
+// complete is false when the socket closed or the source ended before all of it was sent
+typedef void (*swSocketIOFileSentFunc)(swSocketIO *io, int fd, size_t bytesSent, bool complete);
+
+// file sent by swSocketIOSendFile
+typedef struct swSocketIOFileSend
+{
+  int fd;
+  off_t offset;
+  // bytes left, the pipes with no length are sent till the end
+  size_t left;
+  size_t sent;
+  bool active;
+  bool pipe;
+  bool untilEnd;
+} swSocketIOFileSend;
+
+// buffers queued with swSocketIOQueueWrite, a ring of pointers to the buffers of the caller
+typedef struct swSocketIOOutputQueue
+{
+  swStaticBuffer **buffers;
+  uint32_t size;
+  uint32_t head;
+  uint32_t count;
+  // part of the first buffer that is already written
+  size_t offset;
+  // bytes left to write
+  size_t bytes;
+} swSocketIOOutputQueue;
+
+// buffers written with MSG_ZEROCOPY, the kernel still reads them till the send completes
+typedef struct swSocketIOZeroCopyEntry
+{
+  swStaticBuffer *buffer;
+  // number of the last send that took a part of the buffer
+  uint32_t send;
+} swSocketIOZeroCopyEntry;
+
+typedef struct swSocketIOZeroCopyQueue
+{
+  swSocketIOZeroCopyEntry *entries;
+  uint32_t size;
+  uint32_t head;
+  uint32_t count;
+  // the kernel numbers the zero copy sends of a socket from 0
+  uint32_t nextSend;
+  // first send not completed yet
+  uint32_t completed;
+  // the first buffer of the output queue was partly written by a zero copy send
+  bool headPending;
+  uint32_t headSend;
+} swSocketIOZeroCopyQueue;
+
+// latencies measured with the kernel timestamps of the socket, in nanoseconds
+typedef struct swSocketIOTimestamps
+{
+  // from the kernel receive timestamp to the wake up of the loop, the time the data sat in the
+  // socket queue, and from the wake up to the read, the time the loop spent on other callbacks
+  swHistogram kernelLatency;
+  swHistogram loopLatency;
+  // from the send call to the send timestamp of the kernel, or of the NIC when it stamps them
+  swHistogram sendLatency;
+  // realtime of the last sends by their number, the send timestamps are matched against them
+  uint64_t sendTimes[SW_SOCKETIO_TIMESTAMP_SENDS];
+  uint32_t sends;
+  // send timestamps that came after the time of their send was overwritten
+  uint64_t sendsMissed;
+  bool receive;
+  bool send;
+} swSocketIOTimestamps;
+
+// transport counters of a connection, kept across its reconnects
+typedef struct swSocketIOCounters
+{
+  uint64_t bytesRead;
+  uint64_t bytesWritten;
+  // read and write calls, the flushes and the file sends count as writes
+  uint64_t reads;
+  uint64_t writes;
+  // system calls the reads and the writes made, none when the budget was used up
+  uint64_t syscalls;
+  // the ones that found the socket not ready (EAGAIN)
+  uint64_t readNotReady;
+  uint64_t writeNotReady;
+  uint64_t readTimeouts;
+  uint64_t writeTimeouts;
+  // TCP retransmits by the samples of swSocketIOStats, the last one is taken when the socket closes
+  uint64_t retransmits;
+  // retransmits TCP_INFO reported for the current socket at the last sample
+  uint32_t socketRetransmits;
+} swSocketIOCounters;
+
 struct swSocketIO
 {
   swSocket sock;
@@ -52,6 +163,13 @@ struct swSocketIO
 
   uint64_t readTimeout;
   uint64_t writeTimeout;
+  // loop time the socket has to become ready by, 0 when it is not waiting
+  uint64_t readDeadline;
+  uint64_t writeDeadline;
+  // bytes the socket can read and write in one loop iteration, 0 for the budget of the loop
+  uint64_t budget;
+  uint64_t budgetUsed;
+  uint64_t budgetIteration;
 
   swSocketIOReadReadyFunc readReadyFunc;
   swSocketIOWriteReadyFunc writeReadyFunc;
@@ -62,10 +180,43 @@ struct swSocketIO
 
   swSocketIOSocketCleanupFunc socketCleanupFunc;
 
+  swSocketIOOutputQueue outputQueue;
+  // the high watermark function is called when the queued bytes reach highWatermark, the
+  // low watermark one when they drop to lowWatermark afterwards
+  size_t highWatermark;
+  size_t lowWatermark;
+  swSocketIOBufferReleaseFunc bufferReleaseFunc;
+  swSocketIOWatermarkFunc highWatermarkFunc;
+  swSocketIOWatermarkFunc lowWatermarkFunc;
+  swSocketIOFileSend fileSend;
+  // read events of the pipe sent, for when the pipe runs empty before its write end is closed
+  swEdgeIO fileSendEvent;
+  swSocketIOFileSentFunc fileSentFunc;
+  // flushes of at least this many bytes use MSG_ZEROCOPY, 0 when off
+  size_t zeroCopyThreshold;
+  swSocketIOZeroCopyQueue zeroCopy;
+  uint64_t zeroCopySends;
+  uint64_t zeroCopyCompletions;
+  // completions of the sends the kernel ended up copying, loopback always does
+  uint64_t zeroCopyCopied;
+  // set by swSocketIOTimestampsSet
+  swSocketIOTimestamps *timestamps;
+  // set by swSocketIOCountersSet, or by swSocketIOStatsAdd with the stats the socket is sampled by
+  swSocketIOCounters *counters;
+  swSocketIOStats *stats;
+  uint32_t statsPosition;
+
   swSocketIOErrorType lastError;
   unsigned int cleaning : 1;
   unsigned int deleting : 1;
   unsigned int insideIOEventCallback : 1;
+  unsigned int aboveHighWatermark : 1;
+  // the write event is only the flush of the buffers queued in the last iteration, the writer is
+  // not asked for more after it
+  unsigned int flushQueued : 1;
+  // the hang up is delivered as a read event, the reader closes the socket when it gets to the
+  // end of the data; for the users that shut down their writes and keep on reading
+  unsigned int hangUpRead : 1;
 };
 
 swSocketIO *swSocketIONew();
@@ -81,10 +232,28 @@ void swSocketIOCleanup(swSocketIO *io);
 #define swSocketIOWriteTimeoutFuncSet(c, f)  do { if ((c)) ((swSocketIO *)(c))->writeTimeoutFunc = (f); } while(0)
 #define swSocketIOErrorFuncSet(c, f)         do { if ((c)) ((swSocketIO *)(c))->errorFunc = (f); } while(0)
 #define swSocketIOCloseFuncSet(c, f)         do { if ((c)) ((swSocketIO *)(c))->closeFunc = (f); } while(0)
+#define swSocketIOBudgetSet(c, b)            do { if ((c)) ((swSocketIO *)(c))->budget = (b); } while(0)
+#define swSocketIOWatermarksSet(c, l, h)     do { if ((c)) { ((swSocketIO *)(c))->lowWatermark = (l); ((swSocketIO *)(c))->highWatermark = (h); } } while(0)
+#define swSocketIOHighWatermarkFuncSet(c, f) do { if ((c)) ((swSocketIO *)(c))->highWatermarkFunc = (f); } while(0)
+#define swSocketIOLowWatermarkFuncSet(c, f)  do { if ((c)) ((swSocketIO *)(c))->lowWatermarkFunc = (f); } while(0)
+#define swSocketIOBufferReleaseFuncSet(c, f) do { if ((c)) ((swSocketIO *)(c))->bufferReleaseFunc = (f); } while(0)
+#define swSocketIOFileSentFuncSet(c, f)      do { if ((c)) ((swSocketIO *)(c))->fileSentFunc = (f); } while(0)
+#define swSocketIOHangUpReadSet(c, h)        do { if ((c)) ((swSocketIO *)(c))->hangUpRead = (h); } while(0)
+#define swSocketIOQueuedBytesGet(c)          (((swSocketIO *)(c))->outputQueue.bytes)
+// loop stats tag of the IO and timeout watchers
+#define swSocketIOTagSet(c, t)               do { if ((c)) { swEdgeWatcherTagSet(&(((swSocketIO *)(c))->ioEvent), (t)); \
+                                                             swEdgeWatcherTagSet(&(((swSocketIO *)(c))->readTimer), (t)); \
+                                                             swEdgeWatcherTagSet(&(((swSocketIO *)(c))->writeTimer), (t)); } } while(0)
 
 bool swSocketIOStart(swSocketIO *io, swEdgeLoop *loop);
 void swSocketIOClose(swSocketIO *io, swSocketIOErrorType errorCode);
 
+// start waiting for the socket to become ready within the read or write timeout; the timeouts
+// are deadlines against swEdgeLoopNow, a running timer is not touched and the readiness only
+// clears the deadline, so the IO path makes no timer system calls
+bool swSocketIOReadTimerStart (swSocketIO *io);
+bool swSocketIOWriteTimerStart(swSocketIO *io);
+
 static inline void *swSocketIODataGet(swSocketIO *io)
 {
   if (io)
@@ -101,13 +270,133 @@ static inline void swSocketIODataSet(swSocketIO *io, void *data)
 #define swSocketIODataGet(t)     swSocketIODataGet((swSocketIO *)(t))
 #define swSocketIODataSet(t, d)  swSocketIODataSet((swSocketIO *)(t), (void *)(d))
 
+// the socket that used up the budget of the iteration is not ready till the next one, where
+// it is called back through the pending queue
+static inline bool swSocketIOBudgetExhausted(swSocketIO *io, uint32_t events)
+{
+  bool rtn = false;
+  uint64_t budget = (!io->loop)? 0 : ((io->budget)? io->budget : io->loop->ioBudget);
+  if (budget)
+  {
+    if (io->budgetIteration != io->loop->iteration)
+    {
+      io->budgetIteration = io->loop->iteration;
+      io->budgetUsed = 0;
+    }
+    else if (io->budgetUsed >= budget)
+    {
+      swEdgeWatcherPendingSet((swEdgeWatcher *)&(io->ioEvent), events);
+      rtn = true;
+    }
+  }
+  return rtn;
+}
+
+// a successful IO done outside of the ready function queues it, the running one goes on till
+// swSocketReturnNotReady and waits for the next epoll edge, unless the budget cut it short
+static inline void swSocketIOReadyQueue(swSocketIO *io, uint32_t events)
+{
+  swEdgeWatcher *watcher = (swEdgeWatcher *)&(io->ioEvent);
+  swEdgeLoop *loop = swEdgeWatcherLoopGet(watcher);
+  if (loop && (loop->processing != watcher))
+    swEdgeWatcherPendingSet(watcher, events);
+}
+
+// the functions return swSocketReturnNotReady without touching the socket once the budget of the
+// iteration is used up, the ready function is called again in the next iteration
 swSocketReturnType swSocketIORead (swSocketIO *io, swStaticBuffer *buffer, ssize_t *bytesRead);
 swSocketReturnType swSocketIOWrite(swSocketIO *io, swStaticBuffer *buffer, ssize_t *bytesWritten);
 
 swSocketReturnType swSocketIOReadFrom (swSocketIO *io, swStaticBuffer *buffer, swSocketAddress *address, ssize_t *bytesRead);
 swSocketReturnType swSocketIOWriteTo  (swSocketIO *io, swStaticBuffer *buffer, swSocketAddress *address, ssize_t *bytesWritten);
 
+// swSocketIOReadFrom with what came with the data, the address and the info can be NULL; the
+// latencies of the receive timestamp are recorded when the socket has swSocketIOTimestampsSet
+swSocketReturnType swSocketIOReadWithInfo(swSocketIO *io, swStaticBuffer *buffer, swSocketAddress *address, ssize_t *bytesRead, swSocketReceiveInfo *info);
+
 swSocketReturnType swSocketIOReadSplice  (swSocketIO *io, int pipefd[2], size_t len, ssize_t *bytesRead);
 swSocketReturnType swSocketIOWriteSplice (swSocketIO *io, int pipefd[2], size_t len, ssize_t *bytesWritten);
 
+// output queue: the buffers are written in the order they are queued, with one sendmsg for up
+// to 64 of them, the partial writes are picked up where they stopped; the queue is flushed
+// by the loop after all the callbacks of the iteration had a chance to add to it and again
+// whenever the socket becomes writable, the write ready function is only called once the
+// queue is empty and the socket was found full, so swSocketIOWrite should not be mixed with a
+// non empty queue
+//
+// the buffer and its memory have to stay valid till the release function is called for it;
+// the queue writes to the socket directly, it is not meant for the TLS sockets
+bool swSocketIOQueueWrite(swSocketIO *io, swStaticBuffer *buffer);
+// writes as much of the queue as the socket takes now, OK when the queue is empty
+swSocketReturnType swSocketIOFlush(swSocketIO *io, ssize_t *bytesWritten);
+
+// sends len bytes of the file from the offset without passing them through the user space,
+// sendfile for the files and splice for the pipes (the offset is ignored then), len 0 sends
+// the rest of the file or everything till the write end of the pipe is closed; the write events
+// keep it going after the buffers queued before it are written, the write ready function is
+// called again when it is done, the timeout and the errors close the socket like swSocketIOWrite
+//
+// one file at a time, the file sent function is called when it is done or the socket closes,
+// the file descriptor is not closed; swSocketReturnOK when all of it went out right away,
+// swSocketReturnNotReady while it is waiting for the socket, or for more data in the pipe,
+// which has no timeout
+swSocketReturnType swSocketIOSendFile(swSocketIO *io, int fd, off_t offset, size_t len);
+
+// zero copy for the output queue: the flushes of threshold bytes or more are sent with
+// MSG_ZEROCOPY and the buffers are released only when the kernel reports the send complete,
+// the completions are read from the error queue when the loop reports the socket error event;
+// it pays off only for large buffers, the page pinning and the completion cost more than
+// copying a few kilobytes; threshold 0 turns it off, false when the kernel does not support it
+//
+// the completions are expected in the order of the sends, which is the case for TCP; the ones
+// queued when the socket closes are read before it, the buffers still sent after that are
+// released as swSocketIOBufferInFlight
+bool swSocketIOZeroCopySet(swSocketIO *io, size_t threshold);
+
+// kernel timestamps for the latency histograms of swSocketIOTimestamps, set after the socket is
+// created; the receive ones are read by swSocketIOReadWithInfo, the send ones from the error
+// queue like the zero copy completions and matched to the sends by their number, which only
+// works for the datagram sockets (the stream ones count bytes), false for a stream socket then;
+// both false turns them off
+bool swSocketIOTimestampsSet(swSocketIO *io, bool receive, bool send);
+#define swSocketIOTimestampsGet(c)  ((const swSocketIOTimestamps *)((swSocketIO *)(c))->timestamps)
+
+// per connection counters of swSocketIOCounters, they cost an increment or two on every call;
+// false turns them off unless the socket is in a swSocketIOStats, which needs them
+bool swSocketIOCountersSet(swSocketIO *io, bool enable);
+#define swSocketIOCountersGet(c)    ((const swSocketIOCounters *)((swSocketIO *)(c))->counters)
+
+// the counting of the IO functions, for the users that go to the socket directly and handle the
+// result themselves like the splicer: a call counted when it is made and its system call counted
+// with the result, which is passed through
+#define swSocketIOCount(c, f)  do { if (((swSocketIO *)(c))->counters) ((swSocketIO *)(c))->counters->f++; } while(0)
+
+static inline swSocketReturnType swSocketIOReadCount(swSocketIO *io, swSocketReturnType rtn, ssize_t *bytes)
+{
+  swSocketIOCounters *counters = io->counters;
+  if (counters)
+  {
+    counters->syscalls++;
+    if (rtn == swSocketReturnOK)
+      counters->bytesRead += *bytes;
+    else if (rtn == swSocketReturnNotReady)
+      counters->readNotReady++;
+  }
+  return rtn;
+}
+
+static inline swSocketReturnType swSocketIOWriteCount(swSocketIO *io, swSocketReturnType rtn, ssize_t *bytes)
+{
+  swSocketIOCounters *counters = io->counters;
+  if (counters)
+  {
+    counters->syscalls++;
+    if (rtn == swSocketReturnOK)
+      counters->bytesWritten += *bytes;
+    else if (rtn == swSocketReturnNotReady)
+      counters->writeNotReady++;
+  }
+  return rtn;
+}
+
 #endif  // SW_IO_SOCKETIO_H
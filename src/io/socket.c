@@ -1,10 +1,17 @@
 #include "socket.h"
 
 #include <core/memory.h>
+#include <core/time.h>
 
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <linux/tcp.h>
+#include <string.h>
+#include <sys/sendfile.h>
 
 static const char const *swSocketReturnTypeText[swSocketReturnMax] =
 {
@@ -322,6 +329,173 @@ bool swSocketIsConnected(swSocket *sock, int *returnError)
   return rtn;
 }
 
+// older headers do not have the newer busy poll options
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+
+bool swSocketBusyPollSet(swSocket *sock, uint32_t busyPoll, bool prefer)
+{
+  bool rtn = false;
+  if (sock && (sock->fd >= 0))
+  {
+    int value = (int)busyPoll;
+    int preferValue = prefer;
+    // values above net.core.busy_read need CAP_NET_ADMIN, prefer is only known to 5.11 and newer kernels
+    if (!setsockopt(sock->fd, SOL_SOCKET, SO_BUSY_POLL, &value, sizeof(value))
+        && (!prefer || !setsockopt(sock->fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &preferValue, sizeof(preferValue))))
+      rtn = true;
+  }
+  return rtn;
+}
+
+bool swSocketZeroCopySet(swSocket *sock, bool enable)
+{
+  bool rtn = false;
+  if (sock && (sock->fd >= 0))
+  {
+    int value = enable;
+    // 4.14 and newer kernels, TCP and UDP only
+    if (!setsockopt(sock->fd, SOL_SOCKET, SO_ZEROCOPY, &value, sizeof(value)))
+      rtn = true;
+  }
+  return rtn;
+}
+
+static inline uint64_t swSocketTimespecToNSec(struct timespec *time)
+{
+  return (uint64_t)time->tv_sec * SW_TIME_1B + time->tv_nsec;
+}
+
+// the software and the raw hardware time of SCM_TIMESTAMPING or the time of SCM_TIMESTAMPNS
+static void swSocketTimestampsParse(struct cmsghdr *cmsg, uint64_t *softwareTime, uint64_t *hardwareTime)
+{
+  if (cmsg->cmsg_level == SOL_SOCKET)
+  {
+    if (cmsg->cmsg_type == SCM_TIMESTAMPING)
+    {
+      struct scm_timestamping *timestamps = (struct scm_timestamping *)CMSG_DATA(cmsg);
+      *softwareTime = swSocketTimespecToNSec(&(timestamps->ts[0]));
+      *hardwareTime = swSocketTimespecToNSec(&(timestamps->ts[2]));
+    }
+    else if (cmsg->cmsg_type == SCM_TIMESTAMPNS)
+      *softwareTime = swSocketTimespecToNSec((struct timespec *)CMSG_DATA(cmsg));
+  }
+}
+
+swSocketReturnType swSocketErrorQueueReceive(swSocket *sock, swSocketErrorQueueEntry *entry)
+{
+  swSocketReturnType rtn = swSocketReturnNone;
+  if (sock && entry && (sock->fd >= 0))
+  {
+    char control[CMSG_SPACE(sizeof(struct scm_timestamping)) + CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6))] = {0};
+    struct msghdr msg = { .msg_control = control, .msg_controllen = sizeof(control) };
+    memset(entry, 0, sizeof(*entry));
+    if (recvmsg(sock->fd, &msg, MSG_ERRQUEUE) >= 0)
+    {
+      uint64_t softwareTime = 0;
+      uint64_t hardwareTime = 0;
+      rtn = swSocketReturnOK;
+      for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+      {
+        if (((cmsg->cmsg_level == SOL_IP) && (cmsg->cmsg_type == IP_RECVERR)) || ((cmsg->cmsg_level == SOL_IPV6) && (cmsg->cmsg_type == IPV6_RECVERR)))
+        {
+          struct sock_extended_err *error = (struct sock_extended_err *)CMSG_DATA(cmsg);
+          if ((error->ee_errno == 0) && (error->ee_origin == SO_EE_ORIGIN_ZEROCOPY))
+          {
+            // the range of the sends completed, numbered from 0 in the order they were made
+            entry->type = swSocketErrorQueueZeroCopy;
+            entry->first = error->ee_info;
+            entry->last = error->ee_data;
+            entry->copied = ((error->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0);
+          }
+          else if ((error->ee_errno == ENOMSG) && (error->ee_origin == SO_EE_ORIGIN_TIMESTAMPING))
+          {
+            entry->type = swSocketErrorQueueTimestamp;
+            entry->id = error->ee_data;
+          }
+        }
+        else
+          swSocketTimestampsParse(cmsg, &softwareTime, &hardwareTime);
+      }
+      if (entry->type == swSocketErrorQueueTimestamp)
+      {
+        entry->hardware = (!softwareTime && hardwareTime);
+        entry->time = (entry->hardware)? hardwareTime : softwareTime;
+      }
+    }
+    else if (errno == EAGAIN || errno == EWOULDBLOCK)
+      rtn = swSocketReturnNotReady;
+    else
+      rtn = swSocketReturnError;
+  }
+  return rtn;
+}
+
+bool swSocketTCPInfoGet(swSocket *sock, swSocketTCPInfo *info)
+{
+  bool rtn = false;
+  if (sock && info && (sock->fd >= 0))
+  {
+    // the older kernels fill in less of it, the rest stays 0
+    struct tcp_info tcpInfo = {0};
+    socklen_t len = sizeof(tcpInfo);
+    if (!getsockopt(sock->fd, IPPROTO_TCP, TCP_INFO, &tcpInfo, &len))
+    {
+      info->rtt = tcpInfo.tcpi_rtt;
+      info->rttVar = tcpInfo.tcpi_rttvar;
+      info->retransmits = tcpInfo.tcpi_total_retrans;
+      info->cwnd = tcpInfo.tcpi_snd_cwnd;
+      info->deliveryRate = tcpInfo.tcpi_delivery_rate;
+      rtn = true;
+    }
+  }
+  return rtn;
+}
+
+swSocketReturnType swSocketZeroCopyCompletionReceive(swSocket *sock, uint32_t *first, uint32_t *last, bool *copied)
+{
+  swSocketReturnType rtn = swSocketReturnNone;
+  if (sock && first && last)
+  {
+    swSocketErrorQueueEntry entry;
+    if (((rtn = swSocketErrorQueueReceive(sock, &entry)) == swSocketReturnOK) && (entry.type != swSocketErrorQueueZeroCopy))
+      rtn = swSocketReturnInvalidBuffer;
+    else if (rtn == swSocketReturnOK)
+    {
+      *first = entry.first;
+      *last = entry.last;
+      if (copied)
+        *copied = entry.copied;
+    }
+  }
+  return rtn;
+}
+
+bool swSocketTimestampingSet(swSocket *sock, bool receive, bool send)
+{
+  bool rtn = false;
+  if (sock && (sock->fd >= 0))
+  {
+    unsigned int flags = 0;
+    if (receive || send)
+      flags = SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+    if (receive)
+      flags |= SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_RX_HARDWARE;
+    // the send timestamps come without the data, numbered by the sends
+    if (send)
+      flags |= SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_TX_HARDWARE | SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+    rtn = !setsockopt(sock->fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags));
+    if (!send && (!rtn || !receive))
+    {
+      // the receive timestamps of SO_TIMESTAMPNS work where SO_TIMESTAMPING does not
+      int enable = receive;
+      rtn = !setsockopt(sock->fd, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable));
+    }
+  }
+  return rtn;
+}
+
 swSocketReturnType swSocketRead(swSocket *sock, swStaticBuffer *buffer, ssize_t *bytesRead)
 {
   swSocketReturnType rtn = swSocketReturnNone;
@@ -406,6 +580,28 @@ swSocketReturnType swSocketWriteSplice(swSocket *sock, int pipefd[2], size_t len
   return rtn;
 }
 
+swSocketReturnType swSocketSendFile(swSocket *sock, int fd, off_t *offset, size_t len, ssize_t *bytesWritten)
+{
+  swSocketReturnType rtn = swSocketReturnNone;
+  if (sock && (fd >= 0) && offset && len && (sock->fd >= 0))
+  {
+    ssize_t ret = sendfile(sock->fd, fd, offset, len);
+    if (ret > 0)
+    {
+      rtn = swSocketReturnOK;
+      if (bytesWritten)
+        *bytesWritten = ret;
+    }
+    else if (ret == 0)
+      rtn = swSocketReturnClose;
+    else if (errno == EAGAIN || errno == EWOULDBLOCK)
+      rtn = swSocketReturnNotReady;
+    else
+      rtn = swSocketReturnError;
+  }
+  return rtn;
+}
+
 swSocketReturnType swSocketSend(swSocket *sock, swStaticBuffer *buffer, ssize_t *bytesWritten)
 {
   swSocketReturnType rtn = swSocketReturnNone;
@@ -462,6 +658,27 @@ swSocketReturnType swSocketSendMsg(swSocket *sock, struct msghdr *msg)
   return rtn;
 }
 
+swSocketReturnType swSocketSendVector(swSocket *sock, struct iovec *vector, int count, int flags, ssize_t *bytesWritten)
+{
+  swSocketReturnType rtn = swSocketReturnNone;
+  if (sock && vector && (count > 0) && (sock->fd >= 0))
+  {
+    struct msghdr msg = { .msg_iov = vector, .msg_iovlen = count };
+    ssize_t ret = sendmsg(sock->fd, &msg, flags);
+    if (ret >= 0)
+    {
+      rtn = swSocketReturnOK;
+      if (bytesWritten)
+        *bytesWritten = ret;
+    }
+    else if (errno == EAGAIN || errno == EWOULDBLOCK)
+      rtn = swSocketReturnNotReady;
+    else
+      rtn = swSocketReturnError;
+  }
+  return rtn;
+}
+
 swSocketReturnType swSocketReceive(swSocket *sock, swStaticBuffer *buffer, ssize_t *bytesRead)
 {
   swSocketReturnType rtn = swSocketReturnNone;
@@ -506,14 +723,28 @@ swSocketReturnType swSocketReceiveFrom(swSocket *sock, swStaticBuffer *buffer, s
   return rtn;
 }
 
-swSocketReturnType swSocketReceiveMsg(swSocket *sock, struct msghdr *msg)
+swSocketReturnType swSocketReceiveMsg(swSocket *sock, struct msghdr *msg, ssize_t *bytesRead, swSocketReceiveInfo *info)
 {
   swSocketReturnType rtn = swSocketReturnNone;
   if (sock && msg && (sock->fd >= 0))
   {
     ssize_t ret = recvmsg(sock->fd, msg, 0);
-    if (ret == sizeof(msg))
+    if (ret > 0)
+    {
       rtn = swSocketReturnOK;
+      if (bytesRead)
+        *bytesRead = ret;
+      if (info)
+      {
+        memset(info, 0, sizeof(*info));
+        info->flags = msg->msg_flags;
+        if (msg->msg_controllen)
+        {
+          for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg))
+            swSocketTimestampsParse(cmsg, &(info->softwareTime), &(info->hardwareTime));
+        }
+      }
+    }
     else if (ret == 0)
       rtn = swSocketReturnClose;
     else if (errno == EAGAIN || errno == EWOULDBLOCK)
@@ -523,3 +754,22 @@ swSocketReturnType swSocketReceiveMsg(swSocket *sock, struct msghdr *msg)
   }
   return rtn;
 }
+
+swSocketReturnType swSocketReceiveWithInfo(swSocket *sock, swStaticBuffer *buffer, swSocketAddress *address, ssize_t *bytesRead, swSocketReceiveInfo *info)
+{
+  swSocketReturnType rtn = swSocketReturnNone;
+  if (sock && buffer && buffer->len && buffer->data && (sock->fd >= 0))
+  {
+    char control[CMSG_SPACE(sizeof(struct scm_timestamping)) + CMSG_SPACE(sizeof(struct timespec))];
+    struct iovec vector = { .iov_base = buffer->data, .iov_len = buffer->len };
+    struct msghdr msg = { .msg_iov = &vector, .msg_iovlen = 1, .msg_control = control, .msg_controllen = sizeof(control) };
+    if (address)
+    {
+      msg.msg_name = &(address->storage);
+      msg.msg_namelen = sizeof(address->storage);
+    }
+    if (((rtn = swSocketReceiveMsg(sock, &msg, bytesRead, info)) == swSocketReturnOK) && address)
+      address->len = msg.msg_namelen;
+  }
+  return rtn;
+}
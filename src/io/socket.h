@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <stdio.h>
 
 #include <storage/static-buffer.h>
@@ -28,6 +29,52 @@ const char const *swSocketReturnTypeTextGet(swSocketReturnType returnCode);
 
 typedef struct swSocket swSocket;
 
+// what came with a received message besides the data
+typedef struct swSocketReceiveInfo
+{
+  // realtime nanoseconds the kernel received the data, 0 when the socket has no receive timestamps
+  uint64_t softwareTime;
+  // stamped by the NIC, only when the device is set up for it (SIOCSHWTSTAMP)
+  uint64_t hardwareTime;
+  // msg_flags of the receive, MSG_TRUNC for a datagram cut short
+  int flags;
+} swSocketReceiveInfo;
+
+typedef enum swSocketErrorQueueType
+{
+  swSocketErrorQueueNone = 0,
+  swSocketErrorQueueZeroCopy,
+  swSocketErrorQueueTimestamp
+} swSocketErrorQueueType;
+
+// one entry of the error queue of the socket, None for the ones not known here
+typedef struct swSocketErrorQueueEntry
+{
+  swSocketErrorQueueType type;
+  // zero copy: the range of the completed sends and whether the kernel copied the data after all
+  uint32_t first;
+  uint32_t last;
+  bool copied;
+  // send timestamp: number of the send (counted from 0 since the timestamps were turned on) and
+  // the realtime nanoseconds the data left the stack, or the NIC for the hardware timestamps
+  uint32_t id;
+  uint64_t time;
+  bool hardware;
+} swSocketErrorQueueEntry;
+
+// the part of TCP_INFO the transport stats sample, times in microseconds
+typedef struct swSocketTCPInfo
+{
+  uint32_t rtt;
+  uint32_t rttVar;
+  // segments retransmitted over the life of the connection
+  uint32_t retransmits;
+  // congestion window in segments
+  uint32_t cwnd;
+  // bytes per second, 0 on the kernels before 4.9
+  uint64_t deliveryRate;
+} swSocketTCPInfo;
+
 typedef swSocketReturnType (*swSocketReadFunc)(swSocket *sock, swStaticBuffer *buffer);
 typedef swSocketReturnType (*swSocketWriteFunc)(swSocket *sock, swStaticBuffer *buffer);
 typedef swSocketReturnType (*swSocketCloseFunc)(swSocket *sock);
@@ -81,12 +128,34 @@ swSocketReturnType swSocketWriteSplice(swSocket *sock, int pipefd[2], size_t len
 swSocketReturnType swSocketSend(swSocket *sock, swStaticBuffer *buffer, ssize_t *bytesWritten);
 swSocketReturnType swSocketSendTo(swSocket *sock, swStaticBuffer *buffer, swSocketAddress *address, ssize_t *bytesWritten);
 swSocketReturnType swSocketSendMsg(swSocket *sock, struct msghdr *msg);
+// sendfile from the offset, which is moved past the bytes sent; swSocketReturnClose at the end of the file
+swSocketReturnType swSocketSendFile(swSocket *sock, int fd, off_t *offset, size_t len, ssize_t *bytesWritten);
+// one sendmsg for all the buffers, count is limited by IOV_MAX
+swSocketReturnType swSocketSendVector(swSocket *sock, struct iovec *vector, int count, int flags, ssize_t *bytesWritten);
 
 swSocketReturnType swSocketReceive(swSocket *sock, swStaticBuffer *buffer, ssize_t *bytesRead);
 swSocketReturnType swSocketReceiveFrom(swSocket *sock, swStaticBuffer *buffer, swSocketAddress *address, ssize_t *bytesRead);
-swSocketReturnType swSocketReceiveMsg(swSocket *sock, struct msghdr *msg);
+// the control messages of the receive are parsed into the info, which can be NULL
+swSocketReturnType swSocketReceiveMsg(swSocket *sock, struct msghdr *msg, ssize_t *bytesRead, swSocketReceiveInfo *info);
+// recvfrom with the kernel timestamps of the data, the address and the info can be NULL
+swSocketReturnType swSocketReceiveWithInfo(swSocket *sock, swStaticBuffer *buffer, swSocketAddress *address, ssize_t *bytesRead, swSocketReceiveInfo *info);
 
 bool swSocketIsConnected(swSocket *sock, int *returnError);
+// SO_BUSY_POLL in microseconds and SO_PREFER_BUSY_POLL
+bool swSocketBusyPollSet(swSocket *sock, uint32_t busyPoll, bool prefer);
+// SO_ZEROCOPY, needed before the sends with MSG_ZEROCOPY
+bool swSocketZeroCopySet(swSocket *sock, bool enable);
+// one MSG_ZEROCOPY completion from the error queue: the range of the completed sends and whether
+// the kernel copied the data after all; swSocketReturnInvalidBuffer for the other errors queued
+swSocketReturnType swSocketZeroCopyCompletionReceive(swSocket *sock, uint32_t *first, uint32_t *last, bool *copied);
+// software (and hardware, where the NIC does it) timestamps with SO_TIMESTAMPING, the receive ones
+// come with swSocketReceiveMsg, the send ones through the error queue numbered by the sends;
+// falls back to SO_TIMESTAMPNS for the receive only timestamps, both false turns them off
+bool swSocketTimestampingSet(swSocket *sock, bool receive, bool send);
+// one entry of the error queue, zero copy completions and send timestamps share it
+swSocketReturnType swSocketErrorQueueReceive(swSocket *sock, swSocketErrorQueueEntry *entry);
+// getsockopt TCP_INFO, false for the sockets that are not TCP
+bool swSocketTCPInfoGet(swSocket *sock, swSocketTCPInfo *info);
 
 void swSocketClose(swSocket *sock);
 void swSocketDelete(swSocket *sock);
@@ -0,0 +1,347 @@
+#include "tcp-client-pool.h"
+
+#include <core/memory.h>
+#include <core/time.h>
+
+#include <string.h>
+
+#define swTCPClientPoolMemberGet(p, i)   (*swFastArrayGetExistingPtr((p)->members, (i), swTCPClientPoolMember *))
+#define swTCPClientPoolAddressGet(p, i)  swFastArrayGetExistingPtr((p)->addresses, (i), swTCPClientPoolAddress)
+
+static inline bool swTCPClientPoolMemberAvailable(swTCPClientPool *pool, swTCPClientPoolMember *member)
+{
+  return (member->connected && (!pool->maxOutstanding || (member->outstanding < pool->maxOutstanding)));
+}
+
+static void swTCPClientPoolMemberConnected(swTCPClient *client)
+{
+  swTCPClientPoolMember *member = (swTCPClientPoolMember *)client;
+  swTCPClientPool *pool = member->pool;
+  if (!member->connected)
+  {
+    member->connected = true;
+    member->lastUsed = swEdgeLoopNow(pool->loop);
+    swTCPClientPoolAddressGet(pool, member->addressIndex)->connected++;
+    pool->stats.connects++;
+  }
+  if (pool->connectedFunc)
+    pool->connectedFunc(pool, client);
+}
+
+static void swTCPClientPoolMemberClose(swTCPClient *client)
+{
+  swTCPClientPoolMember *member = (swTCPClientPoolMember *)client;
+  swTCPClientPool *pool = member->pool;
+  swTCPClientPoolAddress *address = swTCPClientPoolAddressGet(pool, member->addressIndex);
+  if (member->connected)
+  {
+    member->connected = false;
+    address->connected--;
+    pool->stats.closes++;
+  }
+  // the client reconnects on its own unless it was stopped or could not start again
+  if (member->started && !client->reconnect)
+  {
+    member->started = false;
+    address->started--;
+  }
+  if (pool->closeFunc)
+    pool->closeFunc(pool, client);
+}
+
+static bool swTCPClientPoolMemberStart(swTCPClientPool *pool, swTCPClientPoolMember *member)
+{
+  bool rtn = false;
+  if (!member->started)
+  {
+    swTCPClient *client = (swTCPClient *)member;
+    swTCPClientPoolAddress *address = swTCPClientPoolAddressGet(pool, member->addressIndex);
+    swTCPClientConnectTimeoutSet(client, pool->connectTimeout);
+    swTCPClientReconnectTimeoutSet(client, pool->reconnectTimeout);
+    client->reconnect = true;
+    member->started = true;
+    address->started++;
+    rtn = swTCPClientStart(client, &(address->address), pool->loop, (pool->bind)? &(pool->bindAddress) : NULL);
+    // the start that failed before it had a socket does not call the close function, the
+    // pool timer tries it again
+    if (!rtn && member->started)
+    {
+      member->started = false;
+      address->started--;
+    }
+  }
+  return rtn;
+}
+
+// opens one more connection to an address without a connection in progress, so a burst of
+// checkouts grows the pool by a connection at a time
+static void swTCPClientPoolGrow(swTCPClientPool *pool)
+{
+  uint32_t count = swFastArrayCount(pool->members);
+  for (uint32_t i = 0; i < count; i++)
+  {
+    swTCPClientPoolMember *member = swTCPClientPoolMemberGet(pool, (pool->next + i) % count);
+    swTCPClientPoolAddress *address = swTCPClientPoolAddressGet(pool, member->addressIndex);
+    if (!member->started && (address->started == address->connected))
+    {
+      swTCPClientPoolMemberStart(pool, member);
+      break;
+    }
+  }
+}
+
+// twice per idle timeout, so a connection is closed at most half of the timeout late, and at
+// least once per reconnect timeout, so a connection that could not be started is retried
+static uint64_t swTCPClientPoolTimerInterval(swTCPClientPool *pool)
+{
+  uint64_t rtn = pool->reconnectTimeout;
+  if (pool->idleTimeout)
+  {
+    uint64_t idleInterval = (pool->idleTimeout > 1)? (pool->idleTimeout / 2) : 1;
+    if (!rtn || (idleInterval < rtn))
+      rtn = idleInterval;
+  }
+  return rtn;
+}
+
+static void swTCPClientPoolIdleTimerCallback(swEdgeTimer *timer, uint64_t expiredCount, uint32_t events)
+{
+  swTCPClientPool *pool = swEdgeWatcherDataGet(timer);
+  if (pool && pool->loop)
+  {
+    uint64_t now = swEdgeLoopNow(pool->loop);
+    uint64_t idleTimeout = swTimeMSecToNSec(pool->idleTimeout);
+    uint32_t count = swFastArrayCount(pool->members);
+    for (uint32_t i = 0; i < count; i++)
+    {
+      swTCPClientPoolMember *member = swTCPClientPoolMemberGet(pool, i);
+      swTCPClientPoolAddress *address = swTCPClientPoolAddressGet(pool, member->addressIndex);
+      swTCPClient *client = (swTCPClient *)member;
+      if (pool->idleTimeout && member->connected && !member->outstanding && (address->started > pool->minIdle) && ((now - member->lastUsed) >= idleTimeout))
+      {
+        client->reconnect = false;
+        pool->stats.idleCloses++;
+        swTCPClientClose(client);
+      }
+      // the connections that could not be opened again are retried here
+      else if (!member->started && (address->started < pool->minIdle))
+        swTCPClientPoolMemberStart(pool, member);
+    }
+  }
+}
+
+swTCPClientPool *swTCPClientPoolNew()
+{
+  swTCPClientPool *rtn = swMemoryMalloc(sizeof(swTCPClientPool));
+  if (rtn)
+  {
+    if (!swTCPClientPoolInit(rtn))
+    {
+      swMemoryFree(rtn);
+      rtn = NULL;
+    }
+  }
+  return rtn;
+}
+
+bool swTCPClientPoolInit(swTCPClientPool *pool)
+{
+  bool rtn = false;
+  if (pool)
+  {
+    memset(pool, 0, sizeof(swTCPClientPool));
+    if (swFastArrayInit(&(pool->addresses), sizeof(swTCPClientPoolAddress), 0))
+    {
+      if (swFastArrayInit(&(pool->members), sizeof(swTCPClientPoolMember *), 0))
+      {
+        if (swEdgeTimerInit(&(pool->idleTimer), swTCPClientPoolIdleTimerCallback, false))
+        {
+          swEdgeWatcherDataSet(&(pool->idleTimer), pool);
+          pool->size = pool->minIdle = pool->maxOutstanding = 1;
+          pool->connectTimeout = pool->reconnectTimeout = SW_SOCKETIO_DEFAULT_TIMEOUT;
+          rtn = true;
+        }
+        else
+          swFastArrayClear(&(pool->members));
+      }
+      if (!rtn)
+        swFastArrayClear(&(pool->addresses));
+    }
+  }
+  return rtn;
+}
+
+void swTCPClientPoolCleanup(swTCPClientPool *pool)
+{
+  if (pool)
+  {
+    swTCPClientPoolStop(pool);
+    swEdgeTimerClose(&(pool->idleTimer));
+    swFastArrayClear(&(pool->members));
+    swFastArrayClear(&(pool->addresses));
+  }
+}
+
+void swTCPClientPoolDelete(swTCPClientPool *pool)
+{
+  if (pool)
+  {
+    swTCPClientPoolCleanup(pool);
+    swMemoryFree(pool);
+  }
+}
+
+bool swTCPClientPoolStart(swTCPClientPool *pool, swEdgeLoop *loop, swSocketAddress *addresses, uint32_t addressCount, swSocketAddress *bindAddress)
+{
+  bool rtn = false;
+  if (pool && !pool->loop && loop && addresses && addressCount && pool->size && (pool->minIdle <= pool->size))
+  {
+    pool->loop = loop;
+    pool->next = 0;
+    if ((pool->bind = (bindAddress != NULL)))
+      pool->bindAddress = *bindAddress;
+    rtn = true;
+    for (uint32_t i = 0; rtn && (i < addressCount); i++)
+    {
+      swTCPClientPoolAddress address = { .address = addresses[i] };
+      rtn = swFastArrayPush(pool->addresses, address);
+      for (uint32_t j = 0; rtn && (j < pool->size); j++)
+      {
+        swTCPClientPoolMember *member = swMemoryCalloc(1, sizeof(*member));
+        rtn = false;
+        if (member)
+        {
+          member->pool = pool;
+          member->addressIndex = i;
+          if (swTCPClientInit((swTCPClient *)member) && (!pool->setupFunc || pool->setupFunc(pool, (swTCPClient *)member)) && swFastArrayPush(pool->members, member))
+          {
+            swTCPClientConnectedFuncSet((swTCPClient *)member, swTCPClientPoolMemberConnected);
+            swTCPClientCloseFuncSet((swTCPClient *)member, swTCPClientPoolMemberClose);
+            rtn = true;
+          }
+          else
+          {
+            swTCPClientCleanup((swTCPClient *)member);
+            swMemoryFree(member);
+          }
+        }
+      }
+    }
+    uint64_t interval = swTCPClientPoolTimerInterval(pool);
+    if (rtn && interval)
+      rtn = swEdgeTimerStart(&(pool->idleTimer), loop, interval, interval, false);
+    if (rtn)
+    {
+      // the members of an address are next to each other, the first minIdle of them are opened
+      uint32_t count = swFastArrayCount(pool->members);
+      for (uint32_t i = 0; i < count; i++)
+      {
+        if ((i % pool->size) < pool->minIdle)
+          swTCPClientPoolMemberStart(pool, swTCPClientPoolMemberGet(pool, i));
+      }
+    }
+    else
+      swTCPClientPoolStop(pool);
+  }
+  return rtn;
+}
+
+void swTCPClientPoolStop(swTCPClientPool *pool)
+{
+  if (pool && pool->loop)
+  {
+    swEdgeTimerStop(&(pool->idleTimer));
+    uint32_t count = swFastArrayCount(pool->members);
+    for (uint32_t i = 0; i < count; i++)
+    {
+      swTCPClientPoolMember *member = swTCPClientPoolMemberGet(pool, i);
+      if (member->started)
+        swTCPClientStop((swTCPClient *)member);
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+      swTCPClientPoolMember *member = swTCPClientPoolMemberGet(pool, i);
+      swTCPClientCleanup((swTCPClient *)member);
+      swMemoryFree(member);
+    }
+    pool->members.count = 0;
+    pool->addresses.count = 0;
+    pool->loop = NULL;
+  }
+}
+
+swTCPClient *swTCPClientPoolCheckout(swTCPClientPool *pool)
+{
+  swTCPClient *rtn = NULL;
+  if (pool && pool->loop)
+  {
+    swTCPClientPoolMember *selected = NULL;
+    uint32_t count = swFastArrayCount(pool->members);
+    pool->stats.checkouts++;
+    for (uint32_t i = 0; i < count; i++)
+    {
+      uint32_t index = (pool->next + i) % count;
+      swTCPClientPoolMember *member = swTCPClientPoolMemberGet(pool, index);
+      if (swTCPClientPoolMemberAvailable(pool, member) && (!selected || (member->outstanding < selected->outstanding)))
+      {
+        selected = member;
+        // the search starts after the last selection, which spreads the ties of least outstanding too
+        pool->next = index + 1;
+        if ((pool->selection == swTCPClientPoolSelectionRoundRobin) || !member->outstanding)
+          break;
+      }
+    }
+    if (selected)
+    {
+      selected->outstanding++;
+      selected->lastUsed = swEdgeLoopNow(pool->loop);
+      rtn = (swTCPClient *)selected;
+    }
+    else
+    {
+      pool->stats.misses++;
+      swTCPClientPoolGrow(pool);
+    }
+  }
+  return rtn;
+}
+
+void swTCPClientPoolCheckin(swTCPClient *client, bool reuse)
+{
+  swTCPClientPoolMember *member = (swTCPClientPoolMember *)client;
+  if (member && member->pool)
+  {
+    if (member->outstanding)
+      member->outstanding--;
+    member->lastUsed = swEdgeLoopNow(member->pool->loop);
+    if (!reuse && member->connected)
+      swTCPClientClose(client);
+  }
+}
+
+uint32_t swTCPClientPoolConnectedCount(swTCPClientPool *pool)
+{
+  uint32_t rtn = 0;
+  if (pool)
+  {
+    uint32_t count = swFastArrayCount(pool->addresses);
+    for (uint32_t i = 0; i < count; i++)
+      rtn += swTCPClientPoolAddressGet(pool, i)->connected;
+  }
+  return rtn;
+}
+
+uint32_t swTCPClientPoolAvailableCount(swTCPClientPool *pool)
+{
+  uint32_t rtn = 0;
+  if (pool)
+  {
+    uint32_t count = swFastArrayCount(pool->members);
+    for (uint32_t i = 0; i < count; i++)
+    {
+      if (swTCPClientPoolMemberAvailable(pool, swTCPClientPoolMemberGet(pool, i)))
+        rtn++;
+    }
+  }
+  return rtn;
+}
@@ -0,0 +1,131 @@
+#ifndef SW_IO_TCPCLIENTPOOL_H
+#define SW_IO_TCPCLIENTPOOL_H
+
+#include "tcp-client.h"
+
+#include "collections/fast-array.h"
+
+// connections to one or more addresses kept open between the requests, so the handshake is paid
+// once instead of for every request; the pool opens minIdle connections per address up front,
+// grows up to size per address when all of them are busy and closes the ones above minIdle that
+// were not used for idleTimeout; a connection that closes on its own reconnects after the
+// reconnect timeout of the client and is not handed out in the meantime, one that could not be
+// started at all is retried by the pool timer, which does not run when both timeouts are 0
+
+typedef struct swTCPClientPool  swTCPClientPool;
+
+typedef enum swTCPClientPoolSelection
+{
+  swTCPClientPoolSelectionRoundRobin = 0,
+  swTCPClientPoolSelectionLeastOutstanding
+} swTCPClientPoolSelection;
+
+// called once for every client the pool creates to set the read/write callbacks and timeouts,
+// the connected and the close functions of the client belong to the pool
+typedef bool (*swTCPClientPoolSetupFunc)      (swTCPClientPool *pool, swTCPClient *client);
+typedef void (*swTCPClientPoolConnectedFunc)  (swTCPClientPool *pool, swTCPClient *client);
+typedef void (*swTCPClientPoolCloseFunc)      (swTCPClientPool *pool, swTCPClient *client);
+
+typedef struct swTCPClientPoolAddress
+{
+  swSocketAddress address;
+  // clients started (connected, connecting or waiting to reconnect) and connected
+  uint32_t started;
+  uint32_t connected;
+} swTCPClientPoolAddress;
+
+typedef struct swTCPClientPoolMember
+{
+  swTCPClient client;
+  swTCPClientPool *pool;
+  uint32_t addressIndex;
+  // checkouts not checked in yet, they stay counted when the connection closes till they are
+  // checked in
+  uint32_t outstanding;
+  // loop time of the last checkout or checkin
+  uint64_t lastUsed;
+  unsigned int started : 1;
+  unsigned int connected : 1;
+} swTCPClientPoolMember;
+
+typedef struct swTCPClientPoolStats
+{
+  uint64_t checkouts;
+  // checkouts that found no connection available
+  uint64_t misses;
+  uint64_t connects;
+  uint64_t closes;
+  uint64_t idleCloses;
+} swTCPClientPoolStats;
+
+struct swTCPClientPool
+{
+  swEdgeLoop *loop;
+  // swTCPClientPoolAddress
+  swFastArray addresses;
+  // swTCPClientPoolMember pointers, size of them per address
+  swFastArray members;
+  // closes the idle connections and retries the ones that could not be started
+  swEdgeTimer idleTimer;
+  swSocketAddress bindAddress;
+  void *data;
+
+  uint32_t size;
+  uint32_t minIdle;
+  // checkouts a connection takes at the same time, 0 for no limit
+  uint32_t maxOutstanding;
+  // milliseconds, 0 keeps the connections open
+  uint64_t idleTimeout;
+  uint64_t connectTimeout;
+  uint64_t reconnectTimeout;
+  swTCPClientPoolSelection selection;
+  uint32_t next;
+  swTCPClientPoolStats stats;
+
+  swTCPClientPoolSetupFunc      setupFunc;
+  swTCPClientPoolConnectedFunc  connectedFunc;
+  swTCPClientPoolCloseFunc      closeFunc;
+
+  unsigned int bind : 1;
+};
+
+swTCPClientPool *swTCPClientPoolNew();
+bool swTCPClientPoolInit(swTCPClientPool *pool);
+void swTCPClientPoolCleanup(swTCPClientPool *pool);
+void swTCPClientPoolDelete(swTCPClientPool *pool);
+
+#define swTCPClientPoolSizeSet(p, s, m)           do { if ((p)) { (p)->size = (s); (p)->minIdle = (m); } } while(0)
+#define swTCPClientPoolMaxOutstandingSet(p, m)    do { if ((p)) (p)->maxOutstanding = (m); } while(0)
+#define swTCPClientPoolIdleTimeoutSet(p, t)       do { if ((p)) (p)->idleTimeout = (t); } while(0)
+#define swTCPClientPoolConnectTimeoutSet(p, t)    do { if ((p)) (p)->connectTimeout = (t); } while(0)
+#define swTCPClientPoolReconnectTimeoutSet(p, t)  do { if ((p)) (p)->reconnectTimeout = (t); } while(0)
+#define swTCPClientPoolSelectionSet(p, s)         do { if ((p)) (p)->selection = (s); } while(0)
+#define swTCPClientPoolSetupFuncSet(p, f)         do { if ((p)) (p)->setupFunc = (f); } while(0)
+#define swTCPClientPoolConnectedFuncSet(p, f)     do { if ((p)) (p)->connectedFunc = (f); } while(0)
+#define swTCPClientPoolCloseFuncSet(p, f)         do { if ((p)) (p)->closeFunc = (f); } while(0)
+#define swTCPClientPoolDataSet(p, d)              do { if ((p)) (p)->data = (void *)(d); } while(0)
+#define swTCPClientPoolDataGet(p)                 ((p)->data)
+#define swTCPClientPoolStatsGet(p)                (&((p)->stats))
+
+// the pool of a client the pool created, not for any other client
+static inline swTCPClientPool *swTCPClientPoolFromClient(swTCPClient *client)
+{
+  return (client)? ((swTCPClientPoolMember *)client)->pool : NULL;
+}
+
+// the addresses are copied, bindAddress can be NULL; the clients are created by the start and
+// deleted by the stop, which can not be called from the callbacks of the clients
+bool swTCPClientPoolStart(swTCPClientPool *pool, swEdgeLoop *loop, swSocketAddress *addresses, uint32_t addressCount, swSocketAddress *bindAddress);
+void swTCPClientPoolStop(swTCPClientPool *pool);
+
+// a connected client by the selection of the pool, NULL when all of them are busy or still
+// connecting, a new connection is opened then if the pool has room for it
+swTCPClient *swTCPClientPoolCheckout(swTCPClientPool *pool);
+// false closes the connection, the client reconnects as after any other close
+void swTCPClientPoolCheckin(swTCPClient *client, bool reuse);
+
+// connected clients and the ones that can take another checkout
+uint32_t swTCPClientPoolConnectedCount(swTCPClientPool *pool);
+uint32_t swTCPClientPoolAvailableCount(swTCPClientPool *pool);
+
+#endif // SW_IO_TCPCLIENTPOOL_H
@@ -1,8 +1,68 @@
 #include "tcp-server.h"
 
 #include <core/memory.h>
+#include <core/time.h>
+
+static void swTCPServerAcceptorDetach(swTCPServer *server)
+{
+  swTCPServerAcceptor *serverAcceptor = server->acceptor;
+  if (serverAcceptor)
+  {
+    if (server->prev)
+      server->prev->next = server->next;
+    else
+      serverAcceptor->servers = server->next;
+    if (server->next)
+      server->next->prev = server->prev;
+    server->acceptor = NULL;
+    server->prev = server->next = NULL;
+    serverAcceptor->connections--;
+    // the connections waiting in the backlog do not raise another event, the acceptor has to look for them
+    if (serverAcceptor->paused && (serverAcceptor->connections < serverAcceptor->maxConnections))
+    {
+      serverAcceptor->paused = false;
+      swEdgeWatcherPendingSet((swEdgeWatcher *)&(serverAcceptor->acceptEvent), swEdgeEventRead);
+    }
+  }
+}
+
+static void swTCPServerAcceptorAttach(swTCPServerAcceptor *serverAcceptor, swTCPServer *server)
+{
+  server->acceptor = serverAcceptor;
+  server->prev = NULL;
+  server->next = serverAcceptor->servers;
+  if (server->next)
+    server->next->prev = server;
+  serverAcceptor->servers = server;
+  serverAcceptor->connections++;
+}
+
+static void swTCPServerSocketCleanup(swSocketIO *io)
+{
+  swSocketClose((swSocket *)io);
+  swTCPServerAcceptorDetach((swTCPServer *)io);
+}
+
+static void swTCPServerAcceptorRateUpdate(swTCPServerAcceptor *serverAcceptor)
+{
+  if (serverAcceptor->loop)
+  {
+    uint64_t now = swEdgeLoopNow(serverAcceptor->loop);
+    uint64_t elapsed = now - serverAcceptor->rateStart;
+    if (elapsed >= SW_TIME_1B)
+    {
+      serverAcceptor->stats.acceptsPerSecond = (serverAcceptor->rateStart)? (serverAcceptor->rateAccepted * SW_TIME_1B / elapsed) : serverAcceptor->rateAccepted;
+      serverAcceptor->rateAccepted = 0;
+      serverAcceptor->rateStart = now;
+    }
+  }
+}
+
+static inline bool swTCPServerAcceptorFull(swTCPServerAcceptor *serverAcceptor)
+{
+  return (serverAcceptor->maxConnections && (serverAcceptor->connections >= serverAcceptor->maxConnections));
+}
 
-// TODO: consider limiting the number of accepts on the same pass, if we do limit, set pending on the loop
 static void swTCPServerAcceptorAcceptEventCallback(swEdgeIO *ioWatcher, uint32_t events)
 {
   swTCPServerAcceptor *serverAcceptor = swEdgeWatcherDataGet(ioWatcher);
@@ -13,29 +73,64 @@ static void swTCPServerAcceptorAcceptEventCallback(swEdgeIO *ioWatcher, uint32_t
     if ((events & swEdgeEventRead) && !(events & (swEdgeEventError | swEdgeEventHungUp)))
     {
       swSocketReturnType ret = swSocketReturnNone;
-      while (true)
+      uint32_t accepted = 0;
+      while (sock->fd >= 0)
       {
         swSocket acceptedSock = {.type = SOCK_STREAM, .fd = -1};
+        if (serverAcceptor->acceptBatch && (accepted >= serverAcceptor->acceptBatch))
+        {
+          // the rest of the batch is picked up in the next iteration through the pending queue
+          swEdgeWatcherPendingSet((swEdgeWatcher *)ioWatcher, swEdgeEventRead);
+          break;
+        }
+        if ((serverAcceptor->overload == swTCPServerAcceptorOverloadPause) && swTCPServerAcceptorFull(serverAcceptor))
+        {
+          if (!serverAcceptor->paused)
+          {
+            serverAcceptor->paused = true;
+            serverAcceptor->stats.pauses++;
+          }
+          break;
+        }
         if ((ret = swSocketAccept(sock, &acceptedSock)) == swSocketReturnOK)
         {
-          if (!serverAcceptor->acceptFunc || serverAcceptor->acceptFunc(serverAcceptor))
+          accepted++;
+          serverAcceptor->stats.accepted++;
+          serverAcceptor->rateAccepted++;
+          if (swTCPServerAcceptorFull(serverAcceptor))
+          {
+            serverAcceptor->stats.dropped++;
+            swSocketClose(&acceptedSock);
+          }
+          else if (!serverAcceptor->acceptFunc || serverAcceptor->acceptFunc(serverAcceptor))
           {
             swTCPServer *server = swTCPServerNew();
             if (server)
             {
               server->io.sock = acceptedSock;
               if (!(!serverAcceptor->setupFunc || serverAcceptor->setupFunc(serverAcceptor, server)) || !swTCPServerStart(server, serverAcceptor->loop))
+              {
+                serverAcceptor->stats.rejected++;
                 swTCPServerDelete(server);
+              }
+              else if (((swSocket *)server)->fd >= 0)
+                swTCPServerAcceptorAttach(serverAcceptor, server);
             }
+            else
+              swSocketClose(&acceptedSock);
           }
           else
+          {
+            serverAcceptor->stats.rejected++;
             swSocketClose(&acceptedSock);
+          }
         }
         else
           break;
       }
-      if (ret != swSocketReturnNotReady)
+      if ((ret != swSocketReturnNone) && (ret != swSocketReturnOK) && (ret != swSocketReturnNotReady))
         errorCode = swSocketIOErrorAcceptFailed;
+      swTCPServerAcceptorRateUpdate(serverAcceptor);
     }
     else
       errorCode = ((events & swEdgeEventError) ? swSocketIOErrorSocketError : swSocketIOErrorSocketHangUp);
@@ -48,6 +143,67 @@ static void swTCPServerAcceptorAcceptEventCallback(swEdgeIO *ioWatcher, uint32_t
   }
 }
 
+const swTCPServerAcceptorStats *swTCPServerAcceptorStatsGet(swTCPServerAcceptor *serverAcceptor)
+{
+  const swTCPServerAcceptorStats *rtn = NULL;
+  if (serverAcceptor)
+  {
+    swTCPServerAcceptorRateUpdate(serverAcceptor);
+    rtn = &(serverAcceptor->stats);
+  }
+  return rtn;
+}
+
+swTCPServer *swTCPServerNew()
+{
+  swTCPServer *rtn = swMemoryMalloc(sizeof(swTCPServer));
+  if (rtn)
+  {
+    if (!swTCPServerInit(rtn))
+    {
+      swMemoryFree(rtn);
+      rtn = NULL;
+    }
+  }
+  return rtn;
+}
+
+bool swTCPServerInit(swTCPServer *server)
+{
+  bool rtn = false;
+  if (server)
+  {
+    server->acceptor = NULL;
+    server->prev = server->next = NULL;
+    if (swSocketIOInit((swSocketIO *)server))
+    {
+      server->io.socketCleanupFunc = swTCPServerSocketCleanup;
+      rtn = true;
+    }
+  }
+  return rtn;
+}
+
+void swTCPServerCleanup(swTCPServer *server)
+{
+  if (server)
+  {
+    swTCPServerAcceptorDetach(server);
+    swSocketIOCleanup((swSocketIO *)server);
+  }
+}
+
+// the close function can delete the server again while it is cleaned up, swSocketIODelete
+// guards against that
+void swTCPServerDelete(swTCPServer *server)
+{
+  if (server)
+  {
+    swTCPServerAcceptorDetach(server);
+    swSocketIODelete((swSocketIO *)server);
+  }
+}
+
 swTCPServerAcceptor *swTCPServerAcceptorNew()
 {
   swTCPServerAcceptor *rtn = swMemoryMalloc(sizeof(swTCPServerAcceptor));
@@ -83,6 +239,15 @@ void swTCPServerAcceptorCleanup(swTCPServerAcceptor *serverAcceptor)
   {
     serverAcceptor->loop = NULL;
     swEdgeIOClose(&(serverAcceptor->acceptEvent));
+    // the servers outlive the acceptor, they are not counted anywhere anymore
+    while (serverAcceptor->servers)
+    {
+      swTCPServer *server = serverAcceptor->servers;
+      serverAcceptor->servers = server->next;
+      server->acceptor = NULL;
+      server->prev = server->next = NULL;
+    }
+    serverAcceptor->connections = 0;
   }
 }
 
@@ -104,11 +269,16 @@ bool swTCPServerAcceptorStart(swTCPServerAcceptor *serverAcceptor, swEdgeLoop *l
     if (swSocketInit(sock, address->storage.ss_family, SOCK_STREAM))
     {
       swSocketIOErrorType errorCode = swSocketIOErrorNone;
-      if (swSocketListen(sock, address) == swSocketReturnOK)
+      int reusePort = 1;
+      if ((!serverAcceptor->reusePort || !setsockopt(sock->fd, SOL_SOCKET, SO_REUSEPORT, &reusePort, sizeof(reusePort)))
+          && (swSocketListen(sock, address) == swSocketReturnOK))
       {
         if (swEdgeIOStart(&(serverAcceptor->acceptEvent), loop, sock->fd, swEdgeEventRead))
         {
           serverAcceptor->loop = loop;
+          serverAcceptor->paused = false;
+          serverAcceptor->rateStart = swEdgeLoopNow(loop);
+          serverAcceptor->rateAccepted = 0;
           rtn = true;
         }
         else
@@ -11,6 +11,26 @@ typedef void (*swTCPServerAcceptorStopFunc)         (swTCPServerAcceptor *server
 typedef void (*swTCPServerAcceptorErrorFunc)        (swTCPServerAcceptor *serverAcceptor, swSocketIOErrorType errorCode);
 typedef bool (*swTCPServerAcceptorServerSetupFunc)  (swTCPServerAcceptor *serverAcceptor, swTCPServer *server);
 
+// what the acceptor does with the connections above maxConnections: leave them in the listen
+// backlog till one of its connections closes (the kernel drops the SYNs once the backlog is full)
+// or accept and close them right away
+typedef enum swTCPServerAcceptorOverload
+{
+  swTCPServerAcceptorOverloadPause = 0,
+  swTCPServerAcceptorOverloadClose
+} swTCPServerAcceptorOverload;
+
+typedef struct swTCPServerAcceptorStats
+{
+  uint64_t accepted;
+  // closed because of maxConnections and turned down by the accept or the setup function
+  uint64_t dropped;
+  uint64_t rejected;
+  // times the acceptor stopped accepting because of maxConnections
+  uint64_t pauses;
+  uint64_t acceptsPerSecond;
+} swTCPServerAcceptorStats;
+
 struct swTCPServerAcceptor
 {
   swSocket socket;
@@ -22,6 +42,25 @@ struct swTCPServerAcceptor
   swTCPServerAcceptorStopFunc         stopFunc;
   swTCPServerAcceptorErrorFunc        errorFunc;
   swTCPServerAcceptorServerSetupFunc  setupFunc;
+
+  // connections accepted in one wake up, the rest wait for the next loop iteration, so a storm
+  // of connections does not starve the other sockets of the loop; 0 accepts till EAGAIN
+  uint32_t acceptBatch;
+  // servers open at the same time, 0 for no limit
+  uint32_t maxConnections;
+  uint32_t connections;
+  swTCPServerAcceptorOverload overload;
+  // the servers that are open, they are detached when the acceptor goes away first
+  swTCPServer *servers;
+  swTCPServerAcceptorStats stats;
+  // accepts counted since rateStart (loop time) for acceptsPerSecond
+  uint64_t rateStart;
+  uint64_t rateAccepted;
+
+  // SO_REUSEPORT, lets the acceptors of several loops listen on the same address and the kernel
+  // spread the connections between them
+  unsigned int reusePort : 1;
+  unsigned int paused : 1;
 };
 
 swTCPServerAcceptor *swTCPServerAcceptorNew();
@@ -36,6 +75,13 @@ void swTCPServerAcceptorStop  (swTCPServerAcceptor *serverAcceptor);
 #define swTCPServerAcceptorStopFuncSet(s, f)        do { if ((s)) (s)->stopFunc = (f); } while(0)
 #define swTCPServerAcceptorErrorFuncSet(s, f)       do { if ((s)) (s)->errorFunc = (f); } while(0)
 #define swTCPServerAcceptorSetupFuncSet(s, f)       do { if ((s)) (s)->setupFunc = (f); } while(0)
+#define swTCPServerAcceptorReusePortSet(s, r)       do { if ((s)) (s)->reusePort = (r); } while(0)
+#define swTCPServerAcceptorAcceptBatchSet(s, b)     do { if ((s)) (s)->acceptBatch = (b); } while(0)
+#define swTCPServerAcceptorMaxConnectionsSet(s, m, o) do { if ((s)) { (s)->maxConnections = (m); (s)->overload = (o); } } while(0)
+#define swTCPServerAcceptorConnectionsGet(s)        ((s)->connections)
+
+// the stats with acceptsPerSecond over the last full second
+const swTCPServerAcceptorStats *swTCPServerAcceptorStatsGet(swTCPServerAcceptor *serverAcceptor);
 
 static inline void *swTCPServerAcceptorDataGet(swTCPServerAcceptor *serverAcceptor)
 {
@@ -60,12 +106,16 @@ typedef void (*swTCPServerCloseFunc)        (swTCPServer *server);
 struct swTCPServer
 {
   swSocketIO io;
+  // the acceptor counting the server among its connections till the socket is closed
+  swTCPServerAcceptor *acceptor;
+  swTCPServer *prev;
+  swTCPServer *next;
 };
 
-static inline swTCPServer *swTCPServerNew()                 { return (swTCPServer *)swSocketIONew();        }
-static inline bool swTCPServerInit    (swTCPServer *server) { return swSocketIOInit((swSocketIO *)server);  }
-static inline void swTCPServerCleanup (swTCPServer *server) { swSocketIOCleanup((swSocketIO *)server);      }
-static inline void swTCPServerDelete  (swTCPServer *server) { swSocketIODelete((swSocketIO *)server);       }
+swTCPServer *swTCPServerNew();
+bool swTCPServerInit    (swTCPServer *server);
+void swTCPServerCleanup (swTCPServer *server);
+void swTCPServerDelete  (swTCPServer *server);
 
 static inline bool swTCPServerStart (swTCPServer *server, swEdgeLoop *loop) { return swSocketIOStart((swSocketIO *)server, loop); }
 static inline void swTCPServerStop  (swTCPServer *server) { swSocketIOClose((swSocketIO *)server, swSocketIOErrorNone); }
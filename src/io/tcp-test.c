@@ -1,5 +1,7 @@
 #include "tcp-client.h"
+#include "tcp-client-pool.h"
 #include "tcp-server.h"
+#include "socket-io-stats.h"
 
 #include "unittest/unittest.h"
 
@@ -302,5 +304,296 @@ swTestDeclare(TCPClientServerOverUnixTest, NULL, NULL, swTestRun)
   return rtn;
 }
 
+#define LIMIT_TEST_CLIENTS  5
+
+static swTCPServer *limitTestServers[LIMIT_TEST_CLIENTS] = {NULL};
+static uint32_t limitTestServerCount = 0;
+
+static bool onLimitTestSetup(swTCPServerAcceptor *serverAcceptor, swTCPServer *server)
+{
+  limitTestServers[limitTestServerCount++] = server;
+  return true;
+}
+
+static int limitTestConnect(swSocketAddress *address)
+{
+  int rtn = socket(AF_INET, SOCK_STREAM, 0);
+  if ((rtn >= 0) && connect(rtn, &(address->addr), address->len))
+  {
+    close(rtn);
+    rtn = -1;
+  }
+  return rtn;
+}
+
+// one accept per wake up and at most 2 connections: the acceptor pauses with the connections
+// left in the backlog, picks them up when a server closes and drops them once it is told to
+swTestDeclare(TCPServerAcceptorLimitTest, NULL, NULL, swTestRun)
+{
+  swEdgeLoop *loop = swTestSuiteDataGet(suite);
+  swSocketAddress address = { 0 };
+  int clients[LIMIT_TEST_CLIENTS] = {-1, -1, -1, -1, -1};
+  swTCPServerAcceptor *serverAcceptor = swTCPServerAcceptorNew();
+  ASSERT_NOT_NULL(serverAcceptor);
+  ASSERT_TRUE(swSocketAddressInitInet(&address, "127.0.0.1", 10001));
+  swTCPServerAcceptorSetupFuncSet(serverAcceptor, onLimitTestSetup);
+  swTCPServerAcceptorAcceptBatchSet(serverAcceptor, 1);
+  swTCPServerAcceptorMaxConnectionsSet(serverAcceptor, 2, swTCPServerAcceptorOverloadPause);
+  ASSERT_TRUE(swTCPServerAcceptorStart(serverAcceptor, loop, &address));
+  for (uint32_t i = 0; i < (LIMIT_TEST_CLIENTS - 1); i++)
+    ASSERT_TRUE((clients[i] = limitTestConnect(&address)) >= 0);
+
+  // the batch of one spreads the accepts over the iterations
+  swEdgeLoopRun(loop, true);
+  ASSERT_EQUAL(swTCPServerAcceptorConnectionsGet(serverAcceptor), 1);
+  swEdgeLoopRun(loop, true);
+  ASSERT_EQUAL(swTCPServerAcceptorConnectionsGet(serverAcceptor), 2);
+  swEdgeLoopRun(loop, true);
+  ASSERT_TRUE(serverAcceptor->paused);
+  ASSERT_EQUAL(serverAcceptor->stats.pauses, 1);
+
+  // a closed server makes room for the next connection in the backlog
+  swTCPServerDelete(limitTestServers[0]);
+  limitTestServers[0] = NULL;
+  ASSERT_FALSE(serverAcceptor->paused);
+  swEdgeLoopRun(loop, true);
+  ASSERT_EQUAL(swTCPServerAcceptorConnectionsGet(serverAcceptor), 2);
+  ASSERT_EQUAL(serverAcceptor->stats.accepted, 3);
+  swEdgeLoopRun(loop, true);
+  ASSERT_TRUE(serverAcceptor->paused);
+
+  // closing the connections above the limit right away
+  swTCPServerAcceptorMaxConnectionsSet(serverAcceptor, 2, swTCPServerAcceptorOverloadClose);
+  ASSERT_TRUE((clients[LIMIT_TEST_CLIENTS - 1] = limitTestConnect(&address)) >= 0);
+  swEdgeLoopRun(loop, true);
+  swEdgeLoopRun(loop, true);
+  const swTCPServerAcceptorStats *stats = swTCPServerAcceptorStatsGet(serverAcceptor);
+  ASSERT_NOT_NULL(stats);
+  ASSERT_EQUAL(stats->accepted, 5);
+  ASSERT_EQUAL(stats->dropped, 2);
+  ASSERT_EQUAL(stats->rejected, 0);
+  ASSERT_EQUAL(swTCPServerAcceptorConnectionsGet(serverAcceptor), 2);
+
+  // the servers left open are detached from the acceptor that goes away first
+  swTCPServerAcceptorStop(serverAcceptor);
+  swTCPServerAcceptorDelete(serverAcceptor);
+  for (uint32_t i = 0; i < LIMIT_TEST_CLIENTS; i++)
+  {
+    swTCPServerDelete(limitTestServers[i]);
+    limitTestServers[i] = NULL;
+    close(clients[i]);
+  }
+  limitTestServerCount = 0;
+  return true;
+}
+
+#define POOL_TEST_SERVERS  16
+
+static swTCPServer *poolTestServers[POOL_TEST_SERVERS] = {NULL};
+static uint32_t poolTestServerCount = 0;
+
+static bool onPoolTestSetup(swTCPServerAcceptor *serverAcceptor, swTCPServer *server)
+{
+  bool rtn = false;
+  if (poolTestServerCount < POOL_TEST_SERVERS)
+  {
+    poolTestServers[poolTestServerCount++] = server;
+    rtn = true;
+  }
+  return rtn;
+}
+
+static void onPoolTestChange(swTCPClientPool *pool, swTCPClient *client)
+{
+  swEdgeLoopBreak(pool->loop);
+}
+
+// runs the loop till the pool has the connections, the idle timer wakes it up regularly
+static bool poolTestWait(swTCPClientPool *pool, uint32_t connected)
+{
+  for (uint32_t i = 0; (i < 100) && (swTCPClientPoolConnectedCount(pool) != connected); i++)
+    swEdgeLoopRun(pool->loop, false);
+  return (swTCPClientPoolConnectedCount(pool) == connected);
+}
+
+// 2 connections opened up front, a third one when both of them have 2 checkouts, the third one
+// closed once it is idle and a connection closed at checkin opened again
+swTestDeclare(TCPClientPoolTest, NULL, NULL, swTestRun)
+{
+  swEdgeLoop *loop = swTestSuiteDataGet(suite);
+  swSocketAddress address = { 0 };
+  swTCPClient *clients[4] = {NULL};
+  swTCPServerAcceptor *serverAcceptor = swTCPServerAcceptorNew();
+  swTCPClientPool *pool = swTCPClientPoolNew();
+  ASSERT_NOT_NULL(serverAcceptor);
+  ASSERT_NOT_NULL(pool);
+  ASSERT_TRUE(swSocketAddressInitInet(&address, "127.0.0.1", 10003));
+  swTCPServerAcceptorSetupFuncSet(serverAcceptor, onPoolTestSetup);
+  ASSERT_TRUE(swTCPServerAcceptorStart(serverAcceptor, loop, &address));
+
+  swTCPClientPoolSizeSet(pool, 3, 2);
+  swTCPClientPoolMaxOutstandingSet(pool, 2);
+  swTCPClientPoolSelectionSet(pool, swTCPClientPoolSelectionLeastOutstanding);
+  swTCPClientPoolIdleTimeoutSet(pool, 100);
+  swTCPClientPoolReconnectTimeoutSet(pool, 10);
+  swTCPClientPoolConnectedFuncSet(pool, onPoolTestChange);
+  swTCPClientPoolCloseFuncSet(pool, onPoolTestChange);
+  ASSERT_TRUE(swTCPClientPoolStart(pool, loop, &address, 1, NULL));
+  ASSERT_TRUE(poolTestWait(pool, 2));
+
+  // least outstanding alternates between the two connections till both are full
+  for (uint32_t i = 0; i < 4; i++)
+    ASSERT_NOT_NULL((clients[i] = swTCPClientPoolCheckout(pool)));
+  ASSERT_TRUE(clients[0] != clients[1]);
+  ASSERT_TRUE(clients[0] == clients[2]);
+  ASSERT_TRUE(clients[1] == clients[3]);
+  ASSERT_EQUAL(swTCPClientPoolAvailableCount(pool), 0);
+  ASSERT_NULL(swTCPClientPoolCheckout(pool));
+  ASSERT_EQUAL(swTCPClientPoolStatsGet(pool)->misses, 1);
+  ASSERT_TRUE(poolTestWait(pool, 3));
+  swTCPClient *third = swTCPClientPoolCheckout(pool);
+  ASSERT_NOT_NULL(third);
+  ASSERT_TRUE((third != clients[0]) && (third != clients[1]));
+  ASSERT_TRUE(swTCPClientPoolFromClient(third) == pool);
+
+  // the connection above minIdle goes away once it is idle
+  swTCPClientPoolCheckin(third, true);
+  for (uint32_t i = 0; i < 4; i++)
+    swTCPClientPoolCheckin(clients[i], true);
+  ASSERT_TRUE(poolTestWait(pool, 2));
+  ASSERT_EQUAL(swTCPClientPoolStatsGet(pool)->idleCloses, 1);
+
+  // a connection given back as broken reconnects
+  clients[0] = swTCPClientPoolCheckout(pool);
+  ASSERT_NOT_NULL(clients[0]);
+  swTCPClientPoolCheckin(clients[0], false);
+  ASSERT_EQUAL(swTCPClientPoolConnectedCount(pool), 1);
+  ASSERT_TRUE(poolTestWait(pool, 2));
+  ASSERT_EQUAL(swTCPClientPoolStatsGet(pool)->connects, 4);
+  ASSERT_EQUAL(swTCPClientPoolStatsGet(pool)->closes, 2);
+
+  swTCPClientPoolDelete(pool);
+  swTCPServerAcceptorStop(serverAcceptor);
+  swTCPServerAcceptorDelete(serverAcceptor);
+  for (uint32_t i = 0; i < poolTestServerCount; i++)
+  {
+    swTCPServerDelete(poolTestServers[i]);
+    poolTestServers[i] = NULL;
+  }
+  poolTestServerCount = 0;
+  return true;
+}
+
+// a client that could not get a socket is not counted as started and is retried by the pool
+// timer, which runs without an idle timeout too
+swTestDeclare(TCPClientPoolRetryTest, NULL, NULL, swTestRun)
+{
+  swEdgeLoop *loop = swTestSuiteDataGet(suite);
+  swSocketAddress address = { 0 };
+  swSocketAddress unsupportedAddress = { 0 };
+  swTCPServerAcceptor *serverAcceptor = swTCPServerAcceptorNew();
+  swTCPClientPool *pool = swTCPClientPoolNew();
+  ASSERT_NOT_NULL(serverAcceptor);
+  ASSERT_NOT_NULL(pool);
+  ASSERT_TRUE(swSocketAddressInitInet(&address, "127.0.0.1", 10003));
+  swTCPServerAcceptorSetupFuncSet(serverAcceptor, onPoolTestSetup);
+  ASSERT_TRUE(swTCPServerAcceptorStart(serverAcceptor, loop, &address));
+
+  swTCPClientPoolSizeSet(pool, 1, 1);
+  swTCPClientPoolIdleTimeoutSet(pool, 0);
+  swTCPClientPoolReconnectTimeoutSet(pool, 10);
+  swTCPClientPoolConnectedFuncSet(pool, onPoolTestChange);
+  ASSERT_TRUE(swTCPClientPoolStart(pool, loop, &unsupportedAddress, 1, NULL));
+  swTCPClientPoolAddress *poolAddress = swFastArrayGetExistingPtr(pool->addresses, 0, swTCPClientPoolAddress);
+  ASSERT_EQUAL(poolAddress->started, 0);
+  ASSERT_FALSE((*swFastArrayGetExistingPtr(pool->members, 0, swTCPClientPoolMember *))->started);
+
+  // the address becomes usable, the next tick of the timer opens the connection
+  poolAddress->address = address;
+  ASSERT_TRUE(poolTestWait(pool, 1));
+  ASSERT_EQUAL(poolAddress->started, 1);
+
+  swTCPClientPoolDelete(pool);
+  swTCPServerAcceptorStop(serverAcceptor);
+  swTCPServerAcceptorDelete(serverAcceptor);
+  for (uint32_t i = 0; i < poolTestServerCount; i++)
+  {
+    swTCPServerDelete(poolTestServers[i]);
+    poolTestServers[i] = NULL;
+  }
+  poolTestServerCount = 0;
+  return true;
+}
+
+static swTCPServer *statsTestServer = NULL;
+
+static bool onStatsTestSetup(swTCPServerAcceptor *serverAcceptor, swTCPServer *server)
+{
+  statsTestServer = server;
+  return swSocketIOStatsAdd(swTCPServerAcceptorDataGet(serverAcceptor), (swSocketIO *)server);
+}
+
+// the counters of an accepted connection, the TCP_INFO samples of the timer and the counters
+// kept by the stats after the connection is gone
+swTestDeclare(SocketIOStatsTest, NULL, NULL, swTestRun)
+{
+  swEdgeLoop *loop = swTestSuiteDataGet(suite);
+  swSocketAddress address = { 0 };
+  uint8_t data[64] = {0};
+  swStaticBuffer buffer = swStaticBufferDefineWithLength(data, sizeof(data));
+  ssize_t bytes = 0;
+  swSocketIOStats *stats = swSocketIOStatsNew();
+  swTCPServerAcceptor *serverAcceptor = swTCPServerAcceptorNew();
+  ASSERT_NOT_NULL(stats);
+  ASSERT_NOT_NULL(serverAcceptor);
+  ASSERT_TRUE(swSocketIOStatsStart(stats, loop, 10));
+  ASSERT_TRUE(swSocketAddressInitInet(&address, "127.0.0.1", 10004));
+  swTCPServerAcceptorSetupFuncSet(serverAcceptor, onStatsTestSetup);
+  swTCPServerAcceptorDataSet(serverAcceptor, stats);
+  ASSERT_TRUE(swTCPServerAcceptorStart(serverAcceptor, loop, &address));
+  int client = limitTestConnect(&address);
+  ASSERT_TRUE(client >= 0);
+  for (uint32_t i = 0; (i < 10) && !statsTestServer; i++)
+    swEdgeLoopRun(loop, true);
+  ASSERT_NOT_NULL(statsTestServer);
+  ASSERT_FALSE(swSocketIOCountersSet((swSocketIO *)statsTestServer, false));
+
+  ASSERT_EQUAL(swTCPServerRead(statsTestServer, &buffer, &bytes), swSocketReturnNotReady);
+  ASSERT_EQUAL(write(client, data, sizeof(data)), sizeof(data));
+  ASSERT_EQUAL(swTCPServerRead(statsTestServer, &buffer, &bytes), swSocketReturnOK);
+  ASSERT_EQUAL(swTCPServerWrite(statsTestServer, &buffer, &bytes), swSocketReturnOK);
+  const swSocketIOCounters *counters = swSocketIOCountersGet(statsTestServer);
+  ASSERT_NOT_NULL(counters);
+  ASSERT_EQUAL(counters->reads, 2);
+  ASSERT_EQUAL(counters->writes, 1);
+  ASSERT_EQUAL(counters->syscalls, 3);
+  ASSERT_EQUAL(counters->readNotReady, 1);
+  ASSERT_EQUAL(counters->bytesRead, sizeof(data));
+  ASSERT_EQUAL(counters->bytesWritten, sizeof(data));
+
+  for (uint32_t i = 0; (i < 100) && !stats->samples; i++)
+    swEdgeLoopRun(loop, true);
+  ASSERT_TRUE(stats->samples > 0);
+  ASSERT_TRUE(stats->rtt.count > 0);
+  ASSERT_TRUE(stats->cwnd.min > 0);
+
+  // the connection leaves the stats with its counters and a last sample
+  uint64_t samples = stats->samples;
+  swTCPServerDelete(statsTestServer);
+  statsTestServer = NULL;
+  ASSERT_EQUAL(swFastArrayCount(stats->sockets), 0);
+  ASSERT_EQUAL(stats->samples, samples + 1);
+  counters = swSocketIOStatsCountersGet(stats);
+  ASSERT_EQUAL(counters->reads, 2);
+  ASSERT_EQUAL(counters->bytesWritten, sizeof(data));
+
+  swTCPServerAcceptorStop(serverAcceptor);
+  swTCPServerAcceptorDelete(serverAcceptor);
+  swSocketIOStatsDelete(stats);
+  close(client);
+  return true;
+}
+
 swTestSuiteStructDeclare(TCPClientServerTestSuite, edgeLoopSetup, edgeLoopTeardown, swTestRun,
-                         &TCPClientServerOverIP4Test, &TCPClientServerOverIP6Test , &TCPClientServerOverUnixTest);
+                         &TCPClientServerOverIP4Test, &TCPClientServerOverIP6Test , &TCPClientServerOverUnixTest,
+                         &TCPServerAcceptorLimitTest, &TCPClientPoolTest, &TCPClientPoolRetryTest, &SocketIOStatsTest);
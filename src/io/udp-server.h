@@ -30,6 +30,11 @@ static inline swSocketReturnType swUDPServerWrite(swUDPServer *server, swStaticB
 static inline swSocketReturnType swUDPServerReadFrom(swUDPServer *server, swStaticBuffer *buffer, swSocketAddress *address, ssize_t *bytesRead)   { return swSocketIOReadFrom((swSocketIO *)server, buffer, address, bytesRead);    }
 static inline swSocketReturnType swUDPServerWriteTo(swUDPServer *server, swStaticBuffer *buffer, swSocketAddress *address, ssize_t *bytesWritten) { return swSocketIOWriteTo ((swSocketIO *)server, buffer, address, bytesWritten); }
 
+// the receive and send timestamps of the kernel, the latencies are in swUDPServerTimestampsGet
+static inline bool swUDPServerTimestampsSet(swUDPServer *server, bool receive, bool send) { return swSocketIOTimestampsSet((swSocketIO *)server, receive, send); }
+static inline const swSocketIOTimestamps *swUDPServerTimestampsGet(swUDPServer *server)  { return swSocketIOTimestampsGet(server); }
+static inline swSocketReturnType swUDPServerReadWithInfo(swUDPServer *server, swStaticBuffer *buffer, swSocketAddress *address, ssize_t *bytesRead, swSocketReceiveInfo *info) { return swSocketIOReadWithInfo((swSocketIO *)server, buffer, address, bytesRead, info); }
+
 static inline void *swUDPServerDataGet(swUDPServer *server)            { return swSocketIODataGet(server); }
 static inline void swUDPServerDataSet(swUDPServer *server, void *data) { swSocketIODataSet(server, data);  }
 
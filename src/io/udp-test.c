@@ -1,6 +1,8 @@
 #include "udp-client.h"
 #include "udp-server.h"
 
+#include "io/edge-timer.h"
+
 #include "unittest/unittest.h"
 
 #include <signal.h>
@@ -270,5 +272,71 @@ swTestDeclare(UDPClientServerOverUnixTest, NULL, NULL, swTestRun)
   return rtn;
 }
 
+#define TIMESTAMP_TEST_DATAGRAMS  8
+
+static uint32_t timestampTestReceived = 0;
+
+// echoes the datagrams, the receive timestamps come with the data, the send ones through the
+// error queue of the server
+static void onTimestampServerReadReady(swUDPServer *server)
+{
+  swStaticBuffer buffer = swStaticBufferDefine(serverReadBuffer);
+  swSocketAddress address = { 0 };
+  swSocketReceiveInfo info = { 0 };
+  ssize_t bytesRead = 0;
+  while (swUDPServerReadWithInfo(server, &buffer, &address, &bytesRead, &info) == swSocketReturnOK)
+  {
+    swStaticBuffer echo = { .data = buffer.data, .len = bytesRead };
+    ASSERT_TRUE(info.softwareTime > 0);
+    ASSERT_EQUAL(swUDPServerWriteTo(server, &echo, &address, NULL), swSocketReturnOK);
+    timestampTestReceived++;
+  }
+}
+
+static void onTimestampTestTimer(swEdgeTimer *timer, uint64_t expiredCount, uint32_t events)
+{
+  swEdgeLoopBreak(swEdgeWatcherLoopGet(timer));
+}
+
+swTestDeclare(UDPTimestampsTest, NULL, NULL, swTestRun)
+{
+  swEdgeLoop *loop = swTestSuiteDataGet(suite);
+  swSocketAddress address = { 0 };
+  swEdgeTimer timer = { 0 };
+  swUDPServer *server = swUDPServerNew();
+  int client = socket(AF_INET, SOCK_DGRAM, 0);
+  ASSERT_NOT_NULL(server);
+  ASSERT_TRUE(client >= 0);
+  ASSERT_TRUE(swSocketAddressInitInet(&address, "127.0.0.1", 10010));
+  swUDPServerReadReadyFuncSet(server, onTimestampServerReadReady);
+  ASSERT_TRUE(swUDPServerStart(server, loop, &address));
+  ASSERT_TRUE(swUDPServerTimestampsSet(server, true, true));
+  // the timer keeps the loop from waiting forever when a timestamp does not come
+  ASSERT_TRUE(swEdgeTimerInit(&timer, onTimestampTestTimer, false));
+  ASSERT_TRUE(swEdgeTimerStart(&timer, loop, 10, 10, false));
+
+  for (uint32_t i = 0; i < TIMESTAMP_TEST_DATAGRAMS; i++)
+    ASSERT_TRUE(sendto(client, clientWriteBuffer, 64, 0, &(address.addr), address.len) == 64);
+  const swSocketIOTimestamps *timestamps = swUDPServerTimestampsGet(server);
+  ASSERT_NOT_NULL(timestamps);
+  for (uint32_t i = 0; (i < 100) && ((timestampTestReceived < TIMESTAMP_TEST_DATAGRAMS) || (timestamps->sendLatency.count < TIMESTAMP_TEST_DATAGRAMS)); i++)
+    swEdgeLoopRun(loop, true);
+  ASSERT_EQUAL(timestampTestReceived, TIMESTAMP_TEST_DATAGRAMS);
+  ASSERT_EQUAL(timestamps->kernelLatency.count, TIMESTAMP_TEST_DATAGRAMS);
+  ASSERT_EQUAL(timestamps->loopLatency.count, TIMESTAMP_TEST_DATAGRAMS);
+  ASSERT_EQUAL(timestamps->sendLatency.count, TIMESTAMP_TEST_DATAGRAMS);
+  ASSERT_EQUAL(timestamps->sendsMissed, 0);
+  ASSERT_TRUE(timestamps->sendLatency.max > 0);
+  // the socket stays open, the send timestamps are not taken for errors
+  ASSERT_TRUE(((swSocket *)server)->fd >= 0);
+
+  swEdgeTimerClose(&timer);
+  swUDPServerDelete(server);
+  close(client);
+  timestampTestReceived = 0;
+  return true;
+}
+
 swTestSuiteStructDeclare(UDPClientServerTestSuite, edgeLoopSetup, edgeLoopTeardown, swTestRun,
-                         &UDPClientServerOverIP4Test, &UDPClientServerOverIP6Test, &UDPClientServerOverUnixTest);
+                         &UDPClientServerOverIP4Test, &UDPClientServerOverIP6Test, &UDPClientServerOverUnixTest,
+                         &UDPTimestampsTest);
@@ -85,9 +85,15 @@ swSocketReturnType swSSLSocketIORead(swSSLSocketIO *io, swStaticBuffer *buffer,
     swSocketIO *socketIO = (swSocketIO *)io;
     if (!(io->pendingRead.len) || swStaticBufferSame(&(io->pendingRead), buffer))
     {
-      if ((rtn = swSSLRead(io->ssl, buffer, bytesRead)) == swSocketReturnOK)
+      ssize_t bytes = 0;
+      if (swSocketIOBudgetExhausted(socketIO, swEdgeEventRead))
+        rtn = swSocketReturnNotReady;
+      else if ((rtn = swSSLRead(io->ssl, buffer, &bytes)) == swSocketReturnOK)
       {
-        swEdgeWatcherPendingSet((swEdgeWatcher *)&(socketIO->ioEvent), swEdgeEventRead);
+        socketIO->budgetUsed += bytes;
+        if (bytesRead)
+          *bytesRead = bytes;
+        swSocketIOReadyQueue(socketIO, swEdgeEventRead);
         if (io->pendingRead.len)
           io->pendingRead = swStaticBufferSetEmpty;
       }
@@ -96,13 +102,13 @@ swSocketReturnType swSSLSocketIORead(swSSLSocketIO *io, swStaticBuffer *buffer,
         if (rtn == swSocketReturnReadNotReady)
         {
           io->pendingRead = *buffer;
-          if (!swEdgeTimerStart(&(socketIO->readTimer), socketIO->loop, socketIO->readTimeout, socketIO->readTimeout, false))
+          if (!swSocketIOReadTimerStart(socketIO))
             swSocketIOClose(socketIO, swSocketIOErrorOtherError);
         }
         else if (rtn == swSocketReturnWriteNotReady)
         {
           io->pendingRead = *buffer;
-          if (!swEdgeTimerStart(&(socketIO->writeTimer), socketIO->loop, socketIO->writeTimeout, socketIO->writeTimeout, false))
+          if (!swSocketIOWriteTimerStart(socketIO))
             swSocketIOClose(socketIO, swSocketIOErrorOtherError);
         }
         else
@@ -123,9 +129,15 @@ swSocketReturnType swSSLSocketIOWrite(swSSLSocketIO *io, swStaticBuffer *buffer,
     swSocketIO *socketIO = (swSocketIO *)io;
     if (!(io->pendingWrite.len) || swStaticBufferSame(&(io->pendingWrite), buffer))
     {
-      if ((rtn = swSSLWrite(io->ssl, buffer, bytesWritten)) == swSocketReturnOK)
+      ssize_t bytes = 0;
+      if (swSocketIOBudgetExhausted(socketIO, swEdgeEventWrite))
+        rtn = swSocketReturnNotReady;
+      else if ((rtn = swSSLWrite(io->ssl, buffer, &bytes)) == swSocketReturnOK)
       {
-        swEdgeWatcherPendingSet((swEdgeWatcher *)&(socketIO->ioEvent), swEdgeEventWrite);
+        socketIO->budgetUsed += bytes;
+        if (bytesWritten)
+          *bytesWritten = bytes;
+        swSocketIOReadyQueue(socketIO, swEdgeEventWrite);
         if (io->pendingWrite.len)
           io->pendingWrite = swStaticBufferSetEmpty;
       }
@@ -134,13 +146,13 @@ swSocketReturnType swSSLSocketIOWrite(swSSLSocketIO *io, swStaticBuffer *buffer,
         if (rtn == swSocketReturnWriteNotReady)
         {
           io->pendingWrite = *buffer;
-          if (!swEdgeTimerStart(&(socketIO->writeTimer), socketIO->loop, socketIO->writeTimeout, socketIO->writeTimeout, false))
+          if (!swSocketIOWriteTimerStart(socketIO))
             swSocketIOClose(socketIO, swSocketIOErrorOtherError);
         }
         else if (rtn == swSocketReturnReadNotReady)
         {
           io->pendingWrite = *buffer;
-          if (!swEdgeTimerStart(&(socketIO->readTimer), socketIO->loop, socketIO->readTimeout, socketIO->readTimeout, false))
+          if (!swSocketIOReadTimerStart(socketIO))
             swSocketIOClose(socketIO, swSocketIOErrorOtherError);
         }
         else
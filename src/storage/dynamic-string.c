@@ -1,5 +1,6 @@
 #include "storage/dynamic-string.h"
 
+#include "core/clock.h"
 #include "core/memory.h"
 #include "core/time.h"
 
@@ -276,28 +277,39 @@ bool swDynamicStringAppendCString(swDynamicString *dynamicStr, const char *cStr)
   return rtn;
 }
 
+// the seconds part only changes once a second, so it is formatted once per second and thread
+static __thread time_t timeStringSeconds = -1;
+static __thread char timeStringCache[SW_TIME_STRING_SIZE - 3];
+
 bool swDynamicStringAppendTime(swDynamicString *dynamicStr)
 {
   bool rtn = false;
   if (dynamicStr && (dynamicStr->size - dynamicStr->len) > SW_TIME_STRING_SIZE)
   {
-    struct timespec timeValue = {0};
-    if (!clock_gettime(CLOCK_REALTIME, &timeValue))
+    uint64_t now = swClockRealtimeNow();
+    if (now)
     {
-      uint64_t millisec = swTimeNSecToMSec(timeValue.tv_nsec);
-      struct tm brokenDownTime = {0};
-      if (gmtime_r(&(timeValue.tv_sec), &brokenDownTime))
+      time_t seconds = swTimeNSecToSec(now);
+      uint64_t millisec = swTimeNSecToMSec(swTimeNSecToSecRem(now));
+      if (seconds != timeStringSeconds)
       {
-        int printedLength = strftime(&(dynamicStr->data[dynamicStr->len]), (dynamicStr->size - dynamicStr->len), "%FT%T", &brokenDownTime);
-        if (printedLength == (SW_TIME_STRING_SIZE - 4))
-        {
-          printedLength += sprintf(&(dynamicStr->data[dynamicStr->len + printedLength]), ".%03lu", millisec);
-          if (printedLength == SW_TIME_STRING_SIZE)
-          {
-            dynamicStr->len += printedLength;
-            rtn = true;
-          }
-        }
+        struct tm brokenDownTime = {0};
+        timeStringSeconds = -1;
+        if (gmtime_r(&seconds, &brokenDownTime)
+            && (strftime(timeStringCache, sizeof(timeStringCache), "%FT%T", &brokenDownTime) == (SW_TIME_STRING_SIZE - 4)))
+          timeStringSeconds = seconds;
+      }
+      if (seconds == timeStringSeconds)
+      {
+        char *data = &(dynamicStr->data[dynamicStr->len]);
+        memcpy(data, timeStringCache, SW_TIME_STRING_SIZE - 4);
+        data[SW_TIME_STRING_SIZE - 4] = '.';
+        data[SW_TIME_STRING_SIZE - 3] = '0' + (millisec / 100);
+        data[SW_TIME_STRING_SIZE - 2] = '0' + (millisec / 10) % 10;
+        data[SW_TIME_STRING_SIZE - 1] = '0' + millisec % 10;
+        data[SW_TIME_STRING_SIZE] = '\0';
+        dynamicStr->len += SW_TIME_STRING_SIZE;
+        rtn = true;
       }
     }
   }
@@ -4,7 +4,6 @@
 #include "thread/futex.h"
 
 #include <string.h>
-#include <sys/mman.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -46,9 +45,19 @@ static void swMPSCFutexRingBufferDone(swMPSCFutexRingBuffer *ringBuffer, void *r
 }
 
 swMPSCFutexRingBuffer *swMPSCFutexRingBufferNew(swThreadManager *threadManager, uint32_t pages, swMPSCFutexRingBufferConsumeFunction consumeFunc, void *data)
+{
+  return swMPSCFutexRingBufferNewWithFlags(threadManager, pages, consumeFunc, data, swMPSCFutexRingBufferFlagNone);
+}
+
+swMPSCFutexRingBuffer *swMPSCFutexRingBufferNewWithFlags(swThreadManager *threadManager, uint32_t pages, swMPSCFutexRingBufferConsumeFunction consumeFunc, void *data, uint32_t flags)
+{
+  return swMPSCFutexRingBufferNewOnNode(threadManager, SW_NUMA_NODE_ANY, pages, consumeFunc, data, flags);
+}
+
+swMPSCFutexRingBuffer *swMPSCFutexRingBufferNewOnNode(swThreadManager *threadManager, int node, uint32_t pages, swMPSCFutexRingBufferConsumeFunction consumeFunc, void *data, uint32_t flags)
 {
   swMPSCFutexRingBuffer *ringBuffer = swMemoryCacheAlignMalloc(sizeof(*ringBuffer));
-  if (!swMPSCFutexRingBufferInit(ringBuffer, threadManager, pages, consumeFunc, data))
+  if (!swMPSCFutexRingBufferInitOnNode(ringBuffer, threadManager, node, pages, consumeFunc, data, flags))
   {
     swMemoryFree(ringBuffer);
     ringBuffer = NULL;
@@ -57,49 +66,41 @@ swMPSCFutexRingBuffer *swMPSCFutexRingBufferNew(swThreadManager *threadManager,
 }
 
 bool swMPSCFutexRingBufferInit(swMPSCFutexRingBuffer *ringBuffer, swThreadManager *threadManager, uint32_t pages, swMPSCFutexRingBufferConsumeFunction consumeFunc, void *data)
+{
+  return swMPSCFutexRingBufferInitWithFlags(ringBuffer, threadManager, pages, consumeFunc, data, swMPSCFutexRingBufferFlagNone);
+}
+
+bool swMPSCFutexRingBufferInitWithFlags(swMPSCFutexRingBuffer *ringBuffer, swThreadManager *threadManager, uint32_t pages, swMPSCFutexRingBufferConsumeFunction consumeFunc, void *data, uint32_t flags)
+{
+  return swMPSCFutexRingBufferInitOnNode(ringBuffer, threadManager, SW_NUMA_NODE_ANY, pages, consumeFunc, data, flags);
+}
+
+bool swMPSCFutexRingBufferInitOnNode(swMPSCFutexRingBuffer *ringBuffer, swThreadManager *threadManager, int node, uint32_t pages, swMPSCFutexRingBufferConsumeFunction consumeFunc, void *data, uint32_t flags)
 {
   bool rtn = false;
   if (ringBuffer && threadManager && pages && consumeFunc)
   {
     memset(ringBuffer, 0, sizeof(*ringBuffer));
     ringBuffer->size = getpagesize() * pages;
-    if((ringBuffer->buffer = (uint8_t *)mmap(NULL, ringBuffer->size << 1, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0)))
+    ringBuffer->node = node;
+    if ((ringBuffer->buffer = swHugePageDoubleMap(&(ringBuffer->size), (flags & swMPSCFutexRingBufferFlagHugePages), &(ringBuffer->backing))))
     {
-      char tempFile[] = "/dev/shm/mpscbuffer-XXXXXX";
-      int fd = mkstemp(tempFile);
-      if (fd >= 0)
+      ringBuffer->head = 0;
+      ringBuffer->candidateTail = 0;
+      ringBuffer->currentTail = 0;
+      ringBuffer->threadManager = threadManager;
+      ringBuffer->consumeFunc = consumeFunc;
+      ringBuffer->shutdown = false;
+      ringBuffer->done = false;
+      ringBuffer->data = data;
+      // both mappings share the same pages, binding the first one places all of them
+      if ((node == SW_NUMA_NODE_ANY) || swNumaMemoryBind(ringBuffer->buffer, ringBuffer->size, node))
+        rtn = swThreadManagerStartThreadOnNode(threadManager, node, (swThreadRunFunction)swMPSCFutexRingBufferRun, (swThreadStopFunction)swMPSCFutexRingBufferStop, (swThreadDoneFunction)swMPSCFutexRingBufferDone, ringBuffer);
+      if (!rtn)
       {
-        if (unlink(tempFile) == 0)
-        {
-          if (ftruncate(fd, ringBuffer->size) == 0)
-          {
-            uint8_t *lowerData = ringBuffer->buffer;
-            if (mmap(lowerData, ringBuffer->size, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_SHARED, fd, 0) == lowerData)
-            {
-              uint8_t *upperData = ringBuffer->buffer + ringBuffer->size;
-              if (mmap(upperData, ringBuffer->size, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_SHARED, fd, 0) == upperData)
-              {
-                ringBuffer->head = 0;
-                ringBuffer->candidateTail = 0;
-                ringBuffer->currentTail = 0;
-                ringBuffer->threadManager = threadManager;
-                ringBuffer->consumeFunc = consumeFunc;
-                ringBuffer->shutdown = false;
-                ringBuffer->done = false;
-                ringBuffer->data = data;
-                rtn = swThreadManagerStartThread(threadManager, (swThreadRunFunction)swMPSCFutexRingBufferRun, (swThreadStopFunction)swMPSCFutexRingBufferStop, (swThreadDoneFunction)swMPSCFutexRingBufferDone, ringBuffer);
-                if (!rtn)
-                  munmap(upperData, ringBuffer->size);
-              }
-              if (!rtn)
-                munmap(lowerData, ringBuffer->size);
-            }
-          }
-        }
-        close(fd);
+        swHugePageDoubleUnmap(ringBuffer->buffer, ringBuffer->size);
+        ringBuffer->buffer = NULL;
       }
-      if (!rtn)
-        munmap(ringBuffer->buffer, ringBuffer->size << 1);
     }
   }
   return rtn;
@@ -114,10 +115,7 @@ void swMPSCFutexRingBufferRelease(swMPSCFutexRingBuffer *ringBuffer)
       ringBuffer->shutdown = true;
       swEdgeLoopRun(ringBuffer->threadManager->loop, true);
     }
-    uint8_t *upperData = ringBuffer->buffer + ringBuffer->size;
-    munmap(upperData, ringBuffer->size);
-    munmap(ringBuffer->buffer, ringBuffer->size);
-    munmap(ringBuffer->buffer, ringBuffer->size << 1);
+    swHugePageDoubleUnmap(ringBuffer->buffer, ringBuffer->size);
   }
 }
 
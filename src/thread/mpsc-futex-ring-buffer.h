@@ -1,6 +1,8 @@
 #ifndef SW_THREAD_MPSCFUTEXRINGBUFFER_H
 #define SW_THREAD_MPSCFUTEXRINGBUFFER_H
 
+#include "core/huge-page.h"
+#include "core/numa.h"
 #include "thread/spin-lock.h"
 #include "thread/thread-manager.h"
 
@@ -14,6 +16,13 @@ struct swMPSCFutexRingBuffer;
 
 typedef bool (*swMPSCFutexRingBufferConsumeFunction)(uint8_t *buffer, size_t size, void *data);
 
+typedef enum swMPSCFutexRingBufferFlags
+{
+  swMPSCFutexRingBufferFlagNone      = 0,
+  // back the buffer with huge pages, the size gets rounded up to the huge page size
+  swMPSCFutexRingBufferFlagHugePages = 0x1,
+} swMPSCFutexRingBufferFlags;
+
 typedef struct swMPSCFutexRingBuffer
 {
   swThreadManager *threadManager;
@@ -21,6 +30,8 @@ typedef struct swMPSCFutexRingBuffer
   uint8_t *buffer;
   void *data;
   size_t size;
+  swHugePageBacking backing;
+  int node;
   uint32_t head;
   bool shutdown;
   bool done;
@@ -33,6 +44,11 @@ typedef struct swMPSCFutexRingBuffer
 
 swMPSCFutexRingBuffer *swMPSCFutexRingBufferNew(swThreadManager *threadManager, uint32_t pages, swMPSCFutexRingBufferConsumeFunction consumeFunc, void *data);
 bool swMPSCFutexRingBufferInit(swMPSCFutexRingBuffer *ringBuffer, swThreadManager *threadManager, uint32_t pages, swMPSCFutexRingBufferConsumeFunction consumeFunc, void *data);
+swMPSCFutexRingBuffer *swMPSCFutexRingBufferNewWithFlags(swThreadManager *threadManager, uint32_t pages, swMPSCFutexRingBufferConsumeFunction consumeFunc, void *data, uint32_t flags);
+bool swMPSCFutexRingBufferInitWithFlags(swMPSCFutexRingBuffer *ringBuffer, swThreadManager *threadManager, uint32_t pages, swMPSCFutexRingBufferConsumeFunction consumeFunc, void *data, uint32_t flags);
+// buffer memory is bound to the NUMA node and the consumer thread runs on it, SW_NUMA_NODE_ANY leaves both to the kernel
+swMPSCFutexRingBuffer *swMPSCFutexRingBufferNewOnNode(swThreadManager *threadManager, int node, uint32_t pages, swMPSCFutexRingBufferConsumeFunction consumeFunc, void *data, uint32_t flags);
+bool swMPSCFutexRingBufferInitOnNode(swMPSCFutexRingBuffer *ringBuffer, swThreadManager *threadManager, int node, uint32_t pages, swMPSCFutexRingBufferConsumeFunction consumeFunc, void *data, uint32_t flags);
 void swMPSCFutexRingBufferRelease(swMPSCFutexRingBuffer *ringBuffer);
 void swMPSCFutexRingBufferDelete(swMPSCFutexRingBuffer *ringBuffer);
 bool swMPSCFutexRingBufferProduceAcquire(swMPSCFutexRingBuffer *ringBuffer, uint8_t **buffer, size_t size);
@@ -40,14 +40,15 @@ bool ringBufferConsumeFunction(uint8_t *buffer, size_t size, void *data)
   return true;
 }
 
-void swMPSCRingBufferDataSetup(swThreadedTestData *data)
+static void swMPSCRingBufferDataSetupWithFlags(swThreadedTestData *data, uint32_t flags)
 {
   bool success = false;
   swRingBufferTestData *testData = swMemoryCalloc(1, sizeof(*testData));
   if (testData)
   {
-    if ((testData->ringBuffer = swMPSCRingBufferNew(&(data->threadManager), 4, ringBufferConsumeFunction, data)))
+    if ((testData->ringBuffer = swMPSCRingBufferNewWithFlags(&(data->threadManager), 4, ringBufferConsumeFunction, data, flags)))
     {
+      swTestLogLine("Ring buffer size = %zu, backing = %s\n", testData->ringBuffer->size, swHugePageBackingTextGet(testData->ringBuffer->backing));
       testData->acquireBytesPerThread = acquireBytesTotal / data->numThreads;
       testData->acquireBytesTotal = acquireBytesTotal;
       testData->consumedBytesTotal = 0;
@@ -70,6 +71,11 @@ void swMPSCRingBufferDataSetup(swThreadedTestData *data)
   ASSERT_TRUE(success);
 }
 
+void swMPSCRingBufferDataSetup(swThreadedTestData *data)
+{
+  swMPSCRingBufferDataSetupWithFlags(data, swMPSCRingBufferFlagNone);
+}
+
 void swMPSCRingBufferDataTeardown(swThreadedTestData *data)
 {
   swRingBufferTestData *testData = swThreadedTestDataGet(data);
@@ -137,3 +143,68 @@ static uint32_t threadCounts[] = {1, 2, 4, 8, 16};
 swThreadedTestDeclare(MPSCRingBuffer, swMPSCRingBufferDataSetup, swMPSCRingBufferDataTeardown,
                    swMPSCRingBufferThreadDataSetup, swMPSCRingBufferThreadDataTeardown, swMPSCRingBufferThreadDataRun,
                    threadCounts);
+
+// threaded test suite runs only one threaded test per binary, ring buffer variants are checked
+// with a single producer here
+
+static bool ringBufferCountFunction(uint8_t *buffer, size_t size, void *data)
+{
+  __atomic_add_fetch((size_t *)data, size, __ATOMIC_RELEASE);
+  return true;
+}
+
+static bool swMPSCRingBufferSingleProducerRun(int node, uint32_t flags)
+{
+  bool rtn = false;
+  swEdgeLoop *loop = swEdgeLoopNew();
+  if (loop)
+  {
+    swThreadManager manager;
+    if (swThreadManagerInit(&manager, loop, 1000))
+    {
+      size_t consumed = 0;
+      size_t total = 4 * 1024 * 1024;
+      swMPSCRingBuffer *ringBuffer = swMPSCRingBufferNewOnNode(&manager, node, 4, ringBufferCountFunction, &consumed, flags);
+      if (ringBuffer)
+      {
+        swTestLogLine("Ring buffer size = %zu, backing = %s\n", ringBuffer->size, swHugePageBackingTextGet(ringBuffer->backing));
+        size_t produced = 0;
+        uint8_t *buffer = NULL;
+        rtn = true;
+        while (rtn && (produced < total))
+        {
+          if (swMPSCRingBufferProduceAcquire(ringBuffer, &buffer, acquireBytes))
+          {
+            produced += acquireBytes;
+            rtn = swMPSCRingBufferProduceRelease(ringBuffer, buffer, acquireBytes);
+          }
+          else
+            pthread_yield();
+        }
+        while (rtn && (__atomic_load_n(&consumed, __ATOMIC_ACQUIRE) < total))
+          pthread_yield();
+        swMPSCRingBufferDelete(ringBuffer);
+      }
+      swThreadManagerRelease(&manager);
+    }
+    swEdgeLoopDelete(loop);
+  }
+  return rtn;
+}
+
+swTestDeclare(MPSCRingBufferHugePagesTest, NULL, NULL, swTestRun)
+{
+  ASSERT_TRUE(swMPSCRingBufferSingleProducerRun(SW_NUMA_NODE_ANY, swMPSCRingBufferFlagHugePages));
+  return true;
+}
+
+// buffer memory and the consumer on the last node
+swTestDeclare(MPSCRingBufferOnNodeTest, NULL, NULL, swTestRun)
+{
+  ASSERT_TRUE(swMPSCRingBufferSingleProducerRun(swNumaNodeCount() - 1, swMPSCRingBufferFlagNone));
+  ASSERT_FALSE(swMPSCRingBufferSingleProducerRun(swNumaNodeCount(), swMPSCRingBufferFlagNone));
+  return true;
+}
+
+swTestSuiteStructDeclare(MPSCRingBufferFlagsTest, NULL, NULL, swTestRun,
+                         &MPSCRingBufferHugePagesTest, &MPSCRingBufferOnNodeTest);
@@ -4,7 +4,6 @@
 #include "thread/futex.h"
 
 #include <string.h>
-#include <sys/mman.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -42,9 +41,19 @@ static void swMPSCRingBufferDone(swMPSCRingBuffer *ringBuffer, void *returnValue
 }
 
 swMPSCRingBuffer *swMPSCRingBufferNew(swThreadManager *threadManager, uint32_t pages, swMPSCRingBufferConsumeFunction consumeFunc, void *data)
+{
+  return swMPSCRingBufferNewWithFlags(threadManager, pages, consumeFunc, data, swMPSCRingBufferFlagNone);
+}
+
+swMPSCRingBuffer *swMPSCRingBufferNewWithFlags(swThreadManager *threadManager, uint32_t pages, swMPSCRingBufferConsumeFunction consumeFunc, void *data, uint32_t flags)
+{
+  return swMPSCRingBufferNewOnNode(threadManager, SW_NUMA_NODE_ANY, pages, consumeFunc, data, flags);
+}
+
+swMPSCRingBuffer *swMPSCRingBufferNewOnNode(swThreadManager *threadManager, int node, uint32_t pages, swMPSCRingBufferConsumeFunction consumeFunc, void *data, uint32_t flags)
 {
   swMPSCRingBuffer *ringBuffer = swMemoryCacheAlignMalloc(sizeof(*ringBuffer));
-  if (!swMPSCRingBufferInit(ringBuffer, threadManager, pages, consumeFunc, data))
+  if (!swMPSCRingBufferInitOnNode(ringBuffer, threadManager, node, pages, consumeFunc, data, flags))
   {
     swMemoryFree(ringBuffer);
     ringBuffer = NULL;
@@ -53,51 +62,43 @@ swMPSCRingBuffer *swMPSCRingBufferNew(swThreadManager *threadManager, uint32_t p
 }
 
 bool swMPSCRingBufferInit(swMPSCRingBuffer *ringBuffer, swThreadManager *threadManager, uint32_t pages, swMPSCRingBufferConsumeFunction consumeFunc, void *data)
+{
+  return swMPSCRingBufferInitWithFlags(ringBuffer, threadManager, pages, consumeFunc, data, swMPSCRingBufferFlagNone);
+}
+
+bool swMPSCRingBufferInitWithFlags(swMPSCRingBuffer *ringBuffer, swThreadManager *threadManager, uint32_t pages, swMPSCRingBufferConsumeFunction consumeFunc, void *data, uint32_t flags)
+{
+  return swMPSCRingBufferInitOnNode(ringBuffer, threadManager, SW_NUMA_NODE_ANY, pages, consumeFunc, data, flags);
+}
+
+bool swMPSCRingBufferInitOnNode(swMPSCRingBuffer *ringBuffer, swThreadManager *threadManager, int node, uint32_t pages, swMPSCRingBufferConsumeFunction consumeFunc, void *data, uint32_t flags)
 {
   bool rtn = false;
   if (ringBuffer && threadManager && pages && consumeFunc)
   {
     memset(ringBuffer, 0, sizeof(*ringBuffer));
     ringBuffer->size = getpagesize() * pages;
-    if((ringBuffer->buffer = (uint8_t *)mmap(NULL, ringBuffer->size << 1, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0)))
+    ringBuffer->node = node;
+    if ((ringBuffer->buffer = swHugePageDoubleMap(&(ringBuffer->size), (flags & swMPSCRingBufferFlagHugePages), &(ringBuffer->backing))))
     {
-      char tempFile[] = "/dev/shm/mpscbuffer-XXXXXX";
-      int fd = mkstemp(tempFile);
-      if (fd >= 0)
+      ringBuffer->bufferEnd = ringBuffer->buffer + ringBuffer->size;
+      ringBuffer->head = ringBuffer->buffer;
+      ringBuffer->candidateTail = ringBuffer->buffer;
+      ringBuffer->currentTail = ringBuffer->buffer;
+      ringBuffer->tailLock = 0;
+      ringBuffer->threadManager = threadManager;
+      ringBuffer->consumeFunc = consumeFunc;
+      ringBuffer->shutdown = false;
+      ringBuffer->done = false;
+      ringBuffer->data = data;
+      // both mappings share the same pages, binding the first one places all of them
+      if ((node == SW_NUMA_NODE_ANY) || swNumaMemoryBind(ringBuffer->buffer, ringBuffer->size, node))
+        rtn = swThreadManagerStartThreadOnNode(threadManager, node, (swThreadRunFunction)swMPSCRingBufferRun, (swThreadStopFunction)swMPSCRingBufferStop, (swThreadDoneFunction)swMPSCRingBufferDone, ringBuffer);
+      if (!rtn)
       {
-        if (unlink(tempFile) == 0)
-        {
-          if (ftruncate(fd, ringBuffer->size) == 0)
-          {
-            uint8_t *lowerData = ringBuffer->buffer;
-            if (mmap(lowerData, ringBuffer->size, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_SHARED, fd, 0) == lowerData)
-            {
-              uint8_t *upperData = ringBuffer->buffer + ringBuffer->size;
-              if (mmap(upperData, ringBuffer->size, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_SHARED, fd, 0) == upperData)
-              {
-                ringBuffer->bufferEnd = ringBuffer->buffer + ringBuffer->size;
-                ringBuffer->head = ringBuffer->buffer;
-                ringBuffer->candidateTail = ringBuffer->buffer;
-                ringBuffer->currentTail = ringBuffer->buffer;
-                ringBuffer->tailLock = 0;
-                ringBuffer->threadManager = threadManager;
-                ringBuffer->consumeFunc = consumeFunc;
-                ringBuffer->shutdown = false;
-                ringBuffer->done = false;
-                ringBuffer->data = data;
-                rtn = swThreadManagerStartThread(threadManager, (swThreadRunFunction)swMPSCRingBufferRun, (swThreadStopFunction)swMPSCRingBufferStop, (swThreadDoneFunction)swMPSCRingBufferDone, ringBuffer);
-                if (!rtn)
-                  munmap(upperData, ringBuffer->size);
-              }
-              if (!rtn)
-                munmap(lowerData, ringBuffer->size);
-            }
-          }
-        }
-        close(fd);
+        swHugePageDoubleUnmap(ringBuffer->buffer, ringBuffer->size);
+        ringBuffer->buffer = NULL;
       }
-      if (!rtn)
-        munmap(ringBuffer->buffer, ringBuffer->size << 1);
     }
   }
   return rtn;
@@ -112,10 +113,7 @@ void swMPSCRingBufferRelease(swMPSCRingBuffer *ringBuffer)
       ringBuffer->shutdown = true;
       swEdgeLoopRun(ringBuffer->threadManager->loop, true);
     }
-    uint8_t *upperData = ringBuffer->buffer + ringBuffer->size;
-    munmap(upperData, ringBuffer->size);
-    munmap(ringBuffer->buffer, ringBuffer->size);
-    munmap(ringBuffer->buffer, ringBuffer->size << 1);
+    swHugePageDoubleUnmap(ringBuffer->buffer, ringBuffer->size);
   }
 }
 
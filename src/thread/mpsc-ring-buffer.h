@@ -1,6 +1,8 @@
 #ifndef SW_THREAD_MPSCRINGBUFFER_H
 #define SW_THREAD_MPSCRINGBUFFER_H
 
+#include "core/huge-page.h"
+#include "core/numa.h"
 #include "thread/spin-lock.h"
 #include "thread/thread-manager.h"
 
@@ -26,12 +28,21 @@ struct swMPSCRingBuffer;
 
 typedef bool (*swMPSCRingBufferConsumeFunction)(uint8_t *buffer, size_t size, void *data);
 
+typedef enum swMPSCRingBufferFlags
+{
+  swMPSCRingBufferFlagNone      = 0,
+  // back the buffer with huge pages, the size gets rounded up to the huge page size
+  swMPSCRingBufferFlagHugePages = 0x1,
+} swMPSCRingBufferFlags;
+
 typedef struct swMPSCRingBuffer
 {
   swThreadManager *threadManager;
   swMPSCRingBufferConsumeFunction consumeFunc;
   void *data;
   size_t size;
+  swHugePageBacking backing;
+  int node;
   uint8_t *buffer;
   uint8_t *bufferEnd;
   uint8_t *head;
@@ -44,6 +55,11 @@ typedef struct swMPSCRingBuffer
 
 swMPSCRingBuffer *swMPSCRingBufferNew(swThreadManager *threadManager, uint32_t pages, swMPSCRingBufferConsumeFunction consumeFunc, void *data);
 bool swMPSCRingBufferInit(swMPSCRingBuffer *ringBuffer, swThreadManager *threadManager, uint32_t pages, swMPSCRingBufferConsumeFunction consumeFunc, void *data);
+swMPSCRingBuffer *swMPSCRingBufferNewWithFlags(swThreadManager *threadManager, uint32_t pages, swMPSCRingBufferConsumeFunction consumeFunc, void *data, uint32_t flags);
+bool swMPSCRingBufferInitWithFlags(swMPSCRingBuffer *ringBuffer, swThreadManager *threadManager, uint32_t pages, swMPSCRingBufferConsumeFunction consumeFunc, void *data, uint32_t flags);
+// buffer memory is bound to the NUMA node and the consumer thread runs on it, SW_NUMA_NODE_ANY leaves both to the kernel
+swMPSCRingBuffer *swMPSCRingBufferNewOnNode(swThreadManager *threadManager, int node, uint32_t pages, swMPSCRingBufferConsumeFunction consumeFunc, void *data, uint32_t flags);
+bool swMPSCRingBufferInitOnNode(swMPSCRingBuffer *ringBuffer, swThreadManager *threadManager, int node, uint32_t pages, swMPSCRingBufferConsumeFunction consumeFunc, void *data, uint32_t flags);
 void swMPSCRingBufferRelease(swMPSCRingBuffer *ringBuffer);
 void swMPSCRingBufferDelete(swMPSCRingBuffer *ringBuffer);
 bool swMPSCRingBufferProduceAcquire(swMPSCRingBuffer *ringBuffer, uint8_t **buffer, size_t size);
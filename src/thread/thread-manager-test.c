@@ -1,4 +1,5 @@
 #include "core/memory.h"
+#include "core/numa.h"
 #include "core/time.h"
 #include "thread/thread-manager.h"
 #include "unittest/unittest.h"
@@ -98,8 +99,42 @@ swTestDeclare(RunOneThread, threadCreateSetUp, threadCreateTearDown, swTestRun)
   return rtn;
 }
 
+typedef struct swNodeThreadTestData
+{
+  swThreadManager *manager;
+  int policyNode;
+  int currentNode;
+} swNodeThreadTestData;
+
+void *nodeRunFunction(void *arg)
+{
+  swNodeThreadTestData *testData = arg;
+  testData->policyNode = swNumaThreadNodeGet();
+  testData->currentNode = swNumaCurrentNodeGet();
+  return NULL;
+}
+
+void nodeDoneFunction(void *arg, void *returnValue)
+{
+  swNodeThreadTestData *testData = arg;
+  swEdgeLoopBreak(testData->manager->loop);
+}
+
+swTestDeclare(RunThreadOnNode, NULL, NULL, swTestRun)
+{
+  swThreadManager *manager = swTestSuiteDataGet(suite);
+  int node = swNumaNodeCount() - 1;
+  swNodeThreadTestData testData = {.manager = manager, .policyNode = SW_NUMA_NODE_ANY, .currentNode = SW_NUMA_NODE_ANY};
+  ASSERT_TRUE(swThreadManagerStartThreadOnNode(manager, node, nodeRunFunction, NULL, nodeDoneFunction, &testData));
+  swEdgeLoopRun(manager->loop, false);
+  ASSERT_EQUAL(testData.policyNode, node);
+  ASSERT_EQUAL(testData.currentNode, node);
+  ASSERT_FALSE(swThreadManagerStartThreadOnNode(manager, SW_NUMA_NODE_MAX, nodeRunFunction, NULL, NULL, &testData));
+  return true;
+}
+
 swTestSuiteStructDeclare(ThreadManagerSimpleTest, threadManagerSetUp, threadManagerTearDown, swTestRun,
-                         &RunOneThread);
+                         &RunOneThread, &RunThreadOnNode);
 
 // WARNING: valgrind does not like too many threads, settled on 500 for this test
 #define SW_NUM_THREADS 500
@@ -1,6 +1,7 @@
 #include "thread/thread-manager.h"
 
 #include "core/memory.h"
+#include "core/numa.h"
 
 #include <errno.h>
 #include <string.h>
@@ -113,16 +114,22 @@ static void *swThreadInfoRun(void *data)
   void *rtn = NULL;
   // we are going to be in really bad shape if data is NULL, so I prefer we code dump here
   swThreadInfo *threadInfo = data;
+  if (threadInfo->node != SW_NUMA_NODE_ANY)
+    swNumaThreadNodeSet(threadInfo->node);
   rtn = threadInfo->runFunc(threadInfo->data);
   // not checking return status as there is nothing I can do here
   swEdgeAsyncSend(&(threadInfo->doneEvent));
   return rtn;
 }
 
-bool swThreadManagerStartThread(swThreadManager *manager, swThreadRunFunction runFunc, swThreadStopFunction stopFunc, swThreadDoneFunction doneFunc, void *data)
+// without a CPU set the thread placed on a node runs on the CPUs of the node
+static bool swThreadManagerStartThreadInternal(swThreadManager *manager, cpu_set_t *cpuSet, int node, swThreadRunFunction runFunc, swThreadStopFunction stopFunc, swThreadDoneFunction doneFunc, void *data)
 {
   bool rtn = false;
-  if (manager && runFunc)
+  cpu_set_t nodeCPUSet;
+  if (!cpuSet && (node != SW_NUMA_NODE_ANY) && swNumaNodeCPUSetGet(node, &nodeCPUSet))
+    cpuSet = &nodeCPUSet;
+  if (manager && runFunc && (cpuSet || (node == SW_NUMA_NODE_ANY)))
   {
     swThreadInfo *threadInfo = NULL;
     uint32_t position = 0;
@@ -135,13 +142,22 @@ bool swThreadManagerStartThread(swThreadManager *manager, swThreadRunFunction ru
       threadInfo->doneFunc = doneFunc;
       threadInfo->data = data;
       threadInfo->manager = manager;
+      threadInfo->node = node;
       if (swEdgeAsyncInit(&(threadInfo->doneEvent), swThreadInfoDoneCallback))
       {
         swEdgeWatcherDataSet(&(threadInfo->doneEvent), threadInfo);
         if (swEdgeAsyncStart(&(threadInfo->doneEvent), manager->loop))
         {
-          if (!pthread_create(&(threadInfo->threadId), NULL, swThreadInfoRun, threadInfo))
-            rtn = true;
+          pthread_attr_t attr;
+          if (!pthread_attr_init(&attr))
+          {
+            if (!cpuSet || !pthread_attr_setaffinity_np(&attr, sizeof(*cpuSet), cpuSet))
+            {
+              if (!pthread_create(&(threadInfo->threadId), &attr, swThreadInfoRun, threadInfo))
+                rtn = true;
+            }
+            pthread_attr_destroy(&attr);
+          }
         }
       }
       if (!rtn)
@@ -156,6 +172,21 @@ bool swThreadManagerStartThread(swThreadManager *manager, swThreadRunFunction ru
   return rtn;
 }
 
+bool swThreadManagerStartThread(swThreadManager *manager, swThreadRunFunction runFunc, swThreadStopFunction stopFunc, swThreadDoneFunction doneFunc, void *data)
+{
+  return swThreadManagerStartThreadInternal(manager, NULL, SW_NUMA_NODE_ANY, runFunc, stopFunc, doneFunc, data);
+}
+
+bool swThreadManagerStartThreadOnNode(swThreadManager *manager, int node, swThreadRunFunction runFunc, swThreadStopFunction stopFunc, swThreadDoneFunction doneFunc, void *data)
+{
+  return swThreadManagerStartThreadInternal(manager, NULL, node, runFunc, stopFunc, doneFunc, data);
+}
+
+bool swThreadManagerStartThreadOnCPUSet(swThreadManager *manager, cpu_set_t *cpuSet, swThreadRunFunction runFunc, swThreadStopFunction stopFunc, swThreadDoneFunction doneFunc, void *data)
+{
+  return swThreadManagerStartThreadInternal(manager, cpuSet, SW_NUMA_NODE_ANY, runFunc, stopFunc, doneFunc, data);
+}
+
 static bool swThreadInfoStop(swThreadInfo *threadInfo)
 {
   bool rtn = false;
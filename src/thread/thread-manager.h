@@ -6,6 +6,7 @@
 #include "io/edge-timer.h"
 
 #include <pthread.h>
+#include <sched.h>
 
 // this can only be used from the main thread
 // create specific thread dedicated to performing specific task
@@ -41,11 +42,16 @@ typedef struct swThreadInfo
   void *data;
   void *returnValue;
   uint32_t position;
+  // node memory policy set in the thread before runFunc is called, SW_NUMA_NODE_ANY for none
+  int node;
 } swThreadInfo;
 
 swThreadManager *swThreadManagerNew(swEdgeLoop *loop, uint64_t joinWaitInterval);
 bool swThreadManagerInit(swThreadManager *manager, swEdgeLoop *loop, uint64_t joinWaitInterval);
 bool swThreadManagerStartThread(swThreadManager *manager, swThreadRunFunction runFunc, swThreadStopFunction stopFunc, swThreadDoneFunction doneFunc, void *data);
+// start the thread on the CPUs of the NUMA node, memory allocated by the thread comes from the same node
+bool swThreadManagerStartThreadOnNode(swThreadManager *manager, int node, swThreadRunFunction runFunc, swThreadStopFunction stopFunc, swThreadDoneFunction doneFunc, void *data);
+bool swThreadManagerStartThreadOnCPUSet(swThreadManager *manager, cpu_set_t *cpuSet, swThreadRunFunction runFunc, swThreadStopFunction stopFunc, swThreadDoneFunction doneFunc, void *data);
 void swThreadManagerRelease(swThreadManager *manager);
 void swThreadManagerDelete(swThreadManager *manager);
 
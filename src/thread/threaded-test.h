@@ -55,7 +55,8 @@ struct swThreadedTestSuite
   swThreadedTestThreadDataRunFunc      threadRunFunc;
 
   uint64_t unused1;
-};
+// the compiler aligns big static structures to 32 bytes, the section walk needs the size to match
+} __attribute__ ((aligned(32)));
 
 void swThreadedTestDataSet(swThreadedTestData *testData, void *data);
 void *swThreadedTestDataGet(swThreadedTestData *testData);
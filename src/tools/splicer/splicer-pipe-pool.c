@@ -0,0 +1,89 @@
+#include "tools/splicer/splicer-pipe-pool.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+static bool swSplicerPipeCreate(swSplicerPipePool *pool, swSplicerPipe *pipe)
+{
+  bool rtn = false;
+  if (!pipe2(pipe->fd, O_CLOEXEC | O_NONBLOCK))
+  {
+    int size = 0;
+    // best effort, a pipe of the default size works the same, only with more wake ups
+    if (pool->requestedSize)
+      fcntl(pipe->fd[1], F_SETPIPE_SZ, (int)pool->requestedSize);
+    if ((size = fcntl(pipe->fd[1], F_GETPIPE_SZ)) > 0)
+      pool->pipeSize = size;
+    pool->created++;
+    rtn = true;
+  }
+  return rtn;
+}
+
+static void swSplicerPipeClose(swSplicerPipe *pipe)
+{
+  close(pipe->fd[0]);
+  close(pipe->fd[1]);
+  pipe->fd[0] = pipe->fd[1] = -1;
+}
+
+bool swSplicerPipePoolInit(swSplicerPipePool *pool, size_t pipeSize, uint32_t initialCount, uint32_t maxIdle)
+{
+  bool rtn = false;
+  if (pool)
+  {
+    memset(pool, 0, sizeof(*pool));
+    pool->requestedSize = pipeSize;
+    pool->maxIdle = (maxIdle > initialCount)? maxIdle : initialCount;
+    if (swFastArrayInit(&(pool->pipes), sizeof(swSplicerPipe), (initialCount)? initialCount : 1))
+    {
+      swSplicerPipe pipe = { .fd = {-1, -1} };
+      rtn = true;
+      for (uint32_t i = 0; rtn && (i < initialCount); i++)
+      {
+        if (!(rtn = swSplicerPipeCreate(pool, &pipe) && swFastArrayPush(pool->pipes, pipe)) && (pipe.fd[0] >= 0))
+          swSplicerPipeClose(&pipe);
+      }
+      if (!rtn)
+        swSplicerPipePoolRelease(pool);
+    }
+  }
+  return rtn;
+}
+
+void swSplicerPipePoolRelease(swSplicerPipePool *pool)
+{
+  if (pool)
+  {
+    swSplicerPipe pipe = { .fd = {-1, -1} };
+    while (swFastArrayCount(pool->pipes) && swFastArrayPop(pool->pipes, pipe))
+      swSplicerPipeClose(&pipe);
+    swFastArrayClear(&(pool->pipes));
+  }
+}
+
+bool swSplicerPipePoolGet(swSplicerPipePool *pool, swSplicerPipe *pipe)
+{
+  bool rtn = false;
+  if (pool && pipe)
+  {
+    if ((swFastArrayCount(pool->pipes) && swFastArrayPop(pool->pipes, *pipe)) || swSplicerPipeCreate(pool, pipe))
+    {
+      pool->inUse++;
+      rtn = true;
+    }
+  }
+  return rtn;
+}
+
+void swSplicerPipePoolPut(swSplicerPipePool *pool, swSplicerPipe *pipe, bool empty)
+{
+  if (pool && pipe && (pipe->fd[0] >= 0))
+  {
+    pool->inUse--;
+    if (!empty || (swFastArrayCount(pool->pipes) >= pool->maxIdle) || !swFastArrayPush(pool->pipes, *pipe))
+      swSplicerPipeClose(pipe);
+    pipe->fd[0] = pipe->fd[1] = -1;
+  }
+}
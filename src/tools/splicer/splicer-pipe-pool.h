@@ -0,0 +1,38 @@
+#ifndef SW_TOOLS_SPLICER_SPLICERPIPEPOOL_H
+#define SW_TOOLS_SPLICER_SPLICERPIPEPOOL_H
+
+#include "collections/fast-array.h"
+
+#include <stddef.h>
+
+// pipes kept around between the connections, a new connection pair does not pay for pipe2 and
+// F_SETPIPE_SZ; the pool belongs to one reactor, there is no locking
+//
+// the size above /proc/sys/fs/pipe-max-size needs CAP_SYS_RESOURCE, the pipes keep the size
+// they got then, which is what pipeSize reports
+
+typedef struct swSplicerPipe
+{
+  int fd[2];
+} swSplicerPipe;
+
+typedef struct swSplicerPipePool
+{
+  swFastArray pipes;
+  // size requested and the one the last pipe actually got
+  size_t requestedSize;
+  size_t pipeSize;
+  // pipes kept in the pool at most, the rest are closed when they come back
+  uint32_t maxIdle;
+  uint32_t created;
+  uint32_t inUse;
+} swSplicerPipePool;
+
+bool swSplicerPipePoolInit(swSplicerPipePool *pool, size_t pipeSize, uint32_t initialCount, uint32_t maxIdle);
+void swSplicerPipePoolRelease(swSplicerPipePool *pool);
+
+bool swSplicerPipePoolGet(swSplicerPipePool *pool, swSplicerPipe *pipe);
+// a pipe with data left in it can not be reused, it is closed
+void swSplicerPipePoolPut(swSplicerPipePool *pool, swSplicerPipe *pipe, bool empty);
+
+#endif  // SW_TOOLS_SPLICER_SPLICERPIPEPOOL_H
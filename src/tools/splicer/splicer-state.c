@@ -1,304 +1,596 @@
 #include "tools/splicer/splicer-state.h"
 
+#include "core/clock.h"
 #include "core/memory.h"
+#include "core/time.h"
 #include "log/log-manager.h"
 
 #include <fcntl.h>
-#include <limits.h>
-#include <unistd.h>
+#include <string.h>
+#include <sys/socket.h>
 
 swLoggerDeclareWithLevel(stateLogger, "SplicerState", swLogLevelInfo);
 
-#define SW_SPLICER_DEFAULT_TIMEOUT              60
-#define SW_SPLICER_DEFAULT_CONNECT_TIMEOUT      10
-#define SW_SPLICER_DEFAULT_RECONNECT_INTERVAL   5
+#define SW_SPLICER_INITIAL_PAIRS  64
 
-static bool onAccept(swTCPServerAcceptor *serverAcceptor)
-{
-  SW_LOG_INFO(&stateLogger, "acceptor accepting connection");
-  return true;
-}
+static void swSplicerPairClose(swSplicerPair *pair);
 
-static void onStop(swTCPServerAcceptor *serverAcceptor)
+// the client can not be read from or written to till it is connected
+static inline bool swSplicerIOReady(swSplicerPair *pair, swSocketIO *io)
 {
-  SW_LOG_INFO(&stateLogger, "accepptor stopping");
+  return (((swSocket *)io)->fd >= 0) && ((io != (swSocketIO *)(pair->client)) || pair->connected);
 }
 
-static void onError(swTCPServerAcceptor *serverAcceptor, swSocketIOErrorType errorCode)
+// sends what the mirror pipe holds till the socket is out of space, a failing mirror is closed,
+// the flow goes on without it
+static void swSplicerMirrorDrain(swSplicerMirror *mirror)
 {
-  SW_LOG_ERROR(&stateLogger, "acceptor error \"%s\"", swSocketIOErrorTextGet(errorCode));
+  while (mirror->pipeBytes && mirror->connected)
+  {
+    ssize_t bytes = 0;
+    swSocketReturnType ret = swSocketWriteSplice((swSocket *)(mirror->client), mirror->pipe.fd, mirror->pipeBytes, &bytes);
+    if (ret == swSocketReturnOK)
+    {
+      mirror->pipeBytes -= bytes;
+      mirror->bytes += bytes;
+    }
+    else
+    {
+      if ((ret != swSocketReturnNotReady) || !swSocketIOWriteTimerStart((swSocketIO *)(mirror->client)))
+        swSocketIOClose((swSocketIO *)(mirror->client), swSocketIOErrorSocketError);
+      break;
+    }
+  }
 }
 
-static void onServerReadReady(swTCPServer *server)
+// duplicates the whole pipe of the flow, whatever does not fit into the mirror pipe is lost to the mirror
+static void swSplicerMirrorTee(swSplicerFlow *flow, size_t pipeSize)
 {
-  SW_LOG_TRACE(&stateLogger, "server read ready entered");
-  swSplicerState *splicerState = (swSplicerState *)swTCPServerDataGet(server);
-  if (splicerState)
+  swSplicerMirror *mirror = &(flow->mirror);
+  ssize_t teed = 0;
+  if (!mirror->closed && (mirror->pipeBytes < pipeSize))
   {
-    swSocketReturnType ret = swSocketReturnNone;
-    ssize_t bytesRead = 0;
-    ret = swSocketIOReadSplice((swSocketIO *)server, splicerState->pipeToClient, PIPE_BUF, &bytesRead);
-    if (ret == swSocketReturnOK)
-      splicerState->serverBytesReceived += bytesRead;
+    size_t len = pipeSize - mirror->pipeBytes;
+    if ((teed = tee(flow->pipe.fd[0], mirror->pipe.fd[1], (flow->pipeBytes < len)? flow->pipeBytes : len, SPLICE_F_NONBLOCK)) > 0)
+      mirror->pipeBytes += teed;
+    else
+      teed = 0;
   }
+  if ((size_t)teed < flow->pipeBytes)
+  {
+    mirror->droppedBytes += flow->pipeBytes - teed;
+    mirror->drops++;
+  }
+  flow->mirrorTeed = flow->pipeBytes;
+  swSplicerMirrorDrain(mirror);
 }
 
-static void onServerWriteReady(swTCPServer *server)
+// moves the data of the flow till both sockets are out of it (EAGAIN), the source budget is
+// used up or the pipe is full and the destination can not take more; false on an error
+static bool swSplicerFlowRun(swSplicerPair *pair, swSplicerFlow *flow)
 {
-  SW_LOG_TRACE(&stateLogger, "server write ready entered");
-  swSplicerState *splicerState = (swSplicerState *)swTCPServerDataGet(server);
-  if (splicerState)
+  bool rtn = true;
+  bool progress = true;
+  swSplicerState *state = pair->state;
+  size_t pipeSize = state->pipePool.pipeSize;
+  while (rtn && progress && !flow->shutdown)
   {
+    ssize_t bytes = 0;
     swSocketReturnType ret = swSocketReturnNone;
-    ssize_t bytesWritten = 0;
-    if (splicerState->serverBufferWritten)
+    progress = false;
+    if (!flow->sourceDone && (flow->pipeBytes < pipeSize) && swSplicerIOReady(pair, flow->source)
+        && !swSocketIOBudgetExhausted(flow->source, swEdgeEventRead))
     {
-      ret = swSocketIOWriteSplice((swSocketIO *)server, splicerState->pipeToServer, PIPE_BUF, &bytesWritten);
-      if (ret == swSocketReturnOK)
-        splicerState->serverBytesSent += bytesWritten;
+      swSocketIOCount(flow->source, reads);
+      if ((ret = swSocketIOReadCount(flow->source, swSocketReadSplice((swSocket *)(flow->source), flow->pipe.fd, pipeSize - flow->pipeBytes, &bytes), &bytes)) == swSocketReturnOK)
+      {
+        if (!flow->pipeBytes)
+          flow->filledTime = swClockNow();
+        flow->pipeBytes += bytes;
+        flow->source->budgetUsed += bytes;
+        progress = true;
+      }
+      else if (ret == swSocketReturnClose)
+        flow->sourceDone = progress = true;
+      else if (ret == swSocketReturnNotReady)
+        rtn = swSocketIOReadTimerStart(flow->source);
+      else
+        rtn = false;
     }
-    else
+    if (rtn && flow->mirror.client && !flow->mirrorTeed && flow->pipeBytes)
+      swSplicerMirrorTee(flow, pipeSize);
+    if (rtn && flow->pipeBytes && swSplicerIOReady(pair, flow->destination))
     {
-      ret = swTCPServerWrite(server, (swStaticBuffer *)(&(splicerState->buffer)), &bytesWritten);
-      if (ret == swSocketReturnOK)
+      size_t len = (flow->mirror.client)? flow->mirrorTeed : flow->pipeBytes;
+      swSocketIOCount(flow->destination, writes);
+      if ((ret = swSocketIOWriteCount(flow->destination, swSocketWriteSplice((swSocket *)(flow->destination), flow->pipe.fd, len, &bytes), &bytes)) == swSocketReturnOK)
       {
-        splicerState->serverBytesSent += bytesWritten;
-        splicerState->serverBufferWritten = true;
+        if (bytes > 0)
+        {
+          if (flow->mirror.client)
+            flow->mirrorTeed -= bytes;
+          flow->pipeBytes -= bytes;
+          flow->bytes += bytes;
+          flow->splices++;
+          pair->lastActivity = swEdgeLoopNow(state->loop);
+          if (!flow->pipeBytes)
+          {
+            uint64_t latency = swClockNow() - flow->filledTime;
+            flow->latencyCount++;
+            flow->latencySum += latency;
+            if (latency > flow->latencyMax)
+              flow->latencyMax = latency;
+            swHistogramRecord(&(state->stats.latency), latency);
+          }
+          progress = true;
+        }
       }
+      else if (ret == swSocketReturnNotReady)
+        rtn = swSocketIOWriteTimerStart(flow->destination);
+      else
+        rtn = false;
     }
+    if (rtn && flow->sourceDone && !flow->pipeBytes)
+    {
+      // the end of the data goes on to the destination, the other direction can still be busy
+      if (swSplicerIOReady(pair, flow->destination))
+        shutdown(((swSocket *)(flow->destination))->fd, SHUT_WR);
+      flow->shutdown = true;
+    }
+    // the data left in the pipe can not go anywhere
+    if (((swSocket *)(flow->destination))->fd < 0)
+      flow->shutdown = true;
   }
+  return rtn;
 }
 
-static bool onServerReadTimeout(swTCPServer *server)
+static void swSplicerPairRun(swSplicerPair *pair, swSplicerFlow *flow)
 {
-  SW_LOG_INFO(&stateLogger, "server read timeout");
-  return false;
+  if (!pair->closing)
+  {
+    if (!swSplicerFlowRun(pair, flow))
+    {
+      pair->aborted = true;
+      swSplicerPairClose(pair);
+    }
+    else if (pair->upstream.shutdown && pair->downstream.shutdown)
+      swSplicerPairClose(pair);
+  }
 }
 
-static bool onServerWriteTimeout(swTCPServer *server)
+static void swSplicerFlowStatsLog(swSplicerPair *pair, swSplicerFlow *flow, const char *name)
 {
-  SW_LOG_INFO(&stateLogger, "server write timeout");
-  return false;
+  SW_LOG_INFO(&stateLogger, "pair %p %s: bytes = %lu, splices = %lu, latency avg = %luns, max = %luns", (void *)pair, name,
+    flow->bytes, flow->splices, (flow->latencyCount)? (flow->latencySum / flow->latencyCount) : 0, flow->latencyMax);
+  if (flow->mirror.client)
+    SW_LOG_INFO(&stateLogger, "pair %p %s mirror: bytes = %lu, dropped bytes = %lu, drops = %lu", (void *)pair, name,
+      flow->mirror.bytes, flow->mirror.droppedBytes, flow->mirror.drops);
 }
 
-static void onServerError(swTCPServer *server, swSocketIOErrorType errorCode)
+static void swSplicerMirrorClose(swSplicerState *state, swSplicerMirror *mirror)
 {
-  SW_LOG_ERROR(&stateLogger, "server error \"%s\"", swSocketIOErrorTextGet(errorCode));
+  if (mirror->client)
+  {
+    if (((swSocket *)(mirror->client))->fd >= 0)
+      swSocketIOClose((swSocketIO *)(mirror->client), swSocketIOErrorSocketClose);
+    // what the mirror did not get to send is lost too
+    mirror->droppedBytes += mirror->pipeBytes;
+    swSplicerPipePoolPut(&(state->pipePool), &(mirror->pipe), !mirror->pipeBytes);
+    state->stats.mirrorBytes += mirror->bytes;
+    state->stats.mirrorDroppedBytes += mirror->droppedBytes;
+    state->stats.mirrorDrops += mirror->drops;
+  }
 }
 
-static void onServerClose(swTCPServer *server)
+static void swSplicerCleanupCheckCallback(swEdgeCheck *checkWatcher)
 {
-  SW_LOG_INFO(&stateLogger, "server close");
-  swSplicerState *splicerState = (swSplicerState *)swTCPServerDataGet(server);
-  if (splicerState)
+  swSplicerState *state = swEdgeWatcherDataGet(checkWatcher);
+  if (state)
   {
-    SW_LOG_INFO(&stateLogger, "server bytesSent = %lu, bytesReceived = %lu", splicerState->serverBytesSent, splicerState->serverBytesReceived);
-    splicerState->serverBufferWritten = false;
-    splicerState->server = NULL;
+    swSplicerPair *pair = NULL;
+    while (swFastArrayCount(state->closedPairs) && swFastArrayPop(state->closedPairs, pair))
+    {
+      swTCPServerDelete(pair->server);
+      swTCPClientDelete(pair->client);
+      swTCPClientDelete(pair->upstream.mirror.client);
+      swTCPClientDelete(pair->downstream.mirror.client);
+      swMemoryFree(pair);
+    }
+    swEdgeCheckStop(checkWatcher);
   }
-  swTCPServerDelete(server);
 }
 
-static bool onConnectionSetup(swTCPServerAcceptor *serverAcceptor, swTCPServer *server)
+// the sockets of the pair may still be inside their callbacks, the memory is freed at the end of the iteration
+static void swSplicerPairClose(swSplicerPair *pair)
 {
-  bool rtn = false;
-  SW_LOG_INFO(&stateLogger, "new connection setup for %p", (void *)server);
-  if (serverAcceptor)
+  if (!pair->closing)
   {
-    swSplicerState *splicerState = (swSplicerState *)swTCPServerAcceptorDataGet(serverAcceptor);
-    if (splicerState && !splicerState->server)
-    {
-      if (server)
-      {
-        swTCPServerReadTimeoutSet     (server, SW_SPLICER_DEFAULT_TIMEOUT);
-        swTCPServerWriteTimeoutSet    (server, SW_SPLICER_DEFAULT_TIMEOUT);
-        swTCPServerReadReadyFuncSet   (server, onServerReadReady);
-        swTCPServerWriteReadyFuncSet  (server, onServerWriteReady);
-        swTCPServerReadTimeoutFuncSet (server, onServerReadTimeout);
-        swTCPServerWriteTimeoutFuncSet(server, onServerWriteTimeout);
-        swTCPServerErrorFuncSet       (server, onServerError);
-        swTCPServerCloseFuncSet       (server, onServerClose);
-
-        swTCPServerDataSet(server, splicerState);
-        splicerState->server = server;
-        rtn = true;
-      }
-    }
+    swSplicerState *state = pair->state;
+    swSplicerPair *moved = NULL;
+    pair->closing = true;
+    pair->client->reconnect = false;
+    if (((swSocket *)(pair->server))->fd >= 0)
+      swSocketIOClose((swSocketIO *)(pair->server), swSocketIOErrorSocketClose);
+    if (((swSocket *)(pair->client))->fd >= 0)
+      swSocketIOClose((swSocketIO *)(pair->client), swSocketIOErrorSocketClose);
+    swSplicerPipePoolPut(&(state->pipePool), &(pair->upstream.pipe), !pair->upstream.pipeBytes);
+    swSplicerPipePoolPut(&(state->pipePool), &(pair->downstream.pipe), !pair->downstream.pipeBytes);
+    swSplicerMirrorClose(state, &(pair->upstream.mirror));
+    swSplicerMirrorClose(state, &(pair->downstream.mirror));
+
+    state->stats.closed++;
+    state->stats.bytesUpstream += pair->upstream.bytes;
+    state->stats.bytesDownstream += pair->downstream.bytes;
+    state->stats.splices += pair->upstream.splices + pair->downstream.splices;
+    SW_LOG_INFO(&stateLogger, "pair %p %s, connect latency = %luns", (void *)pair, (pair->aborted)? "aborted" : "closed", pair->connectLatency);
+    swSplicerFlowStatsLog(pair, &(pair->upstream), "upstream");
+    swSplicerFlowStatsLog(pair, &(pair->downstream), "downstream");
+
+    if (swFastRemove(state->pairs, swSplicerPair *, pair->position) && (pair->position < swFastArrayCount(state->pairs))
+        && swFastArrayGet(state->pairs, pair->position, moved))
+      moved->position = pair->position;
+    // the check is running already when this is not the first pair closed in the iteration
+    if (!swFastArrayPush(state->closedPairs, pair)
+        || ((swFastArrayCount(state->closedPairs) == 1) && !swEdgeCheckStart(&(state->cleanupCheck), state->loop)))
+      SW_LOG_ERROR(&stateLogger, "failed to queue pair %p for cleanup", (void *)pair);
   }
-  return rtn;
 }
 
-static void onClientConnected(swTCPClient *client)
+// one of the sockets closed on its own: an error, a timeout or the hang up after both sides
+// shut down their writes
+static void swSplicerIOClose(swSplicerPair *pair, swSocketIO *io)
 {
-  SW_LOG_INFO(&stateLogger, "client connected");
-  // swSplicerState *splicerState = (swSplicerState *)swTCPClientDataGet(client);
+  if (!pair->closing && !pair->starting)
+  {
+    swSplicerFlow *from = (io == (swSocketIO *)(pair->server))? &(pair->upstream) : &(pair->downstream);
+    swSplicerFlow *to = (io == (swSocketIO *)(pair->server))? &(pair->downstream) : &(pair->upstream);
+    from->sourceDone = true;
+    to->shutdown = true;
+    if (pair->aborted)
+      swSplicerPairClose(pair);
+    else
+      swSplicerPairRun(pair, from);
+  }
 }
 
-static void onClientClose(swTCPClient *client)
+static void swSplicerIOError(swSplicerPair *pair, swSocketIOErrorType errorCode)
 {
-  SW_LOG_INFO(&stateLogger, "close");
-  swSplicerState *splicerState = (swSplicerState *)swTCPClientDataGet(client);
-  if (splicerState)
+  if (!pair->closing && !pair->starting && (errorCode != swSocketIOErrorSocketHangUp))
   {
-    SW_LOG_INFO(&stateLogger, "client bytesSent = %lu, bytesReceived = %lu", splicerState->clientBytesSent, splicerState->clientBytesReceived);
-    splicerState->clientBufferWritten = false;
+    SW_LOG_WARNING(&stateLogger, "pair %p error \"%s\"", (void *)pair, swSocketIOErrorTextGet(errorCode));
+    pair->aborted = true;
   }
 }
 
-static void onClientStop(swTCPClient *client)
+// a side waiting for data is fine as long as the other one is busy
+static bool swSplicerIOReadTimeout(swSplicerPair *pair, swSocketIO *io)
 {
-  SW_LOG_INFO(&stateLogger, "client stop");
-  // swSplicerState *splicerState = (swSplicerState *)swTCPClientDataGet(client);
+  return ((pair->lastActivity + io->readTimeout * SW_TIME_1M) > swEdgeLoopNow(pair->state->loop));
 }
 
-static void onClientReadReady(swTCPClient *client)
+static void onServerReadReady(swTCPServer *server)
+{
+  swSplicerPair *pair = swTCPServerDataGet(server);
+  swSplicerPairRun(pair, &(pair->upstream));
+}
+
+static void onServerWriteReady(swTCPServer *server)
+{
+  swSplicerPair *pair = swTCPServerDataGet(server);
+  swSplicerPairRun(pair, &(pair->downstream));
+}
+
+static bool onServerReadTimeout(swTCPServer *server)
 {
-  SW_LOG_TRACE(&stateLogger, "client read ready entered");
-  swSplicerState *splicerState = (swSplicerState *)swTCPClientDataGet(client);
-  if (splicerState)
+  return swSplicerIOReadTimeout(swTCPServerDataGet(server), (swSocketIO *)server);
+}
+
+static void onServerError(swTCPServer *server, swSocketIOErrorType errorCode)
+{
+  swSplicerIOError(swTCPServerDataGet(server), errorCode);
+}
+
+static void onServerClose(swTCPServer *server)
+{
+  swSplicerIOClose(swTCPServerDataGet(server), (swSocketIO *)server);
+}
+
+static void onClientConnected(swTCPClient *client)
+{
+  swSplicerPair *pair = swTCPClientDataGet(client);
+  swSplicerState *state = pair->state;
+  pair->connected = true;
+  pair->connectLatency = swClockNow() - pair->acceptTime;
+  swHistogramRecord(&(state->stats.connectLatency), pair->connectLatency);
+  // connected right away, the accepted connection is not started yet, it gets its events once it is
+  if (!pair->starting)
   {
-    swSocketReturnType ret = swSocketReturnNone;
-    ssize_t bytesRead = 0;
-    ret = swSocketIOReadSplice((swSocketIO *)client, splicerState->pipeToServer, PIPE_BUF, &bytesRead);
-    if (ret == swSocketReturnOK)
-      splicerState->clientBytesReceived += bytesRead;
+    swSplicerPairRun(pair, &(pair->upstream));
+    swSplicerPairRun(pair, &(pair->downstream));
   }
 }
 
+static void onClientReadReady(swTCPClient *client)
+{
+  swSplicerPair *pair = swTCPClientDataGet(client);
+  swSplicerPairRun(pair, &(pair->downstream));
+}
+
 static void onClientWriteReady(swTCPClient *client)
 {
-  SW_LOG_TRACE(&stateLogger, "client write ready entered");
-  swSplicerState *splicerState = (swSplicerState *)swTCPClientDataGet(client);
-  if (splicerState)
+  swSplicerPair *pair = swTCPClientDataGet(client);
+  swSplicerPairRun(pair, &(pair->upstream));
+}
+
+static bool onClientReadTimeout(swTCPClient *client)
+{
+  return swSplicerIOReadTimeout(swTCPClientDataGet(client), (swSocketIO *)client);
+}
+
+static void onClientError(swTCPClient *client, swSocketIOErrorType errorCode)
+{
+  swSplicerIOError(swTCPClientDataGet(client), errorCode);
+}
+
+static void onClientClose(swTCPClient *client)
+{
+  swSplicerPair *pair = swTCPClientDataGet(client);
+  if (!pair->connected)
   {
-    swSocketReturnType ret = swSocketReturnNone;
-    ssize_t bytesWritten = 0;
-    if (splicerState->clientBufferWritten)
-    {
-      ret = swSocketIOWriteSplice((swSocketIO *)client, splicerState->pipeToClient, PIPE_BUF, &bytesWritten);
-      if (ret == swSocketReturnOK)
-        splicerState->clientBytesSent += bytesWritten;
-    }
-    else
+    if (!pair->closing)
     {
-      ret = swTCPClientWrite(client, (swStaticBuffer *)(&(splicerState->buffer)), &bytesWritten);
-      if (ret == swSocketReturnOK)
-      {
-        splicerState->clientBytesSent += bytesWritten;
-        splicerState->clientBufferWritten = true;
-      }
+      pair->state->stats.connectFailures++;
+      pair->failed = pair->aborted = true;
     }
+    if (!pair->starting)
+      swSplicerPairClose(pair);
   }
+  else
+    swSplicerIOClose(pair, (swSocketIO *)client);
 }
 
-static bool onClientReadTimeout(swTCPClient *client)
+static inline swSplicerMirror *swSplicerMirrorGet(swTCPClient *client)
 {
-  SW_LOG_INFO(&stateLogger, "client read timeout");
-  return false;
+  swSplicerPair *pair = swTCPClientDataGet(client);
+  return (pair->upstream.mirror.client == client)? &(pair->upstream.mirror) : &(pair->downstream.mirror);
 }
 
-static bool onClientWriteTimeout(swTCPClient *client)
+static void onMirrorConnected(swTCPClient *client)
 {
-  SW_LOG_INFO(&stateLogger, "client write timeout");
-  return false;
+  swSplicerMirror *mirror = swSplicerMirrorGet(client);
+  mirror->connected = true;
+  swSplicerMirrorDrain(mirror);
 }
 
-static void onClientError(swTCPClient *client, swSocketIOErrorType errorCode)
+static void onMirrorWriteReady(swTCPClient *client)
 {
-  SW_LOG_ERROR(&stateLogger, "client error \"%s\"", swSocketIOErrorTextGet(errorCode));
+  swSplicerMirrorDrain(swSplicerMirrorGet(client));
 }
 
-void swSplicerStateDelete(swSplicerState *splicerState)
+static void onMirrorError(swTCPClient *client, swSocketIOErrorType errorCode)
 {
-  if (splicerState)
+  swSplicerPair *pair = swTCPClientDataGet(client);
+  if (!pair->closing)
+    SW_LOG_WARNING(&stateLogger, "pair %p mirror error \"%s\"", (void *)pair, swSocketIOErrorTextGet(errorCode));
+}
+
+static void onMirrorClose(swTCPClient *client)
+{
+  swSplicerMirror *mirror = swSplicerMirrorGet(client);
+  mirror->connected = false;
+  mirror->closed = true;
+}
+
+// the mirror connections are not needed for the pair to work, a mirror that fails to start is
+// closed and counts the data it misses
+static void swSplicerMirrorStart(swSplicerPair *pair, swSplicerMirror *mirror)
+{
+  swSplicerState *state = pair->state;
+  if ((mirror->client = swTCPClientNew()))
   {
-    if (splicerState->client)
+    if (swSplicerPipePoolGet(&(state->pipePool), &(mirror->pipe)))
     {
-      swTCPClientStop(splicerState->client);
-      swTCPClientDelete(splicerState->client);
+      mirror->client->reconnect = false;
+      swTCPClientDataSet              (mirror->client, pair);
+      swTCPClientWriteTimeoutSet      (mirror->client, state->config.timeout);
+      swTCPClientConnectTimeoutSet    (mirror->client, state->config.connectTimeout);
+      swTCPClientConnectedFuncSet     (mirror->client, onMirrorConnected);
+      swTCPClientCloseFuncSet         (mirror->client, onMirrorClose);
+      swTCPClientWriteReadyFuncSet    (mirror->client, onMirrorWriteReady);
+      swTCPClientErrorFuncSet         (mirror->client, onMirrorError);
+      swTCPClientStart(mirror->client, &(state->mirrorAddress), state->loop, NULL);
     }
-    if (splicerState->server)
-      swTCPServerStop(splicerState->server);
-    if (splicerState->acceptor)
+    else
     {
-      swTCPServerAcceptorStop(splicerState->acceptor);
-      swTCPServerAcceptorDelete(splicerState->acceptor);
+      swTCPClientDelete(mirror->client);
+      mirror->client = NULL;
     }
-    swDynamicBufferRelease(&(splicerState->buffer));
-    if (splicerState->pipeToServer[0] >= 0)
-      close(splicerState->pipeToServer[0]);
-    if (splicerState->pipeToServer[1] >= 0)
-      close(splicerState->pipeToServer[1]);
-    if (splicerState->pipeToClient[0] >= 0)
-      close(splicerState->pipeToClient[0]);
-    if (splicerState->pipeToClient[1] >= 0)
-      close(splicerState->pipeToClient[1]);
-    swMemoryFree(splicerState);
   }
 }
 
-swSplicerState *swSplicerStateNew(swEdgeLoop *loop, swSocketAddress *address, size_t bufferSize)
+static void onAcceptorError(swTCPServerAcceptor *serverAcceptor, swSocketIOErrorType errorCode)
 {
-  swSplicerState *rtn = NULL;
-  if (loop && address && bufferSize)
+  SW_LOG_ERROR(&stateLogger, "acceptor error \"%s\"", swSocketIOErrorTextGet(errorCode));
+}
+
+static void swSplicerFlowInit(swSplicerFlow *flow, swSocketIO *source, swSocketIO *destination)
+{
+  flow->source = source;
+  flow->destination = destination;
+  flow->pipe.fd[0] = flow->pipe.fd[1] = -1;
+  flow->mirror.pipe.fd[0] = flow->mirror.pipe.fd[1] = -1;
+}
+
+static void swSplicerSocketIOSetup(swSocketIO *io, swSplicerState *state, swSplicerPair *pair)
+{
+  swSocketIODataSet(io, pair);
+  swSocketIOReadTimeoutSet(io, state->config.timeout);
+  swSocketIOWriteTimeoutSet(io, state->config.timeout);
+  swSocketIOBudgetSet(io, state->config.budget);
+  // both sides shut down their writes one after the other, the data still on the way has to go through
+  swSocketIOHangUpReadSet(io, true);
+}
+
+static bool onConnectionSetup(swTCPServerAcceptor *serverAcceptor, swTCPServer *server)
+{
+  bool rtn = false;
+  swSplicerState *state = swTCPServerAcceptorDataGet(serverAcceptor);
+  swSplicerPair *pair = NULL;
+  if (state && server && (pair = swMemoryCalloc(1, sizeof(*pair))))
   {
-    swSplicerState *splicerState = swMemoryCalloc(1, sizeof(*rtn));
-    if (splicerState)
+    state->stats.accepted++;
+    pair->state = state;
+    pair->server = server;
+    pair->acceptTime = swClockNow();
+    pair->lastActivity = swEdgeLoopNow(state->loop);
+    swSplicerFlowInit(&(pair->upstream), (swSocketIO *)server, NULL);
+    swSplicerFlowInit(&(pair->downstream), NULL, (swSocketIO *)server);
+    if ((pair->client = swTCPClientNew()))
     {
-      if (swDynamicBufferInit(&(splicerState->buffer), (size_t)bufferSize))
+      pair->client->reconnect = false;
+      pair->upstream.destination = pair->downstream.source = (swSocketIO *)(pair->client);
+      if (swSplicerPipePoolGet(&(state->pipePool), &(pair->upstream.pipe)))
       {
-        // set all the memory in the buffer to make valgrind happy
-        memset(splicerState->buffer.data, 0, bufferSize);
-        splicerState->buffer.len = bufferSize;
-        splicerState->acceptor = swTCPServerAcceptorNew();
-        if (splicerState->acceptor)
+        if (swSplicerPipePoolGet(&(state->pipePool), &(pair->downstream.pipe)))
         {
-          // set callbacks
-          swTCPServerAcceptorAcceptFuncSet  (splicerState->acceptor, onAccept);
-          swTCPServerAcceptorStopFuncSet    (splicerState->acceptor, onStop);
-          swTCPServerAcceptorErrorFuncSet   (splicerState->acceptor, onError);
-          swTCPServerAcceptorSetupFuncSet   (splicerState->acceptor, onConnectionSetup);
+          swSplicerSocketIOSetup((swSocketIO *)server, state, pair);
+          swTCPServerReadReadyFuncSet   (server, onServerReadReady);
+          swTCPServerWriteReadyFuncSet  (server, onServerWriteReady);
+          swTCPServerReadTimeoutFuncSet (server, onServerReadTimeout);
+          swTCPServerErrorFuncSet       (server, onServerError);
+          swTCPServerCloseFuncSet       (server, onServerClose);
+
+          swSplicerSocketIOSetup((swSocketIO *)(pair->client), state, pair);
+          swTCPClientConnectTimeoutSet    (pair->client, state->config.connectTimeout);
+          swTCPClientConnectedFuncSet     (pair->client, onClientConnected);
+          swTCPClientCloseFuncSet         (pair->client, onClientClose);
+          swTCPClientReadReadyFuncSet     (pair->client, onClientReadReady);
+          swTCPClientWriteReadyFuncSet    (pair->client, onClientWriteReady);
+          swTCPClientReadTimeoutFuncSet   (pair->client, onClientReadTimeout);
+          swTCPClientErrorFuncSet         (pair->client, onClientError);
+
+          swSocketIOStatsAdd(&(state->transport), (swSocketIO *)server);
+          swSocketIOStatsAdd(&(state->transport), (swSocketIO *)(pair->client));
 
-          if (swTCPServerAcceptorStart(splicerState->acceptor, loop, address))
+          pair->position = swFastArrayCount(state->pairs);
+          if (swFastArrayPush(state->pairs, pair))
           {
-            swTCPServerAcceptorDataSet(splicerState->acceptor, splicerState);
-            splicerState->client = swTCPClientNew();
-            if (splicerState->client)
+            pair->starting = true;
+            rtn = swTCPClientStart(pair->client, &(state->forwardAddress), state->loop, NULL) && !pair->failed;
+            pair->starting = false;
+            if (!rtn)
+              swFastRemove(state->pairs, swSplicerPair *, pair->position);
+            else if (state->mirror)
             {
-              // set callbacks and timeouts
-              swTCPClientConnectTimeoutSet    (splicerState->client, SW_SPLICER_DEFAULT_CONNECT_TIMEOUT);
-              swTCPClientReconnectTimeoutSet  (splicerState->client, SW_SPLICER_DEFAULT_RECONNECT_INTERVAL);
-              swTCPClientConnectedFuncSet     (splicerState->client, onClientConnected);
-              swTCPClientCloseFuncSet         (splicerState->client, onClientClose);
-              swTCPClientStopFuncSet          (splicerState->client, onClientStop);
-
-              swTCPClientReadTimeoutSet       (splicerState->client, SW_SPLICER_DEFAULT_TIMEOUT);
-              swTCPClientWriteTimeoutSet      (splicerState->client, SW_SPLICER_DEFAULT_TIMEOUT);
-              swTCPClientReadReadyFuncSet     (splicerState->client, onClientReadReady);
-              swTCPClientWriteReadyFuncSet    (splicerState->client, onClientWriteReady);
-              swTCPClientReadTimeoutFuncSet   (splicerState->client, onClientReadTimeout);
-              swTCPClientWriteTimeoutFuncSet  (splicerState->client, onClientWriteTimeout);
-              swTCPClientErrorFuncSet         (splicerState->client, onClientError);
-
-              if (swTCPClientStart(splicerState->client, address, loop, NULL))
-              {
-                swTCPClientDataSet(splicerState->client, splicerState);
-                if(pipe2(splicerState->pipeToServer, O_CLOEXEC | O_NONBLOCK) == 0)
-                {
-                  if(pipe2(splicerState->pipeToClient, O_CLOEXEC | O_NONBLOCK) == 0)
-                    rtn = splicerState;
-                  else
-                    splicerState->pipeToClient[0] = splicerState->pipeToClient[1] = -1;
-                }
-                else
-                  splicerState->pipeToServer[0] = splicerState->pipeToServer[1] = -1;
-              }
+              swSplicerMirrorStart(pair, &(pair->upstream.mirror));
+              swSplicerMirrorStart(pair, &(pair->downstream.mirror));
             }
           }
+          if (!rtn)
+            swSplicerPipePoolPut(&(state->pipePool), &(pair->downstream.pipe), true);
+        }
+        if (!rtn)
+          swSplicerPipePoolPut(&(state->pipePool), &(pair->upstream.pipe), true);
+      }
+      if (!rtn)
+        swTCPClientDelete(pair->client);
+    }
+    if (!rtn)
+    {
+      // the acceptor deletes the server
+      SW_LOG_WARNING(&stateLogger, "failed to set up the connection to the forward address");
+      swMemoryFree(pair);
+    }
+  }
+  return rtn;
+}
+
+static void swSplicerTransportStatsLog(swSocketIOStats *transport)
+{
+  const swSocketIOCounters *counters = swSocketIOStatsCountersGet(transport);
+  SW_LOG_INFO(&stateLogger, "transport reads = %lu, writes = %lu, syscalls = %lu, not ready reads = %lu, writes = %lu, timeouts = %lu, retransmits = %lu",
+    counters->reads, counters->writes, counters->syscalls, counters->readNotReady, counters->writeNotReady,
+    counters->readTimeouts + counters->writeTimeouts, counters->retransmits);
+  if (transport->samples)
+    SW_LOG_INFO(&stateLogger, "tcp info samples = %lu, rtt p50 = %luus, p99 = %luus, rttvar p50 = %luus, cwnd p50 = %lu, delivery rate p50 = %lu bytes/s",
+      transport->samples, swHistogramPercentileGet(&(transport->rtt), 50.0), swHistogramPercentileGet(&(transport->rtt), 99.0),
+      swHistogramPercentileGet(&(transport->rttVar), 50.0), swHistogramPercentileGet(&(transport->cwnd), 50.0),
+      swHistogramPercentileGet(&(transport->deliveryRate), 50.0));
+}
+
+void swSplicerStateDelete(swSplicerState *state)
+{
+  if (state)
+  {
+    swSplicerPair *pair = NULL;
+    if (state->acceptor)
+    {
+      swTCPServerAcceptorStop(state->acceptor);
+      swTCPServerAcceptorDelete(state->acceptor);
+    }
+    while (swFastArrayCount(state->pairs) && swFastArrayGet(state->pairs, 0, pair))
+      swSplicerPairClose(pair);
+    swSplicerCleanupCheckCallback(&(state->cleanupCheck));
+    swEdgeCheckClose(&(state->cleanupCheck));
+    if (state->stats.accepted)
+    {
+      SW_LOG_INFO(&stateLogger, "accepted = %lu, closed = %lu, connect failures = %lu, bytes upstream = %lu, downstream = %lu, splices = %lu",
+        state->stats.accepted, state->stats.closed, state->stats.connectFailures, state->stats.bytesUpstream, state->stats.bytesDownstream, state->stats.splices);
+      if (state->mirror)
+        SW_LOG_INFO(&stateLogger, "mirror bytes = %lu, dropped bytes = %lu, drops = %lu", state->stats.mirrorBytes, state->stats.mirrorDroppedBytes, state->stats.mirrorDrops);
+      SW_LOG_INFO(&stateLogger, "latency p50 = %luns, p99 = %luns, max = %luns; connect latency p50 = %luns, p99 = %luns",
+        swHistogramPercentileGet(&(state->stats.latency), 50.0), swHistogramPercentileGet(&(state->stats.latency), 99.0), state->stats.latency.max,
+        swHistogramPercentileGet(&(state->stats.connectLatency), 50.0), swHistogramPercentileGet(&(state->stats.connectLatency), 99.0));
+      swSplicerTransportStatsLog(&(state->transport));
+    }
+    swSocketIOStatsCleanup(&(state->transport));
+    swFastArrayClear(&(state->closedPairs));
+    swFastArrayClear(&(state->pairs));
+    swSplicerPipePoolRelease(&(state->pipePool));
+    swMemoryFree(state);
+  }
+}
+
+swSplicerState *swSplicerStateNew(swEdgeLoop *loop, swSocketAddress *address, swSocketAddress *forwardAddress, swSocketAddress *mirrorAddress, swSplicerConfig *config)
+{
+  swSplicerState *rtn = NULL;
+  if (loop && address && forwardAddress && config)
+  {
+    swSplicerState *state = swMemoryCalloc(1, sizeof(*state));
+    if (state)
+    {
+      state->loop = loop;
+      state->forwardAddress = *forwardAddress;
+      if (mirrorAddress)
+      {
+        state->mirrorAddress = *mirrorAddress;
+        state->mirror = true;
+      }
+      state->config = *config;
+      if (!state->config.timeout)
+        state->config.timeout = SW_SOCKETIO_DEFAULT_TIMEOUT;
+      if (!state->config.connectTimeout)
+        state->config.connectTimeout = SW_SOCKETIO_DEFAULT_TIMEOUT;
+      // initialized first, the delete of a state that failed to start cleans it up
+      if (swSocketIOStatsInit(&(state->transport)) && swSocketIOStatsStart(&(state->transport), loop, config->statsInterval)
+          && swFastArrayInit(&(state->pairs), sizeof(swSplicerPair *), SW_SPLICER_INITIAL_PAIRS)
+          && swFastArrayInit(&(state->closedPairs), sizeof(swSplicerPair *), SW_SPLICER_INITIAL_PAIRS)
+          && swSplicerPipePoolInit(&(state->pipePool), config->pipeSize, config->pipePoolSize, config->pipePoolSize)
+          && swEdgeCheckInit(&(state->cleanupCheck), swSplicerCleanupCheckCallback))
+      {
+        swEdgeWatcherDataSet(&(state->cleanupCheck), state);
+        if ((state->acceptor = swTCPServerAcceptorNew()))
+        {
+          swTCPServerAcceptorErrorFuncSet   (state->acceptor, onAcceptorError);
+          swTCPServerAcceptorSetupFuncSet   (state->acceptor, onConnectionSetup);
+          swTCPServerAcceptorReusePortSet   (state->acceptor, config->reusePort);
+          swTCPServerAcceptorDataSet        (state->acceptor, state);
+          if (swTCPServerAcceptorStart(state->acceptor, loop, address))
+            rtn = state;
         }
       }
       if (!rtn)
-        swSplicerStateDelete(splicerState);
+        swSplicerStateDelete(state);
     }
   }
   return rtn;
@@ -1,27 +1,132 @@
 #ifndef SW_TOOLS_SPLICER_SPLICERSTATE_H
 #define SW_TOOLS_SPLICER_SPLICERSTATE_H
 
+#include "core/histogram.h"
+#include "io/edge-check.h"
+#include "io/socket-io-stats.h"
 #include "io/tcp-client.h"
 #include "io/tcp-server.h"
-#include "storage/dynamic-buffer.h"
+#include "tools/splicer/splicer-pipe-pool.h"
 
-typedef struct swSplicerState
+// one reactor of the splicer: the connections accepted on the address are paired with the ones
+// it opens to the forward address and the data of both directions is moved with splice through
+// a pipe, it never gets to the user space; every reactor has a loop, an acceptor, a pipe pool
+// and the pairs of its own, several of them share the address with SO_REUSEPORT
+
+typedef struct swSplicerState swSplicerState;
+typedef struct swSplicerPair swSplicerPair;
+
+// copy of one direction sent to the mirror address: tee(2) duplicates the pipe of the flow into
+// the pipe of the mirror without copying the data, the mirror socket drains it; a mirror that
+// can not keep up loses data instead of slowing down the flow
+typedef struct swSplicerMirror
 {
-  swTCPServerAcceptor *acceptor;
+  swTCPClient *client;
+  swSplicerPipe pipe;
+  size_t pipeBytes;
+  uint64_t bytes;
+  // bytes the mirror missed and the number of times it happened
+  uint64_t droppedBytes;
+  uint64_t drops;
+  unsigned int connected : 1;
+  unsigned int closed : 1;
+} swSplicerMirror;
+
+// one direction of a pair
+typedef struct swSplicerFlow
+{
+  swSocketIO *source;
+  swSocketIO *destination;
+  swSplicerPipe pipe;
+  size_t pipeBytes;
+  uint64_t bytes;
+  uint64_t splices;
+  // time the data got into the empty pipe, the latency is the time till the pipe is empty again
+  uint64_t filledTime;
+  uint64_t latencyCount;
+  uint64_t latencySum;
+  uint64_t latencyMax;
+  // tee copies from the start of the pipe, only the bytes already handed to the mirror are written
+  // to the destination, the rest of the pipe is teed once they are gone
+  swSplicerMirror mirror;
+  size_t mirrorTeed;
+  unsigned int sourceDone : 1;
+  unsigned int shutdown : 1;
+} swSplicerFlow;
+
+struct swSplicerPair
+{
+  swSplicerState *state;
+  // accepted connection and the one to the forward address
   swTCPServer *server;
   swTCPClient *client;
-  swDynamicBuffer buffer;
-  int pipeToServer[2];
-  int pipeToClient[2];
-  uint64_t serverBytesSent;
-  uint64_t serverBytesReceived;
-  uint64_t clientBytesSent;
-  uint64_t clientBytesReceived;
-  unsigned clientBufferWritten : 1;
-  unsigned serverBufferWritten : 1;
-} swSplicerState;
-
-swSplicerState *swSplicerStateNew(swEdgeLoop *loop, swSocketAddress *address, size_t bufferSize);
+  // from the accepted connection to the forward address and back
+  swSplicerFlow upstream;
+  swSplicerFlow downstream;
+  uint64_t acceptTime;
+  uint64_t connectLatency;
+  // loop time of the last bytes moved, the read timeout closes the pair only when both sides are idle
+  uint64_t lastActivity;
+  uint32_t position;
+  unsigned int starting : 1;
+  unsigned int failed : 1;
+  unsigned int connected : 1;
+  unsigned int aborted : 1;
+  unsigned int closing : 1;
+};
+
+typedef struct swSplicerStats
+{
+  uint64_t accepted;
+  uint64_t closed;
+  uint64_t connectFailures;
+  uint64_t bytesUpstream;
+  uint64_t bytesDownstream;
+  uint64_t splices;
+  uint64_t mirrorBytes;
+  uint64_t mirrorDroppedBytes;
+  uint64_t mirrorDrops;
+  // nanoseconds the data spent in the pipes and the connect times to the forward address
+  swHistogram latency;
+  swHistogram connectLatency;
+} swSplicerStats;
+
+typedef struct swSplicerConfig
+{
+  size_t pipeSize;
+  uint32_t pipePoolSize;
+  // bytes a direction moves in one wake up before the others get their turn, 0 till EAGAIN
+  uint64_t budget;
+  // milliseconds
+  uint64_t timeout;
+  uint64_t connectTimeout;
+  // TCP_INFO sample interval of the connections, 0 for the samples at close only
+  uint64_t statsInterval;
+  bool reusePort;
+} swSplicerConfig;
+
+struct swSplicerState
+{
+  swEdgeLoop *loop;
+  swTCPServerAcceptor *acceptor;
+  swSocketAddress forwardAddress;
+  swSocketAddress mirrorAddress;
+  swSplicerConfig config;
+  swSplicerPipePool pipePool;
+  swFastArray pairs;
+  // closed in this loop iteration, freed once the callbacks are done with them
+  swFastArray closedPairs;
+  swEdgeCheck cleanupCheck;
+  swSplicerStats stats;
+  // counters and TCP_INFO samples of both sides of the pairs
+  swSocketIOStats transport;
+  bool mirror;
+};
+
+// both directions of every pair are mirrored to their own connection to mirrorAddress, NULL for none
+swSplicerState *swSplicerStateNew(swEdgeLoop *loop, swSocketAddress *address, swSocketAddress *forwardAddress, swSocketAddress *mirrorAddress, swSplicerConfig *config);
 void swSplicerStateDelete(swSplicerState *state);
 
+#define swSplicerStatePairCountGet(s)  swFastArrayCount((s)->pairs)
+
 #endif  // SW_TOOLS_SPLICER_SPLICERSTATE_H
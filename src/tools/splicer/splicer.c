@@ -4,12 +4,14 @@
 #include "command-line/command-line.h"
 #include "init/init.h"
 #include "init/init-command-line.h"
+#include "init/init-clock.h"
 #include "init/init-cpu-timer.h"
 #include "init/init-io.h"
 #include "init/init-log-manager.h"
 #include "init/init-thread-manager.h"
 #include "log/log-manager.h"
-#include "storage/dynamic-buffer.h"
+#include "core/memory.h"
+#include "thread/thread-manager.h"
 
 #include <limits.h>
 #include <signal.h>
@@ -17,35 +19,146 @@
 
 swLoggerDeclareWithLevel(splicerLogger, "Splicer", swLogLevelInfo);
 
-static swStaticString ipAddress  = swStaticStringDefineEmpty;
+static swStaticString ipAddress         = swStaticStringDefineEmpty;
+static swStaticString forwardIPAddress  = swStaticStringDefineEmpty;
+static swStaticString mirrorIPAddress   = swStaticStringDefineEmpty;
 
-static int64_t port   = 0;
-static int64_t bufferSize   = 0;
+static int64_t port         = 0;
+static int64_t forwardPort  = 0;
+static int64_t mirrorPort   = 0;
+static int64_t pipeSize     = 0;
+static int64_t pipePoolSize = 0;
+static int64_t spliceBudget = 0;
+static int64_t timeout      = 0;
+static int64_t threadCount  = 0;
+static int64_t statsInterval = 0;
 
 static swStaticArray defaultIPAddress = swStaticArrayDefine((swStaticString[]){swStaticStringDefine("127.0.0.1")}, swStaticString);
 
-swStaticArray defaultPort       = swStaticArrayDefine(((int64_t[]){6666}),  int64_t);
-swStaticArray defaultBufferSize = swStaticArrayDefine(((int64_t[]){256}),   int64_t);
+swStaticArray defaultPort         = swStaticArrayDefine(((int64_t[]){6666}),    int64_t);
+swStaticArray defaultForwardPort  = swStaticArrayDefine(((int64_t[]){7777}),    int64_t);
+swStaticArray defaultMirrorPort   = swStaticArrayDefine(((int64_t[]){0}),       int64_t);
+swStaticArray defaultPipeSize     = swStaticArrayDefine(((int64_t[]){262144}),  int64_t);
+swStaticArray defaultPipePoolSize = swStaticArrayDefine(((int64_t[]){64}),      int64_t);
+swStaticArray defaultSpliceBudget = swStaticArrayDefine(((int64_t[]){1048576}), int64_t);
+swStaticArray defaultTimeout      = swStaticArrayDefine(((int64_t[]){60000}),   int64_t);
+swStaticArray defaultThreadCount  = swStaticArrayDefine(((int64_t[]){1}),       int64_t);
+swStaticArray defaultStatsInterval = swStaticArrayDefine(((int64_t[]){1000}),   int64_t);
 
 swOptionCategoryMainDeclare(swSplicerMainOptions, "Splicer Main Options",
-  swOptionDeclareScalarWithDefault("ip-address|ip", "IP address for listening/connecting",  "IP",   &defaultIPAddress,
-    &ipAddress,   swOptionValueTypeString,  false),
-  swOptionDeclareScalarWithDefault("port|p",        "Port for listening/connecting",        "PORT", &defaultPort,
-    &port,        swOptionValueTypeInt,     false),
-  swOptionDeclareScalarWithDefault("buffer-size|b", "Initial buffer size",                  NULL,   &defaultBufferSize,
-    &bufferSize,  swOptionValueTypeInt,     false)
+  swOptionDeclareScalarWithDefault("ip-address|ip",         "IP address for listening",                   "IP",   &defaultIPAddress,
+    &ipAddress,         swOptionValueTypeString,  false),
+  swOptionDeclareScalarWithDefault("port|p",                "Port for listening",                         "PORT", &defaultPort,
+    &port,              swOptionValueTypeInt,     false),
+  swOptionDeclareScalarWithDefault("forward-ip-address|fip", "IP address the connections are forwarded to", "IP",   &defaultIPAddress,
+    &forwardIPAddress,  swOptionValueTypeString,  false),
+  swOptionDeclareScalarWithDefault("forward-port|fp",       "Port the connections are forwarded to",      "PORT", &defaultForwardPort,
+    &forwardPort,       swOptionValueTypeInt,     false),
+  swOptionDeclareScalarWithDefault("mirror-ip-address|mip", "IP address both directions are mirrored to", "IP",   &defaultIPAddress,
+    &mirrorIPAddress,   swOptionValueTypeString,  false),
+  swOptionDeclareScalarWithDefault("mirror-port|mp",        "Port of the mirror, 0 for no mirroring",     "PORT", &defaultMirrorPort,
+    &mirrorPort,        swOptionValueTypeInt,     false),
+  swOptionDeclareScalarWithDefault("pipe-size|s",           "Size of the splice pipes (F_SETPIPE_SZ)",    NULL,   &defaultPipeSize,
+    &pipeSize,          swOptionValueTypeInt,     false),
+  swOptionDeclareScalarWithDefault("pipe-pool",             "Pipes kept for reuse by every thread",       NULL,   &defaultPipePoolSize,
+    &pipePoolSize,      swOptionValueTypeInt,     false),
+  swOptionDeclareScalarWithDefault("splice-budget",         "Bytes a connection moves per wake up, 0 for no limit", NULL, &defaultSpliceBudget,
+    &spliceBudget,      swOptionValueTypeInt,     false),
+  swOptionDeclareScalarWithDefault("timeout|t",             "Idle and write timeout in milli seconds",    NULL,   &defaultTimeout,
+    &timeout,           swOptionValueTypeInt,     false),
+  swOptionDeclareScalarWithDefault("threads|n",             "Number of threads accepting and splicing",   NULL,   &defaultThreadCount,
+    &threadCount,       swOptionValueTypeInt,     false),
+  swOptionDeclareScalarWithDefault("stats-interval",        "TCP_INFO sample interval in milli seconds, 0 for the samples at close only", NULL, &defaultStatsInterval,
+    &statsInterval,     swOptionValueTypeInt,     false)
 );
 
-static void *splicerArrayData[1] = {NULL};
+// every reactor runs its own loop with its own acceptor on the shared address, the first one
+// runs on the main loop, the rest on threads of their own
+typedef struct swSplicerReactor
+{
+  swEdgeLoop *loop;
+  swSplicerState *state;
+  swEdgeAsync stopEvent;
+  bool started;
+  bool done;
+} swSplicerReactor;
+
+static void *splicerArrayData[2] = {NULL};
+
+static swSplicerReactor *reactors = NULL;
+static uint32_t reactorCount = 0;
+
+static void swSplicerReactorStopCallback(swEdgeAsync *asyncWatcher, eventfd_t eventCount, uint32_t events)
+{
+  swSplicerReactor *reactor = swEdgeWatcherDataGet(asyncWatcher);
+  swEdgeLoopBreak(reactor->loop);
+}
+
+static void *swSplicerReactorRun(swSplicerReactor *reactor)
+{
+  swEdgeLoopRun(reactor->loop, false);
+  return NULL;
+}
+
+static void swSplicerReactorStop(swSplicerReactor *reactor)
+{
+  swEdgeAsyncSend(&(reactor->stopEvent));
+}
 
-static swSplicerState *splicerState = NULL;
+static void swSplicerReactorDone(swSplicerReactor *reactor, void *returnValue)
+{
+  reactor->done = true;
+}
+
+// the loop is the main one for the first reactor, the others get a loop and a thread of their own
+static bool swSplicerReactorStart(swSplicerReactor *reactor, swEdgeLoop *loop, swThreadManager *threadManager,
+  swSocketAddress *address, swSocketAddress *forwardAddress, swSocketAddress *mirrorAddress, swSplicerConfig *config)
+{
+  bool rtn = false;
+  if (loop)
+  {
+    reactor->loop = loop;
+    rtn = ((reactor->state = swSplicerStateNew(loop, address, forwardAddress, mirrorAddress, config)) != NULL);
+  }
+  else if ((reactor->loop = swEdgeLoopNew()) && swEdgeAsyncInit(&(reactor->stopEvent), swSplicerReactorStopCallback))
+  {
+    swEdgeWatcherDataSet(&(reactor->stopEvent), reactor);
+    if (swEdgeAsyncStart(&(reactor->stopEvent), reactor->loop)
+        && (reactor->state = swSplicerStateNew(reactor->loop, address, forwardAddress, mirrorAddress, config)))
+    {
+      rtn = reactor->started = swThreadManagerStartThread(threadManager, (swThreadRunFunction)swSplicerReactorRun,
+        (swThreadStopFunction)swSplicerReactorStop, (swThreadDoneFunction)swSplicerReactorDone, reactor);
+    }
+  }
+  return rtn;
+}
 
 static void swSplicerStop()
 {
-  if (splicerState)
+  if (reactors)
   {
-    swSplicerStateDelete(splicerState);
-    splicerState = NULL;
+    swThreadManager **threadManagerPtr = (swThreadManager **)splicerArrayData[1];
+    for (uint32_t i = 0; i < reactorCount; i++)
+    {
+      swSplicerReactor *reactor = &(reactors[i]);
+      if (reactor->started)
+      {
+        while (!(reactor->done))
+        {
+          swSplicerReactorStop(reactor);
+          swEdgeLoopRun((*threadManagerPtr)->loop, true);
+        }
+      }
+      swSplicerStateDelete(reactor->state);
+      if (reactor->loop && (reactor->loop != *((swEdgeLoop **)splicerArrayData[0])))
+      {
+        swEdgeAsyncClose(&(reactor->stopEvent));
+        swEdgeLoopDelete(reactor->loop);
+      }
+    }
+    swMemoryFree(reactors);
+    reactors = NULL;
+    reactorCount = 0;
   }
 }
 
@@ -53,15 +166,33 @@ static bool swSplicerStart()
 {
   bool rtn = false;
   swEdgeLoop **loopPtr = (swEdgeLoop **)splicerArrayData[0];
-  if (loopPtr && *loopPtr)
+  swThreadManager **threadManagerPtr = (swThreadManager **)splicerArrayData[1];
+  if (loopPtr && *loopPtr && threadManagerPtr && *threadManagerPtr)
   {
-    if (bufferSize > 0 && port > 0 && port <= USHRT_MAX && ipAddress.len)
+    if ((port > 0) && (port <= USHRT_MAX) && (forwardPort > 0) && (forwardPort <= USHRT_MAX) && ipAddress.len && forwardIPAddress.len
+        && (mirrorPort >= 0) && (mirrorPort <= USHRT_MAX) && (pipeSize >= 0) && (pipePoolSize >= 0) && (spliceBudget >= 0) && (timeout >= 0) && (threadCount > 0) && (statsInterval >= 0))
     {
       swSocketAddress address = { 0 };
-      if (swSocketAddressInitInet(&address, ipAddress.data, port))
+      swSocketAddress forwardAddress = { 0 };
+      swSocketAddress mirrorAddress = { 0 };
+      if (swSocketAddressInitInet(&address, ipAddress.data, port) && swSocketAddressInitInet(&forwardAddress, forwardIPAddress.data, forwardPort)
+          && (!mirrorPort || swSocketAddressInitInet(&mirrorAddress, mirrorIPAddress.data, mirrorPort))
+          && (reactors = swMemoryCalloc(threadCount, sizeof(swSplicerReactor))))
       {
-        if ((splicerState = swSplicerStateNew(*loopPtr, &address, (size_t)bufferSize)))
-          rtn = true;
+        swSplicerConfig config = {.pipeSize = pipeSize, .pipePoolSize = pipePoolSize, .budget = spliceBudget,
+          .timeout = timeout, .connectTimeout = timeout, .statsInterval = statsInterval, .reusePort = (threadCount > 1)};
+        rtn = true;
+        for (reactorCount = 0; rtn && (reactorCount < threadCount); reactorCount++)
+          rtn = swSplicerReactorStart(&(reactors[reactorCount]), (reactorCount)? NULL : *loopPtr, *threadManagerPtr, &address, &forwardAddress,
+            (mirrorPort)? &mirrorAddress : NULL, &config);
+        if (rtn)
+          SW_LOG_INFO(&splicerLogger, "forwarding %.*s:%ld to %.*s:%ld with %u thread(s)", (int)(ipAddress.len), ipAddress.data, port,
+            (int)(forwardIPAddress.len), forwardIPAddress.data, forwardPort, reactorCount);
+        else
+        {
+          SW_LOG_ERROR(&splicerLogger, "failed to start splicer thread %u", reactorCount - 1);
+          swSplicerStop();
+        }
       }
     }
   }
@@ -70,9 +201,10 @@ static bool swSplicerStart()
 
 static swInitData splicerData = {.startFunc = swSplicerStart, .stopFunc = swSplicerStop, .name = "Splicer"};
 
-swInitData *swSpliceerDataGet(swEdgeLoop **loopPtr)
+swInitData *swSpliceerDataGet(swEdgeLoop **loopPtr, swThreadManager **threadManagerPtr)
 {
   splicerArrayData[0] = loopPtr;
+  splicerArrayData[1] = threadManagerPtr;
   return &splicerData;
 }
 
@@ -85,19 +217,19 @@ int main (int argc, char *argv[])
   uint64_t cpuTimerInterval = 1000;
   swInitData *initData[] =
   {
-    swInitCommandLineDataGet(&argc, argv, "Splice Tester", NULL),
+    swInitCommandLineDataGet(&argc, argv, "Splice Proxy", NULL),
     swInitIOEdgeLoopDataGet(&loop),
+    swInitClockDataGet(&loop),
     swInitIOEdgeSignalsDataGet(&loop, SIGINT, SIGHUP, SIGQUIT, SIGTERM, SIGUSR1, SIGUSR2, 0),
     swInitThreadManagerDataGet(&loop, &threadManager),
     swInitLogManagerDataGet(&threadManager),
     swInitCPUTimerGet(&loop, &cpuTimerInterval),
-    swSpliceerDataGet(&loop),
+    swSpliceerDataGet(&loop, &threadManager),
     NULL
   };
 
   if (swInitStart (initData))
   {
-    // printf ("IP address = %.*s, Port = %ld, Buffer Size = %ld\n", (int)(ipAddress.len), ipAddress.data, port, bufferSize);
     swEdgeLoopRun(loop, false);
     rtn = EXIT_SUCCESS;
     swInitStop(initData);
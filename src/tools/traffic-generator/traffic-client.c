@@ -17,6 +17,7 @@ static int64_t readTimeout       = 0;
 static int64_t writeTimeout      = 0;
 static int64_t connectTimeout    = 0;
 static int64_t reconnectInterval = 0;
+static int64_t statsInterval     = 0;
 
 swOptionCategoryModuleDeclare(swTrafficClientOptions, "Traffic Generator Client Options",
   swOptionDeclareArray("connect-ip",            "List of IP addresses that client should connect to",
@@ -35,10 +36,13 @@ swOptionCategoryModuleDeclare(swTrafficClientOptions, "Traffic Generator Client
   swOptionDeclareScalar("client-connect-timeout",     "Client connection connect timeout",
     NULL,   &connectTimeout,      swOptionValueTypeInt, false),
   swOptionDeclareScalar("client-reconnect-interval",  "Client connection write timeout",
-    NULL,   &reconnectInterval,   swOptionValueTypeInt, false)
+    NULL,   &reconnectInterval,   swOptionValueTypeInt, false),
+  swOptionDeclareScalar("client-stats-interval",      "TCP_INFO sample interval in milli seconds, 0 for the samples at close only",
+    NULL,   &statsInterval,       swOptionValueTypeInt, false)
 );
 
 static swDynamicArray *clientConnectionsData = NULL;
+static swSocketIOStats *clientStats = NULL;
 static uint32_t minMessageSize = 0;
 static uint32_t maxMessageSize = 0;
 
@@ -47,7 +51,7 @@ static bool swTrafficClientValidate()
   bool rtn = false;
   if (ipAddresses.count == ports.count && ports.count == connectionsPerPorts.count && connectionsPerPorts.count == sendIntervals.count &&
       ipAddresses.count <= UINT_MAX &&
-      readTimeout >= 0 && writeTimeout >= 0 && connectTimeout >= 0 && reconnectInterval >= 0)
+      readTimeout >= 0 && writeTimeout >= 0 && connectTimeout >= 0 && reconnectInterval >= 0 && statsInterval >= 0)
   {
     uint32_t i = 0;
     swStaticString *verifyIpAddresses = (swStaticString *)ipAddresses.data;
@@ -226,8 +230,11 @@ static bool swTrafficClientCreate(swEdgeLoop *loop, swTrafficConnectionData *con
         swTCPClientReadTimeoutFuncSet(client, onClientReadTimeout);
         swTCPClientWriteTimeoutFuncSet(client, onClientWriteTimeout);
         swTCPClientErrorFuncSet(client, onClientError);
+        swSocketIOTagSet(client, SW_TRAFFIC_TAG_CLIENT);
+        swEdgeLoopTagNameSet(loop, SW_TRAFFIC_TAG_CLIENT, "client");
+        swEdgeLoopTagNameSet(loop, SW_TRAFFIC_TAG_SEND_TIMER, "send timer");
 
-        if (swTCPClientStart(client, &address, loop, NULL))
+        if (swSocketIOStatsAdd(clientStats, (swSocketIO *)client) && swTCPClientStart(client, &address, loop, NULL))
         {
           if (swTrafficConnectionDataInit(connectionData, (swSocketIO *)client, onSendTimerCallback, sendInterval, maxMessageSize))
           {
@@ -278,6 +285,12 @@ static void swTrafficClientStop()
     swTrafficClientStorageDelete(clientConnectionsData);
     clientConnectionsData = NULL;
   }
+  if (clientStats)
+  {
+    swTrafficConnectionStatsLog(&trafficClientLogger, clientStats);
+    swSocketIOStatsDelete(clientStats);
+    clientStats = NULL;
+  }
 }
 
 static bool swTrafficClientStart()
@@ -293,7 +306,8 @@ static bool swTrafficClientStart()
       if (ipAddresses.count)
       {
         int64_t *connectionsPerPort = (int64_t *)connectionsPerPorts.data;
-        if ((clientConnectionsData = swTrafficClietStorageNew(ipAddresses.count, connectionsPerPort)))
+        if ((clientStats = swSocketIOStatsNew()) && swSocketIOStatsStart(clientStats, *loopPtr, statsInterval)
+            && (clientConnectionsData = swTrafficClietStorageNew(ipAddresses.count, connectionsPerPort)))
         {
           swStaticString *ipAddress = (swStaticString *)ipAddresses.data;
           int64_t *port = (int64_t *)ports.data;
@@ -325,6 +339,8 @@ static bool swTrafficClientStart()
           else
             swTrafficClientStop();
         }
+        else
+          swTrafficClientStop();
       }
       else
         rtn = true;
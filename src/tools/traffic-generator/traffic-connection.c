@@ -31,6 +31,7 @@ bool swTrafficConnectionDataInit(swTrafficConnectionData *connData, swSocketIO *
       if (!sendInterval || swEdgeTimerInit(&(connData->sendTimer), timerCB, true))
       {
         swEdgeWatcherDataSet(&(connData->sendTimer), connData);
+        swEdgeWatcherTagSet(&(connData->sendTimer), SW_TRAFFIC_TAG_SEND_TIMER);
         connData->sendInterval = sendInterval;
         connData->connection = connection;
         rtn = true;
@@ -92,3 +93,18 @@ void swTrafficConnectionDataSend(swTrafficConnectionData *connData, swSocketIO *
   }
 }
 
+
+void swTrafficConnectionStatsLog(swLogger *logger, swSocketIOStats *stats)
+{
+  const swSocketIOCounters *counters = swSocketIOStatsCountersGet(stats);
+  if (logger && counters)
+  {
+    SW_LOG_INFO(logger, "bytes read = %lu, written = %lu, reads = %lu, writes = %lu, syscalls = %lu, not ready reads = %lu, writes = %lu",
+      counters->bytesRead, counters->bytesWritten, counters->reads, counters->writes, counters->syscalls, counters->readNotReady, counters->writeNotReady);
+    SW_LOG_INFO(logger, "read timeouts = %lu, write timeouts = %lu, retransmits = %lu", counters->readTimeouts, counters->writeTimeouts, counters->retransmits);
+    if (stats->samples)
+      SW_LOG_INFO(logger, "tcp info samples = %lu, rtt p50 = %luus, p99 = %luus, rttvar p50 = %luus, cwnd p50 = %lu, delivery rate p50 = %lu bytes/s",
+        stats->samples, swHistogramPercentileGet(&(stats->rtt), 50.0), swHistogramPercentileGet(&(stats->rtt), 99.0), swHistogramPercentileGet(&(stats->rttVar), 50.0),
+        swHistogramPercentileGet(&(stats->cwnd), 50.0), swHistogramPercentileGet(&(stats->deliveryRate), 50.0));
+  }
+}
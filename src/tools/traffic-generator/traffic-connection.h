@@ -4,8 +4,15 @@
 #include "collections/dynamic-array.h"
 #include "io/edge-timer.h"
 #include "io/socket-io.h"
+#include "io/socket-io-stats.h"
+#include "log/log-manager.h"
 #include "storage/dynamic-buffer.h"
 
+// loop stats tags
+#define SW_TRAFFIC_TAG_CLIENT     1
+#define SW_TRAFFIC_TAG_SERVER     2
+#define SW_TRAFFIC_TAG_SEND_TIMER 3
+
 typedef struct swTrafficConnectionData
 {
   swSocketIO *connection;
@@ -28,4 +35,7 @@ void swTrafficConnectionDataDelete(swTrafficConnectionData *connData);
 void swTrafficConnectionDataRelease(swTrafficConnectionData *connData);
 void swTrafficConnectionDataSend(swTrafficConnectionData *connData, swSocketIO *connection, uint32_t minMessageSize);
 
+// counters and TCP_INFO samples of all the connections of the client or the server
+void swTrafficConnectionStatsLog(swLogger *logger, swSocketIOStats *stats);
+
 #endif  // SW_TOOLS_TRAFFICGENERATOR_TRAFFICCONNECTION_H
@@ -6,6 +6,7 @@
 #include "command-line/command-line.h"
 #include "init/init.h"
 #include "init/init-command-line.h"
+#include "init/init-clock.h"
 #include "init/init-cpu-timer.h"
 #include "init/init-io.h"
 #include "init/init-log-manager.h"
@@ -37,6 +38,7 @@ int main (int argc, char *argv[])
   {
     swInitCommandLineDataGet(&argc, argv, "Traffic Generator Program", NULL),
     swInitIOEdgeLoopDataGet(&loop),
+    swInitClockDataGet(&loop),
     swInitIOEdgeSignalsDataGet(&loop, SIGINT, SIGHUP, SIGQUIT, SIGTERM, SIGUSR1, SIGUSR2, 0),
     swInitThreadManagerDataGet(&loop, &threadManager),
     swInitLogManagerDataGet(&threadManager),
@@ -14,6 +14,7 @@ static swStaticArray sendIntervals        = swStaticArrayDefineEmpty;
 
 static int64_t readTimeout       = 0;
 static int64_t writeTimeout      = 0;
+static int64_t statsInterval     = 0;
 
 swOptionCategoryModuleDeclare(swTrafficServerOptions, "Traffic Generator Server Options",
 
@@ -27,10 +28,13 @@ swOptionCategoryModuleDeclare(swTrafficServerOptions, "Traffic Generator Server
   swOptionDeclareScalar("server-read-timeout",  "Server connection read timeout",
     NULL, &readTimeout,         swOptionValueTypeInt, false),
   swOptionDeclareScalar("server-write-timeout", "Server connection write timeout",
-    NULL, &writeTimeout,        swOptionValueTypeInt, false)
+    NULL, &writeTimeout,        swOptionValueTypeInt, false),
+  swOptionDeclareScalar("server-stats-interval", "TCP_INFO sample interval in milli seconds, 0 for the samples at close only",
+    NULL, &statsInterval,       swOptionValueTypeInt, false)
 );
 
 static swDynamicArray *serverAcceptorsData = NULL;
+static swSocketIOStats *serverStats = NULL;
 static uint32_t minMessageSize = 0;
 static uint32_t maxMessageSize = 0;
 
@@ -112,7 +116,7 @@ static bool swTrafficServerValidate()
   bool rtn = false;
   if (ipAddresses.count == ports.count && ports.count == sendIntervals.count &&
       ipAddresses.count <= UINT_MAX &&
-      readTimeout >= 0 && writeTimeout >= 0)
+      readTimeout >= 0 && writeTimeout >= 0 && statsInterval >= 0)
   {
     uint32_t i = 0;
     swStaticString *verifyIpAddresses = (swStaticString *)ipAddresses.data;
@@ -239,6 +243,8 @@ static bool onConnectionSetup(swTCPServerAcceptor *serverAcceptor, swTCPServer *
         swTCPServerWriteTimeoutFuncSet(server, onServerWriteTimeout);
         swTCPServerErrorFuncSet       (server, onServerError);
         swTCPServerCloseFuncSet       (server, onServerClose);
+        swSocketIOTagSet              (server, SW_TRAFFIC_TAG_SERVER);
+        swSocketIOStatsAdd            (serverStats, (swSocketIO *)server);
 
         swTrafficConnectionData **connections = (swTrafficConnectionData **)(acceptorData->serverConnections.data);
         swTrafficConnectionData *serverData = NULL;
@@ -303,6 +309,8 @@ swTCPServerAcceptor *swTrafficServerNew(swEdgeLoop *loop, swTrafficAcceptorData
         swTCPServerAcceptorErrorFuncSet   (serverAcceptor, onError);
         swTCPServerAcceptorSetupFuncSet   (serverAcceptor, onConnectionSetup);
 
+        swEdgeLoopTagNameSet(loop, SW_TRAFFIC_TAG_SERVER, "server");
+        swEdgeLoopTagNameSet(loop, SW_TRAFFIC_TAG_SEND_TIMER, "send timer");
         if (swTCPServerAcceptorStart(serverAcceptor, loop, &address))
         {
           swTCPServerAcceptorDataSet(serverAcceptor, acceptorData);
@@ -353,6 +361,12 @@ static void swTrafficServerStop()
     swTrafficServerStorageDelete(serverAcceptorsData);
     serverAcceptorsData = NULL;
   }
+  if (serverStats)
+  {
+    swTrafficConnectionStatsLog(&trafficServerLogger, serverStats);
+    swSocketIOStatsDelete(serverStats);
+    serverStats = NULL;
+  }
 }
 
 static bool swTrafficServerStart()
@@ -367,7 +381,8 @@ static bool swTrafficServerStart()
     {
       if (ipAddresses.count)
       {
-        if ((serverAcceptorsData = swTrafficServerStorageNew(ipAddresses.count)))
+        if ((serverStats = swSocketIOStatsNew()) && swSocketIOStatsStart(serverStats, *loopPtr, statsInterval)
+            && (serverAcceptorsData = swTrafficServerStorageNew(ipAddresses.count)))
         {
           swStaticString *ipAddress = (swStaticString *)ipAddresses.data;
           int64_t *port = (int64_t *)ports.data;
@@ -391,6 +406,8 @@ static bool swTrafficServerStart()
           else
             swTrafficServerStop();
         }
+        else
+          swTrafficServerStop();
       }
       else
         rtn = true;